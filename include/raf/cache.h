@@ -9,10 +9,18 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <dmlc/memory_io.h>
 #include <sys/stat.h>
 #include "./file.h"
+#include "./persist_cache_store.h"
 #include "./op.h"
 #include "./value.h"
 
@@ -149,10 +157,45 @@ class HashKey {
 #undef RAF_DEF_PRIMITIVE
 #undef RAF_APPEND_BYTES
 
+/*! \brief The default number of shards of a MetaCache. */
+constexpr size_t kDefaultMetaCacheShards = 16;
+/*! \brief The number of reader slots of a shard, which are assigned to the threads in turn. */
+constexpr size_t kMetaCacheReaderSlots = 16;
+/*! \brief The initial number of buckets of a shard, which must be a power of 2. */
+constexpr size_t kMetaCacheInitialBuckets = 16;
+/*! \brief The number of entries sampled to pick the one to evict from a full shard. */
+constexpr size_t kMetaCacheEvictionSamples = 8;
+
+/*!
+ * \brief A thread-safe cache from keys to values.
+ *
+ * The keys are partitioned into shards by their hash, and each shard is a chained hash table
+ * whose buckets and chains are published through atomic pointers. A lookup never takes a lock:
+ * it registers in a reader slot of the shard and walks the chain of its bucket. The threads are
+ * assigned to the slots in turn, and each slot has its own cache line, so concurrent cache hits
+ * rarely write to the same cache line. An insertion links a new node under the lock of the
+ * shard, and doubles the buckets when the shard is full, so it takes amortized constant time.
+ * The nodes and buckets unlinked by an eviction or a rehash are freed once no reader of the
+ * shard is observed. This favors the caches in RAF, which are written once per compiled kernel
+ * and read on every dispatch.
+ *
+ * When a capacity is given, each shard keeps at most its share of the capacity. An insertion into
+ * a full shard evicts the least recently used one of a few sampled entries, which approximates
+ * LRU without ordering the entries on each hit. The values are returned as shared pointers, so
+ * they stay valid even if the entries are evicted.
+ */
 template <typename T>
 class MetaCache {
  public:
-  ~MetaCache() = default;
+  /*!
+   * \brief Create a cache.
+   * \param capacity The maximum number of entries, or 0 for an unbounded cache.
+   * \param num_shards The number of shards. Use 1 for small caches that are rarely contended.
+   */
+  explicit MetaCache(size_t capacity = 0, size_t num_shards = kDefaultMetaCacheShards)
+      : num_shards_(std::max<size_t>(num_shards, 1)), shards_(new Shard[num_shards_]) {
+    shard_capacity_ = capacity == 0 ? 0 : (capacity + num_shards_ - 1) / num_shards_;
+  }
 
   bool Has(const std::vector<uint8_t>& key) {
     const std::string key_str(key.begin(), key.end());
@@ -160,22 +203,28 @@ class MetaCache {
   }
 
   bool Has(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mu_);
-    return cached_.count(key);
+    const size_t hash = std::hash<std::string>{}(key);
+    Shard& shard = GetShard(hash);
+    ReaderGuard guard(&shard);
+    return Find(&shard, hash, key) != nullptr;
   }
 
-  const T* Get(const std::vector<uint8_t>& key) {
+  std::shared_ptr<const T> GetShared(const std::vector<uint8_t>& key) {
     const std::string key_str(key.begin(), key.end());
-    return Get(key_str);
+    return GetShared(key_str);
   }
 
-  const T* Get(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mu_);
-    auto iter = cached_.find(key);
-    if (iter == cached_.end()) {
+  /*! \brief Get the value of the key, which stays valid even if the entry is evicted. */
+  std::shared_ptr<const T> GetShared(const std::string& key) {
+    const size_t hash = std::hash<std::string>{}(key);
+    Shard& shard = GetShard(hash);
+    ReaderGuard guard(&shard);
+    const Node* node = Find(&shard, hash, key);
+    if (node == nullptr) {
       return nullptr;
     }
-    return &iter->second;
+    Touch(&shard, node->entry.get());
+    return std::shared_ptr<const T>(node->entry, &node->entry->value);
   }
 
   void Set(const std::vector<uint8_t>& key, T val) {
@@ -184,20 +233,303 @@ class MetaCache {
   }
 
   void Set(const std::string& key, T val) {
-    std::lock_guard<std::mutex> lock(mu_);
-    auto iter = cached_.find(key);
-    if (iter != cached_.end()) {
+    if (!TrySet(key, std::move(val))) {
       LOG(FATAL) << "KeyError: The key is already cached!";
       throw;
     }
-    cached_.emplace(key, val);
+  }
+
+  bool TrySet(const std::vector<uint8_t>& key, T val) {
+    const std::string key_str(key.begin(), key.end());
+    return TrySet(key_str, std::move(val));
+  }
+
+  /*!
+   * \brief Cache the value unless the key is already cached, which happens when another thread
+   * builds the same value concurrently.
+   * \return Whether the value is cached by this call.
+   */
+  bool TrySet(const std::string& key, T val) {
+    const size_t hash = std::hash<std::string>{}(key);
+    Shard& shard = GetShard(hash);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    if (Find(&shard, hash, key) != nullptr) {
+      return false;
+    }
+    Buckets* buckets = shard.buckets.load(std::memory_order_relaxed);
+    if (buckets == nullptr || shard.size.load(std::memory_order_relaxed) >= buckets->size) {
+      buckets = Rehash(&shard, buckets);
+    }
+    Node* node = new Node(hash, std::make_shared<Entry>(key, std::move(val)));
+    Touch(&shard, node->entry.get());
+    auto& head = buckets->heads[BucketIndex(hash, buckets)];
+    node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    head.store(node, std::memory_order_release);
+    shard.size.fetch_add(1, std::memory_order_relaxed);
+    while (shard_capacity_ > 0 && shard.size.load(std::memory_order_relaxed) > shard_capacity_) {
+      Unlink(&shard, buckets, PickVictim(&shard, buckets));
+      shard.size.fetch_sub(1, std::memory_order_relaxed);
+      num_evicted_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Reclaim(&shard);
+    return true;
+  }
+
+  /*! \brief Remove all entries. The values held by the callers stay valid. */
+  void Clear() {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      Shard& shard = shards_[i];
+      std::lock_guard<std::mutex> lock(shard.mu);
+      // The retired buckets free their nodes once no reader is observed.
+      if (Buckets* buckets = shard.buckets.exchange(nullptr)) {
+        shard.retired_buckets.emplace_back(buckets);
+      }
+      shard.size.store(0, std::memory_order_relaxed);
+      Reclaim(&shard);
+    }
+  }
+
+  /*! \brief Get a snapshot of all cached entries. */
+  std::vector<std::pair<std::string, std::shared_ptr<const T>>> Entries() {
+    std::vector<std::pair<std::string, std::shared_ptr<const T>>> ret;
+    for (size_t i = 0; i < num_shards_; ++i) {
+      ReaderGuard guard(&shards_[i]);
+      const Buckets* buckets = shards_[i].buckets.load();
+      for (size_t b = 0; buckets != nullptr && b < buckets->size; ++b) {
+        for (const Node* node = buckets->heads[b].load(); node != nullptr;
+             node = node->next.load(std::memory_order_acquire)) {
+          ret.emplace_back(node->entry->key,
+                           std::shared_ptr<const T>(node->entry, &node->entry->value));
+        }
+      }
+    }
+    return ret;
+  }
+
+  /*! \brief The number of cached entries. */
+  size_t Size() {
+    size_t size = 0;
+    for (size_t i = 0; i < num_shards_; ++i) {
+      size += shards_[i].size.load(std::memory_order_relaxed);
+    }
+    return size;
+  }
+
+  /*! \brief The number of entries evicted due to the capacity. */
+  size_t NumEvicted() const {
+    return num_evicted_.load(std::memory_order_relaxed);
   }
 
  private:
-  /*! \brief The cache mapping from string key to value. */
-  std::unordered_map<std::string, T> cached_;
-  /*! \brief The thread-safe lock. */
-  std::mutex mu_;
+  /*! \brief A cached value and its last use for the eviction. */
+  struct Entry {
+    Entry(std::string k, T v) : key(std::move(k)), value(std::move(v)) {
+    }
+    const std::string key;
+    T value;
+    std::atomic<uint64_t> last_use{0};
+  };
+
+  /*! \brief A node of a chain, which is immutable once linked except for the next pointer. */
+  struct Node {
+    Node(size_t hash, std::shared_ptr<Entry> entry) : hash(hash), entry(std::move(entry)) {
+    }
+    const size_t hash;
+    const std::shared_ptr<Entry> entry;
+    std::atomic<Node*> next{nullptr};
+  };
+
+  /*! \brief The buckets of a shard, which own the nodes linked from them. */
+  struct Buckets {
+    explicit Buckets(size_t size) : size(size), heads(new std::atomic<Node*>[size]) {
+      for (size_t i = 0; i < size; ++i) {
+        heads[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    ~Buckets() {
+      for (size_t i = 0; i < size; ++i) {
+        for (Node* node = heads[i].load(std::memory_order_relaxed); node != nullptr;) {
+          Node* next = node->next.load(std::memory_order_relaxed);
+          delete node;
+          node = next;
+        }
+      }
+    }
+    const size_t size;
+    std::unique_ptr<std::atomic<Node*>[]> heads;
+  };
+
+  /*! \brief A counter of the readers, which is padded to a cache line. */
+  struct ReaderSlot {
+    std::atomic<int64_t> count{0};
+    char padding[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  struct Shard {
+    ~Shard() {
+      delete buckets.load();
+    }
+    /*! \brief The published buckets. */
+    std::atomic<Buckets*> buckets{nullptr};
+    /*! \brief The number of entries. */
+    std::atomic<size_t> size{0};
+    /*! \brief The logical clock of the eviction, which only advances in bounded caches. */
+    std::atomic<uint64_t> clock{0};
+    /*! \brief The state of the random sampling of the eviction. */
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+    /*! \brief The lock of the writers. */
+    std::mutex mu;
+    /*! \brief The counters of the readers. */
+    ReaderSlot readers[kMetaCacheReaderSlots];
+    /*! \brief The unlinked nodes and buckets that may still be read. */
+    std::vector<std::unique_ptr<Node>> retired_nodes;
+    std::vector<std::unique_ptr<Buckets>> retired_buckets;
+  };
+
+  /*! \brief Register a reader of a shard for the lifetime of the guard. */
+  struct ReaderGuard {
+    explicit ReaderGuard(Shard* shard) : slot(&shard->readers[ThreadReaderSlot()]) {
+      slot->count.fetch_add(1);
+    }
+    ~ReaderGuard() {
+      slot->count.fetch_sub(1, std::memory_order_release);
+    }
+    ReaderSlot* slot;
+  };
+
+  /*! \brief The reader slot of the calling thread. */
+  static size_t ThreadReaderSlot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot =
+        next_slot.fetch_add(1, std::memory_order_relaxed) % kMetaCacheReaderSlots;
+    return slot;
+  }
+
+  inline Shard& GetShard(size_t hash) {
+    return num_shards_ == 1 ? shards_[0] : shards_[hash % num_shards_];
+  }
+
+  inline size_t BucketIndex(size_t hash, const Buckets* buckets) const {
+    return (hash / num_shards_) & (buckets->size - 1);
+  }
+
+  /*!
+   * \brief Find the node of the key. The caller must be a registered reader or hold the lock of
+   * the shard.
+   */
+  inline const Node* Find(Shard* shard, size_t hash, const std::string& key) {
+    const Buckets* buckets = shard->buckets.load();
+    if (buckets == nullptr) {
+      return nullptr;
+    }
+    for (const Node* node = buckets->heads[BucketIndex(hash, buckets)].load(); node != nullptr;
+         node = node->next.load(std::memory_order_acquire)) {
+      if (node->hash == hash && node->entry->key == key) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  inline void Touch(Shard* shard, Entry* entry) {
+    if (shard_capacity_ > 0) {
+      const uint64_t now = shard->clock.fetch_add(1, std::memory_order_relaxed) + 1;
+      entry->last_use.store(now, std::memory_order_relaxed);
+    }
+  }
+
+  /*!
+   * \brief Publish twice as many buckets, which link copies of the nodes, and retire the old
+   * ones. The caller must hold the lock of the shard.
+   */
+  Buckets* Rehash(Shard* shard, Buckets* old_buckets) {
+    auto* buckets = new Buckets(old_buckets ? old_buckets->size * 2 : kMetaCacheInitialBuckets);
+    if (old_buckets != nullptr) {
+      for (size_t b = 0; b < old_buckets->size; ++b) {
+        for (Node* node = old_buckets->heads[b].load(std::memory_order_relaxed); node != nullptr;
+             node = node->next.load(std::memory_order_relaxed)) {
+          Node* copy = new Node(node->hash, node->entry);
+          auto& head = buckets->heads[BucketIndex(node->hash, buckets)];
+          copy->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+          head.store(copy, std::memory_order_relaxed);
+        }
+      }
+      shard->retired_buckets.emplace_back(old_buckets);
+    }
+    shard->buckets.store(buckets);
+    return buckets;
+  }
+
+  /*!
+   * \brief Pick the least recently used one of the sampled nodes, or of all nodes if the shard
+   * is small. The caller must hold the lock of the shard.
+   */
+  Node* PickVictim(Shard* shard, Buckets* buckets) {
+    Node* victim = nullptr;
+    size_t num_sampled = 0;
+    auto sample_chain = [&](size_t b) {
+      for (Node* node = buckets->heads[b].load(std::memory_order_relaxed); node != nullptr;
+           node = node->next.load(std::memory_order_relaxed)) {
+        if (victim == nullptr || node->entry->last_use.load(std::memory_order_relaxed) <
+                                     victim->entry->last_use.load(std::memory_order_relaxed)) {
+          victim = node;
+        }
+        num_sampled++;
+      }
+    };
+    if (shard->size.load(std::memory_order_relaxed) > kMetaCacheEvictionSamples) {
+      // The load factor is at least 1/2, so a few random buckets cover enough samples.
+      const size_t max_tries = 4 * kMetaCacheEvictionSamples;
+      for (size_t i = 0; i < max_tries && num_sampled < kMetaCacheEvictionSamples; ++i) {
+        shard->rng ^= shard->rng << 13;
+        shard->rng ^= shard->rng >> 7;
+        shard->rng ^= shard->rng << 17;
+        sample_chain(shard->rng & (buckets->size - 1));
+      }
+    }
+    for (size_t b = 0; victim == nullptr && b < buckets->size; ++b) {
+      sample_chain(b);
+    }
+    return victim;
+  }
+
+  /*! \brief Unlink the node and retire it. The caller must hold the lock of the shard. */
+  void Unlink(Shard* shard, Buckets* buckets, Node* node) {
+    std::atomic<Node*>* link = &buckets->heads[BucketIndex(node->hash, buckets)];
+    while (link->load(std::memory_order_relaxed) != node) {
+      link = &link->load(std::memory_order_relaxed)->next;
+    }
+    link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+    shard->retired_nodes.emplace_back(node);
+  }
+
+  /*!
+   * \brief Free the retired nodes and buckets if no reader of the shard is observed. A reader
+   * that registers after this check only finds the published nodes. The caller must hold the
+   * lock of the shard.
+   */
+  void Reclaim(Shard* shard) {
+    if (shard->retired_nodes.empty() && shard->retired_buckets.empty()) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (const auto& slot : shard->readers) {
+      if (slot.count.load() != 0) {
+        return;
+      }
+    }
+    shard->retired_nodes.clear();
+    shard->retired_buckets.clear();
+  }
+
+  /*! \brief The number of shards. */
+  size_t num_shards_;
+  /*! \brief The shards. */
+  std::unique_ptr<Shard[]> shards_;
+  /*! \brief The maximum number of entries of a shard, or 0 if unbounded. */
+  size_t shard_capacity_;
+  /*! \brief The number of evicted entries. */
+  std::atomic<size_t> num_evicted_{0};
 };
 
 class MetaCacheMetric {
@@ -205,10 +537,140 @@ class MetaCacheMetric {
   virtual std::unordered_map<std::string, size_t> GetMetric() = 0;
 };
 
+/*!
+ * \brief The interface to export and import the entries of a persistent cache, e.g., to bundle
+ * the compiled kernels with an executable. The persistent caches register themselves by name.
+ */
+class MetaCacheSerializer {
+ public:
+  virtual ~MetaCacheSerializer() = default;
+
+  /*! \brief Export the entries as pairs of the key and the packed files saved by the value. */
+  virtual std::vector<std::pair<std::string, std::string>> Export() = 0;
+
+  /*! \brief Export the entries of the given keys that are cached. */
+  virtual std::vector<std::pair<std::string, std::string>> Export(
+      const std::vector<std::string>& keys) = 0;
+
+  /*!
+   * \brief Import the exported entries, skipping the keys that are already cached.
+   * \return The number of imported entries.
+   */
+  virtual size_t Import(const std::vector<std::pair<std::string, std::string>>& entries) = 0;
+
+  /*! \brief Get the registered persistent caches, sorted by name. */
+  static std::vector<std::pair<std::string, MetaCacheSerializer*>> List() {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    std::vector<std::pair<std::string, MetaCacheSerializer*>> ret(Registry().begin(),
+                                                                  Registry().end());
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  /*! \brief Get a registered persistent cache by name, or nullptr if it does not exist. */
+  static MetaCacheSerializer* Get(const std::string& name) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    auto it = Registry().find(name);
+    return it == Registry().end() ? nullptr : it->second;
+  }
+
+ protected:
+  static void Register(const std::string& name, MetaCacheSerializer* cache) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    Registry()[name] = cache;
+  }
+
+  static void Unregister(const std::string& name, MetaCacheSerializer* cache) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    auto it = Registry().find(name);
+    if (it != Registry().end() && it->second == cache) {
+      Registry().erase(it);
+    }
+  }
+
+ private:
+  static std::unordered_map<std::string, MetaCacheSerializer*>& Registry() {
+    static std::unordered_map<std::string, MetaCacheSerializer*> registry;
+    return registry;
+  }
+
+  static std::mutex& RegistryMutex() {
+    static std::mutex mu;
+    return mu;
+  }
+};
+
+/*!
+ * \brief Records the keys of the persistent caches that the current thread looks up or sets
+ * while the recorder is in scope, e.g., to find the kernels used by an OpEnv. The recorders
+ * nest, and a key is recorded by all of them.
+ */
+class MetaCacheKeyRecorder {
+ public:
+  /*! \brief Pairs of the cache name and the key. */
+  using Keys = std::vector<std::pair<std::string, std::string>>;
+
+  MetaCacheKeyRecorder() : prev_(Current()) {
+    Current() = this;
+  }
+
+  ~MetaCacheKeyRecorder() {
+    Current() = prev_;
+  }
+
+  MetaCacheKeyRecorder(const MetaCacheKeyRecorder&) = delete;
+  MetaCacheKeyRecorder& operator=(const MetaCacheKeyRecorder&) = delete;
+
+  /*! \brief Record a key of a persistent cache to the recorders of the current thread. */
+  static void Record(const std::string& cache_name, const std::string& key) {
+    for (auto* recorder = Current(); recorder != nullptr; recorder = recorder->prev_) {
+      recorder->keys_.emplace_back(cache_name, key);
+    }
+  }
+
+  /*! \brief Take the recorded keys. */
+  Keys TakeKeys() {
+    return std::move(keys_);
+  }
+
+ private:
+  static MetaCacheKeyRecorder*& Current() {
+    static thread_local MetaCacheKeyRecorder* current = nullptr;
+    return current;
+  }
+
+  /*! \brief The enclosing recorder. */
+  MetaCacheKeyRecorder* prev_;
+  Keys keys_;
+};
+
+/*!
+ * \brief Get the capacity of the persistent caches from RAF_CACHE_CAPACITY. Returns 0, i.e.,
+ * unbounded, if it is not set.
+ */
+inline size_t GetMetaCacheCapacityFromEnv() {
+  const char* capacity = getenv("RAF_CACHE_CAPACITY");
+  return capacity == nullptr ? 0 : std::stoull(capacity);
+}
+
 template <typename T>
-class MetaPersistCache : public MetaCache<T>, public MetaCacheMetric {
+class MetaPersistCache : public MetaCache<T>, public MetaCacheMetric, public MetaCacheSerializer {
  public:
-  MetaPersistCache(const std::string persist_name) : persist_name_(persist_name) {
+  /*!
+   * \brief Create a persistent cache.
+   * \param persist_name The name of the cache, which is also its directory in the persistent
+   * storage.
+   * \param capacity The maximum number of entries in memory, or 0 for an unbounded cache.
+   * \param bundled Whether the entries used by an executable are bundled with it, which is the
+   * case for the compiled kernels but not for the measurements.
+   */
+  MetaPersistCache(const std::string persist_name, size_t capacity = GetMetaCacheCapacityFromEnv(),
+                   bool bundled = true)
+      : MetaCache<T>(capacity), persist_name_(persist_name), bundled_(bundled) {
+    if (bundled_) {
+      MetaCacheSerializer::Register(persist_name_, this);
+    }
+
     // Enable persistent by users.
     const char* enable_persist = getenv("RAF_PERSIST_CACHE");
     if (enable_persist != nullptr && strcmp(enable_persist, "1") == 0) {
@@ -231,24 +693,33 @@ class MetaPersistCache : public MetaCache<T>, public MetaCacheMetric {
     CreateDir(cache_path);
     path_ = cache_path + "/" + persist_name_;
 
-    // Create the directory for this cache.
-    CreateDir(path_);
+    // Open the store of this cache, which is bounded by RAF_PERSIST_CACHE_MAX_BYTES and
+    // RAF_PERSIST_CACHE_MAX_AGE (in seconds) if given.
+    const char* max_bytes = getenv("RAF_PERSIST_CACHE_MAX_BYTES");
+    const char* max_age = getenv("RAF_PERSIST_CACHE_MAX_AGE");
+    store_ = std::make_unique<PersistCacheStore>(path_, max_bytes ? std::stoll(max_bytes) : 0,
+                                                 max_age ? std::stoll(max_age) : 0);
+  }
+
+  ~MetaPersistCache() {
+    MetaCacheSerializer::Unregister(persist_name_, this);
   }
 
-  const T* Get(const std::vector<uint8_t>& key) {
+  std::shared_ptr<const T> GetShared(const std::vector<uint8_t>& key) {
     const std::string key_str(key.begin(), key.end());
-    return Get(key_str);
+    return GetShared(key_str);
   }
 
-  const T* Get(const std::string& key) {
-    AddMetric("CacheGet", 1);
+  std::shared_ptr<const T> GetShared(const std::string& key) {
+    AddMetric(kCacheGet);
 
     // Cache hit.
-    if (auto val = MetaCache<T>::Get(key)) {
-      AddMetric("CacheHit", 1);
+    if (auto val = MetaCache<T>::GetShared(key)) {
+      AddMetric(kCacheHit);
+      RecordKey(key);
       return val;
     }
-    AddMetric("CacheMiss", 1);
+    AddMetric(kCacheMiss);
     if (!persist_) {
       return nullptr;
     }
@@ -256,24 +727,33 @@ class MetaPersistCache : public MetaCache<T>, public MetaCacheMetric {
     // Cache miss, try to load from the persistent cache.
     std::lock_guard<std::mutex> lock(mu_);
 
-    auto persist_path = GetPersistPath(key);
-
-    // Persistent cache miss.
-    if (!DirExists(persist_path)) {
-      AddMetric("PersistCacheMiss", 1);
-      return nullptr;
+    // The entry may have been loaded by another thread while waiting for the lock.
+    if (auto val = MetaCache<T>::GetShared(key)) {
+      RecordKey(key);
+      return val;
     }
-    AddMetric("PersistCacheHit", 1);
 
     try {
-      MetaCache<T>::Set(key, T::Load(persist_path));
-      return MetaCache<T>::Get(key);
+      std::unique_ptr<T> loaded;
+      auto result = store_->Load(key, [&loaded](const std::string& dir) {
+        loaded = std::make_unique<T>(T::Load(dir));
+      });
+      if (result == PersistCacheStore::LoadResult::kCollision) {
+        AddMetric(kPersistCacheCollision);
+      }
+      if (result != PersistCacheStore::LoadResult::kHit) {
+        AddMetric(kPersistCacheMiss);
+        return nullptr;
+      }
+      AddMetric(kPersistCacheHit);
+      MetaCache<T>::TrySet(key, std::move(*loaded));
+      RecordKey(key);
+      return MetaCache<T>::GetShared(key);
     } catch (dmlc::Error& e) {
-      AddMetric("PersistCacheLoadFailure", 1);
+      AddMetric(kPersistCacheLoadFailure);
       LOG(WARNING) << "Failed to load persist entry " << path_ << ": " << e.what();
       return nullptr;
     }
-    return nullptr;
   }
 
   void Set(const std::vector<uint8_t>& key, T val) {
@@ -282,57 +762,168 @@ class MetaPersistCache : public MetaCache<T>, public MetaCacheMetric {
   }
 
   void Set(const std::string& key, T val) {
-    AddMetric("CacheSet", 1);
+    AddMetric(kCacheSet);
     MetaCache<T>::Set(key, val);
-    if (!persist_) {
-      return;
-    }
+    RecordKey(key);
+    Persist(key, val);
+  }
 
-    std::lock_guard<std::mutex> lock(mu_);
+  bool TrySet(const std::vector<uint8_t>& key, T val) {
+    const std::string key_str(key.begin(), key.end());
+    return TrySet(key_str, val);
+  }
 
-    auto persist_path = GetPersistPath(key);
-    CreateDir(persist_path);
+  /*! \brief Cache the value unless the key is already cached, and persist it if it is cached. */
+  bool TrySet(const std::string& key, T val) {
+    AddMetric(kCacheSet);
+    // The key is recorded either way, as it is cached by this or another thread.
+    RecordKey(key);
+    if (!MetaCache<T>::TrySet(key, val)) {
+      return false;
+    }
+    Persist(key, val);
+    return true;
+  }
 
-    // Persist the cache value.
-    try {
-      if (!val.Save(persist_path)) {
-        throw;
+  std::vector<std::pair<std::string, std::string>> Export() override {
+    std::vector<std::pair<std::string, std::string>> ret;
+    for (const auto& it : MetaCache<T>::Entries()) {
+      ExportEntry(it.first, *it.second, &ret);
+    }
+    return ret;
+  }
+
+  std::vector<std::pair<std::string, std::string>> Export(
+      const std::vector<std::string>& keys) override {
+    std::vector<std::pair<std::string, std::string>> ret;
+    for (const auto& key : keys) {
+      if (auto val = MetaCache<T>::GetShared(key)) {
+        ExportEntry(key, *val, &ret);
       }
-    } catch (dmlc::Error& e) {
-      AddMetric("PersistCacheSaveFailure", 1);
-      LOG(WARNING) << "Failed to persist cache entry to " << path_ << ": " << e.what();
-      return;
     }
+    return ret;
+  }
 
-    std::ofstream metadata_file(persist_path + "/timestamp");
-    metadata_file << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())
-                  << std::endl;
-    metadata_file.close();
+  size_t Import(const std::vector<std::pair<std::string, std::string>>& entries) override {
+    size_t num_imported = 0;
+    for (const auto& it : entries) {
+      if (MetaCache<T>::Has(it.first)) {
+        continue;
+      }
+      ScratchDir dir;
+      try {
+        if (UnpackDirectory(it.second.data(), it.second.size(), dir.path())) {
+          // Another thread may have cached the key in the meantime, which is kept.
+          if (MetaCache<T>::TrySet(it.first, T::Load(dir.path()))) {
+            num_imported++;
+          }
+          continue;
+        }
+      } catch (dmlc::Error& e) {
+        LOG(WARNING) << e.what();
+      }
+      LOG(WARNING) << "Failed to import an entry of cache " << persist_name_;
+    }
+    return num_imported;
   }
 
   std::unordered_map<std::string, size_t> GetMetric() override {
-    return metrics_;
+    static const char* names[] = {"CacheGet",
+                                  "CacheHit",
+                                  "CacheMiss",
+                                  "CacheSet",
+                                  "PersistCacheHit",
+                                  "PersistCacheMiss",
+                                  "PersistCacheLoadFailure",
+                                  "PersistCacheSaveFailure",
+                                  "PersistCacheCollision"};
+    static_assert(sizeof(names) / sizeof(names[0]) == kNumMetrics, "Missing metric names");
+    std::unordered_map<std::string, size_t> ret;
+    for (int i = 0; i < kNumMetrics; ++i) {
+      size_t val = metrics_[i].load(std::memory_order_relaxed);
+      if (val > 0) {
+        ret[names[i]] = val;
+      }
+    }
+    if (size_t num_evicted = MetaCache<T>::NumEvicted()) {
+      ret["CacheEvict"] = num_evicted;
+    }
+    return ret;
   }
 
  private:
-  inline std::string GetPersistPath(const std::string& key) {
-    const size_t hashed_key = std::hash<std::string>{}(key);
-    return path_ + "/" + std::to_string(hashed_key);
+  /*! \brief The kinds of cache metrics. */
+  enum Metric {
+    kCacheGet = 0,
+    kCacheHit,
+    kCacheMiss,
+    kCacheSet,
+    kPersistCacheHit,
+    kPersistCacheMiss,
+    kPersistCacheLoadFailure,
+    kPersistCacheSaveFailure,
+    kPersistCacheCollision,
+    kNumMetrics
+  };
+
+  inline void AddMetric(Metric metric) {
+    metrics_[metric].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /*! \brief Record a key used by the current thread if the entries are bundled. */
+  inline void RecordKey(const std::string& key) {
+    if (bundled_) {
+      MetaCacheKeyRecorder::Record(persist_name_, key);
+    }
+  }
+
+  /*! \brief Pack the files saved by a value and append them to the exported entries. */
+  void ExportEntry(const std::string& key, T val,
+                   std::vector<std::pair<std::string, std::string>>* entries) {
+    ScratchDir dir;
+    std::string packed;
+    try {
+      if (val.Save(dir.path()) && PackDirectory(dir.path(), &packed)) {
+        entries->emplace_back(key, std::move(packed));
+        return;
+      }
+    } catch (dmlc::Error& e) {
+      LOG(WARNING) << e.what();
+    }
+    LOG(WARNING) << "Failed to export an entry of cache " << persist_name_;
   }
 
-  inline void AddMetric(const std::string name, size_t val) {
-    metrics_[name] += val;
+  /*! \brief Save the value to the persistent storage if it is enabled. */
+  void Persist(const std::string& key, T& val) {
+    if (!persist_) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+    try {
+      if (!store_->Save(key, [&val](const std::string& dir) { return val.Save(dir); })) {
+        AddMetric(kPersistCacheSaveFailure);
+        LOG(WARNING) << "Failed to persist cache entry to " << path_;
+      }
+    } catch (dmlc::Error& e) {
+      AddMetric(kPersistCacheSaveFailure);
+      LOG(WARNING) << "Failed to persist cache entry to " << path_ << ": " << e.what();
+    }
   }
 
   /*! \brief The cache metrics for analysis. */
-  std::unordered_map<std::string, size_t> metrics_;
+  std::atomic<size_t> metrics_[kNumMetrics] = {};
   /*! \brief Persist directory name. */
   std::string persist_name_;
+  /*! \brief Whether the entries are bundled with the executables. */
+  bool bundled_;
   /*! \brief Persist directory path. */
   std::string path_;
   /*! \brief Whether to presist values. */
   bool persist_ = false;
-  /*! \brief The thread-safe lock. */
+  /*! \brief The on-disk store of the persisted values. */
+  std::unique_ptr<PersistCacheStore> store_;
+  /*! \brief The thread-safe lock of the persistent storage. */
   std::mutex mu_;
 };
 
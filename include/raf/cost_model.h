@@ -0,0 +1,104 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file cost_model.h
+ * \brief The cost models to estimate the latency of ops for the compilation passes, such as
+ * rematerialization and stream scheduling.
+ */
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "raf/device.h"
+#include "raf/ir.h"
+
+namespace raf {
+namespace cost_model {
+
+using namespace raf::ir;
+
+/*! \brief The estimated cost of an op. */
+struct OpCost {
+  /*! \brief The latency in microseconds. */
+  float latency = 0.0f;
+  /*! \brief The workspace size in bytes, or 0 if unknown. */
+  int64_t workspace_size = 0;
+};
+
+/*!
+ * \brief The base class of the cost models. A cost model is created by the global function
+ * "raf.cost_model._make.<name>", which takes the target device and the options, and returns a
+ * pointer to a new cost model, so more cost models can be plugged in without touching the passes.
+ */
+class CostModel {
+ public:
+  /*!
+   * \brief Create a cost model by name.
+   * \param name The name of the cost model, e.g., "profiler" or "roofline".
+   * \param device The target device.
+   * \param options The options of the cost model, e.g., "warmup", "number" and "repeat" of the
+   * profiler cost model.
+   * \return The cost model.
+   */
+  static std::shared_ptr<CostModel> Make(const std::string& name, const Device& device,
+                                         Map<String, ObjectRef> options = {});
+
+  virtual ~CostModel() {
+  }
+
+  /*!
+   * \brief Estimate the cost of an op.
+   * \param op The type-inferred op, which is a call to an op or a fused function. Other
+   * expressions, e.g., tuples, have no cost.
+   * \return The estimated cost.
+   */
+  virtual OpCost EstimateOp(const Expr& op) = 0;
+
+  /*!
+   * \brief Estimate the latency of a stage, whose groups of ops are launched on different
+   * streams and the ops in a group run one after another.
+   * \param groups The groups of ops.
+   * \return The latency samples of the stage in microseconds.
+   */
+  virtual std::vector<float> EstimateStage(const std::vector<std::vector<Expr>>& groups) = 0;
+};
+
+using CostModelPtr = std::shared_ptr<CostModel>;
+
+/*! \brief The performance limits of a device, which bound the latency of each op. */
+struct Roofline {
+  /*! \brief The peak compute throughput in GFLOPS. */
+  double peak_gflops = 0.0;
+  /*! \brief The peak memory bandwidth in GB/s. */
+  double bandwidth_gbps = 0.0;
+  /*! \brief The fixed overhead of launching an op in microseconds. */
+  double launch_overhead_us = 0.0;
+
+  /*!
+   * \brief Get the roofline of a device. The configs "raf.cost_model.roofline.peak_gflops",
+   * "raf.cost_model.roofline.bandwidth_gbps" and "raf.cost_model.roofline.launch_overhead_us"
+   * of the current pass context are used if given, so no device is needed to compile for it.
+   * The others are calibrated once per device by profiling a matmul, an add and a tiny op.
+   * \param device The device.
+   * \return The roofline.
+   */
+  static Roofline Get(const Device& device);
+
+  /*!
+   * \brief Estimate the latency of an op.
+   * \param gflops The compute GFLOPS.
+   * \param bytes The bytes read and written.
+   * \return The latency in microseconds.
+   */
+  double Latency(double gflops, double bytes) const {
+    return launch_overhead_us +
+           std::max(gflops * 1e6 / peak_gflops, bytes * 1e-3 / bandwidth_gbps);
+  }
+};
+
+}  // namespace cost_model
+}  // namespace raf
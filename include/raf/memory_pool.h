@@ -10,6 +10,7 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "./device.h"
 
@@ -45,6 +46,8 @@ class Memory {
 
   static std::pair<float, float> GetPoolSize(const Device& dev);
 
+  static std::unordered_map<std::string, double> GetPoolStats(const Device& dev);
+
   // means "no longer considered as allocator when asking for new memory."
   static void RemovePool(const Device& dev);
 
@@ -124,6 +127,17 @@ class MemoryPool {
    * \return A pair of the total size of (used chunks, pool).
    */
   virtual std::pair<float, float> GetPoolSize() = 0;
+
+  /*!
+   * \brief Get the detailed statistics of the pool, such as the fragmentation. Pools that do not
+   * track more than their size only report the used and total bytes.
+   *
+   * \return A map from the statistic name to its value.
+   */
+  virtual std::unordered_map<std::string, double> GetPoolStats() {
+    auto size = GetPoolSize();
+    return {{"used_bytes", size.first * 1048576.0}, {"pool_bytes", size.second * 1048576.0}};
+  }
 };
 
 }  // namespace memory_pool
@@ -8,6 +8,11 @@
  * \brief memory profiler
  */
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -21,6 +26,11 @@
   }
 
 namespace raf {
+
+namespace memory_pool {
+class Memory;
+}  // namespace memory_pool
+
 namespace memory_profiler {
 
 using FloatPair = std::pair<float, float>;
@@ -56,6 +66,66 @@ struct MemoryStat {
   int num_gc = 0;
 };
 
+/*! \brief The instruction on whose behalf the memory is allocated by the current thread. */
+struct AllocSite {
+  /*! \brief The name of the VM function, or nullptr if the memory is not allocated by a VM. */
+  const std::string* func_name = nullptr;
+  /*! \brief The program counter of the instruction. */
+  int64_t pc = -1;
+  /*! \brief The op that owns the memory, or nullptr if it is not known yet. */
+  const std::string* op_name = nullptr;
+  /*! \brief The kind of the memory, e.g., "storage", "workspace" or "arena". */
+  const char* kind = "external";
+};
+
+/*!
+ * \brief Set the allocation site of the current thread in the scope. It only stores a few
+ * pointers, so it is cheap enough to be used whether or not the allocations are traced.
+ */
+class AllocSiteScope {
+ public:
+  AllocSiteScope(const std::string* func_name, int64_t pc, const std::string* op_name,
+                 const char* kind)
+      : prev_(current_) {
+    current_.func_name = func_name;
+    current_.pc = pc;
+    current_.op_name = op_name;
+    current_.kind = kind;
+  }
+  ~AllocSiteScope() {
+    current_ = prev_;
+  }
+  static const AllocSite& Current() {
+    return current_;
+  }
+
+ private:
+  AllocSite prev_;
+  static thread_local AllocSite current_;
+};
+
+/*! \brief An allocation event recorded by the allocation tracer. */
+struct AllocEvent {
+  /*! \brief The device of the memory. */
+  std::string device;
+  /*! \brief The address of the memory. */
+  const void* data = nullptr;
+  /*! \brief The requested bytes. */
+  int64_t nbytes = 0;
+  /*! \brief The bytes reserved by the pool, which may be more than requested due to rounding. */
+  int64_t reserved_bytes = 0;
+  /*! \brief The sequence numbers of the allocation and the free, or -1 if it is never freed. */
+  int64_t alloc_seq = -1, free_seq = -1;
+  /*! \brief The timestamps in microseconds of the allocation and the free. */
+  int64_t alloc_us = -1, free_us = -1;
+  /*! \brief The owning instruction and op, which are empty for the memory allocated outside VMs. */
+  std::string func_name;
+  int64_t pc = -1;
+  std::string op_name;
+  /*! \brief The kind of the memory, see AllocSite. */
+  std::string kind;
+};
+
 /*! \brief The memory profiler for all devices. */
 class MemoryProfiler {
  public:
@@ -70,6 +140,48 @@ class MemoryProfiler {
     return is_profiling_;
   }
 
+  /*! \brief Enable or disable tracing every allocation and free of the memory pools. */
+  void SetTraceAllocs(bool trace) {
+    is_tracing_allocs_ = trace;
+  }
+
+  bool IsTracingAllocs() const {
+    return is_tracing_allocs_.load(std::memory_order_relaxed);
+  }
+
+  /*!
+   * \brief Record the allocation of a memory chunk at the site of the current thread.
+   * \param device The device of the memory.
+   * \param nbytes The requested bytes.
+   * \param reserved_bytes The bytes reserved by the pool for the request.
+   * \param memory The allocated memory.
+   * \return The memory that records its free when the last reference to it is released. It
+   * points to the same Memory object, so the pools that check the reference count of the chunks
+   * see them as in use until then.
+   */
+  std::shared_ptr<memory_pool::Memory> TraceAlloc(const Device& device, int64_t nbytes,
+                                                  int64_t reserved_bytes,
+                                                  std::shared_ptr<memory_pool::Memory> memory);
+
+  /*!
+   * \brief Attribute the live memory chunks that contain the given addresses to an op, unless
+   * they are already attributed. This is how the storage allocated ahead of an op is charged to
+   * the op that writes its outputs there.
+   * \param data The addresses of the outputs of the op.
+   * \param func_name The name of the VM function.
+   * \param pc The program counter of the instruction that invokes the op.
+   * \param op_name The name of the op.
+   */
+  void AttributeAllocs(const std::vector<const void*>& data, const std::string& func_name,
+                       int64_t pc, const std::string& op_name);
+
+  /*!
+   * \brief Get the allocation events of the given device.
+   * \param device The device to get the events.
+   * \return The events in the order of their allocations.
+   */
+  std::vector<AllocEvent> GetAllocEvents(const Device& device);
+
   /*!
    * \brief Record the current used and allocated memory for the given device and tag.
    * \param device The device to record.
@@ -100,6 +212,26 @@ class MemoryProfiler {
   std::unordered_map<std::string, MemoryStat> memory_stats_;
   /*! \brief Whether the profiling is enabled. */
   bool is_profiling_ = false;
+
+  /*! \brief Record the free of an allocation event, unless the events are reset since then. */
+  void TraceFree(int64_t generation, int64_t event_id);
+  /*! \brief The microseconds since the tracer was reset. */
+  int64_t NowUs() const;
+
+  /*! \brief Whether the allocations are traced. */
+  std::atomic<bool> is_tracing_allocs_{false};
+  /*! \brief The allocation events of all devices, indexed by their ids. */
+  std::vector<AllocEvent> alloc_events_;
+  /*! \brief Mapping from the address of each live memory chunk to its event id. */
+  std::map<const void*, int64_t> live_allocs_;
+  /*! \brief The sequence number of the next allocation or free. */
+  int64_t next_seq_ = 0;
+  /*! \brief The number of times the events are reset. */
+  int64_t alloc_generation_ = 0;
+  /*! \brief The start time of the tracer. */
+  std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+  /*! \brief The mutex of the tracer, as the memory may be freed by other threads. */
+  std::mutex alloc_mu_;
 };
 }  // namespace memory_profiler
 }  // namespace raf
@@ -12,6 +12,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <utility>
 
 #include "./device.h"
 #include "./dialect.h"
@@ -71,7 +72,8 @@ class OpEnv {
    */
   virtual void Execute(const CallValues& call) = 0;
   /*!
-   * \brief Execute the OpEnv with a list of inputs and output value.
+   * \brief Execute the OpEnv with a list of inputs and output value. On CPU, the VM may call it
+   * concurrently from the host stream workers, so it must not write the OpEnv.
    * \param inputs The vector of input values.
    * \param output The output value.
    */
@@ -91,6 +93,13 @@ class OpEnv {
   std::shared_ptr<requests::Requests> GetRequests() const;
   /*! \brief Data input indices in the argument list. This is used by VM executor. */
   std::vector<int> arg_indices;
+  /*! \brief The name of the op whose OpEnvMaker made this OpEnv, set by the dispatcher. */
+  std::string dispatched_op;
+  /*!
+   * \brief The entries of the persistent caches, e.g., the compiled kernels, that made this
+   * OpEnv, as pairs of the cache name and the key. Set by the VM.
+   */
+  std::vector<std::pair<std::string, std::string>> cache_keys;
 
   /*!
    * \brief Set the stream to launch the kernels for all enabled backends
@@ -194,6 +203,15 @@ inline T GetOpAttrOrDefault(const ir::Op& op, const std::string attr_name, T def
  */
 std::shared_ptr<OpEnv> Dispatch(const CallValues& call);
 
+/*!
+ * \brief Make the OpEnv with the OpEnvMaker of a given op, e.g., to replay a dispatch decision
+ * that was made before, without trying the dialects of higher priority.
+ * \param call The call values.
+ * \param op_name The name of the op, which is the dispatched_op of a previous OpEnv.
+ * \return The created OpEnv, or nullptr if the op cannot make a valid OpEnv for the call.
+ */
+std::shared_ptr<OpEnv> DispatchTo(const CallValues& call, const std::string& op_name);
+
 /*!
  * \brief Create a dummy call_values from a call expression. The inputs and output of the call
  * values are dummy values created according to the inferred type of the call expression.
@@ -111,7 +111,7 @@ class OpProfiler {
   }
 
   /*!
-   * \brief Reset the latency cache.
+   * \brief Reset the latency cache. The entries of the persistent latency database are kept.
    */
   void Reset() {
     latency_and_workspace_size_cache_.clear();
@@ -129,8 +129,26 @@ class OpProfiler {
   LatencyAndWorkspaceMapT latency_and_workspace_size_cache_;
   /*! \brief A cache to store built OpEnv. */
   OpEnvMapT op_env_cache_;
+  /*! \brief The signature of the device in the keys of the latency database. */
+  std::string device_signature_;
 
  private:
+  /*!
+   * \brief Generate the key of the given ops in the persistent latency database. Unlike the
+   * in-memory cache key, it only depends on the printed IR, so it is stable across processes.
+   * \param ops The ops to be profiled.
+   * \param stream_ids The stream IDs, or empty for the default stream.
+   * \param warmup The number of warmup iterations.
+   * \param exec_number The number of execution iterations.
+   * \param repeat The number of repeat iterations.
+   * \return The key.
+   */
+  std::string GetDBKey(const std::vector<Expr>& ops, const std::vector<int>& stream_ids,
+                       int32_t warmup, int32_t exec_number, int32_t repeat);
+
+  /*! \brief Get the name of the device model, e.g., the GPU name, to key the latency database. */
+  const std::string& GetDeviceSignature();
+
   /*!
    * \brief Generate a byte string hash for the given call node using its op as well as
    * argument and return types.
@@ -114,7 +114,12 @@ Pass MemoryPlan();
 Pass CanonicalizeOps();
 
 /*!
- * \brief Create a type inference pass.
+ * \brief Create a type inference pass. With the pass config raf.type_infer.incremental, the let
+ * bindings whose values and inputs keep their checked types from the last inference are reused,
+ * and only the changed bindings and their users whose input types change are re-inferred. The
+ * changed bindings are the ones created by the passes since then, which have no type yet, and the
+ * ones marked by MarkBindingChanged. With raf.type_infer.validate, the incremental result is
+ * cross-checked against a full inference.
  * \return The created pass.
  */
 Pass InferType();
@@ -445,6 +450,14 @@ ir::Expr InferTypeWithValues(const ir::Expr& func, const ir::Array<value::Value>
  */
 ir::Expr InferTypeWithModule(const ir::Expr& expr, const ir::IRModule& module);
 
+/*!
+ * \brief Mark a let binding as changed, so that the incremental type inference re-infers it and
+ * its users. This is only needed by the passes that change the meaning of a binding without
+ * creating a new value for it.
+ * \param var The var of the binding.
+ */
+void MarkBindingChanged(const ir::Var& var);
+
 /*!
  * \brief Eliminate dead code in the give expression
  * \param expr The expression.
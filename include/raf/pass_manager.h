@@ -12,6 +12,11 @@
 
 #include <tvm/ir/transform.h>
 
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "raf/op.h"
 #include "raf/ir.h"
 #include "raf/ir_ext.h"
@@ -53,5 +58,66 @@ class RAFSequential : public Pass {
   using ContainerType = RAFSequential;
 };
 
+/*! \brief The compile cost of a pass run by a RAFSequential. */
+struct PassProfileRecord {
+  /*! \brief The name of the RAFSequential that runs the pass. */
+  std::string seq_name;
+  /*! \brief The name of the pass. */
+  std::string pass_name;
+  /*! \brief The nesting depth of the RAFSequential, starting from 0. */
+  int depth = 0;
+  /*! \brief The wall time of the pass in microseconds. */
+  int64_t elapsed_us = -1;
+  /*! \brief The growth of the peak resident set size of the process in KBs. */
+  int64_t peak_rss_delta_kb = 0;
+  /*! \brief The change of the resident set size of the process in KBs. */
+  int64_t rss_delta_kb = 0;
+  /*! \brief The number of distinct expression nodes of the module before the pass. */
+  int64_t nodes_before = 0;
+  /*! \brief The number of distinct expression nodes of the module after the pass. */
+  int64_t nodes_after = 0;
+};
+
+/*!
+ * \brief The profiler of the passes run by RAFSequential. When it is enabled, every pass of a
+ * RAFSequential, including the passes it runs to resolve the required ones, is recorded in the
+ * order the passes start, so the passes of a nested RAFSequential follow the record of the
+ * nested one.
+ */
+class PassProfiler {
+ public:
+  static PassProfiler* Get();
+
+  void SetEnabled(bool enabled) {
+    is_enabled_ = enabled;
+  }
+
+  bool IsEnabled() const {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  /*!
+   * \brief Reserve the record of a pass that starts.
+   * \return The index of the record, which is filled by End when the pass ends.
+   */
+  size_t Begin(const std::string& seq_name, const std::string& pass_name, int depth);
+
+  /*! \brief Fill the record of a pass that ends, unless the record is reset since it starts. */
+  void End(size_t index, const PassProfileRecord& record);
+
+  /*! \brief Get the records of the finished passes. */
+  std::vector<PassProfileRecord> GetRecords();
+
+  /*! \brief Clear the records. */
+  void Reset();
+
+ private:
+  /*! \brief Whether the profiling is enabled. */
+  std::atomic<bool> is_enabled_{false};
+  /*! \brief The records, where the ones of the running passes have negative elapsed_us. */
+  std::vector<PassProfileRecord> records_;
+  std::mutex mu_;
+};
+
 }  // namespace pass
 }  // namespace raf
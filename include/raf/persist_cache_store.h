@@ -0,0 +1,188 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file persist_cache_store.h
+ * \brief The on-disk store of the persistent caches.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace raf {
+
+/*!
+ * \brief Pack the regular files in a directory, e.g., the files saved by a cache value, into
+ * a buffer.
+ * \param dir The directory.
+ * \param buf The buffer to append to.
+ * \return Whether all files were read.
+ */
+bool PackDirectory(const std::string& dir, std::string* buf);
+
+/*!
+ * \brief Extract the files packed by PackDirectory to a directory.
+ * \param data The packed files.
+ * \param size The size of the packed files.
+ * \param dir The directory.
+ * \return Whether the packed files are well-formed and were written.
+ */
+bool UnpackDirectory(const char* data, size_t size, const std::string& dir);
+
+/*! \brief A temporary directory, which is removed with its files on destruction. */
+class ScratchDir {
+ public:
+  /*!
+   * \brief Create a scratch directory.
+   * \param parent The parent directory, or empty to use TMPDIR or /tmp.
+   */
+  explicit ScratchDir(const std::string& parent = "");
+  ~ScratchDir();
+
+  const std::string& path() const {
+    return path_;
+  }
+
+ private:
+  std::string path_;
+};
+
+/*! \brief A 128-bit hash of a cache key. */
+struct PersistCacheHash {
+  uint64_t h1;
+  uint64_t h2;
+
+  bool operator==(const PersistCacheHash& other) const {
+    return h1 == other.h1 && h2 == other.h2;
+  }
+
+  struct Hasher {
+    size_t operator()(const PersistCacheHash& hash) const {
+      return static_cast<size_t>(hash.h1);
+    }
+  };
+
+  /*! \brief Compute the MurmurHash3 (x64, 128-bit) of the bytes. */
+  static PersistCacheHash Compute(const void* data, size_t size, uint64_t seed = 0);
+};
+
+/*! \brief An entry in the index file of a persistent cache store. */
+struct PersistCacheIndexRecord {
+  /*! \brief The hash of the full key. */
+  PersistCacheHash hash;
+  /*! \brief The offset of the entry in the data file. */
+  uint64_t offset;
+  /*! \brief The size of the entry in the data file. */
+  uint64_t size;
+  /*! \brief The time (in seconds since epoch) when the entry was written. */
+  int64_t timestamp;
+  /*! \brief The size of the key. */
+  uint32_t key_size;
+  /*! \brief The checksum of the fields above, used to skip partially written records. */
+  uint32_t checksum;
+};
+
+static_assert(sizeof(PersistCacheIndexRecord) == 48, "Unexpected index record layout");
+
+/*!
+ * \brief The on-disk store of a persistent cache, which keeps all entries in two files under
+ * the cache directory, instead of one directory per entry:
+ *
+ *  - "data": the entries appended one after another. An entry holds its full key, followed by
+ *    the files that the cache value saved.
+ *  - "index": a header followed by fixed-size records (PersistCacheIndexRecord) mapping the
+ *    128-bit hash of a key to its entry. The file is mmap-ed and scanned once at open time,
+ *    and only the records appended since the last scan are read afterwards.
+ *
+ * Lookups never probe the filesystem per key. A hit is verified against the full key stored
+ * in the entry, so hash collisions are detected and reported instead of loading a wrong value.
+ *
+ * Writers of all processes on the host are serialized by an exclusive flock on the "lock"
+ * file, and an entry is always written before its index record, so readers never see an index
+ * record of an incomplete entry. When the store exceeds the maximum age or size, it is
+ * compacted under the lock by rewriting both files and renaming them into place, evicting
+ * the oldest entries first. Readers reopen the files under a shared lock when they detect
+ * that the files were replaced.
+ */
+class PersistCacheStore {
+ public:
+  /*! \brief The result of loading an entry. */
+  enum class LoadResult { kHit, kMiss, kCollision };
+
+  /*!
+   * \brief Open or create a store.
+   * \param path The directory of the store.
+   * \param max_bytes The maximum size of the data file, or 0 if unlimited.
+   * \param max_age_sec The maximum age of an entry in seconds, or 0 if unlimited.
+   */
+  PersistCacheStore(const std::string& path, int64_t max_bytes = 0, int64_t max_age_sec = 0);
+
+  ~PersistCacheStore();
+
+  /*! \brief Whether the store has an entry for the key. */
+  bool Contains(const std::string& key);
+
+  /*!
+   * \brief Load the entry of the key. The files of the entry are extracted to a scratch
+   * directory, which is removed after f_load returns or throws.
+   * \param key The key.
+   * \param f_load The function that loads the value from the scratch directory.
+   * \return kHit if the entry was loaded, or kCollision if the entry of the hash has a
+   * different key.
+   */
+  LoadResult Load(const std::string& key, const std::function<void(const std::string&)>& f_load);
+
+  /*!
+   * \brief Save an entry for the key. The value is saved by f_save to a scratch directory, and
+   * all regular files in the directory are packed into the entry. The entry is not written
+   * again if another process has already saved the key.
+   * \param key The key.
+   * \param f_save The function that saves the value to the scratch directory.
+   * \return Whether the entry is in the store.
+   */
+  bool Save(const std::string& key, const std::function<bool(const std::string&)>& f_save);
+
+  /*! \brief Evict the entries that exceed the maximum age or size. */
+  void Compact();
+
+  /*! \brief The number of entries. */
+  size_t Size();
+
+ private:
+  /*! \brief Open the index and data files, and reset the scanned index. */
+  void OpenFiles();
+  void CloseFiles();
+  /*! \brief Reopen the files if they were replaced by a compaction of another process. */
+  void ReopenIfReplaced();
+  /*! \brief Scan the index records appended since the last scan. */
+  void RefreshIndex();
+  bool ReadEntry(const PersistCacheIndexRecord& record, std::string* buf);
+  bool NeedCompaction();
+  /*! \brief Rewrite the files with the entries to keep. The caller must hold the file lock. */
+  void CompactLocked();
+
+  /*! \brief The directory of the store. */
+  std::string path_;
+  /*! \brief The maximum size of the data file, or 0 if unlimited. */
+  int64_t max_bytes_;
+  /*! \brief The maximum age of an entry in seconds, or 0 if unlimited. */
+  int64_t max_age_sec_;
+  /*! \brief The file descriptors of the lock, index and data files. */
+  int lock_fd_ = -1;
+  int index_fd_ = -1;
+  int data_fd_ = -1;
+  /*! \brief The number of bytes of the index file that have been scanned. */
+  uint64_t index_scanned_ = 0;
+  /*! \brief The entries by the hash of their keys. */
+  std::unordered_map<PersistCacheHash, PersistCacheIndexRecord, PersistCacheHash::Hasher> index_;
+  /*! \brief The lock of the store within the process. */
+  std::mutex mu_;
+};
+
+}  // namespace raf
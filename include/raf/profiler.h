@@ -9,6 +9,7 @@
  */
 #pragma once
 #include <dmlc/concurrentqueue.h>
+#include <atomic>
 #include <cstdint>
 #include <array>
 #include <utility>
@@ -20,6 +21,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
 #include "device.h"
 #include "device_api.h"
 
@@ -29,20 +31,17 @@
 #include <unistd.h>
 #endif
 
-#define WITH_BASE_PROFILER_LEVEL(LEVEL, DEVICE, NAME, CAT, ARGS, CODE_SNIPPET)                \
-  {                                                                                           \
-    bool _profiling = raf::profiler::Profiler::Get()->IsProfiling(LEVEL);                     \
-    if (_profiling) {                                                                         \
-      auto& _pool = raf::profiler::Profiler::Get()->HelperPool();                             \
-      auto _phelper_index = _pool.size();                                                     \
-      _pool.push_back(raf::profiler::ProfilerHelper(DEVICE.device_id(), DEVICE.device_type(), \
-                                                    NAME, CAT, ARGS));                        \
-      _pool[_phelper_index].start();                                                          \
-      CODE_SNIPPET                                                                            \
-      _pool[_phelper_index].stop();                                                           \
-    } else {                                                                                  \
-      CODE_SNIPPET                                                                            \
-    }                                                                                         \
+#define WITH_BASE_PROFILER_LEVEL(LEVEL, DEVICE, NAME, CAT, ARGS, CODE_SNIPPET)    \
+  {                                                                               \
+    auto* _profiler = raf::profiler::Profiler::Get();                             \
+    if (_profiler->IsProfiling(LEVEL) && _profiler->Sample()) {                   \
+      raf::profiler::ProfileRecorder _precorder(DEVICE, NAME, CAT, ARGS);         \
+      _precorder.start();                                                         \
+      CODE_SNIPPET                                                                \
+      _precorder.stop();                                                          \
+    } else {                                                                      \
+      CODE_SNIPPET                                                                \
+    }                                                                             \
   }
 
 #define WITH_BASE_PROFILER(DEVICE, NAME, CAT, ARGS, CODE_SNIPPET) \
@@ -188,6 +187,31 @@ class ProfilerHelper {
   std::vector<std::string> args;
 };
 
+/*! \brief The maximum number of arguments of a profiled region. */
+constexpr size_t kMaxProfileEventArgs = 4;
+
+/*!
+ * \brief A profiled region recorded by WITH_BASE_PROFILER. The name, category and arguments are
+ * interned by the profiler, so that recording an event does not allocate.
+ */
+struct ProfileEvent {
+  /*! \brief The start time in microseconds. */
+  uint64_t start_time;
+  /*! \brief The end time in microseconds. */
+  uint64_t end_time;
+  /*! \brief The interned name. */
+  uint32_t name_id;
+  /*! \brief The interned category. */
+  uint32_t category_id;
+  /*! \brief The number of arguments. */
+  uint32_t num_args;
+  /*! \brief The interned arguments, each in its own slot. */
+  uint32_t arg_ids[kMaxProfileEventArgs];
+};
+
+/*! \brief The fixed-capacity ring buffer of the events recorded by one thread. */
+class ProfileRingBuffer;
+
 class Profiler {
  public:
   ~Profiler();
@@ -197,40 +221,113 @@ class Profiler {
   std::string GetProfile();
   std::vector<ProfileStat> GetProfileStats();
 
-  inline bool IsProfiling(int level) {
-    return profile_level_ >= level;
+  inline bool IsProfiling(int level) const {
+    return profile_level_.load(std::memory_order_relaxed) >= level;
   }
 
-  void CollectStat() {
-    for (int i = 0; i < helpers_.size(); i++) {
-      helpers_[i].collect();
-    }
-    helpers_.clear();
-  }
+  /*!
+   * \brief Move the events recorded by all threads so far into the profile statistics. It is
+   * safe to call while other threads are recording, so a trace can be dumped on demand.
+   */
+  void CollectStat();
 
   inline int profile_level() const {
-    return profile_level_;
+    return profile_level_.load(std::memory_order_relaxed);
   }
 
   inline void set_profile_level(int profile_level = 0) {
-    profile_level_ = profile_level;
+    profile_level_.store(profile_level, std::memory_order_relaxed);
   }
 
-  std::vector<ProfilerHelper>& HelperPool() {
-    return helpers_;
+  /*!
+   * \brief Configure the recording of events.
+   * \param sync_device Whether to synchronize the device at the start and the end of each event,
+   * so that the event covers the device execution. Without it, an event only measures the host
+   * time, e.g., the kernel launch, but the profiler never stalls the device.
+   * \param sample_rate Record one of every sample_rate events on each thread.
+   * \param buffer_size The capacity in events of the ring buffer of each thread. When a buffer
+   * is full, the oldest events are overwritten. It applies to the buffers created afterwards.
+   */
+  void Configure(bool sync_device, int sample_rate, int64_t buffer_size);
+
+  inline bool sync_device() const {
+    return sync_device_.load(std::memory_order_relaxed);
+  }
+
+  /*! \brief Decide whether the next event of the calling thread is sampled. */
+  inline bool Sample() const {
+    int rate = sample_rate_.load(std::memory_order_relaxed);
+    if (rate <= 1) {
+      return true;
+    }
+    thread_local uint64_t counter = 0;
+    return counter++ % rate == 0;
+  }
+
+  /*! \brief Intern a string, returning its ID. The ID of the empty string is 0. */
+  uint32_t Intern(const std::string& str);
+
+  /*! \brief Look up an interned string by its ID. */
+  std::string LookupString(uint32_t id);
+
+  /*! \brief Record an event into the ring buffer of the calling thread. */
+  void Record(const ProfileEvent& event);
+
+  /*! \brief The number of events overwritten before they were collected. */
+  int64_t NumDroppedEvents() const {
+    return num_dropped_.load(std::memory_order_relaxed);
   }
 
  private:
   Profiler();
 
+  /*! \brief Get the ring buffer of the calling thread, creating it on first use. */
+  ProfileRingBuffer* GetThreadBuffer();
+
   /*! \brief Profile statistics. */
   DeviceStats profile_stats_;
   /*! \brief Profiling level. */
-  int profile_level_{0};
+  std::atomic<int> profile_level_{0};
+  /*! \brief Whether to synchronize the device around each event. */
+  std::atomic<bool> sync_device_{true};
+  /*! \brief Record one of every sample_rate_ events on each thread. */
+  std::atomic<int> sample_rate_{1};
+  /*! \brief The capacity of the ring buffer of each thread. */
+  std::atomic<int64_t> buffer_size_;
+  /*! \brief The number of events overwritten before they were collected. */
+  std::atomic<int64_t> num_dropped_{0};
   /*! \brief Mutex for multi-threading. */
   std::recursive_mutex m_;
-  /*! \brief The helper pool. */
-  std::vector<ProfilerHelper> helpers_;
+  /*! \brief The ring buffers of all threads that recorded events. */
+  std::vector<std::shared_ptr<ProfileRingBuffer>> buffers_;
+  /*! \brief The lock of the ring buffers. */
+  std::mutex buffers_mu_;
+  /*! \brief The interned strings indexed by their IDs. */
+  std::vector<std::string> strings_;
+  /*! \brief The IDs of the interned strings. */
+  std::unordered_map<std::string, uint32_t> string_ids_;
+  /*! \brief The lock of the interned strings. */
+  std::mutex strings_mu_;
+};
+
+/*!
+ * \brief Records one event of WITH_BASE_PROFILER into the ring buffer of the calling thread.
+ */
+class ProfileRecorder {
+ public:
+  ProfileRecorder(const Device& device, const std::string& name, const std::string& categories,
+                  const std::vector<std::string>& args);
+
+  inline void start();
+  inline void stop();
+
+ private:
+  /*! \brief The device to synchronize. */
+  tvm::Device device_;
+  /*! \brief The api of the device to synchronize, or null if the device is not synchronized. */
+  std::shared_ptr<device_api::DeviceAPI> dev_api_;
+  /*! \brief The event being recorded. */
+  ProfileEvent event_;
 };
 
 inline void ProfilerHelper::start() {
@@ -247,6 +344,21 @@ inline void ProfilerHelper::stop() {
   end_time_ = ProfileStat::NowInMicrosec();
 }
 
+inline void ProfileRecorder::start() {
+  if (dev_api_) {
+    dev_api_->WaitDevice(Device(device_));
+  }
+  event_.start_time = ProfileStat::NowInMicrosec();
+}
+
+inline void ProfileRecorder::stop() {
+  if (dev_api_) {
+    dev_api_->WaitDevice(Device(device_));
+  }
+  event_.end_time = ProfileStat::NowInMicrosec();
+  Profiler::Get()->Record(event_);
+}
+
 inline void ProfilerHelper::collect() {
   Profiler::Get()->AddNewProfileStat(categories_, name_, start_time_, end_time_, args);
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file shm_communicator.h
+ * \brief Shared-memory Communicator for the processes on the same host.
+ */
+#pragma once
+#include <string>
+#include "raf/communicator.h"
+#include "raf/value.h"
+
+namespace raf {
+namespace distributed {
+namespace communicator {
+
+/*! \brief The reduction of the shared-memory collectives. */
+enum class SHMReduceOp : int {
+  kSum = 0,
+  kProd = 1,
+  kMin = 2,
+  kMax = 3,
+  kAvg = 4,
+};
+
+/*! \brief Parse the computation attribute of a collective, e.g., "sum". */
+SHMReduceOp ParseSHMReduceOp(const std::string& computation);
+
+/*!
+ * \brief A communicator of the processes on the same host, which exchanges data through a
+ * POSIX shared memory segment instead of a network library. The segment holds two sets of
+ * per-rank staging slots, which are used alternately by consecutive chunks, so a rank can
+ * stage the next chunk while the slower ranks still read the previous one. Large tensors are
+ * processed chunk by chunk, and each rank reduces a disjoint slice of each chunk, i.e., the
+ * reduce-scatter and all-gather phases of a ring allreduce without the extra hops.
+ *
+ * All ranks of the communicator must call the collectives in the same order. The size of a
+ * chunk is set by RAF_SHM_CHUNK_BYTES (1 MiB by default). The segment is named after
+ * RAF_SHM_JOB_ID, or the parent process ID by default, and the global ranks of the group.
+ */
+class SHMCommunicatorObj final : public CommunicatorObj {
+ public:
+  /*! \brief Prevent the global communicator from being released in advance. */
+  Communicator parent_comm;
+  /*! \brief The mapped shared memory segment, or nullptr if the group has a single rank. */
+  uint8_t* segment = nullptr;
+  /*! \brief The size of the mapped segment. */
+  size_t segment_bytes = 0;
+  /*! \brief The size of a staging slot. */
+  int64_t chunk_bytes = 0;
+  /*! \brief The number of chunks processed so far, which selects the set of slots to use. */
+  uint64_t step = 0;
+
+  ~SHMCommunicatorObj();
+
+  /*! \brief Block until all ranks arrive. */
+  void Barrier();
+  /*! \brief Reduce the buffers of all ranks and write the result to all ranks. */
+  void AllReduce(const void* send_buf, void* recv_buf, int64_t count, DLDataType dtype,
+                 SHMReduceOp op);
+  /*! \brief Reduce the buffers of all ranks and write the result to the root. */
+  void Reduce(const void* send_buf, void* recv_buf, int64_t count, DLDataType dtype,
+              SHMReduceOp op, int root);
+  /*! \brief Concatenate the buffers of all ranks in the order of the ranks. */
+  void AllGather(const void* send_buf, void* recv_buf, int64_t bytes);
+  /*!
+   * \brief Reduce the buffers of all ranks, which have recv_count * size elements, and write
+   * the i-th slice of recv_count elements to rank i.
+   */
+  void ReduceScatter(const void* send_buf, void* recv_buf, int64_t recv_count, DLDataType dtype,
+                     SHMReduceOp op);
+  /*! \brief Copy the buffer of the root to all ranks. */
+  void Broadcast(const void* send_buf, void* recv_buf, int64_t bytes, int root);
+  /*! \brief Send a buffer to the peer, which returns once the last chunk is staged. */
+  void Send(const void* buf, int64_t bytes, int peer);
+  /*! \brief Receive a buffer from the peer. */
+  void Recv(void* buf, int64_t bytes, int peer);
+
+  static constexpr const char* _type_key = "raf.distributed.SHMCommunicator";
+  RAF_FINAL_OBJECT(SHMCommunicatorObj, CommunicatorObj);
+
+ private:
+  /*! \brief Reduce the elements of all ranks into the recv buffer of all ranks or the root. */
+  void ReduceImpl(const void* send_buf, void* recv_buf, int64_t count, DLDataType dtype,
+                  SHMReduceOp op, int root);
+};
+
+class SHMCommunicator final : public Communicator {
+ public:
+  static SHMCommunicator make(Value rank_list);
+  RAF_OBJECT_REF(SHMCommunicator, Communicator, SHMCommunicatorObj);
+};
+
+}  // namespace communicator
+}  // namespace distributed
+}  // namespace raf
@@ -241,7 +241,7 @@ class TensorValue final : public BaseTensorValue {
                               const std::vector<int64_t>& strides = {}, void* data = nullptr,
                               std::shared_ptr<memory_pool::Memory> mem = nullptr);
   TensorValue CreateView(const std::vector<int64_t>& shape = {},
-                         const std::vector<int64_t>& strides = {}) const;
+                         const std::vector<int64_t>& strides = {}, void* data = nullptr) const;
   RAF_OBJECT_REF(TensorValue, BaseTensorValue, TensorValueObj);
 };
 
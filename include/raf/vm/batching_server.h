@@ -0,0 +1,171 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file include/raf/vm/batching_server.h
+ * \brief A serving front end of the virtual machine that batches independent requests.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "raf/cache.h"
+#include "raf/vm/vm.h"
+
+namespace raf {
+namespace executor {
+namespace vm {
+
+/*!
+ * \brief A serving front end that queues independent requests and runs them in batches.
+ *
+ * The inputs of a request are concatenated along their first axis with the inputs of other
+ * queued requests, until the batch reaches the largest batch size or the oldest request has
+ * waited for the max delay. The batch is padded to the smallest bucketed batch size that fits,
+ * and is run by the VM compiled for that batch size. The rows of the outputs are then scattered
+ * back to the requests.
+ *
+ * The entry function of the VMs takes the batched inputs first, followed by the shared inputs,
+ * e.g., the weights, which are the same for all requests. Every output must be batched along its
+ * first axis as well.
+ */
+class BatchingServer : public tvm::runtime::ModuleNode {
+ public:
+  /*! \brief The max number of latencies kept for the percentiles. */
+  static constexpr size_t kLatencyReservoirSize = 4096;
+
+  /*!
+   * \brief Create a batching server and start its workers.
+   * \param vms The VMs of the workers, where the VM of worker i for batch size j is at
+   * i * batch_sizes.size() + j. A worker runs a batch at a time, and the workers have their own
+   * VMs, as the workspace of an OpEnv is shared by the runs of a VM.
+   * \param batch_sizes The bucketed batch sizes in the ascending order.
+   * \param input_types The types of the batched parameters of the entry function, whose shapes
+   * except for the batch axes and dtypes are the same for all batch sizes.
+   * \param device The device of the VMs.
+   * \param shared_args The inputs shared by all requests.
+   * \param func_name The name of the entry function.
+   * \param max_delay_us The max microseconds a request waits for a batch to be formed.
+   */
+  BatchingServer(std::vector<tvm::runtime::Module> vms, std::vector<int64_t> batch_sizes,
+                 const std::vector<TensorType>& input_types, Device device,
+                 std::vector<Value> shared_args, std::string func_name, int64_t max_delay_us);
+  ~BatchingServer();
+
+  const char* type_key() const final {
+    return "BatchingServer";
+  }
+
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final;
+
+  /*!
+   * \brief Queue a request.
+   * \param inputs The batched inputs of the request, whose first axes are the batch axes.
+   * \return The id of the request.
+   */
+  int64_t Submit(std::vector<Value> inputs);
+
+  /*!
+   * \brief Wait for a request to finish.
+   * \param request_id The id of the request.
+   * \return The outputs of the request.
+   */
+  Value Get(int64_t request_id);
+
+  /*! \brief Get the statistics since the last reset. */
+  PackedMetricMap GetStats();
+
+  /*! \brief Reset the statistics. */
+  void ResetStats();
+
+  /*! \brief Stop the workers after the queued requests are done. */
+  void Stop();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /*! \brief The row shape and dtype of a batched input. */
+  struct InputSpec {
+    /*! \brief The shape except for the batch axis. */
+    std::vector<int64_t> row_shape;
+    DLDataType dtype;
+  };
+
+  /*! \brief A queued request. */
+  struct Request {
+    std::vector<Value> inputs;
+    /*! \brief The number of rows of the request in a batch. */
+    int64_t rows;
+    Clock::time_point arrival;
+    std::promise<Value> promise;
+  };
+  using RequestPtr = std::shared_ptr<Request>;
+
+  /*! \brief The states of a worker for a batch size, which are reused by its batches. */
+  struct Bucket {
+    /*! \brief The VM context, or undefined before the first batch. */
+    VMContext ctx;
+    /*! \brief The buffers of the batched inputs. */
+    std::vector<TensorValue> inputs;
+  };
+
+  /*! \brief The loop of a worker. */
+  void Loop(int worker_id);
+  /*! \brief Pop a batch of requests from the queue, or an empty batch if the server stops. */
+  std::vector<RequestPtr> PopBatch();
+  /*! \brief Run a batch of requests with the VMs of a worker and fulfill the requests. */
+  void RunBatch(int worker_id, std::vector<Bucket>* buckets,
+                const std::vector<RequestPtr>& batch);
+
+  /*! \brief The VMs and their entry functions. */
+  std::vector<tvm::runtime::Module> vm_modules_;
+  std::vector<VirtualMachine*> vms_;
+  std::vector<int64_t> batch_sizes_;
+  std::vector<InputSpec> input_specs_;
+  Device device_;
+  std::vector<Value> shared_args_;
+  std::string func_name_;
+  Clock::duration max_delay_;
+
+  /*! \brief The queued requests. */
+  std::deque<RequestPtr> queue_;
+  /*! \brief The total rows of the queued requests. */
+  int64_t queued_rows_ = 0;
+  /*! \brief The requests that are not taken by Get yet, indexed by their ids. */
+  std::unordered_map<int64_t, std::shared_future<Value>> futures_;
+  int64_t next_request_id_ = 0;
+  bool stop_ = false;
+  std::mutex mu_;
+  std::condition_variable queue_cv_;
+
+  /*! \brief The statistics. */
+  std::mutex stats_mu_;
+  int64_t num_requests_ = 0;
+  int64_t num_batches_ = 0;
+  int64_t num_rows_ = 0;
+  int64_t num_padded_rows_ = 0;
+  int64_t max_latency_us_ = 0;
+  /*!
+   * \brief A uniform sample of at most kLatencyReservoirSize latencies of the requests, from
+   * which the percentiles are estimated with bounded memory.
+   */
+  std::vector<int64_t> latencies_us_;
+  std::mt19937_64 latency_rng_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace vm
+}  // namespace executor
+}  // namespace raf
@@ -150,6 +150,9 @@ struct Instruction {
       Index device_id;
       /*! \brief Allocate storage alloc_async if available. */
       bool alloc_async;
+      /*! \brief The offset of the storage in the static arena of the function, or -1 if the
+       * storage is allocated from the memory pool. */
+      Index arena_offset;
     } alloc_storage;
     struct /* AllocTensor Operands */ {
       /*! \brief The storage to allocate from. */
@@ -200,6 +203,8 @@ struct Instruction {
       RegName data;
       /*! \brief The register containing the shape. */
       RegName shape;
+      /*! \brief The offset of the view into the data in bytes. */
+      Index offset;
     } set_shape;
 
     struct /* InvokeFunc Operands */ {
@@ -327,9 +332,10 @@ struct Instruction {
    * \param data The register containing the data.
    * \param shape The register containing the raw shape.
    * \param dst The destination register.
+   * \param offset The offset of the view into the data in bytes.
    * \return The set shape instruction.
    */
-  static Instruction SetShape(RegName data, RegName shape, RegName dst);
+  static Instruction SetShape(RegName data, RegName shape, RegName dst, Index offset = 0);
   /*!
    * \brief Construct a get field instruction.
    * \param object_reg The register containing the object to project from.
@@ -400,11 +406,13 @@ struct Instruction {
    * \param device_id The device ID.
    * \param dst The destination to place the storage.
    * \param alloc_async Allocate storage async if available.
+   * \param arena_offset The offset in the static arena of the function, or -1 to allocate
+   * from the memory pool.
    * \return The alloc storage instruction.
    */
   static Instruction AllocStorage(RegName size, RegName alignment, DLDataType dtype_hint,
                                   DevType device_type, Index device_id, RegName dst,
-                                  bool alloc_async = true);
+                                  bool alloc_async = true, Index arena_offset = -1);
 
   /*!
    * \brief Free a tensor or a storage.
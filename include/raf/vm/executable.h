@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -26,6 +27,26 @@ using raf::registry::PackedFunc;
 
 struct VMFunction;
 
+/*!
+ * \brief A dispatch decision made by a VM, which is bundled with the executable ahead of time
+ * so that a new VM can make the OpEnv directly.
+ */
+struct AOTDispatchRecord {
+  /*! \brief The index of the function. */
+  Index func_index;
+  /*! \brief The program counter of the InvokeJit instruction. */
+  Index pc;
+  /*! \brief The signature of the input and output shapes, i.e., the OpEnv cache key. */
+  std::string key;
+  /*! \brief The op that made the OpEnv. */
+  std::string op_name;
+  /*!
+   * \brief The entries of the persistent caches used by the OpEnv, as pairs of the cache name
+   * and the key, which select the entries bundled with the executable. Not serialized.
+   */
+  std::vector<std::pair<std::string, std::string>> cache_keys;
+};
+
 /*!
  * \brief The executable emitted by the VM compiler.
  *
@@ -37,6 +58,8 @@ struct VMFunction;
  *  - Primitive name section, containing the function name of the primitive ops
  *  used by the virtual machine.
  *  - Code section, handling the VM functions and bytecode.
+ *  - Constant blobs, holding the raw data of the CPU tensors in the constant pool at page
+ *  aligned offsets of the file, so that they can be mapped from the file without copying.
  */
 class Executable : public tvm::runtime::ModuleNode {
  public:
@@ -54,9 +77,13 @@ class Executable : public tvm::runtime::ModuleNode {
    * \brief Serialize the executable into global section, constant section, and
    * code section.
    *
+   * \param aot Whether to append the AOT section, which holds the dispatch decisions in
+   * `aot_dispatch` and the entries of all persistent kernel caches (e.g., the compiled TVM
+   * modules), so that the executable loaded in a new process runs without JIT compilation.
+   *
    * \return The binary representation of the VM.
    */
-  TVMByteArray Save();
+  TVMByteArray Save(bool aot = false);
 
   /*!
    * \brief Load the saved VM executable.
@@ -68,6 +95,20 @@ class Executable : public tvm::runtime::ModuleNode {
    */
   static tvm::runtime::Module Load(const std::string& code, const tvm::runtime::Module lib);
 
+  /*!
+   * \brief Load the VM executable saved in a file. The file is mapped into memory, and the
+   * constant tensors are bound onto the mapping without copying, so that their pages are read
+   * lazily on first use, and are shared through the page cache by the processes that load the
+   * same file. The file must not be modified while the executable or its constants are alive.
+   *
+   * \param path The path of the saved bytecode.
+   * \param lib The compiled runtime library.
+   *
+   * \return exe The constructed executable.
+   */
+  static tvm::runtime::Module LoadFromFile(const std::string& path,
+                                           const tvm::runtime::Module lib);
+
   /*!
    * \brief Get the serialized form of the `functions`. This is
    * essentially bytecode serialization.
@@ -153,6 +194,8 @@ class Executable : public tvm::runtime::ModuleNode {
   std::unordered_map<std::string, Index> primitive_map;
   /*! \brief The virtual machine's function table. */
   std::vector<VMFunction> functions;
+  /*! \brief The dispatch decisions of the AOT section. */
+  std::vector<AOTDispatchRecord> aot_dispatch;
 
  private:
   /*!
@@ -163,11 +206,14 @@ class Executable : public tvm::runtime::ModuleNode {
   void SaveGlobalSection(dmlc::Stream* strm);
 
   /*!
-   * \brief Save the constant pool.
+   * \brief Save the constant pool. The compact CPU tensors are saved as references to the
+   * constant blobs, which are appended after all sections.
    *
    * \param strm The input stream.
+   * \param blobs The tensors to save as blobs, with their offsets in the blob region.
    */
-  void SaveConstantSection(dmlc::Stream* strm);
+  void SaveConstantSection(dmlc::Stream* strm,
+                           std::vector<std::pair<const DLTensor*, uint64_t>>* blobs);
 
   /*!
    * \brief Save primitive op names.
@@ -183,6 +229,13 @@ class Executable : public tvm::runtime::ModuleNode {
    */
   void SaveCodeSection(dmlc::Stream* strm);
 
+  /*!
+   * \brief Save the dispatch decisions and the kernel caches.
+   *
+   * \param strm The input stream.
+   */
+  void SaveAOTSection(dmlc::Stream* strm);
+
   /*!
    * \brief Load the globals.
    *
@@ -194,8 +247,12 @@ class Executable : public tvm::runtime::ModuleNode {
    * \brief Load the constant pool.
    *
    * \param strm The input stream.
+   * \param blobs The blob region, or nullptr if the constants are saved inline in the section.
+   * \param blobs_size The size of the blob region.
+   * \param mapping The file mapping to bind the blobs onto, or nullptr to copy them.
    */
-  void LoadConstantSection(dmlc::Stream* strm);
+  void LoadConstantSection(dmlc::Stream* strm, const char* blobs, size_t blobs_size,
+                           std::shared_ptr<void> mapping);
 
   /*!
    * \brief Load primitive op names.
@@ -211,6 +268,28 @@ class Executable : public tvm::runtime::ModuleNode {
    */
   void LoadCodeSection(dmlc::Stream* strm);
 
+  /*!
+   * \brief Load the dispatch decisions, and import the kernel caches if the AOT section exists.
+   *
+   * \param strm The input stream.
+   */
+  void LoadAOTSection(dmlc::Stream* strm);
+
+  /*!
+   * \brief Load the VM executable from the saved bytecode in memory.
+   *
+   * \param data The saved bytecode.
+   * \param size The size of the saved bytecode.
+   * \param lib The compiled runtime library.
+   * \param mapping The file mapping of the bytecode, or nullptr if the constants must be copied
+   * out of the bytecode.
+   *
+   * \return exe The constructed executable.
+   */
+  static tvm::runtime::Module LoadFromBuffer(const char* data, size_t size,
+                                             const tvm::runtime::Module lib,
+                                             std::shared_ptr<void> mapping);
+
   /*! \brief The serialized bytecode. */
   std::string code_;
 };
@@ -0,0 +1,116 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file include/raf/vm/host_stream.h
+ * \brief Host worker threads that execute the multi-stream schedule on CPU.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "raf/vm/bytecode.h"
+
+namespace raf {
+namespace executor {
+namespace vm {
+
+/*!
+ * \brief A lightweight event of the host streams. Like a CUDA event, waiting on it waits for the
+ * latest record issued before the wait, so the event can be recorded again in later runs.
+ */
+class HostEvent {
+ public:
+  /*! \brief Issue a new record and return its generation. Only called by the VM thread. */
+  int64_t Issue() {
+    return ++issued_;
+  }
+  /*! \brief The generation of the latest issued record. Only called by the VM thread. */
+  int64_t Latest() const {
+    return issued_;
+  }
+  /*! \brief Mark the record of the given generation as completed. */
+  void Complete(int64_t generation);
+  /*! \brief Block until the record of the given generation is completed. */
+  void Wait(int64_t generation);
+
+ private:
+  /*! \brief The number of issued records. */
+  int64_t issued_ = 0;
+  /*! \brief The generation of the latest completed record. */
+  int64_t completed_ = 0;
+  std::mutex mu_;
+  std::condition_variable cv_;
+};
+
+/*! \brief A host worker thread that executes its tasks in the order they are enqueued. */
+class HostStream {
+ public:
+  HostStream();
+  ~HostStream();
+  /*! \brief Enqueue a task to run after all previously enqueued tasks. */
+  void Enqueue(std::function<void()> task);
+  /*! \brief Block until all enqueued tasks are done. */
+  void Synchronize();
+
+ private:
+  void Loop();
+
+  std::deque<std::function<void()>> tasks_;
+  /*! \brief The number of tasks that are enqueued but not done yet. */
+  size_t num_pending_ = 0;
+  bool stop_ = false;
+  std::mutex mu_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  std::thread thread_;
+};
+
+/*!
+ * \brief The host streams and events of a VM context. The streams and events are created on
+ * their first use and are indexed by the stream and event ids in the bytecode. The methods are
+ * called by the VM thread only.
+ */
+class HostStreamPool {
+ public:
+  /*! \brief Run an op on the given stream after the tasks enqueued before on the stream. */
+  void Launch(Index stream_id, std::function<void()> op);
+  /*! \brief Record the event on the given stream. */
+  void RecordEvent(Index stream_id, Index event_id);
+  /*! \brief Make the given stream wait for the latest record of the event. */
+  void WaitEvent(Index stream_id, Index event_id);
+  /*!
+   * \brief Block until all streams are idle. If an op failed since the last synchronization,
+   * the error is rethrown here.
+   */
+  void Synchronize();
+  /*! \brief Whether there may be tasks that are not synchronized yet. */
+  bool IsActive() const {
+    return active_;
+  }
+
+ private:
+  HostStream* GetStream(Index stream_id);
+  HostEvent* GetEvent(Index event_id);
+
+  std::vector<std::unique_ptr<HostEvent>> events_;
+  bool active_ = false;
+  /*! \brief The first error raised by an op since the last synchronization. Later ops are
+   * skipped once it is set, while events are still recorded so that no stream is blocked. */
+  std::exception_ptr error_;
+  std::mutex error_mu_;
+  /*! \brief Declared last so that the workers are joined before the events are destroyed. */
+  std::vector<std::unique_ptr<HostStream>> streams_;
+};
+
+}  // namespace vm
+}  // namespace executor
+}  // namespace raf
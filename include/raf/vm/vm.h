@@ -9,7 +9,9 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -27,6 +29,7 @@
 #include "raf/event_pool.h"
 #include "raf/vm/bytecode.h"
 #include "raf/vm/executable.h"
+#include "raf/vm/host_stream.h"
 #include "raf/vm/value.h"
 
 #ifdef RAF_USE_CUDA
@@ -63,6 +66,11 @@ struct VMFunction {
   std::vector<Instruction> instructions;
   /*! \brief The size of the frame for this function */
   Index register_file_size;
+  /*! \brief The size of the static arena for the storages with a planned offset. 0 means the
+   * function does not use a static arena. */
+  Index arena_size = 0;
+  /*! \brief The alignment of the static arena. */
+  Index arena_alignment = 0;
 
   VMFunction(const std::string& name, std::vector<std::string> params,
              std::vector<Instruction> instructions, Index register_file_size)
@@ -108,6 +116,42 @@ struct VMFrame {
         register_file(register_file_size),
         is_const(register_file_size, false) {
   }
+
+  /*! \brief Reinitialize a released frame for another call, reusing its register file. */
+  void Reset(Index caller_func_index, Index caller_pc, RegName caller_ret_reg, Index num_args,
+             Index register_file_size) {
+    this->caller_func_index = caller_func_index;
+    this->caller_return_pc = caller_pc;
+    this->caller_return_register = caller_ret_reg;
+    this->num_args = num_args;
+    register_file.resize(register_file_size);
+    is_const.assign(register_file_size, false);
+  }
+
+  /*! \brief Release the values held by the registers but keep the storage of the register file. */
+  void Release() {
+    register_file.clear();
+    is_const.clear();
+  }
+};
+
+/*!
+ * \brief An InvokeJit instruction reached by the walk of a kernel warmup, with the values that
+ * its OpEnv is resolved for.
+ */
+struct JitSite {
+  /*! \brief The index of the function of the instruction. */
+  Index func_index;
+  /*! \brief The program counter of the instruction. */
+  Index pc;
+  /*! \brief The op or the closure to invoke. */
+  Value callee;
+  /*! \brief The input arguments. */
+  Array<Value> args;
+  /*! \brief The output value. */
+  Value output;
+  /*! \brief The key of the OpEnv in the OpEnv cache of the instruction. */
+  std::string key;
 };
 
 /*!
@@ -117,6 +161,8 @@ class VMContextObj : public ValueObj {
  public:
   /*! \brief The current stack of call frames. */
   std::vector<VMFrame> frames;
+  /*! \brief The released frames, which are reused by later calls on this context. */
+  std::vector<VMFrame> free_frames;
   /*! \brief The fuction table index of the current function. */
   Index func_index{-1};
   /*! \brief The virtual machine PC. */
@@ -143,6 +189,17 @@ class VMContextObj : public ValueObj {
   Index current_device_id{0};
   /*! \brief The index of current working stream into cuda_streams. 0 indicates default stream. */
   Index current_stream_id{0};
+  /*! \brief The host worker threads that run the multi-stream schedule on CPU. */
+  std::shared_ptr<HostStreamPool> host_streams;
+  /*! \brief Whether the ops of the current run are launched to the host streams. It is set by
+   * the first stream instruction of the run on CPU. */
+  bool use_host_streams{false};
+  /*! \brief If set, the InvokeJit instructions are collected here instead of being executed. */
+  std::vector<JitSite>* jit_sites{nullptr};
+  /*! \brief The static arenas of the functions indexed by the function index. An arena is
+   * allocated on the first planned AllocStorage and kept with the context, so running a reused
+   * context does not touch the memory pool again. */
+  std::vector<std::shared_ptr<Memory>> arenas;
 
   void VisitAttrs(tvm::AttrVisitor* v) {
     v->Visit("func_index", &func_index);
@@ -201,6 +258,16 @@ class VMContext : public Value {
    * \param ret_reg The return register to write back in the caller.
    */
   inline void PushFrame(Index func_index, const std::vector<Value>& args, RegName ret_reg);
+  /*!
+   * \brief Push a call frame on to the call stack, passing the values of the registers of the
+   * current frame as the arguments, so that no temporary argument list is built.
+   * \param func_index The index of the VM function to invoke.
+   * \param arg_regs The registers in the current frame that hold the arguments.
+   * \param num_args The number of arguments.
+   * \param ret_reg The return register to write back in the caller.
+   */
+  inline void PushFrame(Index func_index, const RegName* arg_regs, Index num_args,
+                        RegName ret_reg);
   /*!
    * \brief Pop a frame off the call stack.
    * \return The number of frnames left.
@@ -208,13 +275,43 @@ class VMContext : public Value {
   inline Index PopFrame();
 
   RAF_MUTABLE_OBJECT_REF(VMContext, Value, VMContextObj);
+
+ private:
+  /*!
+   * \brief Push a frame with empty registers for a function and jump to its entry.
+   * \return The new frame.
+   */
+  inline VMFrame& PushEmptyFrame(Index func_index, Index num_args, RegName ret_reg);
 };
 
 using OpEnvCache = MetaCache<OpEnvPtr>;
 
+/*!
+ * \brief The OpEnv most recently resolved by an InvokeJit instruction, together with the
+ * shape/dtype signature of the registers it was resolved for.
+ */
+struct OpEnvCacheEntry {
+  /*! \brief The hash of the signature. */
+  size_t hash;
+  /*! \brief The flattened shape/dtype signature of the input and output registers. */
+  std::vector<int64_t> signature;
+  /*! \brief The resolved OpEnv. */
+  OpEnvPtr op_env;
+  /*! \brief The key of the OpEnv in the OpEnv cache. */
+  std::string key;
+};
+
 /*! \brief The OpEnv cache for a VM function. */
 class VMFuncOpEnvCache {
  public:
+  explicit VMFuncOpEnvCache(size_t num_instructions = 0)
+      : num_instructions_(num_instructions),
+        last_entries_(new std::atomic<const OpEnvCacheEntry*>[num_instructions]) {
+    for (size_t i = 0; i < num_instructions_; ++i) {
+      last_entries_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
   /*!
    * \brief Get the OpEnv cache for a given instruction.
    * \param pc The program counter
@@ -223,14 +320,98 @@ class VMFuncOpEnvCache {
   std::shared_ptr<OpEnvCache> Get(Index pc);
 
   /*!
-   * \brief Clear the OpEnv cache.
+   * \brief Get the last OpEnv resolved by a given instruction without locking.
+   * \param pc The program counter
+   * \return The last cache entry, which lives until Clear, or nullptr if the instruction has
+   * not been resolved yet.
+   */
+  const OpEnvCacheEntry* GetLastEntry(Index pc) const {
+    return pc < num_instructions_ ? last_entries_[pc].load(std::memory_order_acquire) : nullptr;
+  }
+
+  /*!
+   * \brief Record the last OpEnv resolved by a given instruction. The entries are kept per
+   * instruction and OpEnv cache key, so alternating shapes reuse them.
+   * \param pc The program counter
+   * \param hash The hash of the signature.
+   * \param signature The signature of the registers.
+   * \param op_env The resolved OpEnv.
+   * \param key The key of the OpEnv in the OpEnv cache.
+   * \return The cache entry, which lives until Clear.
+   */
+  const OpEnvCacheEntry* SetLastEntry(Index pc, size_t hash,
+                                      const std::vector<int64_t>& signature, OpEnvPtr op_env,
+                                      std::string key);
+
+  /*!
+   * \brief Get the OpEnv caches of all instructions that have been resolved.
+   * \return Pairs of the program counter and its OpEnv cache.
+   */
+  std::vector<std::pair<Index, std::shared_ptr<OpEnvCache>>> GetAll();
+
+  /*!
+   * \brief Clear the OpEnv cache. It must not run concurrently with the VM, which may hold the
+   * last cache entries.
    */
   void Clear();
 
  private:
   /*! \brief Cache map from instruction index to OpEnv cache. */
   std::unordered_map<Index, std::shared_ptr<OpEnvCache>> cache_map_;
-  /*! \brief The mutex for the cache_map_. */
+  /*! \brief The number of instructions of the function. */
+  size_t num_instructions_;
+  /*!
+   * \brief The last resolved entry of each instruction, which is a plain atomic pointer so that
+   * the common case of unchanged shapes takes no lock.
+   */
+  std::unique_ptr<std::atomic<const OpEnvCacheEntry*>[]> last_entries_;
+  /*! \brief The owned cache entries, indexed by the instruction and the OpEnv cache key. */
+  std::unordered_map<Index, std::unordered_map<std::string, std::unique_ptr<OpEnvCacheEntry>>>
+      entries_;
+  /*! \brief The entries replaced by a new signature of the same key, which may still be read. */
+  std::vector<std::unique_ptr<OpEnvCacheEntry>> retired_entries_;
+  /*! \brief The mutex for the cache_map_ and the owned entries. */
+  std::mutex mu_;
+};
+
+/*!
+ * \brief The constants of an executable on a device, which are shared by the VMs in a process
+ * that opt in. A pool lives as long as the VMs that use it, so the constants are copied to the
+ * device once no matter how many replicas of the VM run the executable.
+ */
+class SharedConstantPool {
+ public:
+  /*!
+   * \brief Get the pool of an executable on a device, which is created if no VM uses it yet.
+   * \param exec The executable.
+   * \param device The device of the constants.
+   * \return The pool.
+   */
+  static std::shared_ptr<SharedConstantPool> Get(const Executable* exec, const Device& device);
+
+  /*!
+   * \brief Get the statistics of the pools in use.
+   * \return The number of pools, and the number and the bytes of the constants in them.
+   */
+  static PackedMetricMap GetStats();
+
+  /*!
+   * \brief Get a constant, which is copied to the device by the first VM that loads it.
+   * \param exec The executable.
+   * \param const_index The index of the constant in the executable.
+   * \return The constant on the device.
+   */
+  Value Load(const Executable* exec, Index const_index);
+
+ private:
+  explicit SharedConstantPool(const Device& device) : device_(device) {
+  }
+
+  /*! \brief The device of the constants. */
+  Device device_;
+  /*! \brief The loaded constants, indexed by their indices in the executable. */
+  std::vector<Value> values_;
+  /*! \brief The mutex for the values_. */
   std::mutex mu_;
 };
 
@@ -249,6 +430,10 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
  public:
   VirtualMachine(bool enable_cuda_graph, bool dryrun)
       : exec_(nullptr), dryrun_(dryrun), enable_cuda_graph_(enable_cuda_graph) {
+    const char* disable_fast_path = getenv("RAF_VM_DISABLE_OPENV_FAST_PATH");
+    if (disable_fast_path != nullptr && strcmp(disable_fast_path, "1") == 0) {
+      use_op_env_fast_path_ = false;
+    }
 #ifndef RAF_USE_CUDA
     if (enable_cuda_graph) {
       LOG(WARNING) << "Because CUDA is not enabled in RAF, CUDA graph will be disabled in the VM.";
@@ -292,6 +477,13 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
    * \param devices The set of devices.
    */
   void SetDevices(const std::vector<Device>& devices);
+  /*!
+   * \brief Set whether the constants are loaded from the SharedConstantPool of the executable,
+   * instead of being copied to the device by this VM alone. The constants are immutable, so
+   * the VMs of the same executable and device can share them.
+   * \param share_constants Whether to share the constants.
+   */
+  void SetShareConstants(bool share_constants);
   /*!
    * \brief Prepare a VM runtime context.
    * \param func_name The entry function name.
@@ -299,6 +491,15 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
    * \return The VM context.
    */
   VMContext PrepareVMContext(const std::string& func_name, const std::vector<Value>& inputs);
+  /*!
+   * \brief Rebind the inputs of a prepared VM context in place, so that the context, including
+   * its frames, register files and static arenas, can be reused by another run. Inputs that
+   * already reside on the device are bound without a copy. In CUDA graph mode, the inputs are
+   * copied to the captured input buffers instead.
+   * \param ctx The VM context prepared for the same VM.
+   * \param inputs The new inputs to the entry function of the context.
+   */
+  void BindInputs(VMContext ctx, const std::vector<Value>& inputs);
   /*!
    * \brief Run the virtual machine.
    * \param ctx The runtime context.
@@ -335,6 +536,27 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
    */
   Array<FloatValue> Profile(VMContext ctx, int warmup, int number, int repeat);
 
+  /*!
+   * \brief Get the dispatch decisions of all OpEnvs created by this VM, which can be bundled
+   * with the executable ahead of time (see Executable::Save).
+   * \return The dispatch decisions.
+   */
+  std::vector<AOTDispatchRecord> GetDispatchRecords() const;
+
+  /*!
+   * \brief Compile the OpEnvs of a function ahead of its first run. The function is walked once
+   * without executing any op, which collects its InvokeJit instructions with their static
+   * shapes. The OpEnvs missing from the OpEnv cache are then created concurrently and cached,
+   * so the first run does not compile kernels one by one. The ops whose shapes depend on the
+   * data of other ops are not known until they run, so they are still compiled on demand.
+   * \param ctx The runtime context, which is reusable afterwards.
+   * \param num_threads The number of compile threads, or 0 to use all cores.
+   * \param progress If defined, it is called with the number of finished and total OpEnvs
+   * whenever an OpEnv is created.
+   * \return The statistics of the warmup.
+   */
+  PackedMetricMap Warmup(VMContext ctx, int num_threads, PackedFunc progress);
+
  protected:
   /*! \brief Get device for params. */
   Device GetParamsDevice() const;
@@ -350,11 +572,62 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
   inline std::shared_ptr<Memory> Alloc(const VMContext& ctx, Device dev, int64_t nbytes,
                                        int64_t alignment = kDefaultMemoryAlignment,
                                        bool alloc_async = true) const;
+  /*!
+   * \brief Get the memory at the given offset of the static arena of the current function,
+   * allocating the arena if the context does not have one yet.
+   * \param ctx The VM context.
+   * \param dev The device of the arena.
+   * \param offset The offset in the arena.
+   * \return The memory in the arena.
+   */
+  std::shared_ptr<Memory> AllocFromArena(const VMContext& ctx, Device dev, int64_t offset) const;
   /*! \brief Run VM dispatch loop. */
   virtual void RunLoop(VMContext& ctx);
-  /*! \brief Prepare an OpEnv with its inputs and output */
-  virtual std::tuple<OpEnvPtr, std::vector<Value>, Value, std::string> PrepareOpEnv(
+  /*!
+   * \brief The VM dispatch loop over the pre-decoded instruction stream.
+   * \tparam kProfiling Whether each instruction is wrapped with the profiler. The loop is
+   * specialized once per run, so the profiler is not queried per instruction when it is off.
+   */
+  template <bool kProfiling>
+  void RunDispatchLoop(VMContext& ctx);
+  /*!
+   * \brief Prepare an OpEnv with its inputs and output.
+   * \return The OpEnv, its inputs, its output and its key in the OpEnv cache. The key is owned
+   * by the OpEnv cache of the function.
+   */
+  virtual std::tuple<OpEnvPtr, std::vector<Value>, Value, const std::string*> PrepareOpEnv(
       const VMContext& ctx, const Instruction& instr);
+  /*!
+   * \brief Look up the OpEnv of an InvokeJit instruction in the OpEnv cache by its string key,
+   * and dispatch a new OpEnv on cache miss.
+   * \param ctx The VM context.
+   * \param instr The InvokeJit instruction.
+   * \param args The input arguments read from the registers.
+   * \param output The output value read from the registers.
+   * \return The OpEnv and its cache key.
+   */
+  std::pair<OpEnvPtr, std::string> LookupOpEnv(const VMContext& ctx, const Instruction& instr,
+                                               const Array<Value>& args, const Value& output);
+  /*! \brief Get the key of the OpEnv of an InvokeJit instruction in its OpEnv cache. */
+  std::string GetOpEnvKey(const VMContext& ctx, const Instruction& instr, const Array<Value>& args,
+                          const Value& output) const;
+  /*!
+   * \brief Dispatch a new OpEnv for an InvokeJit instruction. It does not touch the VM context,
+   * so it may be called from multiple threads.
+   * \param func_index The index of the function of the instruction.
+   * \param pc The program counter of the instruction.
+   * \param callee The op or the closure to invoke.
+   * \param args The input arguments.
+   * \param output The output value.
+   * \param key The key of the OpEnv in the OpEnv cache.
+   * \return The OpEnv.
+   */
+  OpEnvPtr CreateOpEnv(Index func_index, Index pc, const Value& callee, const Array<Value>& args,
+                       const Value& output, const std::string& key) const;
+  /*! \brief Fulfill the communicator and stream requests of a new OpEnv. */
+  void PrepareRequests(const VMContext& ctx, const OpEnvPtr& op_env);
+  /*! \brief Record an InvokeJit instruction in the jit sites of the context for warmup. */
+  void CollectJitSite(const VMContext& ctx, const Instruction& instr);
   /*! \brief Handle Move instruction*/
   virtual void HandleMove(VMContext& ctx, const Instruction& instr);
   /*! \brief Handle LoadConst instruction*/
@@ -397,6 +670,16 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
   virtual void HandleCudaWaitEvent(VMContext& ctx, const Instruction& instr);
   /*! \brief Handle CudaStreamBarrier instruction*/
   virtual void HandleCudaStreamBarrier(VMContext& ctx, const Instruction& instr);
+  /*!
+   * \brief Wait for the ops launched to the host streams, before the VM thread reads the data of
+   * a tensor or returns. It does nothing if the host streams are not used.
+   */
+  void SyncHostStreams(VMContext& ctx);
+  /*!
+   * \brief Release the states held by a run of the context, i.e., the CUDA graph context and the
+   * stream bound to the backends. It is called on every exit path of a run or a warmup walk.
+   */
+  void FinishRun(const VMContext& ctx);
 
  protected:
   /*! \brief The virtual machine's packed function table. */
@@ -412,17 +695,37 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
    * object to avoid rellocation of constants during inference.
    */
   std::vector<Value> const_pool_;
+  /*! \brief Whether the constants are loaded from the shared constant pool. */
+  bool share_constants_ = false;
+  /*! \brief The shared constant pool of the executable and the device, if shared. */
+  std::shared_ptr<SharedConstantPool> shared_const_pool_;
   /*!
    * \brief OpEnv cache. Each element in the vector stores the cache for the
    * corresponding VM function. It's a map from pc to the OpEnv cache.
    */
   std::vector<std::shared_ptr<VMFuncOpEnvCache>> op_env_cache_;
+  /*!
+   * \brief The dispatch decisions bundled with the executable, indexed by function, program
+   * counter and OpEnv cache key.
+   */
+  std::vector<std::unordered_map<Index, std::unordered_map<std::string, std::string>>>
+      aot_dispatch_;
+  /*!
+   * \brief The pre-decoded instruction stream of each VM function. The opcode of each instruction
+   * is decoded at load time into a dense index of its handler in the dispatch loop.
+   */
+  std::vector<std::vector<uint8_t>> dispatch_ops_;
   /*! \brief Indicates whether to dryrun (skip op execution). */
   bool dryrun_ = false;
   /*! \brief Indicates whether CUDA is used. */
   bool use_cuda_ = false;
   /*! \brief Indicates whether CUDA Graph is enabled when VM is initialized. */
   bool enable_cuda_graph_ = false;
+  /*!
+   * \brief Indicates whether InvokeJit first compares the shape/dtype signature against the last
+   * OpEnv resolved at the same instruction before building the string key of the OpEnv cache.
+   */
+  bool use_op_env_fast_path_ = true;
 
 #ifdef RAF_USE_CUDA
   /*!
@@ -439,6 +742,8 @@ class VirtualMachine : public tvm::runtime::ModuleNode {
   bool cuda_graph_occupied_ = false;
   /*! \brief The mutex to access CUDA graph related fields. */
   std::mutex cuda_graph_mutex_;
+  /*! \brief Copy the inputs to the input buffers of the captured CUDA graph. */
+  void CopyToCudaGraphInputs(const std::vector<Value>& inputs);
 #endif
 };
 
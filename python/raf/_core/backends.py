@@ -24,3 +24,16 @@ class CUDNNConfig:  # pylint: disable=too-few-public-methods
 
 
 cudnn = CUDNNConfig()
+
+
+class CPUConfig:  # pylint: disable=too-few-public-methods
+    """Native CPU dialect configuration."""
+
+    @property
+    def isa(self):
+        """Get the instruction set used by the native CPU kernels. It is detected at runtime
+        and can be lowered with the environment variable RAF_CPU_ISA."""
+        return _ffi.backend.cpu.GetISA()
+
+
+cpu = CPUConfig()
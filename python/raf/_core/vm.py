@@ -7,6 +7,7 @@ import numpy as np
 import tvm
 
 from .. import _ffi
+from .._ffi.pass_ import InferType
 from .._lib import _ByteArray
 from .._core.value import Value, TupleValue
 from . import ndarray as _nd
@@ -22,15 +23,25 @@ class Executable:
         self.mod = mod
         self._function_params = {}
         self._save = self.mod["save"]
+        self._save_aot = self.mod["save_aot"]
         self._get_lib = self.mod["get_lib"]
         self._get_bytecode = self.mod["get_bytecode"]
         self._get_stats = self.mod["get_stats"]
         self._get_function_arity = self.mod["get_function_arity"]
         self._get_function_param_name = self.mod["get_function_param_name"]
 
-    def save(self):
+    def save(self, vm=None):
         """Save the RAF VM Executable.
 
+        Parameters
+        ----------
+        vm : Optional[VirtualMachine]
+            If given, save an ahead-of-time bundle, which additionally holds the dispatch
+            decisions made by the VM for each instruction and input shapes, and the kernels
+            they use. A VM created from the loaded bundle runs the recorded
+            shapes without JIT compilation. Run the VM with the representative inputs before
+            saving the bundle.
+
         Returns
         -------
         code : bytearray
@@ -58,6 +69,11 @@ class Executable:
          - Code section. The VM functions, including bytecode, are sitting in
          this section.
 
+         - AOT section (only if vm is given). The dispatch decisions and their kernels.
+
+         - Constant blobs. The raw data of the CPU tensors in the constant pool, which starts at
+         a page boundary so that :py:meth:`load_exec_from_file` maps it without copying.
+
         Examples
         --------
 
@@ -91,6 +107,8 @@ class Executable:
             res = des_vm.run(x_data)
             print(res.numpy())
         """
+        if vm is not None:
+            return self._save_aot(vm.module), self._get_lib()
         return self._save(), self._get_lib()
 
     @staticmethod
@@ -126,6 +144,34 @@ class Executable:
 
         return Executable(_ffi.vm.Load_Executable(bytecode, lib))
 
+    @staticmethod
+    def load_exec_from_file(path, lib):
+        """Construct an executable from the bytecode saved in a file. The file is mapped into
+        memory instead of being read, and the constant tensors on CPU are bound onto the mapping.
+        Their pages are read on first use, and are shared by the processes that load the same
+        file. The file must not be modified while the executable is in use.
+
+        Parameters
+        ----------
+        path : str
+            The path of the file that holds the bytecode returned by :py:meth:`save`.
+
+        lib : :py:class:`~tvm.runtime.Module`
+            The runtime module that contains the generated code.
+
+        Returns
+        -------
+        exec: Executable
+            An executable constructed using the provided artifacts.
+        """
+        if lib is not None and not isinstance(lib, tvm.runtime.Module):
+            raise TypeError(
+                "lib is expected to be the type of tvm.runtime.Module"
+                + ", but received {}".format(type(lib))
+            )
+
+        return Executable(_ffi.vm.Load_ExecutableFromFile(str(path), lib))
+
     @property
     def lib(self):
         """Get the library that contains hardware dependent code.
@@ -436,9 +482,14 @@ class VirtualMachine:
 
     dryrun: bool
         Whether to create a dryrun VM that skips the op execution.
+
+    share_constants: bool
+        Whether to share the constants on the device with the other VMs of the same executable
+        in this process that share them as well, so that the replicas of a VM hold one copy of
+        the weights.
     """
 
-    def __init__(self, exe, device, enable_cuda_graph=False, dryrun=False):
+    def __init__(self, exe, device, enable_cuda_graph=False, dryrun=False, share_constants=False):
         if not isinstance(exe, Executable):
             raise TypeError(
                 "mod is expected to be the type of Executable, but received {}".format(type(exe))
@@ -447,8 +498,12 @@ class VirtualMachine:
         self._exec = exe
         self._set_devices = self.module["set_devices"]
         self._prepare_context = self.module["prepare_context"]
+        self._bind_inputs = self.module["bind_inputs"]
         self._run = self.module["run"]
         self._profile = self.module["profile"]
+        self._warmup = self.module["warmup"]
+        if share_constants:
+            self.module["share_constants"](True)
         self._set_devices(device)
 
     def prepare_context(self, func_name, *args, **kwargs):
@@ -470,6 +525,32 @@ class VirtualMachine:
         result : VMContext
             The initialized VM context.
         """
+        cargs = self._convert_func_args(func_name, args, kwargs)
+        return self._prepare_context(func_name, *cargs)
+
+    def bind_inputs(self, ctx, *args, func_name="main", **kwargs):
+        """Rebind the arguments of a prepared VM Context in place, so that the context can be
+        reused by another run without being created again. Arrays that already reside on the
+        device of the VM are bound without a copy.
+
+        Parameters
+        ----------
+        ctx : VMContext
+            The VM context prepared by this VM for the function.
+
+        args : list[raf.ndarray] or list[np.ndarray]
+            The arguments to the function.
+
+        func_name : str
+            The name of the function, which is used to resolve the named arguments.
+
+        kwargs: dict of str to raf.ndarray or np.ndarray
+            Named arguments to the function.
+        """
+        cargs = self._convert_func_args(func_name, args, kwargs)
+        self._bind_inputs(ctx, *cargs)
+
+    def _convert_func_args(self, func_name, args, kwargs):
         if kwargs:
             func_params = self._exec.get_function_params(func_name)
             new_args = [None] * len(func_params)
@@ -483,10 +564,9 @@ class VirtualMachine:
                     new_args[i] = args[idx]
                     idx += 1
             args = new_args
-        cargs = _convert_args(args)
-        return self._prepare_context(func_name, *cargs)
+        return _convert_args(args)
 
-    def run(self, *args, func_name="main", **kwargs):
+    def run(self, *args, func_name="main", ctx=None, **kwargs):
         """Run the virtual machine.
 
         Parameters
@@ -497,6 +577,10 @@ class VirtualMachine:
         func_name : str
             The name of function to run.
 
+        ctx : Optional[VMContext]
+            The VM context prepared for the function. If given, the arguments are rebound to
+            it and the context is reused instead of creating a new one.
+
         kwargs: dict of str to raf.ndarray or np.ndarray
             Named arguments to the function.
 
@@ -505,7 +589,10 @@ class VirtualMachine:
         result : Object
             The output.
         """
-        ctx = self.prepare_context(func_name, *args, **kwargs)
+        if ctx is None:
+            ctx = self.prepare_context(func_name, *args, **kwargs)
+        else:
+            self.bind_inputs(ctx, *args, func_name=func_name, **kwargs)
         return self._run(ctx)
 
     def profile(self, *args, func_name="main", warmup=5, number=10, repeat=10, **kwargs):
@@ -543,3 +630,226 @@ class VirtualMachine:
         ctx = self.prepare_context(func_name, *args, **kwargs)
         result = [v.value for v in self._profile(ctx, warmup, number, repeat)]
         return result
+
+    def warmup(self, *args, func_name="main", num_threads=0, progress=None, **kwargs):
+        """Compile the kernels of the function on a pool of threads ahead of the first run.
+        The function is walked with the given arguments without running the ops, so the kernels
+        whose shapes depend on the data computed by the ops are still compiled on demand.
+
+        Parameters
+        ----------
+        args : list[raf.ndarray] or list[np.ndarray]
+            The arguments to the function.
+
+        func_name : str
+            The name of the function to warmup.
+
+        num_threads : int
+            The number of compilation threads. 0 means the number of hardware threads.
+
+        progress : Optional[Callable[[int, int], None]]
+            Called with the number of finished kernels and the number of kernels to compile.
+
+        kwargs: dict of str to raf.ndarray or np.ndarray
+            Named arguments to the function.
+
+        Returns
+        -------
+        stats : Dict[str, int]
+            The number of sites, cached, compiled and failed kernels, the number of threads,
+            and the elapsed time in microseconds.
+        """
+        ctx = self.prepare_context(func_name, *args, **kwargs)
+        stats = self._warmup(ctx, num_threads, progress)
+        return {str(k): v.value for k, v in stats.items()}
+
+
+class BatchingServer:
+    """A serving front end of the VM that queues independent requests and runs them in batches.
+
+    The inputs of the queued requests are concatenated along their first axis, until the batch
+    reaches the largest batch size or the oldest request has waited for max_delay_us. The batch
+    is padded to the smallest bucketed batch size that fits, and run by the executable compiled
+    for that batch size, so the kernels of a batch size are compiled once. The rows of the
+    outputs are then scattered back to the requests.
+
+    The function takes the batched inputs first, followed by the shared inputs (e.g., the
+    weights) that are the same for all requests. Every output must be batched as well.
+
+    Parameters
+    ----------
+    executables : List[Executable]
+        The executables compiled for the batch sizes.
+
+    batch_sizes : List[int]
+        The bucketed batch sizes in the ascending order.
+
+    device : Union[str, Device]
+        The runtime context to run the code on.
+
+    input_types : List[tvm.ir.TensorType]
+        The types of the batched parameters of the function in any of the executables. The
+        batched inputs of a request must match their shapes except for the batch axes and dtypes.
+
+    shared_args : List[raf.ndarray]
+        The inputs shared by all requests.
+
+    func_name : str
+        The name of the function to serve.
+
+    max_delay_us : int
+        The max microseconds a request waits for a batch to be formed, which bounds the latency
+        added by batching.
+
+    num_workers : int
+        The number of workers, each of which runs a batch at a time with its own VMs.
+    """
+
+    # pylint: disable=too-many-arguments
+    def __init__(
+        self,
+        executables,
+        batch_sizes,
+        device,
+        input_types,
+        shared_args=(),
+        func_name="main",
+        max_delay_us=1000,
+        num_workers=1,
+    ):
+        if len(executables) != len(batch_sizes):
+            raise ValueError("Expected an executable per batch size")
+        if isinstance(device, str):
+            device = Device(device)
+        # The workers share the constants of an executable, which are the same for all batches.
+        vms = [
+            VirtualMachine(exe, device, share_constants=True).module
+            for _ in range(num_workers)
+            for exe in executables
+        ]
+        self.module = _ffi.vm.BatchingServer(
+            vms,
+            list(batch_sizes),
+            list(input_types),
+            device,
+            _convert_args(shared_args),
+            func_name,
+            max_delay_us,
+        )
+        self._submit = self.module["submit"]
+        self._get = self.module["get"]
+        self._infer = self.module["infer"]
+        self._stats = self.module["stats"]
+        self._reset_stats = self.module["reset_stats"]
+        self._stop = self.module["stop"]
+
+    @staticmethod
+    def from_model(model, device, batch_sizes, example_inputs, shared_args=(), **kwargs):
+        """Create a batching server that serves a model.
+
+        Parameters
+        ----------
+        model : raf.Model
+            The model, which takes the batched inputs first, followed by the shared inputs.
+
+        device : str
+            The device to run the model on.
+
+        batch_sizes : List[int]
+            The bucketed batch sizes in the ascending order.
+
+        example_inputs : List[raf.ndarray]
+            The batched inputs of a request, whose shapes except for the batch axis and dtypes
+            are used to compile the model for each batch size.
+
+        shared_args : List[raf.ndarray]
+            The inputs shared by all requests.
+
+        kwargs : dict
+            The other arguments of BatchingServer.
+
+        Returns
+        -------
+        server : BatchingServer
+            The batching server.
+        """
+        # pylint: disable=protected-access
+        executables = []
+        input_types = None
+        for batch_size in batch_sizes:
+            inputs = [
+                _nd.array(
+                    np.zeros((batch_size,) + tuple(x.shape[1:]), dtype=x.dtype), device=device
+                )
+                for x in example_inputs
+            ]
+            mod = model._internal(*inputs, *shared_args).mod
+            if input_types is None:
+                params = InferType()(mod)["main"].params
+                input_types = [param.checked_type for param in params[: len(example_inputs)]]
+            executables.append(compile(mod, Device(device)))
+        return BatchingServer(executables, batch_sizes, device, input_types, shared_args, **kwargs)
+
+    def submit(self, *inputs):
+        """Queue a request without waiting for it.
+
+        Parameters
+        ----------
+        inputs : List[raf.ndarray]
+            The batched inputs of the request.
+
+        Returns
+        -------
+        request_id : int
+            The id of the request to get its outputs.
+        """
+        return self._submit(*_convert_args(inputs))
+
+    def get(self, request_id):
+        """Wait for a request and get its outputs.
+
+        Parameters
+        ----------
+        request_id : int
+            The id of the request returned by submit.
+
+        Returns
+        -------
+        result : Object
+            The outputs of the request.
+        """
+        return self._get(request_id)
+
+    def infer(self, *inputs):
+        """Queue a request and wait for its outputs.
+
+        Parameters
+        ----------
+        inputs : List[raf.ndarray]
+            The batched inputs of the request.
+
+        Returns
+        -------
+        result : Object
+            The outputs of the request.
+        """
+        return self._infer(*_convert_args(inputs))
+
+    def stats(self):
+        """Get the statistics since the last reset.
+
+        Returns
+        -------
+        stats : Dict[str, int]
+            The number of requests, batches, rows and padding rows, and the 50th, 99th
+            percentile and max latency of the requests in microseconds.
+        """
+        return {str(k): v.value for k, v in self._stats().items()}
+
+    def reset_stats(self):
+        """Reset the statistics."""
+        self._reset_stats()
+
+    def stop(self):
+        """Stop the server after the queued requests are done."""
+        self._stop()
@@ -5,16 +5,30 @@
 
 from raf._ffi.memory_profiler import EnableMemoryProfiler, DisableMemoryeProfiler
 from raf._ffi.memory_profiler import ResetMemoryProfiler, GetMaxMemoryInfo, GetMemoryTrace
+from raf._ffi.memory_profiler import SetTraceAllocs, GetAllocTrace
 
 
-def start():
-    """Enable the profiler in backend to start profiling."""
-    EnableMemoryProfiler()
+def start(trace_pool=True, trace_allocations=False):
+    """Enable the profiler in backend to start profiling.
+
+    Parameters
+    ----------
+    trace_pool: bool
+        Whether to record the used and allocated memory of the pool after each op.
+
+    trace_allocations: bool
+        Whether to record every allocation and free of the memory pools with the op that owns
+        the memory. See get_allocation_trace and analyze_allocations.
+    """
+    if trace_pool:
+        EnableMemoryProfiler()
+    SetTraceAllocs(trace_allocations)
 
 
 def stop():
     """Disable the profiler in backend to stop profiling."""
     DisableMemoryeProfiler()
+    SetTraceAllocs(False)
 
 
 def reset():
@@ -53,3 +67,116 @@ def get_memory_trace(device):
         The complete trace in a string.
     """
     return GetMemoryTrace(device)
+
+
+ALLOC_EVENT_FIELDS = [
+    "nbytes",
+    "reserved_bytes",
+    "alloc_seq",
+    "free_seq",
+    "alloc_us",
+    "free_us",
+    "func_name",
+    "pc",
+    "op_name",
+    "kind",
+]
+
+
+def get_allocation_trace(device):
+    """Get the allocation events traced with start(trace_allocations=True).
+
+    Parameters
+    ----------
+    device: Device
+        The device to fetch.
+
+    Returns
+    -------
+    ret: List[Dict[str, Union[int, str]]]
+        The events in the order of their allocations. Each event has the requested and reserved
+        bytes, the sequence numbers and timestamps (in microseconds) of the allocation and the
+        free (-1 if the memory is still alive), the VM function and pc of the owning instruction,
+        the op that owns the memory, and the kind of the memory, i.e., "storage", "workspace",
+        "arena" or "external" for the memory allocated outside VMs.
+    """
+    events = []
+    for record in GetAllocTrace(device):
+        event = {}
+        for name, value in zip(ALLOC_EVENT_FIELDS, record):
+            event[name] = str(value) if isinstance(value, str) else value.value
+        events.append(event)
+    return events
+
+
+def analyze_allocations(device, top_n=10, estimated_trace=None):
+    """Analyze the allocation trace to find the peak memory and what contributes to it.
+
+    Parameters
+    ----------
+    device: Device
+        The device to analyze.
+
+    top_n: int
+        The number of top contributors at the peak to report.
+
+    estimated_trace: Optional[List[Tuple[str, float]]]
+        The memory trace in MBs estimated by the compiler, e.g., raf.model.model.trace_memory, to be
+        compared with the traced peak. Note that the traced memory only includes the memory
+        allocated after the tracing starts, so the parameters should be excluded from the
+        estimation if they were allocated before.
+
+    Returns
+    -------
+    ret: Dict[str, Any]
+        The high-water mark in MBs, the fragmentation ratio of the pool at the peak (the portion
+        of the reserved memory that is not requested), the top contributors at the peak grouped
+        by op with their MBs, and the largest live tensors at the peak. If estimated_trace is
+        given, the estimated peak in MBs and its relative error are also included.
+    """
+    events = get_allocation_trace(device)
+    deltas = []
+    for idx, event in enumerate(events):
+        deltas.append((event["alloc_seq"], idx, 1))
+        if event["free_seq"] >= 0:
+            deltas.append((event["free_seq"], idx, -1))
+    deltas.sort()
+
+    live_bytes = peak_bytes = 0
+    peak_seq = -1
+    for seq, idx, sign in deltas:
+        live_bytes += sign * events[idx]["nbytes"]
+        if live_bytes > peak_bytes:
+            peak_bytes, peak_seq = live_bytes, seq
+
+    live = [
+        event
+        for event in events
+        if 0 <= event["alloc_seq"] <= peak_seq
+        and (event["free_seq"] < 0 or event["free_seq"] > peak_seq)
+    ]
+    reserved_bytes = sum(event["reserved_bytes"] for event in live)
+    by_op = {}
+    for event in live:
+        name = event["op_name"] or "<%s>" % event["kind"]
+        by_op[name] = by_op.get(name, 0) + event["nbytes"]
+    top_ops = sorted(by_op.items(), key=lambda x: x[1], reverse=True)[:top_n]
+    top_tensors = sorted(live, key=lambda x: x["nbytes"], reverse=True)[:top_n]
+
+    mega_bytes = 1048576.0
+    ret = {
+        "high_water_mark": peak_bytes / mega_bytes,
+        "fragmentation": 1.0 - peak_bytes / reserved_bytes if reserved_bytes > 0 else 0.0,
+        "top_contributors": [(name, nbytes / mega_bytes) for name, nbytes in top_ops],
+        "top_tensors": top_tensors,
+        "num_allocs": len(events),
+    }
+    if estimated_trace:
+        estimated_peak = max(mem for _, mem in estimated_trace)
+        ret["estimated_peak"] = estimated_peak
+        ret["estimate_error"] = (
+            (estimated_peak - ret["high_water_mark"]) / ret["high_water_mark"]
+            if peak_bytes > 0
+            else 0.0
+        )
+    return ret
@@ -0,0 +1,95 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compile-time profiler of the passes run by RAFSequential."""
+
+from raf._ffi.pass_ import SetPassProfiling, ResetPassProfile, GetPassProfile
+
+PASS_RECORD_FIELDS = [
+    "seq_name",
+    "pass_name",
+    "depth",
+    "elapsed_us",
+    "peak_rss_delta_kb",
+    "rss_delta_kb",
+    "nodes_before",
+    "nodes_after",
+]
+
+
+def start():
+    """Start recording the passes run by RAFSequential."""
+    SetPassProfiling(True)
+
+
+def stop():
+    """Stop recording the passes. The records are kept until reset."""
+    SetPassProfiling(False)
+
+
+def reset():
+    """Clear the records."""
+    ResetPassProfile()
+
+
+def get_records():
+    """Get the records of the passes run since the last reset.
+
+    Returns
+    -------
+    ret: List[Dict[str, Union[int, str]]]
+        The records in the order the passes start. Each record has the name of the RAFSequential
+        and the pass, the nesting depth of the RAFSequential (0 for the outermost one), the wall
+        time in microseconds, the growth of the peak RSS and the change of the RSS of the process
+        in KBs, and the number of distinct expression nodes of the module before and after the
+        pass. A nested RAFSequential is recorded as a pass, followed by the records of its passes.
+    """
+    records = []
+    for row in GetPassProfile():
+        record = {}
+        for name, value in zip(PASS_RECORD_FIELDS, row):
+            record[name] = str(value) if isinstance(value, str) else value.value
+        records.append(record)
+    return records
+
+
+def summarize(records=None):
+    """Aggregate the records by pass, excluding the nested RAFSequentials themselves to avoid
+    counting their passes twice.
+
+    Parameters
+    ----------
+    records: Optional[List[Dict[str, Union[int, str]]]]
+        The records to aggregate. If not given, the current records are used.
+
+    Returns
+    -------
+    ret: List[Dict[str, Union[int, str]]]
+        The passes in the descending order of their total wall time. Each one has the pass name,
+        the number of runs, the total wall time in microseconds, the total growth of the peak
+        RSS in KBs, and the total change of the node count.
+    """
+    records = get_records() if records is None else records
+    nested = set()
+    for prev, curr in zip(records, records[1:]):
+        if curr["depth"] > prev["depth"]:
+            nested.add(id(prev))
+    by_pass = {}
+    for record in records:
+        if id(record) in nested:
+            continue
+        entry = by_pass.setdefault(
+            record["pass_name"],
+            {
+                "pass_name": record["pass_name"],
+                "count": 0,
+                "elapsed_us": 0,
+                "peak_rss_delta_kb": 0,
+                "nodes_delta": 0,
+            },
+        )
+        entry["count"] += 1
+        entry["elapsed_us"] += record["elapsed_us"]
+        entry["peak_rss_delta_kb"] += record["peak_rss_delta_kb"]
+        entry["nodes_delta"] += record["nodes_after"] - record["nodes_before"]
+    return sorted(by_pass.values(), key=lambda x: x["elapsed_us"], reverse=True)
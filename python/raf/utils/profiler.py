@@ -4,18 +4,34 @@
 """Runtime profiler"""
 import json
 from raf import build
-from raf._ffi.profiler import EnableProfiler, DisableProfiler
+from raf._ffi.profiler import EnableProfiler, DisableProfiler, ConfigureProfiler
 from raf._ffi.profiler import CollectBaseProfile, CollectCudaProfile, GetProfile
 
 
-def start(prof_level=1):
+def start(prof_level=1, sync_device=True, sample_rate=1, buffer_size=0):
     """Enable the profiler in backend and start to profile the execution from now.
 
+    Each thread records its events into a fixed-capacity ring buffer, so the profiler can be left
+    on in serving, with the results pulled by get() or dump() on demand.
+
     Parameters
     ----------
     prof_level : int
         Specify the profiling level.
+
+    sync_device : bool
+        Whether to synchronize the device around each profiled event, so that the event covers
+        the device execution. Disable it to profile the host without stalling the device.
+
+    sample_rate : int
+        Record one of every sample_rate events on each thread.
+
+    buffer_size : int
+        The capacity in events of the ring buffer of each thread created from now. When a buffer
+        is full, its oldest events are overwritten. 0 keeps the current capacity, which defaults
+        to the environment variable RAF_PROFILER_BUFFER_SIZE or 65536.
     """
+    ConfigureProfiler(sync_device, sample_rate, buffer_size)
     EnableProfiler(prof_level)
 
 
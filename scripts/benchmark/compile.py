@@ -0,0 +1,189 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compile-time benchmark of the VM compiler on the models in raf.testing.
+
+The benchmark compiles MLP, ResNet-50 and Inception v3 to VM executables with the pass profiler
+on. For each model, it reports the compile time, and the wall time, the peak RSS growth and the
+IR node counts of the passes run by RAFSequential, aggregated by pass. The fastest of the
+repeated compilations is reported.
+
+The results can be saved as a JSON baseline with --save. With --baseline, the results are
+compared with a saved baseline, and the passes that get slower than the threshold are listed.
+The exit code is 1 if any model or pass regresses.
+
+Usage: python3 scripts/benchmark/compile.py --models mlp resnet50 inception_v3 --save base.json
+       python3 scripts/benchmark/compile.py --baseline base.json --threshold 0.2
+"""
+# pylint: disable=missing-function-docstring, protected-access
+import argparse
+import json
+import sys
+import time
+
+import raf
+from raf._core.vm import compile as vm_compile
+from raf.testing import inception, mlp, randn_torch, resnet
+from raf.utils import pass_profiler
+
+MLP_CONFIG = (784, 10, 256, 256)
+
+
+def get_model_and_input(name, device, batch_size):
+    if name == "mlp":
+        model, _ = mlp.get_model(MLP_CONFIG)
+        m_in, _ = mlp.get_input(MLP_CONFIG, batch_size=batch_size, device=device)
+    elif name == "resnet50":
+        model, _ = resnet.get_model([3, 4, 6, 3])
+        m_in, _ = resnet.get_input(batch_size=batch_size, device=device)
+    elif name == "inception_v3":
+        model, _ = inception.get_model()
+        m_in, _ = inception.get_input(batch_size=batch_size, device=device)
+    else:
+        raise ValueError("Unknown model: %s" % name)
+    model.to(device=device)
+    return model, list(m_in)
+
+
+def get_module(name, device, batch_size, train):
+    model, m_in = get_model_and_input(name, device, batch_size)
+    if not train:
+        model.infer_mode()
+        return model._internal(m_in[0]).mod
+    model.train_mode()
+    optimizer = raf.optim.sgd.with_sgd(learning_rate=0.1, momentum=0.01)(model)
+    m_dy, _ = randn_torch((), device=device, requires_grad=False)
+    return optimizer._internal(m_dy, *m_in).mod
+
+
+def compile_once(mod, device, opt_level, config):
+    pass_profiler.reset()
+    pass_profiler.start()
+    start = time.perf_counter()
+    with raf.ir.PassContext(opt_level=opt_level, config=config):
+        mod = raf._ffi.pass_.InferType()(mod)
+        vm_compile(mod, device)
+    elapsed_ms = (time.perf_counter() - start) * 1e3
+    pass_profiler.stop()
+    records = pass_profiler.get_records()
+    pass_profiler.reset()
+    return elapsed_ms, records
+
+
+def benchmark_model(name, args):
+    mod = get_module(name, args.device, args.batch_size, args.train)
+    config = {"raf.type_infer.incremental": args.incremental_type_infer}
+    best = None
+    for _ in range(args.repeat):
+        elapsed_ms, records = compile_once(mod, args.device, args.opt_level, config)
+        if best is None or elapsed_ms < best[0]:
+            best = (elapsed_ms, records)
+    elapsed_ms, records = best
+    passes = pass_profiler.summarize(records)
+    top = [r for r in records if r["depth"] == 0]
+    return {
+        "compile_ms": elapsed_ms,
+        "nodes_before": top[0]["nodes_before"] if top else 0,
+        "nodes_after": top[-1]["nodes_after"] if top else 0,
+        "passes": {
+            p["pass_name"]: {
+                "count": p["count"],
+                "elapsed_ms": p["elapsed_us"] / 1e3,
+                "peak_rss_delta_mb": p["peak_rss_delta_kb"] / 1024.0,
+                "nodes_delta": p["nodes_delta"],
+            }
+            for p in passes
+        },
+    }
+
+
+def print_result(name, result):
+    print(
+        "%s: %.1f ms, %d -> %d nodes"
+        % (name, result["compile_ms"], result["nodes_before"], result["nodes_after"])
+    )
+    print("  %-32s %5s %12s %14s %12s" % ("pass", "runs", "time (ms)", "peak RSS (MB)", "nodes"))
+    for pass_name, entry in result["passes"].items():
+        print(
+            "  %-32s %5d %12.2f %14.1f %+12d"
+            % (
+                pass_name,
+                entry["count"],
+                entry["elapsed_ms"],
+                entry["peak_rss_delta_mb"],
+                entry["nodes_delta"],
+            )
+        )
+
+
+def compare(results, baseline, threshold, min_ms):
+    """Return the regressions, which are slower than the baseline by more than the threshold
+    and by at least min_ms, to ignore the noise of the short passes."""
+
+    def regressed(curr, base):
+        return curr - base > max(base * threshold, min_ms)
+
+    regressions = []
+    for name, result in results.items():
+        if name not in baseline:
+            continue
+        base = baseline[name]
+        if regressed(result["compile_ms"], base["compile_ms"]):
+            regressions.append((name, "<total>", base["compile_ms"], result["compile_ms"]))
+        for pass_name, entry in result["passes"].items():
+            base_entry = base["passes"].get(pass_name)
+            if base_entry and regressed(entry["elapsed_ms"], base_entry["elapsed_ms"]):
+                regressions.append(
+                    (name, pass_name, base_entry["elapsed_ms"], entry["elapsed_ms"])
+                )
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument(
+        "--models",
+        nargs="+",
+        default=["mlp", "resnet50", "inception_v3"],
+        choices=["mlp", "resnet50", "inception_v3"],
+    )
+    parser.add_argument("--device", type=str, default="cpu", help="target device")
+    parser.add_argument("--batch-size", type=int, default=1)
+    parser.add_argument("--train", action="store_true", help="compile the training graph")
+    parser.add_argument("--opt-level", type=int, default=3)
+    parser.add_argument("--repeat", type=int, default=3, help="compilations per model")
+    parser.add_argument(
+        "--incremental-type-infer",
+        action="store_true",
+        help="only re-infer the bindings changed since the last InferType",
+    )
+    parser.add_argument("--save", type=str, default=None, help="save the results as JSON")
+    parser.add_argument("--baseline", type=str, default=None, help="JSON baseline to compare")
+    parser.add_argument("--threshold", type=float, default=0.2, help="relative slowdown")
+    parser.add_argument("--min-ms", type=float, default=5.0, help="absolute slowdown")
+    args = parser.parse_args()
+
+    results = {}
+    for name in args.models:
+        results[name] = benchmark_model(name, args)
+        print_result(name, results[name])
+
+    if args.save:
+        with open(args.save, "w") as out_file:
+            json.dump(results, out_file, indent=2, sort_keys=True)
+    if args.baseline:
+        with open(args.baseline) as in_file:
+            baseline = json.load(in_file)
+        regressions = compare(results, baseline, args.threshold, args.min_ms)
+        for name, pass_name, base_ms, curr_ms in regressions:
+            print(
+                "REGRESSION %s %s: %.2f ms -> %.2f ms (%+.1f%%)"
+                % (name, pass_name, base_ms, curr_ms, (curr_ms / max(base_ms, 1e-3) - 1) * 100)
+            )
+        if regressions:
+            sys.exit(1)
+        print("No regression against %s" % args.baseline)
+
+
+if __name__ == "__main__":
+    main()
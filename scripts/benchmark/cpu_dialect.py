@@ -0,0 +1,105 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Microbenchmark of the native CPU dialect against the TVM dialect.
+
+Each op is compiled with fusion disabled and dispatched to the given dialect only, so that the
+latency is the one of a single kernel. The instruction set of the native kernels can be lowered
+with the environment variable RAF_CPU_ISA (scalar, avx2 or avx512).
+
+Usage: python3 scripts/benchmark/cpu_dialect.py --ops softmax layer_norm --rows 4096 --cols 1024
+"""
+# pylint: disable=missing-function-docstring, missing-class-docstring, protected-access
+import argparse
+
+import numpy as np
+
+import raf
+from raf._op.dialect import DialectPreference
+from raf.testing import get_vm_profiler, randn, randint
+
+
+class OpModel(raf.Model):
+    # pylint: disable=attribute-defined-outside-init
+    def build(self, op):
+        self.op = op
+
+    @raf.model.trace
+    def forward(self, *inputs):
+        if self.op == "softmax":
+            return raf.softmax(inputs[0], axis=-1)
+        if self.op == "log_softmax":
+            return raf.log_softmax(inputs[0], axis=-1)
+        if self.op == "layer_norm":
+            return raf.layer_norm(*inputs, axis=-1, eps=1e-5)
+        if self.op == "embedding":
+            return raf.embedding(*inputs)
+        if self.op == "cast_fp16":
+            return raf.cast(inputs[0], "float16")
+        assert self.op == "cast_fp32"
+        return raf.cast(inputs[0], "float32")
+
+
+def make_inputs(op, rows, cols):
+    if op == "layer_norm":
+        return [randn([rows, cols])[0], randn([cols])[0], randn([cols])[0]]
+    if op == "embedding":
+        return [randn([rows, cols])[0], randint([rows], low=0, high=rows)[0]]
+    if op == "cast_fp32":
+        return [randn([rows, cols], dtype="float16")[0]]
+    return [randn([rows, cols])[0]]
+
+
+def profile(op, rows, cols, dialect, warmup, number, repeat):
+    model = OpModel(op)
+    model.infer_mode()
+    inputs = make_inputs(op, rows, cols)
+    with DialectPreference([dialect]):
+        mod = model._internal(*inputs).mod
+        profiler = get_vm_profiler(
+            mod, "cpu", disable_fusion=True, warmup=warmup, number=number, repeat=repeat
+        )
+        return np.mean(profiler(*inputs))
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument(
+        "--ops",
+        type=str,
+        nargs="+",
+        default=["softmax", "log_softmax", "layer_norm", "embedding", "cast_fp16", "cast_fp32"],
+        help="ops to benchmark",
+    )
+    parser.add_argument("--rows", type=int, nargs="+", default=[128, 4096], help="number of rows")
+    parser.add_argument("--cols", type=int, nargs="+", default=[768, 1024], help="row length")
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--number", type=int, default=100)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    print("Native CPU kernels use %s" % raf._core.backends.cpu.isa)
+    print("%-12s %12s %12s %12s %8s" % ("op", "shape", "tvm (ms)", "cpu (ms)", "speedup"))
+    for op in args.ops:
+        for rows in args.rows:
+            for cols in args.cols:
+                latency = {
+                    dialect: profile(
+                        op, rows, cols, dialect, args.warmup, args.number, args.repeat
+                    )
+                    for dialect in ["tvm", "cpu"]
+                }
+                print(
+                    "%-12s %12s %12.4f %12.4f %7.2fx"
+                    % (
+                        op,
+                        "%dx%d" % (rows, cols),
+                        latency["tvm"],
+                        latency["cpu"],
+                        latency["tvm"] / latency["cpu"],
+                    )
+                )
+
+
+if __name__ == "__main__":
+    main()
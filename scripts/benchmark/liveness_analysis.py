@@ -0,0 +1,74 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compile-time benchmark of the liveness analysis and the memory passes built on it.
+
+The benchmark builds a synthetic function in ANF with the given number of ops, in which each add
+reads the output of the previous op and the one of `skip` ops before, so every line has about
+`skip` live tensors, as in an unrolled residual network. It reports the compile time of the
+liveness analysis itself, of the memory planning after ManifestAlloc, and of the
+rematerialization with the roofline cost model under a memory budget of half the peak memory.
+
+Usage: python3 scripts/benchmark/liveness_analysis.py --num-ops 100000 --skip 8
+"""
+# pylint: disable=missing-function-docstring, protected-access
+import argparse
+import time
+
+import raf
+from raf._lib import tvm, relay
+from raf.ir import ScopeBuilder
+from raf._ffi.pass_ import InferType, LivenessAnalysis, ManifestAlloc, MemoryPlan
+from raf._ffi.pass_ import InlinePrimitives, Rematerialization
+
+ROOFLINE = {
+    "raf.cost_model.roofline.peak_gflops": 1000.0,
+    "raf.cost_model.roofline.bandwidth_gbps": 100.0,
+    "raf.cost_model.roofline.launch_overhead_us": 5.0,
+}
+
+
+def build_mod(num_ops, skip, shape):
+    sb = ScopeBuilder()
+    p0 = raf.ir.var("p0", shape=shape)
+    outs = [p0]
+    for i in range(num_ops):
+        outs.append(sb.let("a%d" % i, raf.ir.op.add(outs[i], outs[max(i + 1 - skip, 0)])))
+    sb.ret(outs[-1])
+    return InferType()(tvm.IRModule.from_expr(relay.Function([p0], sb.get())))
+
+
+def measure(name, func):
+    start = time.perf_counter()
+    ret = func()
+    print("%-18s: %.3f s" % (name, time.perf_counter() - start))
+    return ret
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--num-ops", type=int, default=100000, help="number of ops")
+    parser.add_argument("--skip", type=int, default=8, help="distance of the residual input")
+    parser.add_argument("--size", type=int, default=256, help="size of the square tensors")
+    args = parser.parse_args()
+
+    shape = (args.size, args.size)
+    mod = measure("build", lambda: build_mod(args.num_ops, args.skip, shape))
+    live_in = measure("liveness", lambda: LivenessAnalysis(mod))
+    print("%d lines, peak %d live tensors" % (len(live_in), max(len(v) for v in live_in.values())))
+
+    alloc_mod = InferType()(ManifestAlloc()(mod))
+    measure("memory plan", lambda: MemoryPlan()(alloc_mod))
+
+    peak_mbs = (args.skip + 2) * args.size * args.size * 4 / 1048576
+    config = dict(ROOFLINE)
+    config["raf.memory_budget"] = int(peak_mbs / 2 * 1048576)
+    config["raf.remat.cost_model"] = "roofline"
+    with raf.Device("cpu"):
+        with raf.ir.PassContext(config=config):
+            remat_mod = InlinePrimitives()(mod)
+            measure("rematerialization", lambda: Rematerialization()(remat_mod))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Load generator for the batching server of the VM.
+
+The benchmark sends single-row MLP requests in an open loop with Poisson arrivals at the given
+rate. It reports the throughput and the tail latency in two setups. In the first, every request
+runs alone. In the second, the queued requests are batched up to the max batch size or the max
+delay.
+
+Usage: python3 scripts/benchmark/vm_batching.py --rate 2000 --max-batch 16 --max-delay-us 1000
+"""
+# pylint: disable=missing-function-docstring, missing-class-docstring
+import argparse
+import time
+
+import numpy as np
+
+import raf
+from raf._core.vm import BatchingServer
+from raf.testing import randn
+
+
+class MLP(raf.Model):
+    # pylint: disable=attribute-defined-outside-init
+    def build(self, num_layers):
+        self.num_layers = num_layers
+
+    @raf.model.trace
+    def forward(self, x, w):
+        for _ in range(self.num_layers):
+            x = raf.relu(raf.matmul(x, w))
+        return x
+
+
+def generate_load(server, requests, rate, seed=0):
+    """Send the requests at Poisson arrivals, then wait for all of them."""
+    rng = np.random.RandomState(seed)
+    arrivals = np.cumsum(rng.exponential(1.0 / rate, len(requests)))
+    server.reset_stats()
+    start = time.perf_counter()
+    ids = []
+    for arrival, m_x in zip(arrivals, requests):
+        delay = start + arrival - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+        ids.append(server.submit(m_x))
+    for request_id in ids:
+        server.get(request_id)
+    elapsed = time.perf_counter() - start
+    return len(requests) / elapsed, server.stats()
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--num-layers", type=int, default=4, help="number of MLP layers")
+    parser.add_argument("--hidden", type=int, default=256, help="hidden size")
+    parser.add_argument("--device", type=str, default="cpu", help="target device")
+    parser.add_argument("--rate", type=float, default=2000, help="requests per second")
+    parser.add_argument("--max-batch", type=int, default=16, help="max batch size")
+    parser.add_argument("--max-delay-us", type=int, default=1000, help="max batching delay")
+    parser.add_argument("--num-workers", type=int, default=1, help="number of workers")
+    parser.add_argument("--warmup", type=int, default=200)
+    parser.add_argument("--number", type=int, default=5000)
+    args = parser.parse_args()
+
+    model = MLP(args.num_layers)
+    model.infer_mode()
+    m_x, _ = randn((1, args.hidden), device=args.device)
+    m_w, _ = randn((args.hidden, args.hidden), device=args.device)
+    requests = [randn((1, args.hidden), device=args.device)[0] for _ in range(16)]
+    requests = [requests[i % len(requests)] for i in range(args.number)]
+
+    batch_sizes = [1]
+    while batch_sizes[-1] < args.max_batch:
+        batch_sizes.append(min(batch_sizes[-1] * 2, args.max_batch))
+    setups = [("unbatched", [1], 0), ("batched", batch_sizes, args.max_delay_us)]
+    for name, sizes, max_delay_us in setups:
+        server = BatchingServer.from_model(
+            model,
+            args.device,
+            sizes,
+            [m_x],
+            [m_w],
+            max_delay_us=max_delay_us,
+            num_workers=args.num_workers,
+        )
+        generate_load(server, requests[: args.warmup], args.rate)
+        throughput, stats = generate_load(server, requests, args.rate)
+        server.stop()
+        print(
+            "%-9s: %.1f requests/sec, %.2f rows/batch, p50 %.3f ms, p99 %.3f ms, max %.3f ms"
+            % (
+                name,
+                throughput,
+                stats["num_rows"] / max(stats["num_batches"], 1),
+                stats["latency_p50_us"] / 1e3,
+                stats["latency_p99_us"] / 1e3,
+                stats["latency_max_us"] / 1e3,
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,88 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Microbenchmark of the bytecode dispatch loop of the RAF VM.
+
+The benchmark builds a control-heavy program of tiny ops with fusion disabled: each step splits
+a tensor into a tuple, reads its fields and concatenates them back, so most instructions are
+GetField, AllocTuple and allocation instructions instead of kernels. The VM runs in dryrun mode,
+which skips the kernels, so the latency is the cost of the dispatch loop and the handlers. It
+reports the average latency per executed instruction with the per-instruction profiler off and
+on (profiling level 2).
+
+To compare the computed-goto dispatch with the switch dispatch, rebuild with
+-DRAF_VM_DISABLE_COMPUTED_GOTO in CMAKE_CXX_FLAGS and rerun.
+
+Usage: python3 scripts/benchmark/vm_bytecode.py --num-steps 256 --dryrun
+"""
+# pylint: disable=missing-function-docstring, missing-class-docstring
+import argparse
+import re
+import time
+
+import raf
+from raf._core.executor import VMExecutor
+from raf.testing import randn
+from raf.utils import profiler
+
+
+class SplitConcatModel(raf.Model):
+    # pylint: disable=attribute-defined-outside-init
+    def build(self, num_steps):
+        self.num_steps = num_steps
+
+    @raf.model.trace
+    def forward(self, x):
+        for _ in range(self.num_steps):
+            y = raf.split(x, 2)
+            x = raf.concatenate([y[1], y[0]])
+        return x
+
+
+def count_instructions(executable):
+    return sum(int(n) for n in re.findall(r"# instruction count = (\d+)", executable.bytecode))
+
+
+def measure(vm, m_x, warmup, number, prof_level):
+    for _ in range(warmup):
+        vm.run(m_x)
+    if prof_level > 0:
+        profiler.start(prof_level=prof_level)
+    start = time.perf_counter()
+    for _ in range(number):
+        vm.run(m_x)
+    elapsed = time.perf_counter() - start
+    if prof_level > 0:
+        profiler.stop()
+        profiler.get()
+    return elapsed / number
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--num-steps", type=int, default=256, help="number of split/concat steps")
+    parser.add_argument("--device", type=str, default="cpu", help="target device")
+    parser.add_argument("--dryrun", action="store_true", help="skip the kernels")
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--number", type=int, default=100)
+    args = parser.parse_args()
+
+    model = SplitConcatModel(args.num_steps)
+    model.infer_mode()
+    m_x, _ = randn([2], device=args.device)
+    mod = model._internal(m_x).mod  # pylint: disable=protected-access
+    with raf.ir.PassContext(disabled_pass=["FuseDialect", "FuseTVM"]):
+        executor = VMExecutor(mod, args.device, dryrun=args.dryrun)
+    num_instrs = count_instructions(executor.executable)
+    print("%d instructions, dryrun %s" % (num_instrs, "on" if args.dryrun else "off"))
+
+    for prof_level in [0, 2]:
+        latency = measure(executor.vm, m_x, args.warmup, args.number, prof_level)
+        print(
+            "profiling level %d: %.3f ms per run, %.1f ns per instruction"
+            % (prof_level, latency * 1e3, latency * 1e9 / num_instrs)
+        )
+
+
+if __name__ == "__main__":
+    main()
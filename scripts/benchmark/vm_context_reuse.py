@@ -0,0 +1,70 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Microbenchmark of the per-request overhead of preparing a VM context.
+
+The benchmark serves a small MLP request by request, and reports the throughput when a fresh
+VM context is prepared for every request, and when one context is prepared once and reused
+with its inputs rebound.
+
+Usage: python3 scripts/benchmark/vm_context_reuse.py --num-layers 4 --hidden 64 --batch 1
+"""
+# pylint: disable=missing-function-docstring, missing-class-docstring
+import argparse
+import time
+
+import raf
+from raf._core.executor import VMExecutor
+from raf.testing import randn
+
+
+class MLP(raf.Model):
+    # pylint: disable=attribute-defined-outside-init
+    def build(self, num_layers):
+        self.num_layers = num_layers
+
+    @raf.model.trace
+    def forward(self, x, w):
+        for _ in range(self.num_layers):
+            x = raf.relu(raf.matmul(x, w))
+        return x
+
+
+def serve(vm, requests, m_w, reuse):
+    ctx = vm.prepare_context("main", requests[0], m_w) if reuse else None
+    start = time.perf_counter()
+    for m_x in requests:
+        vm.run(m_x, m_w, ctx=ctx)
+    return len(requests) / (time.perf_counter() - start)
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--num-layers", type=int, default=4, help="number of MLP layers")
+    parser.add_argument("--hidden", type=int, default=64, help="hidden size")
+    parser.add_argument("--batch", type=int, default=1, help="batch size of a request")
+    parser.add_argument("--device", type=str, default="cpu", help="target device")
+    parser.add_argument("--warmup", type=int, default=100)
+    parser.add_argument("--number", type=int, default=2000)
+    args = parser.parse_args()
+
+    model = MLP(args.num_layers)
+    model.infer_mode()
+    m_x, _ = randn((args.batch, args.hidden), device=args.device)
+    m_w, _ = randn((args.hidden, args.hidden), device=args.device)
+    mod = model._internal(m_x, m_w).mod  # pylint: disable=protected-access
+    vm = VMExecutor(mod, args.device).vm
+    requests = [randn((args.batch, args.hidden), device=args.device)[0] for _ in range(16)]
+    requests = [requests[i % len(requests)] for i in range(args.number)]
+
+    for reuse in [False, True]:
+        serve(vm, requests[: args.warmup], m_w, reuse)
+        throughput = serve(vm, requests, m_w, reuse)
+        print(
+            "%-13s: %.1f requests/sec"
+            % ("reused ctx" if reuse else "fresh ctx", throughput)
+        )
+
+
+if __name__ == "__main__":
+    main()
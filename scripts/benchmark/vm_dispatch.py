@@ -0,0 +1,68 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+"""Microbenchmark of the per-instruction dispatch overhead of the RAF VM.
+
+The benchmark builds a chain of small elementwise ops with fusion disabled, so that the
+end-to-end latency is dominated by the VM instead of the kernels. It reports the average
+latency per InvokeJit instruction with and without the OpEnv fast path.
+
+Usage: python3 scripts/benchmark/vm_dispatch.py --num-ops 256 --shape 1
+"""
+# pylint: disable=missing-function-docstring, missing-class-docstring
+import argparse
+import os
+
+import numpy as np
+
+import raf
+from raf.testing import get_vm_profiler, randn
+
+
+class ChainModel(raf.Model):
+    # pylint: disable=attribute-defined-outside-init
+    def build(self, num_ops):
+        self.num_ops = num_ops
+
+    @raf.model.trace
+    def forward(self, x):
+        for _ in range(self.num_ops):
+            x = raf.add(x, x)
+        return x
+
+
+def profile(mod, m_x, device, warmup, number, repeat, fast_path):
+    os.environ["RAF_VM_DISABLE_OPENV_FAST_PATH"] = "0" if fast_path else "1"
+    profiler = get_vm_profiler(
+        mod, device, disable_fusion=True, warmup=warmup, number=number, repeat=repeat
+    )
+    return np.mean(profiler(m_x))
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--num-ops", type=int, default=256, help="number of chained ops")
+    parser.add_argument("--shape", type=int, nargs="+", default=[1], help="input shape")
+    parser.add_argument("--device", type=str, default="cpu", help="target device")
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--number", type=int, default=100)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    model = ChainModel(args.num_ops)
+    model.infer_mode()
+    m_x, _ = randn(args.shape, device=args.device)
+    mod = model._internal(m_x).mod  # pylint: disable=protected-access
+
+    for fast_path in [False, True]:
+        latency = profile(
+            mod, m_x, args.device, args.warmup, args.number, args.repeat, fast_path
+        )
+        print(
+            "OpEnv fast path %-3s: %.3f ms per run, %.3f us per InvokeJit"
+            % ("on" if fast_path else "off", latency, latency * 1000.0 / args.num_ops)
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,612 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/distributed/common/shm_communicator.cc
+ * \brief Shared-memory Communicator.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "raf/device.h"
+#include "raf/registry.h"
+#include "raf/shm_communicator.h"
+
+namespace raf {
+namespace distributed {
+namespace communicator {
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "The atomics in the shared memory segment must be lock-free");
+
+/*! \brief The magic number marking an initialized segment. */
+constexpr uint64_t kSHMMagic = 0x52414653484d0001ULL;
+/*! \brief The default size of a staging slot. */
+constexpr int64_t kDefaultChunkBytes = 1 << 20;
+/*! \brief The minimum size of a staging slot. */
+constexpr int64_t kMinChunkBytes = 4096;
+/*! \brief The alignment of the slots and of the slices reduced by each rank. */
+constexpr int64_t kSHMAlign = 64;
+/*! \brief The number of busy-wait iterations before yielding the CPU. */
+constexpr int kSpinCount = 1024;
+/*! \brief The time to wait for the other ranks to create or attach the segment. */
+constexpr std::chrono::seconds kAttachTimeout(300);
+
+/*! \brief A sense-reversing barrier. */
+struct alignas(kSHMAlign) SHMBarrier {
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> generation;
+};
+
+/*! \brief The sequence numbers of the mailbox from one rank to another. */
+struct alignas(kSHMAlign) SHMChannel {
+  std::atomic<uint64_t> posted;
+  std::atomic<uint64_t> consumed;
+};
+
+/*!
+ * \brief The header of a segment, which is followed by:
+ *  - size * size channels, one per (sender, receiver) pair;
+ *  - 2 sets of size staging slots of chunk_bytes, used alternately by consecutive steps;
+ *  - 2 result slots of chunk_bytes, used alternately by consecutive steps;
+ *  - size * size mailboxes of chunk_bytes, one per (sender, receiver) pair.
+ */
+struct alignas(kSHMAlign) SHMHeader {
+  std::atomic<uint64_t> magic;
+  int64_t size;
+  int64_t chunk_bytes;
+  /*! \brief The process ID and start time of rank 0, which identify the job of the segment. */
+  int64_t creator_pid;
+  uint64_t creator_start_time;
+  SHMBarrier barrier;
+};
+
+inline int64_t RoundUp(int64_t x, int64_t align) {
+  return (x + align - 1) / align * align;
+}
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/*! \brief Busy-wait until the condition holds, and yield the CPU if it takes a while. */
+template <typename F>
+inline void SpinUntil(F cond) {
+  for (int i = 0; !cond(); ++i) {
+    if (i < kSpinCount) {
+      CpuRelax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*! \brief The offsets of the regions in a segment. */
+struct SHMLayout {
+  int64_t size;
+  int64_t chunk_bytes;
+  int64_t channels;
+  int64_t slots;
+  int64_t results;
+  int64_t mailboxes;
+  int64_t total;
+
+  SHMLayout(int64_t size, int64_t chunk_bytes) : size(size), chunk_bytes(chunk_bytes) {
+    channels = RoundUp(sizeof(SHMHeader), kSHMAlign);
+    slots = RoundUp(channels + size * size * sizeof(SHMChannel), kSHMAlign);
+    results = slots + 2 * size * chunk_bytes;
+    mailboxes = results + 2 * chunk_bytes;
+    total = mailboxes + size * size * chunk_bytes;
+  }
+};
+
+inline SHMHeader* Header(uint8_t* segment) {
+  return reinterpret_cast<SHMHeader*>(segment);
+}
+
+inline SHMChannel* Channel(const SHMCommunicatorObj* comm, int src, int dst) {
+  SHMLayout layout(comm->size, comm->chunk_bytes);
+  return reinterpret_cast<SHMChannel*>(comm->segment + layout.channels) + src * comm->size + dst;
+}
+
+/*! \brief The staging slot of the rank at the step. */
+inline uint8_t* Slot(const SHMCommunicatorObj* comm, uint64_t step, int rank) {
+  SHMLayout layout(comm->size, comm->chunk_bytes);
+  return comm->segment + layout.slots + ((step % 2) * comm->size + rank) * comm->chunk_bytes;
+}
+
+inline uint8_t* Result(const SHMCommunicatorObj* comm, uint64_t step) {
+  SHMLayout layout(comm->size, comm->chunk_bytes);
+  return comm->segment + layout.results + (step % 2) * comm->chunk_bytes;
+}
+
+inline uint8_t* Mailbox(const SHMCommunicatorObj* comm, int src, int dst) {
+  SHMLayout layout(comm->size, comm->chunk_bytes);
+  return comm->segment + layout.mailboxes + (src * comm->size + dst) * comm->chunk_bytes;
+}
+
+template <typename T>
+struct SumOp {
+  static T Apply(T a, T b) {
+    return a + b;
+  }
+};
+
+template <typename T>
+struct ProdOp {
+  static T Apply(T a, T b) {
+    return a * b;
+  }
+};
+
+template <typename T>
+struct MinOp {
+  static T Apply(T a, T b) {
+    return b < a ? b : a;
+  }
+};
+
+template <typename T>
+struct MaxOp {
+  static T Apply(T a, T b) {
+    return a < b ? b : a;
+  }
+};
+
+/*!
+ * \brief Reduce the slices of all ranks element-wise into dst. The slices are combined in the
+ * order of the ranks, so all ranks get bitwise identical results. The loops have no
+ * dependency across elements and are vectorized by the compiler.
+ */
+template <typename T, typename Op>
+void ReduceSlicesWith(T* __restrict__ dst, const uint8_t* const* srcs, int num_srcs, int64_t n) {
+  const T* __restrict__ a = reinterpret_cast<const T*>(srcs[0]);
+  const T* __restrict__ b = reinterpret_cast<const T*>(srcs[1]);
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = Op::Apply(a[i], b[i]);
+  }
+  for (int s = 2; s < num_srcs; ++s) {
+    const T* __restrict__ src = reinterpret_cast<const T*>(srcs[s]);
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = Op::Apply(dst[i], src[i]);
+    }
+  }
+}
+
+template <typename T>
+void ReduceSlicesTyped(void* dst_ptr, const uint8_t* const* srcs, int num_srcs, int64_t n,
+                       SHMReduceOp op) {
+  T* dst = static_cast<T*>(dst_ptr);
+  switch (op) {
+    case SHMReduceOp::kSum:
+    case SHMReduceOp::kAvg:
+      ReduceSlicesWith<T, SumOp<T>>(dst, srcs, num_srcs, n);
+      break;
+    case SHMReduceOp::kProd:
+      ReduceSlicesWith<T, ProdOp<T>>(dst, srcs, num_srcs, n);
+      break;
+    case SHMReduceOp::kMin:
+      ReduceSlicesWith<T, MinOp<T>>(dst, srcs, num_srcs, n);
+      break;
+    case SHMReduceOp::kMax:
+      ReduceSlicesWith<T, MaxOp<T>>(dst, srcs, num_srcs, n);
+      break;
+  }
+  if (op == SHMReduceOp::kAvg) {
+    const T divisor = static_cast<T>(num_srcs);
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = dst[i] / divisor;
+    }
+  }
+}
+
+void ReduceSlices(DLDataType dtype, void* dst, const uint8_t* const* srcs, int num_srcs,
+                  int64_t n, SHMReduceOp op) {
+  if (dtype.lanes == 1) {
+    switch (dtype.code) {
+      case kDLFloat:
+        if (dtype.bits == 32) return ReduceSlicesTyped<float>(dst, srcs, num_srcs, n, op);
+        if (dtype.bits == 64) return ReduceSlicesTyped<double>(dst, srcs, num_srcs, n, op);
+        break;
+      case kDLInt:
+        if (dtype.bits == 8) return ReduceSlicesTyped<int8_t>(dst, srcs, num_srcs, n, op);
+        if (dtype.bits == 32) return ReduceSlicesTyped<int32_t>(dst, srcs, num_srcs, n, op);
+        if (dtype.bits == 64) return ReduceSlicesTyped<int64_t>(dst, srcs, num_srcs, n, op);
+        break;
+      case kDLUInt:
+        if (dtype.bits == 8) return ReduceSlicesTyped<uint8_t>(dst, srcs, num_srcs, n, op);
+        break;
+    }
+  }
+  LOG(FATAL) << "NotImplementedError: SHMCommunicator does not support " << DType(dtype).c_str();
+}
+
+SHMReduceOp ParseSHMReduceOp(const std::string& computation) {
+  if (computation == "sum") return SHMReduceOp::kSum;
+  if (computation == "prod") return SHMReduceOp::kProd;
+  if (computation == "min") return SHMReduceOp::kMin;
+  if (computation == "max") return SHMReduceOp::kMax;
+  if (computation == "avg") return SHMReduceOp::kAvg;
+  LOG(FATAL) << "Invalid computation " << computation;
+  throw;
+}
+
+SHMCommunicatorObj::~SHMCommunicatorObj() {
+  if (segment != nullptr) {
+    munmap(segment, segment_bytes);
+  }
+}
+
+void SHMCommunicatorObj::Barrier() {
+  if (segment == nullptr) return;
+  SHMBarrier& barrier = Header(segment)->barrier;
+  uint32_t generation = barrier.generation.load(std::memory_order_acquire);
+  if (barrier.count.fetch_add(1, std::memory_order_acq_rel) == static_cast<uint32_t>(size - 1)) {
+    barrier.count.store(0, std::memory_order_relaxed);
+    barrier.generation.fetch_add(1, std::memory_order_release);
+  } else {
+    SpinUntil([&]() { return barrier.generation.load(std::memory_order_acquire) != generation; });
+  }
+}
+
+void SHMCommunicatorObj::ReduceImpl(const void* send_buf, void* recv_buf, int64_t count,
+                                    DLDataType dtype, SHMReduceOp op, int root) {
+  const int64_t elem_bytes = (dtype.bits * dtype.lanes + 7) / 8;
+  const uint8_t* send = static_cast<const uint8_t*>(send_buf);
+  uint8_t* recv = static_cast<uint8_t*>(recv_buf);
+  if (size == 1) {
+    if (recv != send) std::memcpy(recv, send, count * elem_bytes);
+    return;
+  }
+  const int64_t chunk_elems = chunk_bytes / elem_bytes;
+  const int64_t align_elems = std::max<int64_t>(1, kSHMAlign / elem_bytes);
+  std::vector<const uint8_t*> srcs(size);
+  for (int64_t begin = 0; begin < count; begin += chunk_elems, ++step) {
+    const int64_t n = std::min(chunk_elems, count - begin);
+    // Stage the chunk of this rank.
+    std::memcpy(Slot(this, step, rank), send + begin * elem_bytes, n * elem_bytes);
+    Barrier();
+    // Reduce the slice of this rank across all ranks.
+    const int64_t slice = RoundUp((n + size - 1) / size, align_elems);
+    const int64_t slice_begin = std::min(n, rank * slice);
+    const int64_t slice_end = std::min(n, slice_begin + slice);
+    if (slice_end > slice_begin) {
+      for (int r = 0; r < size; ++r) {
+        srcs[r] = Slot(this, step, r) + slice_begin * elem_bytes;
+      }
+      ReduceSlices(dtype, Result(this, step) + slice_begin * elem_bytes, srcs.data(), size,
+                   slice_end - slice_begin, op);
+    }
+    Barrier();
+    if (root < 0 || root == rank) {
+      std::memcpy(recv + begin * elem_bytes, Result(this, step), n * elem_bytes);
+    }
+  }
+}
+
+void SHMCommunicatorObj::AllReduce(const void* send_buf, void* recv_buf, int64_t count,
+                                   DLDataType dtype, SHMReduceOp op) {
+  ReduceImpl(send_buf, recv_buf, count, dtype, op, -1);
+}
+
+void SHMCommunicatorObj::Reduce(const void* send_buf, void* recv_buf, int64_t count,
+                                DLDataType dtype, SHMReduceOp op, int root) {
+  CHECK(root >= 0 && root < size) << "Invalid root " << root;
+  ReduceImpl(send_buf, recv_buf, count, dtype, op, root);
+}
+
+void SHMCommunicatorObj::AllGather(const void* send_buf, void* recv_buf, int64_t bytes) {
+  const uint8_t* send = static_cast<const uint8_t*>(send_buf);
+  uint8_t* recv = static_cast<uint8_t*>(recv_buf);
+  if (size == 1) {
+    if (recv != send) std::memcpy(recv, send, bytes);
+    return;
+  }
+  for (int64_t begin = 0; begin < bytes; begin += chunk_bytes, ++step) {
+    const int64_t n = std::min(chunk_bytes, bytes - begin);
+    std::memcpy(Slot(this, step, rank), send + begin, n);
+    Barrier();
+    for (int r = 0; r < size; ++r) {
+      uint8_t* dst = recv + r * bytes + begin;
+      if (dst != send + begin) {
+        std::memcpy(dst, Slot(this, step, r), n);
+      }
+    }
+  }
+}
+
+void SHMCommunicatorObj::ReduceScatter(const void* send_buf, void* recv_buf, int64_t recv_count,
+                                       DLDataType dtype, SHMReduceOp op) {
+  const int64_t elem_bytes = (dtype.bits * dtype.lanes + 7) / 8;
+  const uint8_t* send = static_cast<const uint8_t*>(send_buf);
+  uint8_t* recv = static_cast<uint8_t*>(recv_buf);
+  if (size == 1) {
+    if (recv != send) std::memcpy(recv, send, recv_count * elem_bytes);
+    return;
+  }
+  // Each slot holds the same range of the slices of all ranks.
+  const int64_t block_elems = chunk_bytes / size / elem_bytes;
+  CHECK_GT(block_elems, 0) << "RAF_SHM_CHUNK_BYTES is too small for " << size << " ranks";
+  std::vector<const uint8_t*> srcs(size);
+  for (int64_t begin = 0; begin < recv_count; begin += block_elems, ++step) {
+    const int64_t n = std::min(block_elems, recv_count - begin);
+    uint8_t* slot = Slot(this, step, rank);
+    for (int r = 0; r < size; ++r) {
+      std::memcpy(slot + r * block_elems * elem_bytes, send + (r * recv_count + begin) * elem_bytes,
+                  n * elem_bytes);
+    }
+    Barrier();
+    for (int r = 0; r < size; ++r) {
+      srcs[r] = Slot(this, step, r) + rank * block_elems * elem_bytes;
+    }
+    ReduceSlices(dtype, recv + begin * elem_bytes, srcs.data(), size, n, op);
+  }
+}
+
+void SHMCommunicatorObj::Broadcast(const void* send_buf, void* recv_buf, int64_t bytes, int root) {
+  CHECK(root >= 0 && root < size) << "Invalid root " << root;
+  const uint8_t* send = static_cast<const uint8_t*>(send_buf);
+  uint8_t* recv = static_cast<uint8_t*>(recv_buf);
+  if (size == 1) {
+    if (recv != send) std::memcpy(recv, send, bytes);
+    return;
+  }
+  // The staging slots of all ranks form a single buffer of the root.
+  const int64_t step_bytes = size * chunk_bytes;
+  for (int64_t begin = 0; begin < bytes; begin += step_bytes, ++step) {
+    const int64_t n = std::min(step_bytes, bytes - begin);
+    uint8_t* buffer = Slot(this, step, 0);
+    if (rank == root) {
+      std::memcpy(buffer, send + begin, n);
+    }
+    Barrier();
+    if (rank != root) {
+      std::memcpy(recv + begin, buffer, n);
+    } else if (recv != send) {
+      std::memcpy(recv + begin, send + begin, n);
+    }
+  }
+}
+
+void SHMCommunicatorObj::Send(const void* buf, int64_t bytes, int peer) {
+  CHECK(peer >= 0 && peer < size && peer != rank) << "Invalid peer " << peer;
+  const uint8_t* data = static_cast<const uint8_t*>(buf);
+  SHMChannel* channel = Channel(this, rank, peer);
+  uint8_t* mailbox = Mailbox(this, rank, peer);
+  for (int64_t begin = 0; begin < bytes; begin += chunk_bytes) {
+    const int64_t n = std::min(chunk_bytes, bytes - begin);
+    const uint64_t seq = channel->posted.load(std::memory_order_relaxed);
+    SpinUntil([&]() { return channel->consumed.load(std::memory_order_acquire) == seq; });
+    std::memcpy(mailbox, data + begin, n);
+    channel->posted.store(seq + 1, std::memory_order_release);
+  }
+}
+
+void SHMCommunicatorObj::Recv(void* buf, int64_t bytes, int peer) {
+  CHECK(peer >= 0 && peer < size && peer != rank) << "Invalid peer " << peer;
+  uint8_t* data = static_cast<uint8_t*>(buf);
+  SHMChannel* channel = Channel(this, peer, rank);
+  const uint8_t* mailbox = Mailbox(this, peer, rank);
+  for (int64_t begin = 0; begin < bytes; begin += chunk_bytes) {
+    const int64_t n = std::min(chunk_bytes, bytes - begin);
+    const uint64_t seq = channel->consumed.load(std::memory_order_relaxed);
+    SpinUntil([&]() { return channel->posted.load(std::memory_order_acquire) > seq; });
+    std::memcpy(data + begin, mailbox, n);
+    channel->consumed.store(seq + 1, std::memory_order_release);
+  }
+}
+
+/*! \brief Get the size of a staging slot from RAF_SHM_CHUNK_BYTES. */
+int64_t GetSHMChunkBytes() {
+  int64_t chunk_bytes = kDefaultChunkBytes;
+  if (const char* env = getenv("RAF_SHM_CHUNK_BYTES")) {
+    chunk_bytes = std::max<int64_t>(kMinChunkBytes, std::atoll(env));
+  }
+  return RoundUp(chunk_bytes, kSHMAlign);
+}
+
+/*! \brief Name the segment after the job and the global ranks of the group. */
+std::string GetSHMSegmentName(const std::vector<int64_t>& global_ranks) {
+  std::string job_id;
+  if (const char* env = getenv("RAF_SHM_JOB_ID")) {
+    job_id = env;
+  } else {
+    job_id = std::to_string(getppid());
+  }
+  std::ostringstream ranks;
+  for (auto rank : global_ranks) {
+    ranks << rank << ",";
+  }
+  std::ostringstream os;
+  os << "/raf_shm_" << job_id << "_" << std::hex << std::hash<std::string>{}(ranks.str());
+  return os.str();
+}
+
+/*! \brief Get the start time of a process in clock ticks after boot, or 0 if it has exited. */
+uint64_t GetProcessStartTime(int64_t pid) {
+  std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat;
+  if (!std::getline(in, stat)) return 0;
+  // The command name may contain spaces, so the fields are parsed after its closing parenthesis.
+  auto pos = stat.rfind(')');
+  if (pos == std::string::npos) return 0;
+  std::istringstream fields(stat.substr(pos + 1));
+  std::string state, field;
+  fields >> state;
+  if (state == "Z" || state == "X") return 0;
+  // Skip the fields 4 to 21, which are followed by the start time.
+  for (int i = 4; i < 22; ++i) {
+    fields >> field;
+  }
+  uint64_t start_time = 0;
+  fields >> start_time;
+  return start_time;
+}
+
+/*! \brief Whether the name still refers to the segment with the given stat. */
+bool IsSHMSegmentLinked(const std::string& name, const struct stat& st) {
+  int fd = shm_open(name.c_str(), O_RDONLY, S_IRUSR | S_IWUSR);
+  if (fd < 0) return false;
+  struct stat curr;
+  bool linked = fstat(fd, &curr) == 0 && curr.st_dev == st.st_dev && curr.st_ino == st.st_ino;
+  close(fd);
+  return linked;
+}
+
+/*!
+ * \brief Try to map the segment of the given size on a non-zero rank.
+ * \return The address, or nullptr if the segment is not created yet.
+ */
+void* TryMapSHMSegment(const std::string& name, int64_t total, struct stat* st) {
+  int fd = shm_open(name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) return nullptr;
+  void* addr = nullptr;
+  if (fstat(fd, st) == 0 && st->st_size == total) {
+    addr = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK(addr != MAP_FAILED) << "Failed to map shared memory " << name << ": " << strerror(errno);
+  }
+  close(fd);
+  return addr;
+}
+
+/*!
+ * \brief Create (on rank 0) or attach (on other ranks) the segment of the group. The name is
+ * unlinked once all ranks have attached, so no segment is left behind when the job exits.
+ *
+ * A segment left by a crashed job with the same name may be found by the other ranks before
+ * rank 0 replaces it. Rank 0 records its process ID and start time in the header, and the other
+ * ranks only use a segment whose rank 0 is still running, or wait for the replacement otherwise.
+ */
+void AttachSHMSegment(SHMCommunicatorObj* obj, const std::string& name) {
+  SHMLayout layout(obj->size, obj->chunk_bytes);
+  const auto deadline = std::chrono::steady_clock::now() + kAttachTimeout;
+  if (obj->rank == 0) {
+    // Remove the segment left by a crashed job with the same name.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    CHECK_GE(fd, 0) << "Failed to create shared memory " << name << ": " << strerror(errno);
+    CHECK_EQ(ftruncate(fd, layout.total), 0)
+        << "Failed to resize shared memory " << name << ": " << strerror(errno);
+    void* addr = mmap(nullptr, layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(addr != MAP_FAILED) << "Failed to map shared memory " << name << ": "
+                              << strerror(errno);
+    obj->segment = static_cast<uint8_t*>(addr);
+    obj->segment_bytes = layout.total;
+
+    SHMHeader* header = Header(obj->segment);
+    new (&header->barrier.count) std::atomic<uint32_t>(0);
+    new (&header->barrier.generation) std::atomic<uint32_t>(0);
+    for (int i = 0; i < obj->size * obj->size; ++i) {
+      new (Channel(obj, i / obj->size, i % obj->size)) SHMChannel();
+    }
+    header->size = obj->size;
+    header->chunk_bytes = obj->chunk_bytes;
+    header->creator_pid = getpid();
+    header->creator_start_time = GetProcessStartTime(getpid());
+    header->magic.store(kSHMMagic, std::memory_order_release);
+  } else {
+    while (obj->segment == nullptr) {
+      CHECK(std::chrono::steady_clock::now() < deadline)
+          << "Timeout waiting for rank 0 to create shared memory " << name;
+      struct stat st;
+      void* addr = TryMapSHMSegment(name, layout.total, &st);
+      if (addr == nullptr) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      // The segment is stale if it is replaced before being initialized, or if its rank 0 has
+      // exited, e.g., the pid is reused by another process that started later.
+      SHMHeader* header = Header(static_cast<uint8_t*>(addr));
+      bool live = true;
+      while (live && header->magic.load(std::memory_order_acquire) != kSHMMagic) {
+        CHECK(std::chrono::steady_clock::now() < deadline)
+            << "Timeout waiting for rank 0 to initialize shared memory " << name;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        live = IsSHMSegmentLinked(name, st);
+      }
+      if (live && header->magic.load(std::memory_order_acquire) == kSHMMagic &&
+          GetProcessStartTime(header->creator_pid) == header->creator_start_time) {
+        obj->segment = static_cast<uint8_t*>(addr);
+        obj->segment_bytes = layout.total;
+      } else {
+        munmap(addr, layout.total);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    SHMHeader* header = Header(obj->segment);
+    CHECK_EQ(header->size, obj->size) << "Mismatched communicator size in " << name;
+    CHECK_EQ(header->chunk_bytes, obj->chunk_bytes)
+        << "RAF_SHM_CHUNK_BYTES must be the same on all ranks";
+  }
+  obj->Barrier();
+  if (obj->rank == 0) {
+    shm_unlink(name.c_str());
+  }
+}
+
+SHMCommunicator SHMCommunicator::make(Value rank_list) {
+  auto global_comm = GetGlobalCommunicator();
+  auto obj = make_object<SHMCommunicatorObj>();
+  std::vector<int64_t> global_ranks;
+
+  if (!rank_list.defined()) {
+    // Create Global Communicator
+    obj->local_size = global_comm->local_size;
+    obj->local_rank = global_comm->local_rank;
+    obj->size = global_comm->size;
+    obj->rank = global_comm->rank;
+    obj->world_size = global_comm->world_size;
+    obj->world_rank = global_comm->world_rank;
+    obj->root_rank = global_comm->root_rank;
+    obj->group_id = -1;
+    obj->group_size = 0;
+    obj->host_ids = global_comm->host_ids;
+    for (int i = 0; i < obj->size; ++i) {
+      global_ranks.push_back(i);
+    }
+  } else {
+    // Create Sub-communicator
+    InitSubCommunicator(obj.get(), rank_list, global_comm);
+    if (obj->group_id >= 0) {
+      auto group = Downcast<TupleValue>(rank_list)->fields[obj->group_id];
+      for (auto rank : Downcast<TupleValue>(group)->fields) {
+        global_ranks.push_back(Downcast<IntValue>(rank)->value);
+      }
+    }
+  }
+  obj->parent_comm = global_comm;
+  for (auto host_id : obj->host_ids) {
+    CHECK_EQ(host_id, obj->host_ids[0]) << "SHMCommunicator only supports ranks on the same host";
+  }
+
+  obj->chunk_bytes = GetSHMChunkBytes();
+  if (obj->size > 1) {
+    AttachSHMSegment(obj.get(), GetSHMSegmentName(global_ranks));
+  }
+  return SHMCommunicator(obj);
+}
+
+RAF_REGISTER_GLOBAL("raf.distributed.communicator._make.shm").set_body_typed(SHMCommunicator::make);
+
+RAF_REGISTER_OBJECT_REFLECT(SHMCommunicatorObj);
+
+}  // namespace communicator
+}  // namespace distributed
+}  // namespace raf
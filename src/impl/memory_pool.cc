@@ -7,9 +7,12 @@
  * \file src/impl/memory_pool.cc
  * \brief RAF memory pool manager
  */
+#include <cstring>
 #include <unordered_map>
 #include "raf/device.h"
+#include "raf/ir.h"
 #include "raf/memory_pool.h"
+#include "raf/memory_profiler.h"
 #include "raf/registry.h"
 
 #ifdef RAF_USE_CUDA
@@ -36,6 +39,11 @@ static std::unordered_map<int, std::string> default_strategies = {
 
 class MemoryPoolManager {
  public:
+  MemoryPoolManager() {
+    const char* use_thread_cache = getenv("RAF_MEMORY_POOL_THREAD_CACHE");
+    use_thread_cache_ = use_thread_cache != nullptr && strcmp(use_thread_cache, "1") == 0;
+  }
+
   static MemoryPoolManager* Get() {
     static MemoryPoolManager* instance = new MemoryPoolManager();
     return instance;
@@ -55,8 +63,23 @@ class MemoryPoolManager {
       if (result == nullptr) {
         // ok, it is truly a nullptr
         std::string pool_name = (name == "") ? default_strategies[dev.device_type()] : name;
+        // A pool name in the form of "wrapper:inner" puts the wrapper pool in front of the inner
+        // pool, e.g., "thread_cache_pool:arena_pool".
+        std::string wrapper_name;
+        auto pos = pool_name.find(':');
+        if (pos != std::string::npos) {
+          wrapper_name = pool_name.substr(0, pos);
+          pool_name = pool_name.substr(pos + 1);
+        } else if (name == "" && use_thread_cache_) {
+          wrapper_name = "thread_cache_pool";
+        }
         snprintf(maker_name, sizeof(maker_name), "raf.memory_pool._make.%s", pool_name.c_str());
         void* ret = GetPackedFunc(maker_name)(dev);
+        if (!wrapper_name.empty()) {
+          snprintf(maker_name, sizeof(maker_name), "raf.memory_pool._wrap.%s",
+                   wrapper_name.c_str());
+          ret = GetPackedFunc(maker_name)(ret);
+        }
         result.reset(static_cast<MemoryPool*>(ret));
         return result.get();
       }
@@ -73,6 +96,10 @@ class MemoryPoolManager {
 
  public:
   PerDeviceStore<MemoryPool, false> reg;
+
+ private:
+  /*! \brief Whether to put a per-thread cache in front of the default pools. */
+  bool use_thread_cache_ = false;
 };
 
 inline void CheckAlignment(int64_t alignment) {
@@ -86,17 +113,29 @@ int64_t Memory::GetAllocBytes(const Device& dev, int64_t nbytes) {
   return mgr->GetPool(dev, "")->GetAllocBytes(nbytes);
 }
 
+/*! \brief Record the allocation in the memory profiler if it traces the allocations. */
+inline std::shared_ptr<Memory> TraceAlloc(MemoryPool* pool, const Device& dev, int64_t nbytes,
+                                          std::shared_ptr<Memory> memory) {
+  auto* profiler = memory_profiler::MemoryProfiler::Get();
+  if (!profiler->IsTracingAllocs()) {
+    return memory;
+  }
+  return profiler->TraceAlloc(dev, nbytes, pool->GetAllocBytes(nbytes), std::move(memory));
+}
+
 std::shared_ptr<Memory> Memory::Alloc(const Device& dev, int64_t nbytes, int64_t alignment) {
   MemoryPoolManager* mgr = MemoryPoolManager::Get();
   CheckAlignment(alignment);
-  return mgr->GetPool(dev, "")->Alloc(nbytes, alignment);
+  MemoryPool* pool = mgr->GetPool(dev, "");
+  return TraceAlloc(pool, dev, nbytes, pool->Alloc(nbytes, alignment));
 }
 
 std::shared_ptr<Memory> Memory::AllocAsync(const Device& dev, int64_t nbytes, void* stream,
                                            int64_t alignment) {
   MemoryPoolManager* mgr = MemoryPoolManager::Get();
   CheckAlignment(alignment);
-  return mgr->GetPool(dev, "")->AllocAsync(nbytes, stream, alignment);
+  MemoryPool* pool = mgr->GetPool(dev, "");
+  return TraceAlloc(pool, dev, nbytes, pool->AllocAsync(nbytes, stream, alignment));
 }
 
 std::vector<std::shared_ptr<Memory> > Memory::AllocBatch(const Device& dev,
@@ -104,7 +143,12 @@ std::vector<std::shared_ptr<Memory> > Memory::AllocBatch(const Device& dev,
                                                          int64_t alignment) {
   MemoryPoolManager* mgr = MemoryPoolManager::Get();
   CheckAlignment(alignment);
-  return mgr->GetPool(dev, "")->AllocBatch(nbytes, alignment);
+  MemoryPool* pool = mgr->GetPool(dev, "");
+  auto ret = pool->AllocBatch(nbytes, alignment);
+  for (size_t i = 0; i < ret.size(); ++i) {
+    ret[i] = TraceAlloc(pool, dev, nbytes[i], std::move(ret[i]));
+  }
+  return ret;
 }
 
 std::pair<float, float> Memory::GetPoolSize(const Device& dev) {
@@ -112,6 +156,11 @@ std::pair<float, float> Memory::GetPoolSize(const Device& dev) {
   return mgr->GetPool(dev, "")->GetPoolSize();
 }
 
+std::unordered_map<std::string, double> Memory::GetPoolStats(const Device& dev) {
+  MemoryPoolManager* mgr = MemoryPoolManager::Get();
+  return mgr->GetPool(dev, "")->GetPoolStats();
+}
+
 void Memory::RemovePool(const Device& dev) {
   MemoryPoolManager* mgr = MemoryPoolManager::Get();
   mgr->Remove(dev);
@@ -170,6 +219,14 @@ RAF_REGISTER_GLOBAL("raf.memory_pool.InitPool")
       return InitPool(dev, pool_name);
     });
 
+RAF_REGISTER_GLOBAL("raf.memory_pool.GetPoolStats").set_body_typed([](const Device& dev) {
+  ir::Map<ir::String, ir::FloatImm> ret;
+  for (const auto& kv : Memory::GetPoolStats(dev)) {
+    ret.Set(kv.first, ir::FloatImm(ir::DataType::Float(64), kv.second));
+  }
+  return ret;
+});
+
 RAF_REGISTER_GLOBAL("raf.memory_pool.RemovePool").set_body_typed([](const Device& dev) {
   return RemovePool(dev);
 });
@@ -8,6 +8,7 @@
  * \brief RAF operator interface underlying implementation
  */
 #include <tvm/runtime/device_api.h>
+#include <mutex>
 #include "dmlc/registry.h"
 #include "raf/executor.h"
 #include "raf/ir.h"
@@ -135,6 +136,7 @@ OpEnvPtr DispatchSingleOp(const CallValues& call) {
     auto env = OpEnvPtr((*maker)(call));
     if (env && !env->HasError()) {
       DLOG(INFO) << "Dispatch to " << op->name;
+      env->dispatched_op = op->name;
       return env;
     } else if (env) {
       for (auto msg : env->error_msgs) {
@@ -161,6 +163,7 @@ OpEnvPtr DispatchSingleOp(const CallValues& call) {
       auto env = OpEnvPtr((*maker)(call));
       if (env && !env->HasError()) {
         DLOG(INFO) << "Dispatch to " << dialect_op->name;
+        env->dispatched_op = dialect_op->name;
         return env;
       } else if (env) {
         for (auto msg : env->error_msgs) {
@@ -201,6 +204,7 @@ OpEnvPtr DispatchFusedOp(const CallValues& call) {
     ss << "\nName: " << os.str() << "\n" << ir::AsText(func);
     LOG(FATAL) << ss.str();
   }
+  op_env->dispatched_op = os.str();
   return op_env;
 }
 
@@ -214,6 +218,23 @@ OpEnvPtr Dispatch(const CallValues& call) {
   return nullptr;
 }
 
+OpEnvPtr DispatchTo(const CallValues& call, const std::string& op_name) {
+  auto maker = OpEnvMaker::Get(op_name);
+  if (maker == nullptr) {
+    return nullptr;
+  }
+  if (const auto* callee = call->callee.as<value::OpValueObj>()) {
+    auto op = Op::Get(op_name);
+    op->op_type = callee->op->op_type;
+  }
+  auto env = OpEnvPtr((*maker)(call));
+  if (env == nullptr || env->HasError()) {
+    return nullptr;
+  }
+  env->dispatched_op = op_name;
+  return env;
+}
+
 CallValues CreateDummyCallValues(Call call, Device device) {
   auto call_node = call.as<CallNode>();
   CHECK(call_node != nullptr);
@@ -262,6 +283,9 @@ Array<Value> GetListArgs(const Attrs& attrs) {
 
 std::string GetUniqueName(std::string name) {
   static std::unordered_map<std::string, int> name_map;
+  // OpEnvs may be created concurrently, e.g., by the kernel warmup of the VM.
+  static std::mutex mu;
+  std::lock_guard<std::mutex> lock(mu);
   for (size_t i = 0; i < name.length(); ++i) {
     if (name[i] == '.') name[i] = '_';
   }
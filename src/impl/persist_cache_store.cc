@@ -0,0 +1,600 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/impl/persist_cache_store.cc
+ * \brief The on-disk store of the persistent caches.
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include "raf/file.h"
+#include "raf/persist_cache_store.h"
+
+namespace raf {
+namespace {
+
+/*! \brief The magic number and version of the index file. */
+constexpr char kIndexMagic[8] = {'R', 'A', 'F', 'C', 'I', 'D', 'X', '1'};
+constexpr uint64_t kIndexHeaderSize = 16;
+constexpr uint64_t kIndexRecordSize = sizeof(PersistCacheIndexRecord);
+/*! \brief The magic number of an entry in the data file. */
+constexpr uint32_t kEntryMagic = 0x43464152;
+
+/*! \brief The header of an entry in the data file, followed by the key and the packed files. */
+struct EntryHeader {
+  uint32_t magic;
+  uint32_t key_size;
+};
+
+/*! \brief The header of a file in an entry, followed by the file name and content. */
+struct FileHeader {
+  uint64_t data_size;
+  uint32_t name_size;
+  uint32_t reserved;
+};
+
+inline uint64_t Rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t Fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+inline int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+inline uint32_t RecordChecksum(const PersistCacheIndexRecord& record) {
+  return static_cast<uint32_t>(
+      PersistCacheHash::Compute(&record, offsetof(PersistCacheIndexRecord, checksum)).h1);
+}
+
+/*! \brief Hold a flock on a file for the lifetime of the guard. */
+class FileLockGuard {
+ public:
+  FileLockGuard(int fd, int op) : fd_(fd) {
+    while (flock(fd_, op) == -1) {
+      CHECK_EQ(errno, EINTR) << "Failed to lock the persistent cache: " << strerror(errno);
+    }
+  }
+  ~FileLockGuard() {
+    flock(fd_, LOCK_UN);
+  }
+
+ private:
+  int fd_;
+};
+
+bool ReadAll(int fd, void* buf, size_t size, uint64_t offset) {
+  auto* ptr = static_cast<char*>(buf);
+  while (size > 0) {
+    ssize_t n = pread(fd, ptr, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+bool WriteAll(int fd, const void* buf, size_t size, uint64_t offset) {
+  const auto* ptr = static_cast<const char*>(buf);
+  while (size > 0) {
+    ssize_t n = pwrite(fd, ptr, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+uint64_t FileSize(int fd) {
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Failed to stat the persistent cache: " << strerror(errno);
+  return st.st_size;
+}
+
+int OpenFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  CHECK_GE(fd, 0) << "Failed to open " << path << ": " << strerror(errno);
+  return fd;
+}
+
+template <typename T>
+void Append(std::string* buf, const T& pod) {
+  buf->append(reinterpret_cast<const char*>(&pod), sizeof(T));
+}
+
+/*! \brief Pack the key and the files in the directory into an entry. */
+bool PackEntry(const std::string& key, const std::string& dir, std::string* buf) {
+  EntryHeader header{kEntryMagic, static_cast<uint32_t>(key.size())};
+  Append(buf, header);
+  buf->append(key);
+  return PackDirectory(dir, buf);
+}
+
+/*! \brief Whether the entry is well-formed and holds the key. */
+bool EntryHasKey(const std::string& buf, const std::string& key) {
+  if (buf.size() < sizeof(EntryHeader)) {
+    return false;
+  }
+  EntryHeader header;
+  memcpy(&header, buf.data(), sizeof(header));
+  return header.magic == kEntryMagic && header.key_size == key.size() &&
+         buf.size() >= sizeof(header) + key.size() &&
+         buf.compare(sizeof(header), key.size(), key) == 0;
+}
+
+}  // namespace
+
+bool PackDirectory(const std::string& dir, std::string* buf) {
+  std::vector<std::string> names;
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) {
+    return false;
+  }
+  while (struct dirent* ent = readdir(d)) {
+    struct stat st;
+    std::string name = ent->d_name;
+    if (stat((dir + "/" + name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      names.push_back(name);
+    }
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+
+  Append(buf, static_cast<uint32_t>(names.size()));
+  for (const auto& name : names) {
+    std::ifstream ifs(dir + "/" + name, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (ifs.bad()) {
+      return false;
+    }
+    FileHeader file_header{data.size(), static_cast<uint32_t>(name.size()), 0};
+    Append(buf, file_header);
+    buf->append(name);
+    buf->append(data);
+  }
+  return true;
+}
+
+bool UnpackDirectory(const char* data, size_t size, const std::string& dir) {
+  uint32_t num_files;
+  if (size < sizeof(num_files)) {
+    return false;
+  }
+  memcpy(&num_files, data, sizeof(num_files));
+  size_t pos = sizeof(num_files);
+  for (uint32_t i = 0; i < num_files; ++i) {
+    FileHeader file_header;
+    if (pos + sizeof(file_header) > size) {
+      return false;
+    }
+    memcpy(&file_header, data + pos, sizeof(file_header));
+    pos += sizeof(file_header);
+    if (pos + file_header.name_size + file_header.data_size > size) {
+      return false;
+    }
+    std::string name(data + pos, file_header.name_size);
+    pos += file_header.name_size;
+    if (name.empty() || name.find('/') != std::string::npos || name == "." || name == "..") {
+      return false;
+    }
+    std::ofstream ofs(dir + "/" + name, std::ios::binary);
+    ofs.write(data + pos, file_header.data_size);
+    if (!ofs.good()) {
+      return false;
+    }
+    pos += file_header.data_size;
+  }
+  return true;
+}
+
+ScratchDir::ScratchDir(const std::string& parent) {
+  std::string base = parent;
+  if (base.empty()) {
+    const char* tmp = getenv("TMPDIR");
+    base = tmp ? tmp : "/tmp";
+  }
+  path_ = base + "/.raf-scratch-XXXXXX";
+  CHECK(mkdtemp(&path_[0]) != nullptr)
+      << "Failed to create a scratch directory in " << base << ": " << strerror(errno);
+}
+
+ScratchDir::~ScratchDir() {
+  if (DIR* d = opendir(path_.c_str())) {
+    while (struct dirent* ent = readdir(d)) {
+      if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+        unlink((path_ + "/" + ent->d_name).c_str());
+      }
+    }
+    closedir(d);
+  }
+  rmdir(path_.c_str());
+}
+
+PersistCacheHash PersistCacheHash::Compute(const void* data, size_t size, uint64_t seed) {
+  constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+  constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  const size_t num_blocks = size / 16;
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint64_t k1, k2;
+    memcpy(&k1, bytes + i * 16, 8);
+    memcpy(&k2, bytes + i * 16 + 8, 8);
+    k1 *= c1;
+    k1 = Rotl64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = Rotl64(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2;
+    k2 = Rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = Rotl64(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  const uint8_t* tail = bytes + num_blocks * 16;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  const size_t rem = size & 15;
+  for (size_t i = rem; i > 8; --i) {
+    k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+  }
+  if (rem > 8) {
+    k2 *= c2;
+    k2 = Rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+  }
+  for (size_t i = std::min<size_t>(rem, 8); i > 0; --i) {
+    k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+  }
+  if (rem > 0) {
+    k1 *= c1;
+    k1 = Rotl64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+  }
+
+  h1 ^= size;
+  h2 ^= size;
+  h1 += h2;
+  h2 += h1;
+  h1 = Fmix64(h1);
+  h2 = Fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+  return PersistCacheHash{h1, h2};
+}
+
+PersistCacheStore::PersistCacheStore(const std::string& path, int64_t max_bytes,
+                                     int64_t max_age_sec)
+    : path_(path), max_bytes_(max_bytes), max_age_sec_(max_age_sec) {
+  CreateDir(path_);
+  lock_fd_ = OpenFile(path_ + "/lock");
+  FileLockGuard file_lock(lock_fd_, LOCK_EX);
+  OpenFiles();
+  if (FileSize(index_fd_) < kIndexHeaderSize) {
+    char header[kIndexHeaderSize] = {0};
+    memcpy(header, kIndexMagic, sizeof(kIndexMagic));
+    CHECK(WriteAll(index_fd_, header, kIndexHeaderSize, 0))
+        << "Failed to initialize the persistent cache " << path_ << ": " << strerror(errno);
+  }
+  RefreshIndex();
+  if (NeedCompaction()) {
+    CompactLocked();
+  }
+}
+
+PersistCacheStore::~PersistCacheStore() {
+  CloseFiles();
+  if (lock_fd_ >= 0) {
+    close(lock_fd_);
+  }
+}
+
+void PersistCacheStore::OpenFiles() {
+  index_fd_ = OpenFile(path_ + "/index");
+  data_fd_ = OpenFile(path_ + "/data");
+  index_scanned_ = 0;
+  index_.clear();
+}
+
+void PersistCacheStore::CloseFiles() {
+  if (index_fd_ >= 0) {
+    close(index_fd_);
+  }
+  if (data_fd_ >= 0) {
+    close(data_fd_);
+  }
+  index_fd_ = data_fd_ = -1;
+}
+
+void PersistCacheStore::ReopenIfReplaced() {
+  struct stat path_st, fd_st;
+  if (stat((path_ + "/index").c_str(), &path_st) == 0 && fstat(index_fd_, &fd_st) == 0 &&
+      path_st.st_ino == fd_st.st_ino && path_st.st_dev == fd_st.st_dev) {
+    return;
+  }
+  CloseFiles();
+  OpenFiles();
+}
+
+void PersistCacheStore::RefreshIndex() {
+  uint64_t size = FileSize(index_fd_);
+  if (size < kIndexHeaderSize) {
+    return;
+  }
+  // Only scan complete records. A partial one is left by a writer that crashed, and will be
+  // overwritten by the next writer.
+  size = kIndexHeaderSize + (size - kIndexHeaderSize) / kIndexRecordSize * kIndexRecordSize;
+  if (size <= index_scanned_) {
+    return;
+  }
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, index_fd_, 0);
+  CHECK(addr != MAP_FAILED) << "Failed to map the index of " << path_ << ": " << strerror(errno);
+  const char* base = static_cast<const char*>(addr);
+  if (index_scanned_ == 0) {
+    if (memcmp(base, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+      munmap(addr, size);
+      LOG(WARNING) << "Ignored the persistent cache " << path_ << " with an unknown format";
+      index_scanned_ = size;
+      return;
+    }
+    index_scanned_ = kIndexHeaderSize;
+  }
+  for (uint64_t pos = index_scanned_; pos < size; pos += kIndexRecordSize) {
+    PersistCacheIndexRecord record;
+    memcpy(&record, base + pos, kIndexRecordSize);
+    if (record.checksum == RecordChecksum(record)) {
+      index_[record.hash] = record;
+    }
+  }
+  munmap(addr, size);
+  index_scanned_ = size;
+}
+
+bool PersistCacheStore::ReadEntry(const PersistCacheIndexRecord& record, std::string* buf) {
+  buf->resize(record.size);
+  return ReadAll(data_fd_, &(*buf)[0], record.size, record.offset);
+}
+
+bool PersistCacheStore::NeedCompaction() {
+  if (max_bytes_ > 0 && FileSize(data_fd_) > static_cast<uint64_t>(max_bytes_)) {
+    return true;
+  }
+  if (max_age_sec_ > 0) {
+    int64_t expire = Now() - max_age_sec_;
+    for (const auto& it : index_) {
+      if (it.second.timestamp < expire) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void PersistCacheStore::CompactLocked() {
+  // Keep the newest entries that are not expired, within 3/4 of the maximum size so that the
+  // store is not compacted again on every write.
+  std::vector<PersistCacheIndexRecord> records;
+  int64_t expire = max_age_sec_ > 0 ? Now() - max_age_sec_ : INT64_MIN;
+  for (const auto& it : index_) {
+    if (it.second.timestamp >= expire) {
+      records.push_back(it.second);
+    }
+  }
+  // The entries are appended to the data file and compacted in order, so their offsets give the
+  // order of the writes, unlike the timestamps, which are in whole seconds and tie.
+  std::sort(records.begin(), records.end(),
+            [](const PersistCacheIndexRecord& a, const PersistCacheIndexRecord& b) {
+              return a.offset > b.offset;
+            });
+  if (max_bytes_ > 0) {
+    uint64_t budget = static_cast<uint64_t>(max_bytes_) / 4 * 3;
+    uint64_t total = 0;
+    size_t keep = 0;
+    // The newest entry, e.g., the one just saved, is always kept.
+    while (keep < records.size() && (keep == 0 || total + records[keep].size <= budget)) {
+      total += records[keep++].size;
+    }
+    records.resize(keep);
+  }
+  std::reverse(records.begin(), records.end());
+
+  std::string index_tmp = path_ + "/index.tmp";
+  std::string data_tmp = path_ + "/data.tmp";
+  int new_index_fd = open(index_tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  int new_data_fd = open(data_tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  bool success = new_index_fd >= 0 && new_data_fd >= 0;
+  char header[kIndexHeaderSize] = {0};
+  memcpy(header, kIndexMagic, sizeof(kIndexMagic));
+  success = success && WriteAll(new_index_fd, header, kIndexHeaderSize, 0);
+  uint64_t data_offset = 0;
+  uint64_t index_offset = kIndexHeaderSize;
+  std::string buf;
+  for (auto record : records) {
+    if (!success) {
+      break;
+    }
+    if (!ReadEntry(record, &buf)) {
+      continue;
+    }
+    record.offset = data_offset;
+    record.checksum = RecordChecksum(record);
+    success = WriteAll(new_data_fd, buf.data(), buf.size(), data_offset) &&
+              WriteAll(new_index_fd, &record, kIndexRecordSize, index_offset);
+    data_offset += buf.size();
+    index_offset += kIndexRecordSize;
+  }
+  // Replace the data file first. A reader only reopens the files under a shared lock, which
+  // cannot be taken until both files are replaced.
+  success = success && fsync(new_data_fd) == 0 && fsync(new_index_fd) == 0 &&
+            rename(data_tmp.c_str(), (path_ + "/data").c_str()) == 0 &&
+            rename(index_tmp.c_str(), (path_ + "/index").c_str()) == 0;
+  if (new_index_fd >= 0) {
+    close(new_index_fd);
+  }
+  if (new_data_fd >= 0) {
+    close(new_data_fd);
+  }
+  if (!success) {
+    LOG(WARNING) << "Failed to compact the persistent cache " << path_ << ": " << strerror(errno);
+    unlink(index_tmp.c_str());
+    unlink(data_tmp.c_str());
+    return;
+  }
+  DLOG(INFO) << "Compacted the persistent cache " << path_ << ": kept " << records.size()
+             << " of " << index_.size() << " entries";
+  CloseFiles();
+  OpenFiles();
+  RefreshIndex();
+}
+
+bool PersistCacheStore::Contains(const std::string& key) {
+  auto hash = PersistCacheHash::Compute(key.data(), key.size());
+  std::lock_guard<std::mutex> lock(mu_);
+  if (index_.count(hash)) {
+    return true;
+  }
+  FileLockGuard file_lock(lock_fd_, LOCK_SH);
+  ReopenIfReplaced();
+  RefreshIndex();
+  return index_.count(hash) > 0;
+}
+
+PersistCacheStore::LoadResult PersistCacheStore::Load(
+    const std::string& key, const std::function<void(const std::string&)>& f_load) {
+  auto hash = PersistCacheHash::Compute(key.data(), key.size());
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = index_.find(hash);
+  if (it == index_.end()) {
+    // Pick up the entries written by other processes.
+    FileLockGuard file_lock(lock_fd_, LOCK_SH);
+    ReopenIfReplaced();
+    RefreshIndex();
+    it = index_.find(hash);
+    if (it == index_.end()) {
+      return LoadResult::kMiss;
+    }
+  }
+  std::string buf;
+  if (!ReadEntry(it->second, &buf)) {
+    LOG(WARNING) << "Failed to read an entry of the persistent cache " << path_;
+    return LoadResult::kMiss;
+  }
+  if (!EntryHasKey(buf, key)) {
+    LOG(WARNING) << "Hash collision in the persistent cache " << path_;
+    return LoadResult::kCollision;
+  }
+  ScratchDir scratch(path_);
+  size_t pos = sizeof(EntryHeader) + key.size();
+  if (!UnpackDirectory(buf.data() + pos, buf.size() - pos, scratch.path())) {
+    LOG(WARNING) << "Failed to unpack an entry of the persistent cache " << path_;
+    return LoadResult::kMiss;
+  }
+  f_load(scratch.path());
+  return LoadResult::kHit;
+}
+
+bool PersistCacheStore::Save(const std::string& key,
+                             const std::function<bool(const std::string&)>& f_save) {
+  auto hash = PersistCacheHash::Compute(key.data(), key.size());
+  std::lock_guard<std::mutex> lock(mu_);
+  std::string buf;
+  {
+    ScratchDir scratch(path_);
+    if (!f_save(scratch.path()) || !PackEntry(key, scratch.path(), &buf)) {
+      return false;
+    }
+  }
+
+  FileLockGuard file_lock(lock_fd_, LOCK_EX);
+  ReopenIfReplaced();
+  RefreshIndex();
+  auto it = index_.find(hash);
+  if (it != index_.end()) {
+    // Saved by another process, unless the hash collides with another key.
+    std::string existing;
+    return ReadEntry(it->second, &existing) && EntryHasKey(existing, key);
+  }
+
+  // Write the entry before its index record, so that a reader never sees an index record of
+  // an incomplete entry.
+  PersistCacheIndexRecord record;
+  memset(&record, 0, sizeof(record));
+  record.hash = hash;
+  record.offset = FileSize(data_fd_);
+  record.size = buf.size();
+  record.timestamp = Now();
+  record.key_size = key.size();
+  record.checksum = RecordChecksum(record);
+  uint64_t index_offset = index_scanned_;
+  if (!WriteAll(data_fd_, buf.data(), buf.size(), record.offset) ||
+      !WriteAll(index_fd_, &record, kIndexRecordSize, index_offset)) {
+    LOG(WARNING) << "Failed to write the persistent cache " << path_ << ": " << strerror(errno);
+    return false;
+  }
+  index_[hash] = record;
+  index_scanned_ = index_offset + kIndexRecordSize;
+  if (max_bytes_ > 0 && FileSize(data_fd_) > static_cast<uint64_t>(max_bytes_)) {
+    CompactLocked();
+  }
+  return index_.count(hash) > 0;
+}
+
+void PersistCacheStore::Compact() {
+  std::lock_guard<std::mutex> lock(mu_);
+  FileLockGuard file_lock(lock_fd_, LOCK_EX);
+  ReopenIfReplaced();
+  RefreshIndex();
+  if (NeedCompaction()) {
+    CompactLocked();
+  }
+}
+
+size_t PersistCacheStore::Size() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return index_.size();
+}
+
+}  // namespace raf
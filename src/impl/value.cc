@@ -291,8 +291,8 @@ TensorValue TensorValue::Assemble(const Device& dev, const DType& dtype,
 }
 
 TensorValue TensorValue::CreateView(const std::vector<int64_t>& shape,
-                                    const std::vector<int64_t>& strides) const {
-  return TensorValue::make((*this)->tensor.CreateView(shape, strides), (*this)->mem);
+                                    const std::vector<int64_t>& strides, void* data) const {
+  return TensorValue::make((*this)->tensor.CreateView(shape, strides, data), (*this)->mem);
 }
 
 TensorValue AssembleTensorValue(const Device& dev, DLDataType dtype, Array<Integer> shape,
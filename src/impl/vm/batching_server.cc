@@ -0,0 +1,419 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/impl/vm/batching_server.cc
+ * \brief A serving front end of the virtual machine that batches independent requests.
+ */
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "raf/memory_pool.h"
+#include "raf/registry.h"
+#include "raf/vm/batching_server.h"
+
+namespace raf {
+namespace executor {
+namespace vm {
+
+/*! \brief Get the bytes of a row, i.e., a slice along the first axis, of a tensor. */
+inline int64_t RowBytes(const DLTensor* tensor) {
+  int64_t bytes = (tensor->dtype.bits * tensor->dtype.lanes + 7) / 8;
+  for (int i = 1; i < tensor->ndim; ++i) {
+    bytes *= tensor->shape[i];
+  }
+  return bytes;
+}
+
+/*! \brief Print a shape, e.g., "[2, 8]". */
+inline std::string ShapeToString(const int64_t* begin, const int64_t* end) {
+  std::ostringstream os;
+  os << "[";
+  for (const int64_t* it = begin; it != end; ++it) {
+    os << (it == begin ? "" : ", ") << *it;
+  }
+  os << "]";
+  return os.str();
+}
+
+/*! \brief Allocate a compact tensor with the given shape except for the batch axis. */
+inline TensorValue AllocRows(const Device& device, DLDataType dtype,
+                             const std::vector<int64_t>& row_shape, int64_t rows) {
+  std::vector<int64_t> shape{rows};
+  shape.insert(shape.end(), row_shape.begin(), row_shape.end());
+  int64_t bytes = (dtype.bits * dtype.lanes + 7) / 8 * rows;
+  for (int64_t dim : row_shape) {
+    bytes *= dim;
+  }
+  auto mem = memory_pool::Memory::Alloc(device, bytes);
+  return TensorValue::Assemble(device, dtype, shape, {}, mem->data, mem);
+}
+
+/*! \brief Allocate a compact tensor with the given number of rows and the row shape of another. */
+inline TensorValue AllocRows(const DLTensor* like, int64_t rows) {
+  return AllocRows(like->device, like->dtype,
+                   std::vector<int64_t>(like->shape + 1, like->shape + like->ndim), rows);
+}
+
+/*! \brief Get a view of the rows [offset, offset + rows) of a tensor. */
+inline tensor::Tensor ViewRows(const tensor::Tensor& tensor, int64_t offset, int64_t rows) {
+  const DLTensor* dl = tensor.operator->();
+  std::vector<int64_t> shape(dl->shape, dl->shape + dl->ndim);
+  shape[0] = rows;
+  void* data = static_cast<char*>(dl->data) + dl->byte_offset + offset * RowBytes(dl);
+  return tensor.CreateView(shape, {}, data);
+}
+
+/*! \brief Copy the rows [offset, offset + rows) of the outputs of a batch. */
+Value CopyRows(const Value& value, int64_t offset, int64_t rows) {
+  if (const auto* tuple = value.as<TupleValueObj>()) {
+    Array<Value> fields;
+    for (const auto& field : tuple->fields) {
+      fields.push_back(CopyRows(field, offset, rows));
+    }
+    return TupleValue::make(fields);
+  }
+  const auto* tensor = value.as<TensorValueObj>();
+  CHECK(tensor != nullptr) << "The outputs of a batch must be tensors, but got "
+                           << value->GetTypeKey();
+  const DLTensor* dl = tensor->tensor.operator->();
+  CHECK_GT(dl->ndim, 0) << "The outputs of a batch must have a batch axis";
+  // The output is copied, as its storage may be reused by the next batch.
+  auto ret = AllocRows(dl, rows);
+  ViewRows(tensor->tensor, offset, rows).CopyTo(ret->tensor);
+  return ret;
+}
+
+BatchingServer::BatchingServer(std::vector<tvm::runtime::Module> vms,
+                               std::vector<int64_t> batch_sizes,
+                               const std::vector<TensorType>& input_types, Device device,
+                               std::vector<Value> shared_args, std::string func_name,
+                               int64_t max_delay_us)
+    : vm_modules_(std::move(vms)),
+      batch_sizes_(std::move(batch_sizes)),
+      device_(device),
+      shared_args_(std::move(shared_args)),
+      func_name_(std::move(func_name)),
+      max_delay_(std::chrono::microseconds(max_delay_us)) {
+  CHECK(!batch_sizes_.empty()) << "No batch size is given";
+  CHECK_GT(batch_sizes_[0], 0) << "Invalid batch size: " << batch_sizes_[0];
+  for (size_t i = 1; i < batch_sizes_.size(); ++i) {
+    CHECK_GT(batch_sizes_[i], batch_sizes_[i - 1]) << "The batch sizes must be ascending";
+  }
+  CHECK(!input_types.empty()) << "The entry function has no batched parameter";
+  for (const auto& type : input_types) {
+    CHECK(!type->shape.empty()) << "The batched parameters must have a batch axis";
+    InputSpec spec;
+    for (size_t i = 1; i < type->shape.size(); ++i) {
+      const auto* dim = type->shape[i].as<IntImmNode>();
+      CHECK(dim != nullptr) << "The batched parameters must have static shapes, but got "
+                            << type;
+      spec.row_shape.push_back(dim->value);
+    }
+    spec.dtype = type->dtype;
+    input_specs_.push_back(std::move(spec));
+  }
+  CHECK(!vm_modules_.empty() && vm_modules_.size() % batch_sizes_.size() == 0)
+      << "Expected a VM per batch size for each worker, but got " << vm_modules_.size()
+      << " VMs for " << batch_sizes_.size() << " batch sizes";
+  for (auto& mod : vm_modules_) {
+    auto* vm = dynamic_cast<VirtualMachine*>(mod.operator->());
+    CHECK(vm) << "Expected a virtual machine, but got " << mod->type_key();
+    vms_.push_back(vm);
+  }
+  int num_workers = vm_modules_.size() / batch_sizes_.size();
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this, i]() { Loop(i); });
+  }
+}
+
+BatchingServer::~BatchingServer() {
+  Stop();
+}
+
+int64_t BatchingServer::Submit(std::vector<Value> inputs) {
+  CHECK_EQ(inputs.size(), input_specs_.size())
+      << "Expected " << input_specs_.size() << " batched inputs, but got " << inputs.size();
+  auto request = std::make_shared<Request>();
+  request->rows = -1;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const auto* tensor = inputs[i].as<TensorValueObj>();
+    CHECK(tensor != nullptr) << "The batched inputs must be tensors, but got "
+                             << inputs[i]->GetTypeKey();
+    const DLTensor* dl = tensor->tensor.operator->();
+    const InputSpec& spec = input_specs_[i];
+    CHECK(dl->dtype == spec.dtype) << "The batched input " << i << " has dtype "
+                                   << tvm::runtime::DLDataType2String(dl->dtype) << ", expected "
+                                   << tvm::runtime::DLDataType2String(spec.dtype);
+    CHECK(dl->ndim == static_cast<int>(spec.row_shape.size()) + 1 &&
+          std::equal(spec.row_shape.begin(), spec.row_shape.end(), dl->shape + 1))
+        << "The batched input " << i << " has shape "
+        << ShapeToString(dl->shape, dl->shape + dl->ndim) << ", which does not match the row shape "
+        << ShapeToString(spec.row_shape.data(), spec.row_shape.data() + spec.row_shape.size())
+        << " of the parameter";
+    int64_t rows = dl->shape[0];
+    CHECK(request->rows < 0 || request->rows == rows)
+        << "The batched inputs of a request have different batch sizes";
+    request->rows = rows;
+  }
+  CHECK_LE(request->rows, batch_sizes_.back())
+      << "The request is larger than the max batch size " << batch_sizes_.back();
+  request->inputs = std::move(inputs);
+  request->arrival = Clock::now();
+
+  int64_t request_id;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    CHECK(!stop_) << "The batching server is stopped";
+    request_id = next_request_id_++;
+    futures_[request_id] = request->promise.get_future().share();
+    queued_rows_ += request->rows;
+    queue_.push_back(std::move(request));
+  }
+  queue_cv_.notify_all();
+  return request_id;
+}
+
+Value BatchingServer::Get(int64_t request_id) {
+  std::shared_future<Value> future;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = futures_.find(request_id);
+    CHECK(it != futures_.end()) << "Unknown request " << request_id;
+    future = it->second;
+    futures_.erase(it);
+  }
+  return future.get();
+}
+
+void BatchingServer::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+std::vector<BatchingServer::RequestPtr> BatchingServer::PopBatch() {
+  const int64_t max_rows = batch_sizes_.back();
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    queue_cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return {};
+    }
+    // Wait for more requests until the batch is full or the oldest request is due. The queue is
+    // checked again afterwards, as other workers may take the requests in the meantime.
+    auto deadline = queue_.front()->arrival + max_delay_;
+    if (stop_ || queued_rows_ >= max_rows || Clock::now() >= deadline) {
+      break;
+    }
+    queue_cv_.wait_until(lock, deadline,
+                         [&]() { return stop_ || queue_.empty() || queued_rows_ >= max_rows; });
+  }
+
+  std::vector<RequestPtr> batch;
+  int64_t rows = 0;
+  while (!queue_.empty() && rows + queue_.front()->rows <= max_rows) {
+    rows += queue_.front()->rows;
+    batch.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+  }
+  queued_rows_ -= rows;
+  if (!queue_.empty()) {
+    // Let another worker batch the rest.
+    queue_cv_.notify_one();
+  }
+  return batch;
+}
+
+void BatchingServer::Loop(int worker_id) {
+  std::vector<Bucket> buckets(batch_sizes_.size());
+  while (true) {
+    auto batch = PopBatch();
+    if (batch.empty()) {
+      return;
+    }
+    RunBatch(worker_id, &buckets, batch);
+  }
+}
+
+void BatchingServer::RunBatch(int worker_id, std::vector<Bucket>* buckets,
+                              const std::vector<RequestPtr>& batch) {
+  int64_t rows = 0;
+  for (const auto& request : batch) {
+    rows += request->rows;
+  }
+  size_t bucket_idx =
+      std::lower_bound(batch_sizes_.begin(), batch_sizes_.end(), rows) - batch_sizes_.begin();
+  int64_t batch_size = batch_sizes_[bucket_idx];
+  Bucket& bucket = (*buckets)[bucket_idx];
+  VirtualMachine* vm = vms_[worker_id * batch_sizes_.size() + bucket_idx];
+
+  size_t num_done = 0;
+  try {
+    if (bucket.inputs.empty()) {
+      for (const auto& spec : input_specs_) {
+        auto buffer = AllocRows(device_, spec.dtype, spec.row_shape, batch_size);
+        const DLTensor* dl = buffer->tensor.operator->();
+        // Zero the buffer once, so the padding rows hold valid numbers. Later they hold the stale
+        // rows of the previous batches, whose outputs are dropped as well.
+        auto zeros = tvm::runtime::NDArray::Empty(
+            tvm::runtime::ShapeTuple(dl->shape, dl->shape + dl->ndim), spec.dtype,
+            Device(DevType::kCPU(), 0));
+        memset(zeros->data, 0, batch_size * RowBytes(dl));
+        tensor::Tensor(zeros).CopyTo(buffer->tensor);
+        bucket.inputs.push_back(buffer);
+      }
+    }
+
+    // Concatenate the inputs of the requests, whose row shapes and dtypes are checked by Submit.
+    for (size_t i = 0; i < bucket.inputs.size(); ++i) {
+      const auto& buffer = bucket.inputs[i]->tensor;
+      int64_t offset = 0;
+      for (const auto& request : batch) {
+        const auto& input = Downcast<TensorValue>(request->inputs[i])->tensor;
+        input.CopyTo(ViewRows(buffer, offset, request->rows));
+        offset += request->rows;
+      }
+    }
+
+    std::vector<Value> args(bucket.inputs.begin(), bucket.inputs.end());
+    args.insert(args.end(), shared_args_.begin(), shared_args_.end());
+    if (!bucket.ctx.defined()) {
+      bucket.ctx = vm->PrepareVMContext(func_name_, args);
+    } else {
+      vm->BindInputs(bucket.ctx, args);
+    }
+    Value output = vm->Run(bucket.ctx);
+
+    // Scatter the rows of the outputs back to the requests.
+    int64_t offset = 0;
+    for (const auto& request : batch) {
+      request->promise.set_value(CopyRows(output, offset, request->rows));
+      offset += request->rows;
+      ++num_done;
+    }
+  } catch (...) {
+    auto error = std::current_exception();
+    for (size_t i = num_done; i < batch.size(); ++i) {
+      batch[i]->promise.set_exception(error);
+    }
+  }
+
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(stats_mu_);
+  num_batches_ += 1;
+  num_rows_ += rows;
+  num_padded_rows_ += batch_size - rows;
+  for (const auto& request : batch) {
+    int64_t latency =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - request->arrival).count();
+    max_latency_us_ = std::max(max_latency_us_, latency);
+    // Keep a uniform sample of the latencies with reservoir sampling.
+    if (latencies_us_.size() < kLatencyReservoirSize) {
+      latencies_us_.push_back(latency);
+    } else {
+      uint64_t idx = latency_rng_() % static_cast<uint64_t>(num_requests_ + 1);
+      if (idx < kLatencyReservoirSize) {
+        latencies_us_[idx] = latency;
+      }
+    }
+    ++num_requests_;
+  }
+}
+
+PackedMetricMap BatchingServer::GetStats() {
+  std::lock_guard<std::mutex> lock(stats_mu_);
+  auto latencies = latencies_us_;
+  auto percentile = [&](double p) -> int64_t {
+    if (latencies.empty()) {
+      return 0;
+    }
+    size_t idx = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+    std::nth_element(latencies.begin(), latencies.begin() + idx, latencies.end());
+    return latencies[idx];
+  };
+  PackedMetricMap ret;
+  ret.Set("num_requests", num_requests_);
+  ret.Set("num_batches", num_batches_);
+  ret.Set("num_rows", num_rows_);
+  ret.Set("num_padded_rows", num_padded_rows_);
+  ret.Set("latency_p50_us", percentile(0.5));
+  ret.Set("latency_p99_us", percentile(0.99));
+  ret.Set("latency_max_us", max_latency_us_);
+  return ret;
+}
+
+void BatchingServer::ResetStats() {
+  std::lock_guard<std::mutex> lock(stats_mu_);
+  num_requests_ = num_batches_ = num_rows_ = num_padded_rows_ = max_latency_us_ = 0;
+  latencies_us_.clear();
+}
+
+PackedFunc BatchingServer::GetFunction(const std::string& name,
+                                       const ObjectPtr<Object>& sptr_to_self) {
+  auto get_inputs = [](const registry::TVMArgs& args) {
+    std::vector<Value> inputs(args.size());
+    for (int i = 0; i < args.size(); ++i) {
+      inputs[i] = args[i];
+    }
+    return inputs;
+  };
+  if (name == "submit") {
+    return PackedFunc([sptr_to_self, this, get_inputs](registry::TVMArgs args,
+                                                       registry::TVMRetValue* rv) {
+      *rv = Submit(get_inputs(args));
+    });
+  } else if (name == "get") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      int64_t request_id = args[0];
+      *rv = Get(request_id);
+    });
+  } else if (name == "infer") {
+    return PackedFunc([sptr_to_self, this, get_inputs](registry::TVMArgs args,
+                                                       registry::TVMRetValue* rv) {
+      *rv = Get(Submit(get_inputs(args)));
+    });
+  } else if (name == "stats") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      *rv = GetStats();
+    });
+  } else if (name == "reset_stats") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      ResetStats();
+    });
+  } else if (name == "stop") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      Stop();
+    });
+  }
+  LOG(FATAL) << "Unknown packed function: " << name;
+  return PackedFunc([sptr_to_self, name](registry::TVMArgs args, registry::TVMRetValue* rv) {});
+}
+
+RAF_REGISTER_GLOBAL("raf.vm.BatchingServer")
+    .set_body_typed([](Array<tvm::runtime::Module> vms, Array<Integer> batch_sizes,
+                       Array<TensorType> input_types, Device device, Array<Value> shared_args,
+                       String func_name, int64_t max_delay_us) {
+      std::vector<int64_t> sizes;
+      for (const auto& size : batch_sizes) {
+        sizes.push_back(size->value);
+      }
+      auto server = make_object<BatchingServer>(
+          std::vector<tvm::runtime::Module>(vms.begin(), vms.end()), sizes,
+          std::vector<TensorType>(input_types.begin(), input_types.end()), device,
+          std::vector<Value>(shared_args.begin(), shared_args.end()), func_name, max_delay_us);
+      return tvm::runtime::Module(server);
+    });
+
+}  // namespace vm
+}  // namespace executor
+}  // namespace raf
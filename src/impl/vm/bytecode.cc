@@ -73,6 +73,7 @@ Instruction::Instruction(const Instruction& instr) {
     case Opcode::SetShape:
       this->set_shape.data = instr.set_shape.data;
       this->set_shape.shape = instr.set_shape.shape;
+      this->set_shape.offset = instr.set_shape.offset;
       return;
     case Opcode::InvokePacked:
       this->invoke_packed.packed_index = instr.invoke_packed.packed_index;
@@ -196,6 +197,7 @@ Instruction& Instruction::operator=(const Instruction& instr) {
     case Opcode::SetShape:
       this->set_shape.data = instr.set_shape.data;
       this->set_shape.shape = instr.set_shape.shape;
+      this->set_shape.offset = instr.set_shape.offset;
       return *this;
     case Opcode::InvokePacked:
       this->invoke_packed.packed_index = instr.invoke_packed.packed_index;
@@ -377,7 +379,7 @@ Instruction Instruction::AllocTensorReg(RegName storage, Index offset, RegName s
 
 Instruction Instruction::AllocStorage(RegName size, Index alignment, DLDataType dtype_hint,
                                       DevType device_type, Index device_id, Index dst,
-                                      bool alloc_async) {
+                                      bool alloc_async, Index arena_offset) {
   Instruction instr;
   instr.op = Opcode::AllocStorage;
   instr.dst = dst;
@@ -387,6 +389,7 @@ Instruction Instruction::AllocStorage(RegName size, Index alignment, DLDataType
   instr.alloc_storage.device_type = device_type;
   instr.alloc_storage.device_id = device_id;
   instr.alloc_storage.alloc_async = alloc_async;
+  instr.alloc_storage.arena_offset = arena_offset;
   return instr;
 }
 
@@ -423,12 +426,13 @@ Instruction Instruction::AllocClosure(Index func_index, const std::vector<RegNam
   return instr;
 }
 
-Instruction Instruction::SetShape(RegName data, RegName shape, RegName dst) {
+Instruction Instruction::SetShape(RegName data, RegName shape, RegName dst, Index offset) {
   Instruction instr;
   instr.op = Opcode::SetShape;
   instr.dst = dst;
   instr.set_shape.data = data;
   instr.set_shape.shape = shape;
+  instr.set_shape.offset = offset;
   return instr;
 }
 
@@ -657,6 +661,9 @@ void InstructionPrint(std::ostream& os, const Instruction& instr) {
     case Opcode::SetShape: {
       os << "set_shape $" << instr.dst << " $" << instr.set_shape.data << " $"
          << instr.set_shape.shape;
+      if (instr.set_shape.offset != 0) {
+        os << " " << instr.set_shape.offset;
+      }
       break;
     }
     case Opcode::If: {
@@ -700,6 +707,9 @@ void InstructionPrint(std::ostream& os, const Instruction& instr) {
       if (instr.alloc_storage.alloc_async) {
         os << "(async)";
       }
+      if (instr.alloc_storage.arena_offset >= 0) {
+        os << " arena+" << instr.alloc_storage.arena_offset;
+      }
       break;
     }
     case Opcode::Free: {
@@ -7,6 +7,7 @@
  * \file src/impl/vm/compiler.cc
  * \brief The RAF virtual machine compiler.
  */
+#include <algorithm>
 #include <tvm/ir/module.h>
 #include <tvm/ir/type_functor.h>
 #include <tvm/target/target.h>
@@ -410,7 +411,8 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
           .Match("raf.op.vm.alloc_tensor",
                  [this](const Array<Expr>& args, const Attrs& attrs, const Array<Type>& type_arg) {
                    bool own = true;
-                   if (args.size() == 5) {
+                   Index offset = 0;
+                   if (args.size() >= 5) {
                      // The last "own" argument is usually specified by the MemoryPlan pass
                      // to indicate that this tensor is not the final output so it should not
                      // own the memory pointer.
@@ -421,6 +423,14 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
                    } else {
                      CHECK_EQ(args.size(), 4);
                    }
+                   if (args.size() == 6) {
+                     // The offset in the storage, which is specified by the MemoryPlan pass
+                     // when multiple tensors are packed into one storage.
+                     CHECK(args[5].as<ConstantNode>());
+                     auto offset_val = args[5].as<ConstantNode>()->value;
+                     CHECK(offset_val->IsInstance<IntValueObj>());
+                     offset = offset_val.as<IntValueObj>()->value;
+                   }
 
                    // The storage will be passed dynamically.
                    this->VisitExpr(args[0]);
@@ -446,12 +456,12 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
                        raw_shape.push_back(imm->value);
                      }
                      // Add context field.
-                     Emit(Instruction::AllocTensor(storage_register, 0, raw_shape, dtype,
+                     Emit(Instruction::AllocTensor(storage_register, offset, raw_shape, dtype,
                                                    NewRegister(), own));
                    } else {
                      this->VisitExpr(args[1]);
-                     Emit(Instruction::AllocTensorReg(storage_register, 0, last_register_, dtype,
-                                                      NewRegister(), own));
+                     Emit(Instruction::AllocTensorReg(storage_register, offset, last_register_,
+                                                      dtype, NewRegister(), own));
                    }
                  })
           .Match("raf.op.vm.alloc_storage",
@@ -508,13 +518,21 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
                  })
           .Match("raf.op.vm.set_shape",
                  [this](const Array<Expr>& args, const Attrs& attrs, const Array<Type>& type_arg) {
-                   CHECK_EQ(args.size(), 2);
+                   CHECK(args.size() == 2 || args.size() == 3);
                    this->VisitExpr(args[0]);
                    auto data_reg = last_register_;
                    // The shape argument may be a constant or a tensor
                    this->VisitExpr(args[1]);
                    auto shape_reg = last_register_;
-                   Emit(Instruction::SetShape(data_reg, shape_reg, NewRegister()));
+                   // The byte offset of the view, which is specified by the ManifestAlloc pass
+                   Index offset = 0;
+                   if (args.size() == 3) {
+                     CHECK(args[2].as<ConstantNode>());
+                     auto offset_val = args[2].as<ConstantNode>()->value;
+                     CHECK(offset_val->IsInstance<IntValueObj>());
+                     offset = offset_val.as<IntValueObj>()->value;
+                   }
+                   Emit(Instruction::SetShape(data_reg, shape_reg, NewRegister(), offset));
                  })
           .Match(
               "raf.op.set_stream",
@@ -773,6 +791,225 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
   DeviceMap device_map_;
 };
 
+/*! \brief Get the registers read by an instruction. */
+std::vector<RegName> GetInputRegisters(const Instruction& instr) {
+  switch (instr.op) {
+    case Opcode::Move:
+      return {instr.from};
+    case Opcode::Ret:
+      return {instr.result};
+    case Opcode::GetField:
+      return {instr.get_field.object};
+    case Opcode::If:
+      return {instr.if_op.test, instr.if_op.target};
+    case Opcode::AllocStorage:
+      return {instr.alloc_storage.allocation_size};
+    case Opcode::AllocTensor:
+      return {instr.alloc_tensor.storage};
+    case Opcode::AllocTensorReg:
+      return {instr.alloc_tensor_reg.storage, instr.alloc_tensor_reg.shape_register};
+    case Opcode::AllocTuple:
+      return std::vector<RegName>(instr.alloc_tuple.fields,
+                                  instr.alloc_tuple.fields + instr.alloc_tuple.num_fields);
+    case Opcode::AllocClosure:
+      return std::vector<RegName>(
+          instr.alloc_closure.free_vars,
+          instr.alloc_closure.free_vars + instr.alloc_closure.num_free_vars);
+    case Opcode::SetShape:
+      return {instr.set_shape.data, instr.set_shape.shape};
+    case Opcode::Free:
+      return {instr.free.memory};
+    case Opcode::InvokeFunc:
+      return std::vector<RegName>(instr.invoke_func.args,
+                                  instr.invoke_func.args + instr.invoke_func.num_args);
+    case Opcode::InvokeClosure: {
+      std::vector<RegName> regs{instr.invoke_closure.closure};
+      regs.insert(regs.end(), instr.invoke_closure.args,
+                  instr.invoke_closure.args + instr.invoke_closure.num_args);
+      return regs;
+    }
+    case Opcode::InvokePacked:
+      return std::vector<RegName>(instr.invoke_packed.args,
+                                  instr.invoke_packed.args + instr.invoke_packed.arity);
+    case Opcode::InvokeJit: {
+      std::vector<RegName> regs{instr.invoke_jit.op_reg};
+      regs.insert(regs.end(), instr.invoke_jit.args,
+                  instr.invoke_jit.args + instr.invoke_jit.arity);
+      return regs;
+    }
+    case Opcode::InferType: {
+      std::vector<RegName> regs{instr.infer_type.op_reg};
+      regs.insert(regs.end(), instr.infer_type.args,
+                  instr.infer_type.args + instr.infer_type.num_args);
+      return regs;
+    }
+    default:
+      return {};
+  }
+}
+
+/*!
+ * \brief Plan a static arena for a VM function. Every storage with a constant size that only
+ * backs intermediate tensors gets an offset in one arena of the function, and two storages may
+ * share bytes only if their live ranges do not overlap. The live range of a storage spans from
+ * its allocation to the last instruction that reads it or any value derived from it (tensors,
+ * views and tuples). The offsets are assigned greedily from the largest storage, each placed at
+ * the lowest offset that does not conflict with the placed storages that are live at the same
+ * time. Only straight-line functions running on a single stream are planned, so that the
+ * instruction order is the execution order.
+ * \param func The function to plan, whose AllocStorage instructions are updated in place.
+ * \param constants The constant pool of the executable.
+ */
+void PlanStaticArena(VMFunction* func, const std::vector<Value>& constants) {
+  auto& instrs = func->instructions;
+  for (const auto& instr : instrs) {
+    switch (instr.op) {
+      case Opcode::If:
+      case Opcode::Goto:
+      case Opcode::InvokeFunc:
+      case Opcode::InvokeClosure:
+      case Opcode::CudaSetStream:
+      case Opcode::CudaAddEvent:
+      case Opcode::CudaWaitEvent:
+      case Opcode::CudaStreamBarrier:
+        return;
+      default:
+        break;
+    }
+  }
+
+  struct StorageInfo {
+    size_t pc;
+    int64_t size;
+    int64_t alignment;
+    size_t last_use;
+    bool valid;
+    int64_t offset;
+  };
+  std::vector<StorageInfo> storages;
+  // The constant sizes in registers.
+  std::unordered_map<RegName, int64_t> const_regs;
+  // The storages that the value in a register is derived from.
+  std::unordered_map<RegName, std::vector<size_t>> derived;
+
+  for (size_t pc = 0; pc < instrs.size(); ++pc) {
+    const auto& instr = instrs[pc];
+    if (instr.op == Opcode::LoadConst) {
+      const auto* int_val = constants[instr.const_index].as<IntValueObj>();
+      if (int_val) {
+        const_regs[instr.dst] = int_val->value;
+      }
+      continue;
+    } else if (instr.op == Opcode::LoadConsti) {
+      const_regs[instr.dst] = instr.load_consti.val;
+      continue;
+    } else if (instr.op == Opcode::AllocStorage) {
+      auto it = const_regs.find(instr.alloc_storage.allocation_size);
+      // Storages of output tensors are not allocated asynchronously, and they must outlive
+      // the function.
+      if (it != const_regs.end() && it->second > 0 && instr.alloc_storage.alloc_async) {
+        derived[instr.dst] = {storages.size()};
+        storages.push_back({pc, it->second, instr.alloc_storage.alignment, pc, true, -1});
+      }
+      continue;
+    }
+
+    std::vector<size_t> sources;
+    for (auto reg : GetInputRegisters(instr)) {
+      auto it = derived.find(reg);
+      if (it == derived.end()) {
+        continue;
+      }
+      for (auto sid : it->second) {
+        auto& storage = storages[sid];
+        storage.last_use = pc;
+        if (instr.op == Opcode::Ret ||
+            (instr.op == Opcode::AllocTensor && instr.alloc_tensor.own) ||
+            (instr.op == Opcode::AllocTensorReg && instr.alloc_tensor_reg.own)) {
+          // The memory escapes from the function.
+          storage.valid = false;
+        }
+        sources.push_back(sid);
+      }
+    }
+    if (!sources.empty()) {
+      switch (instr.op) {
+        case Opcode::AllocTensor:
+        case Opcode::AllocTensorReg:
+        case Opcode::AllocTuple:
+        case Opcode::GetField:
+        case Opcode::Move:
+        case Opcode::SetShape:
+        case Opcode::AllocClosure:
+        case Opcode::InferType:
+          derived[instr.dst] = std::move(sources);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  // All storages in an arena must be on the same device.
+  std::vector<size_t> order;
+  for (size_t i = 0; i < storages.size(); ++i) {
+    if (!storages[i].valid) {
+      continue;
+    }
+    const auto& first = instrs[storages[order.empty() ? i : order[0]].pc].alloc_storage;
+    const auto& curr = instrs[storages[i].pc].alloc_storage;
+    if (curr.device_type == first.device_type && curr.device_id == first.device_id) {
+      order.push_back(i);
+    }
+  }
+  if (order.empty()) {
+    return;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return storages[a].size > storages[b].size; });
+
+  int64_t arena_size = 0;
+  int64_t arena_alignment = kDefaultMemoryAlignment;
+  std::vector<size_t> placed;
+  for (auto sid : order) {
+    auto& storage = storages[sid];
+    // Collect the placed storages that are live at the same time, ordered by their offsets.
+    std::vector<size_t> conflicts;
+    for (auto pid : placed) {
+      const auto& other = storages[pid];
+      if (other.pc <= storage.last_use && storage.pc <= other.last_use) {
+        conflicts.push_back(pid);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end(),
+              [&](size_t a, size_t b) { return storages[a].offset < storages[b].offset; });
+    int64_t alignment = std::max<int64_t>(storage.alignment, 1);
+    int64_t offset = 0;
+    for (auto pid : conflicts) {
+      const auto& other = storages[pid];
+      if (offset + storage.size <= other.offset) {
+        break;
+      }
+      int64_t end = other.offset + other.size;
+      offset = std::max(offset, (end + alignment - 1) / alignment * alignment);
+    }
+    storage.offset = offset;
+    placed.push_back(sid);
+    arena_size = std::max(arena_size, offset + storage.size);
+    arena_alignment = std::max(arena_alignment, alignment);
+  }
+
+  int64_t total_size = 0;
+  for (auto sid : placed) {
+    instrs[storages[sid].pc].alloc_storage.arena_offset = storages[sid].offset;
+    total_size += storages[sid].size;
+  }
+  func->arena_size = arena_size;
+  func->arena_alignment = arena_alignment;
+  DLOG(INFO) << "Static arena of " << func->name << ": " << placed.size() << " storages, "
+             << arena_size << " bytes (" << total_size << " bytes without sharing)";
+}
+
 void VMCompiler::SetParam(const std::string& name, Value data_in) {
   params_[name] = data_in;
 }
@@ -805,6 +1042,8 @@ void VMCompiler::Lower(IRModule mod, const DeviceMap& device_map) {
   // the global state.
   exec_->functions.resize(context_.module->functions.size());
 
+  pass::PassContext pass_ctx = pass::PassContext::Current();
+  bool static_arena = pass_ctx->GetConfig("raf.vm.static_arena", Bool(false)).value();
   for (auto named_func : context_.module->functions) {
     auto gvar = named_func.first;
     if (auto* n = named_func.second.as<FunctionNode>()) {
@@ -812,6 +1051,10 @@ void VMCompiler::Lower(IRModule mod, const DeviceMap& device_map) {
       VMFunctionCompiler func_compiler(&context_, device_map_);
       auto vm_func = func_compiler.Compile(gvar, func);
 
+      if (static_arena) {
+        PlanStaticArena(&vm_func, context_.constants);
+      }
+
       size_t func_index = context_.global_map.at(gvar);
       CHECK(func_index < exec_->functions.size());
       exec_->functions[func_index] = vm_func;
@@ -869,9 +1112,10 @@ IRModule VMCompiler::OptimizeModule(const IRModule& mod, const DeviceMap& device
     // output type than the base ops.
     pass_seqs.push_back(pass::EraseType());
 
-    // optimization passes that transform BBNF into ANF
-    if (device_t == DevType::kCUDA()) {
-      if (DistConfig::Global()->enable_data_parallel) {
+    // optimization passes that transform BBNF into ANF. On CPU, the streams of the schedule are
+    // mapped to host worker threads by the VM.
+    if (device_t == DevType::kCUDA() || device_t == DevType::kCPU()) {
+      if (device_t == DevType::kCUDA() && DistConfig::Global()->enable_data_parallel) {
         // The current design of EnforceSync assumes ops are executed on multiple CUDA streams:
         // all computation ops are executed on a computation stream, and all communication
         // collectives are executed on another communication stream. Memory copy ops added in
@@ -895,11 +1139,16 @@ IRModule VMCompiler::OptimizeModule(const IRModule& mod, const DeviceMap& device
         } else if (policy_name == "asap") {
           pass_seqs.push_back(pass::ASAPStreamSchedule());
         } else if (policy_name == "ios") {
+          // IOS profiles the candidate stages on the CUDA device.
+          if (device_t != DevType::kCUDA()) {
+            LOG(FATAL) << "The ios schedule policy only supports CUDA. The supported policies on "
+                       << device_t.c_str() << " are sequential, wavefront, and asap";
+          }
           pass_seqs.push_back(pass::InferType());
           pass_seqs.push_back(pass::IOSStreamSchedule());
         } else {
           LOG(FATAL) << "Cannot recognize schedule policy: " << policy_name << ", candidates are \n"
-                     << "  sequential, wavefront, asap, and ios" << std::endl;
+                     << "  sequential, wavefront, asap, and ios (CUDA only)" << std::endl;
         }
       }
     } else {
@@ -935,7 +1184,12 @@ IRModule VMCompiler::OptimizeModule(const IRModule& mod, const DeviceMap& device
   pass_seqs.push_back(pass::LambdaLift());
   pass_seqs.push_back(pass::InferType());
   pass_seqs.push_back(pass::ManifestAlloc());
-  pass_seqs.push_back(pass::MemoryPlan());
+  if (!enable_stream_schedule || device_t != DevType::kCPU()) {
+    // The memory plan shares buffers by the liveness in program order, which does not hold when
+    // the host streams run the ops out of order. The buffers are instead kept alive by the ops
+    // launched to the host streams until they are done.
+    pass_seqs.push_back(pass::MemoryPlan());
+  }
 
   pass::RAFSequential seq(pass_seqs, "vm_compiler_optimize");
   return seq(mod);
@@ -999,6 +1253,7 @@ PackedFunc VMCompiler::GetFunction(const std::string& name, const ObjectPtr<Obje
 
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.vm.optimize.anf_only", Bool);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.use_multi_func", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.vm.static_arena", Bool);
 
 RAF_REGISTER_GLOBAL("raf.vm.VMCompiler").set_body_typed(CreateVMCompiler);
 
@@ -9,18 +9,29 @@
  */
 
 #include <dmlc/memory_io.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <tvm/runtime/memory.h>
 #include <tvm/runtime/object.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <set>
 #include <sstream>
 #include <vector>
 
+#include "raf/cache.h"
+#include "raf/memory_pool.h"
 #include "raf/serialization.h"
 #include "raf/vm/vm.h"
 #include "./serialize_util.h"
+#include "../../common/shape_utils.h"
 
 namespace raf {
 namespace executor {
@@ -33,6 +44,31 @@ using namespace raf::registry;
   CHECK(val) << "Invalid VM file format in the " << section << " section." \
              << "\n";
 
+/*! \brief The kinds of the entries in the constant section. */
+enum ConstantKind : uint8_t {
+  /*! \brief The value is serialized in the constant section. */
+  kInlineConstant = 0,
+  /*! \brief The tensor refers to its raw data in the blob region. */
+  kBlobConstant = 1,
+};
+
+inline uint64_t AlignUp(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+/*! \brief A constant tensor bound onto the mapping of the executable file. */
+class MappedMemory final : public memory_pool::Memory {
+ public:
+  MappedMemory(std::shared_ptr<void> mapping, void* data) : mapping_(std::move(mapping)) {
+    this->data = data;
+    this->device = Device(DevType::kCPU(), 0);
+  }
+
+ private:
+  /*! \brief The file mapping, which is unmapped when all constants on it are freed. */
+  std::shared_ptr<void> mapping_;
+};
+
 // Helper to serialize a vm instruction.
 VMInstructionSerializer SerializeInstruction(const Instruction& instr);
 // Helper to deserialize a serialized vm instruction.
@@ -49,6 +85,14 @@ PackedFunc Executable::GetFunction(const std::string& name, const ObjectPtr<Obje
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->Stats(); });
   } else if (name == "save") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->Save(); });
+  } else if (name == "save_aot") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      tvm::runtime::Module vm_mod = args[0];
+      const auto* vm = dynamic_cast<const VirtualMachine*>(vm_mod.operator->());
+      CHECK(vm) << "Expected a VirtualMachine to collect the dispatch decisions";
+      this->aot_dispatch = vm->GetDispatchRecords();
+      *rv = this->Save(true);
+    });
   } else if (name == "get_function_arity") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       std::string func_name = args[0];
@@ -104,6 +148,9 @@ std::string Executable::GetBytecode() const {
     oss << ")" << std::endl;
     oss << "# reg file size = " << func.register_file_size << std::endl;
     oss << "# instruction count = " << func.instructions.size() << std::endl;
+    if (func.arena_size > 0) {
+      oss << "# static arena size = " << func.arena_size << std::endl;
+    }
 
     // Print the instructions of a `VMFunction`.
     // The part after ";" is the instruction in text format.
@@ -161,6 +208,10 @@ std::string Executable::Stats() const {
   if (!prim_ops.empty()) oss.seekp(-2, oss.cur);
   oss << "]" << std::endl;
 
+  if (!aot_dispatch.empty()) {
+    oss << "  AOT dispatch records (#" << aot_dispatch.size() << ")" << std::endl;
+  }
+
   return oss.str();
 }
 
@@ -171,7 +222,7 @@ void SaveHeader(dmlc::Stream* strm) {
   strm->Write(version);
 }
 
-TVMByteArray Executable::Save() {
+TVMByteArray Executable::Save(bool aot) {
   // Initialize the stream object.
   code_.clear();
   dmlc::MemoryStringStream strm(&code_);
@@ -183,7 +234,8 @@ TVMByteArray Executable::Save() {
   SaveGlobalSection(&strm);
 
   // Constant section.
-  SaveConstantSection(&strm);
+  std::vector<std::pair<const DLTensor*, uint64_t>> blobs;
+  SaveConstantSection(&strm, &blobs);
 
   // Primitive names.
   SavePrimitiveOpNames(&strm);
@@ -191,6 +243,26 @@ TVMByteArray Executable::Save() {
   // Code section.
   SaveCodeSection(&strm);
 
+  // AOT section.
+  if (aot) {
+    SaveAOTSection(&strm);
+  }
+
+  // Constant blobs, which start at a page boundary of the file, followed by the trailer that
+  // locates them.
+  uint64_t sections_size = code_.size();
+  uint64_t blobs_offset = AlignUp(sections_size, kConstantBlobPageSize);
+  std::string padding(blobs_offset - sections_size, '\0');
+  strm.Write(padding.data(), padding.size());
+  for (const auto& blob : blobs) {
+    padding.assign(blobs_offset + blob.second - code_.size(), '\0');
+    strm.Write(padding.data(), padding.size());
+    strm.Write(blob.first->data, common::shape_utils::BytesCompactTensor(*blob.first));
+  }
+  strm.Write(sections_size);
+  strm.Write(blobs_offset);
+  strm.Write(kMetaVMConstantBlobMagic);
+
   TVMByteArray arr;
   arr.data = code_.c_str();
   arr.size = code_.length();
@@ -212,10 +284,37 @@ void Executable::SaveGlobalSection(dmlc::Stream* strm) {
   strm->Write(glbs);
 }
 
-void Executable::SaveConstantSection(dmlc::Stream* strm) {
+void Executable::SaveConstantSection(dmlc::Stream* strm,
+                                     std::vector<std::pair<const DLTensor*, uint64_t>>* blobs) {
   strm->Write(static_cast<uint64_t>(constants.size()));
+  uint64_t blobs_size = 0;
   for (const auto& value : this->constants) {
-    serialization::SerializeValue(strm, value);
+    const DLTensor* dlt = nullptr;
+    if (value.as<TensorValueObj>()) {
+      dlt = Downcast<TensorValue>(value);
+    }
+    int64_t nbytes = 0;
+    if (dlt && dlt->device.device_type == kDLCPU && common::shape_utils::IsCompact(*dlt)) {
+      nbytes = common::shape_utils::BytesCompactTensor(*dlt);
+    }
+    if (nbytes == 0) {
+      strm->Write(static_cast<uint8_t>(kInlineConstant));
+      serialization::SerializeValue(strm, value);
+      continue;
+    }
+    // The large blobs start at page boundaries, so that the pages of a tensor are not shared
+    // with other tensors.
+    uint64_t alignment = nbytes >= static_cast<int64_t>(kConstantBlobPageSize)
+                             ? kConstantBlobPageSize
+                             : kDefaultMemoryAlignment;
+    uint64_t offset = AlignUp(blobs_size, alignment);
+    blobs_size = offset + nbytes;
+    blobs->emplace_back(dlt, offset);
+    strm->Write(static_cast<uint8_t>(kBlobConstant));
+    strm->Write(dlt->dtype);
+    strm->Write(std::vector<int64_t>(dlt->shape, dlt->shape + dlt->ndim));
+    strm->Write(offset);
+    strm->Write(static_cast<uint64_t>(nbytes));
   }
 }
 
@@ -328,6 +427,7 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
       fields.push_back(instr.alloc_storage.device_id);
       fields.push_back(instr.dst);
       fields.push_back(instr.alloc_storage.alloc_async);
+      fields.push_back(instr.alloc_storage.arena_offset);
       break;
     }
     case Opcode::Free: {
@@ -353,10 +453,11 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
       break;
     }
     case Opcode::SetShape: {
-      // Number of fields = 3
+      // Number of fields = 4
       fields.push_back(instr.set_shape.data);
       fields.push_back(instr.set_shape.shape);
       fields.push_back(instr.dst);
+      fields.push_back(instr.set_shape.offset);
       break;
     }
     case Opcode::If: {
@@ -454,7 +555,7 @@ void Executable::SaveCodeSection(dmlc::Stream* strm) {
   for (const auto& func : this->functions) {
     // Save the function info.
     VMFunctionSerializer func_format(func.name, func.register_file_size, func.instructions.size(),
-                                     func.params);
+                                     func.params, func.arena_size, func.arena_alignment);
     func_format.Save(strm);
 
     // Serialize each instruction.
@@ -465,6 +566,44 @@ void Executable::SaveCodeSection(dmlc::Stream* strm) {
   }
 }
 
+void Executable::SaveAOTSection(dmlc::Stream* strm) {
+  strm->Write(kMetaVMAOTSectionMagic);
+
+  // Save the dispatch decisions.
+  strm->Write(static_cast<uint64_t>(aot_dispatch.size()));
+  for (const auto& record : aot_dispatch) {
+    strm->Write(record.func_index);
+    strm->Write(record.pc);
+    strm->Write(record.key);
+    strm->Write(record.op_name);
+  }
+
+  // Save the entries of the persistent kernel caches used by the recorded OpEnvs.
+  std::map<std::string, std::set<std::string>> cache_keys;
+  for (const auto& record : aot_dispatch) {
+    for (const auto& it : record.cache_keys) {
+      cache_keys[it.first].insert(it.second);
+    }
+  }
+  std::vector<std::pair<std::string, op::MetaCacheSerializer*>> caches;
+  for (const auto& it : cache_keys) {
+    if (auto* cache = op::MetaCacheSerializer::Get(it.first)) {
+      caches.emplace_back(it.first, cache);
+    }
+  }
+  strm->Write(static_cast<uint64_t>(caches.size()));
+  for (const auto& cache : caches) {
+    const auto& keys = cache_keys[cache.first];
+    auto entries = cache.second->Export(std::vector<std::string>(keys.begin(), keys.end()));
+    strm->Write(cache.first);
+    strm->Write(static_cast<uint64_t>(entries.size()));
+    for (const auto& entry : entries) {
+      strm->Write(entry.first);
+      strm->Write(entry.second);
+    }
+  }
+}
+
 void LoadHeader(dmlc::Stream* strm) {
   // Check header.
   uint64_t header;
@@ -478,10 +617,48 @@ void LoadHeader(dmlc::Stream* strm) {
 }
 
 tvm::runtime::Module Executable::Load(const std::string& code, const tvm::runtime::Module lib) {
+  return LoadFromBuffer(code.data(), code.size(), lib, nullptr);
+}
+
+tvm::runtime::Module Executable::LoadFromFile(const std::string& path,
+                                              const tvm::runtime::Module lib) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Cannot open " << path << ": " << strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat " << path << ": " << strerror(errno);
+  size_t size = static_cast<size_t>(st.st_size);
+  CHECK_GT(size, 0) << "Empty VM executable file " << path;
+  // A private writable mapping, so that the clean pages are shared through the page cache, and
+  // a write to a constant copies its page instead of modifying the file.
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK(addr != MAP_FAILED) << "Cannot map " << path << ": " << strerror(errno);
+  std::shared_ptr<void> mapping(addr, [size](void* p) { munmap(p, size); });
+  return LoadFromBuffer(static_cast<const char*>(addr), size, lib, mapping);
+}
+
+tvm::runtime::Module Executable::LoadFromBuffer(const char* data, size_t size,
+                                                const tvm::runtime::Module lib,
+                                                std::shared_ptr<void> mapping) {
   auto exec = make_object<Executable>();
   exec->lib = lib;
-  exec->code_ = code;
-  dmlc::MemoryStringStream strm(&exec->code_);
+
+  // Locate the constant blobs with the trailer. The files saved before the blobs were
+  // introduced have their constants inline.
+  size_t sections_size = size;
+  const char* blobs = nullptr;
+  size_t blobs_size = 0;
+  uint64_t trailer[3];
+  if (size >= sizeof(trailer)) {
+    std::memcpy(trailer, data + size - sizeof(trailer), sizeof(trailer));
+    if (trailer[2] == kMetaVMConstantBlobMagic) {
+      STREAM_CHECK(trailer[0] <= trailer[1] && trailer[1] <= size - sizeof(trailer), "trailer");
+      sections_size = trailer[0];
+      blobs = data + trailer[1];
+      blobs_size = size - sizeof(trailer) - trailer[1];
+    }
+  }
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(data), sections_size);
 
   // Load header.
   LoadHeader(&strm);
@@ -490,7 +667,7 @@ tvm::runtime::Module Executable::Load(const std::string& code, const tvm::runtim
   exec->LoadGlobalSection(&strm);
 
   // Constant section.
-  exec->LoadConstantSection(&strm);
+  exec->LoadConstantSection(&strm, blobs, blobs_size, std::move(mapping));
 
   // Primitive names that will be invoked by `InvokePacked` instructions.
   exec->LoadPrimitiveOpNames(&strm);
@@ -498,9 +675,53 @@ tvm::runtime::Module Executable::Load(const std::string& code, const tvm::runtim
   // Code section.
   exec->LoadCodeSection(&strm);
 
+  // AOT section, if any.
+  exec->LoadAOTSection(&strm);
+
   return tvm::runtime::Module(exec);
 }
 
+void Executable::LoadAOTSection(dmlc::Stream* strm) {
+  uint64_t magic;
+  if (!strm->Read(&magic)) {
+    return;
+  }
+  STREAM_CHECK(magic == kMetaVMAOTSectionMagic, "aot");
+
+  // Load the dispatch decisions.
+  uint64_t num_records;
+  STREAM_CHECK(strm->Read(&num_records), "aot/dispatch");
+  aot_dispatch.resize(num_records);
+  for (auto& record : aot_dispatch) {
+    STREAM_CHECK(strm->Read(&record.func_index), "aot/dispatch");
+    STREAM_CHECK(strm->Read(&record.pc), "aot/dispatch");
+    STREAM_CHECK(strm->Read(&record.key), "aot/dispatch");
+    STREAM_CHECK(strm->Read(&record.op_name), "aot/dispatch");
+  }
+
+  // Import the entries of the persistent kernel caches.
+  uint64_t num_caches;
+  STREAM_CHECK(strm->Read(&num_caches), "aot/cache");
+  for (uint64_t i = 0; i < num_caches; ++i) {
+    std::string name;
+    uint64_t num_entries;
+    STREAM_CHECK(strm->Read(&name), "aot/cache");
+    STREAM_CHECK(strm->Read(&num_entries), "aot/cache");
+    std::vector<std::pair<std::string, std::string>> entries(num_entries);
+    for (auto& entry : entries) {
+      STREAM_CHECK(strm->Read(&entry.first), "aot/cache");
+      STREAM_CHECK(strm->Read(&entry.second), "aot/cache");
+    }
+    if (auto* cache = op::MetaCacheSerializer::Get(name)) {
+      size_t num_imported = cache->Import(entries);
+      DLOG(INFO) << "Imported " << num_imported << " entries to cache " << name;
+    } else if (!entries.empty()) {
+      LOG(WARNING) << "Skipped " << entries.size() << " entries of cache " << name
+                   << ", which is not available in this build";
+    }
+  }
+}
+
 void Executable::LoadGlobalSection(dmlc::Stream* strm) {
   std::vector<std::string> globals;
   STREAM_CHECK(strm->Read(&globals), "global");
@@ -509,15 +730,41 @@ void Executable::LoadGlobalSection(dmlc::Stream* strm) {
   }
 }
 
-void Executable::LoadConstantSection(dmlc::Stream* strm) {
+void Executable::LoadConstantSection(dmlc::Stream* strm, const char* blobs, size_t blobs_size,
+                                     std::shared_ptr<void> mapping) {
   uint64_t sz;
   // Load the number of constants.
   STREAM_CHECK(strm->Read(&sz, sizeof(sz)), "constant");
   size_t size = static_cast<size_t>(sz);
   // Load each of the constants.
   for (size_t i = 0; i < size; i++) {
-    Value value = serialization::DeserializeValue(strm);
-    constants.push_back(value);
+    uint8_t kind = kInlineConstant;
+    if (blobs != nullptr) {
+      STREAM_CHECK(strm->Read(&kind), "constant");
+    }
+    if (kind == kInlineConstant) {
+      constants.push_back(serialization::DeserializeValue(strm));
+      continue;
+    }
+    STREAM_CHECK(kind == kBlobConstant, "constant");
+    DLDataType dtype;
+    std::vector<int64_t> shape;
+    uint64_t offset, nbytes;
+    STREAM_CHECK(strm->Read(&dtype), "constant/blob");
+    STREAM_CHECK(strm->Read(&shape), "constant/blob");
+    STREAM_CHECK(strm->Read(&offset), "constant/blob");
+    STREAM_CHECK(strm->Read(&nbytes), "constant/blob");
+    STREAM_CHECK(offset <= blobs_size && nbytes <= blobs_size - offset, "constant/blob");
+    Device cpu(DevType::kCPU(), 0);
+    std::shared_ptr<memory_pool::Memory> mem;
+    if (mapping) {
+      // Bind the tensor onto the mapping, so that its pages are read on first use.
+      mem = std::make_shared<MappedMemory>(mapping, const_cast<char*>(blobs + offset));
+    } else {
+      mem = memory_pool::Memory::Alloc(cpu, nbytes);
+      std::memcpy(mem->data, blobs + offset, nbytes);
+    }
+    constants.push_back(TensorValue::Assemble(cpu, dtype, shape, {}, mem->data, mem));
   }
 }
 
@@ -648,9 +895,10 @@ Instruction DeserializeInstruction(const VMInstructionSerializer& instr) {
       Index device_id = instr.fields[6];
       RegName dst = instr.fields[7];
       bool alloc_async = instr.fields[8];
+      Index arena_offset = instr.fields.size() > 9 ? instr.fields[9] : -1;
 
       return Instruction::AllocStorage(allocation_size, alignment, dtype, device_type, device_id,
-                                       dst, alloc_async);
+                                       dst, alloc_async, arena_offset);
     }
     case Opcode::Free: {
       DCHECK_EQ(instr.fields.size(), 1U);
@@ -662,8 +910,10 @@ Instruction DeserializeInstruction(const VMInstructionSerializer& instr) {
       RegName data = instr.fields[0];
       RegName shape = instr.fields[1];
       RegName dst = instr.fields[2];
+      // The offset is absent in the executables saved before views with offsets.
+      Index offset = instr.fields.size() > 3 ? instr.fields[3] : 0;
 
-      return Instruction::SetShape(data, shape, dst);
+      return Instruction::SetShape(data, shape, dst, offset);
     }
     case Opcode::If: {
       // Number of fields = 4
@@ -791,6 +1041,8 @@ void Executable::LoadCodeSection(dmlc::Stream* strm) {
     // Create the VM function.
     VMFunction vm_func = VMFunction(loaded_func.name, loaded_func.params, instructions,
                                     loaded_func.register_file_size);
+    vm_func.arena_size = loaded_func.arena_size;
+    vm_func.arena_alignment = loaded_func.arena_alignment;
     auto it = this->global_map.find(loaded_func.name);
     CHECK(it != this->global_map.end());
     CHECK_LE(it->second, this->global_map.size());
@@ -848,6 +1100,11 @@ RAF_REGISTER_GLOBAL("raf.vm.Load_Executable")
       return Executable::Load(code, lib);
     });
 
+RAF_REGISTER_GLOBAL("raf.vm.Load_ExecutableFromFile")
+    .set_body_typed([](std::string path, tvm::runtime::Module lib) {
+      return Executable::LoadFromFile(path, lib);
+    });
+
 }  // namespace vm
 }  // namespace executor
 }  // namespace raf
@@ -0,0 +1,163 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/impl/vm/host_stream.cc
+ * \brief Host worker threads that execute the multi-stream schedule on CPU.
+ */
+#include <dmlc/logging.h>
+#include <algorithm>
+#include "raf/vm/host_stream.h"
+
+namespace raf {
+namespace executor {
+namespace vm {
+
+void HostEvent::Complete(int64_t generation) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    completed_ = std::max(completed_, generation);
+  }
+  cv_.notify_all();
+}
+
+void HostEvent::Wait(int64_t generation) {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [&]() { return completed_ >= generation; });
+}
+
+HostStream::HostStream() : thread_([this]() { Loop(); }) {
+}
+
+HostStream::~HostStream() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  task_cv_.notify_one();
+  thread_.join();
+}
+
+void HostStream::Enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    tasks_.push_back(std::move(task));
+    ++num_pending_;
+  }
+  task_cv_.notify_one();
+}
+
+void HostStream::Synchronize() {
+  std::unique_lock<std::mutex> lock(mu_);
+  done_cv_.wait(lock, [&]() { return num_pending_ == 0; });
+}
+
+void HostStream::Loop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      task_cv_.wait(lock, [&]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    // The tasks never throw, because the errors of the ops are caught by the pool.
+    task();
+    // Release the values captured by the task before it is reported as done.
+    task = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      --num_pending_;
+    }
+    done_cv_.notify_all();
+  }
+}
+
+HostStream* HostStreamPool::GetStream(Index stream_id) {
+  CHECK_GE(stream_id, 0) << "Invalid stream id: " << stream_id;
+  if (static_cast<size_t>(stream_id) >= streams_.size()) {
+    streams_.resize(stream_id + 1);
+  }
+  if (streams_[stream_id] == nullptr) {
+    streams_[stream_id] = std::make_unique<HostStream>();
+  }
+  return streams_[stream_id].get();
+}
+
+HostEvent* HostStreamPool::GetEvent(Index event_id) {
+  CHECK_GE(event_id, 0) << "Invalid event id: " << event_id;
+  if (static_cast<size_t>(event_id) >= events_.size()) {
+    events_.resize(event_id + 1);
+  }
+  if (events_[event_id] == nullptr) {
+    events_[event_id] = std::make_unique<HostEvent>();
+  }
+  return events_[event_id].get();
+}
+
+void HostStreamPool::Launch(Index stream_id, std::function<void()> op) {
+  active_ = true;
+  GetStream(stream_id)->Enqueue([this, op]() {
+    {
+      std::lock_guard<std::mutex> lock(error_mu_);
+      if (error_ != nullptr) {
+        return;
+      }
+    }
+    try {
+      op();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mu_);
+      if (error_ == nullptr) {
+        error_ = std::current_exception();
+      }
+    }
+  });
+}
+
+void HostStreamPool::RecordEvent(Index stream_id, Index event_id) {
+  active_ = true;
+  HostEvent* event = GetEvent(event_id);
+  int64_t generation = event->Issue();
+  GetStream(stream_id)->Enqueue([event, generation]() { event->Complete(generation); });
+}
+
+void HostStreamPool::WaitEvent(Index stream_id, Index event_id) {
+  active_ = true;
+  HostEvent* event = GetEvent(event_id);
+  int64_t generation = event->Latest();
+  if (generation == 0) {
+    // The event has never been recorded, so there is nothing to wait for.
+    return;
+  }
+  GetStream(stream_id)->Enqueue([event, generation]() { event->Wait(generation); });
+}
+
+void HostStreamPool::Synchronize() {
+  if (!active_) {
+    return;
+  }
+  for (auto& stream : streams_) {
+    if (stream != nullptr) {
+      stream->Synchronize();
+    }
+  }
+  active_ = false;
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(error_mu_);
+    std::swap(error, error_);
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace vm
+}  // namespace executor
+}  // namespace raf
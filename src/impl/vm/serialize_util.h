@@ -24,6 +24,12 @@ namespace vm {
 
 /*! \brief The magic number for the serialized VM bytecode file  */
 constexpr uint64_t kMetaVMBytecodeMagic = 0xD225DE2F4214151D;
+/*! \brief The magic number for the optional AOT section after the code section */
+constexpr uint64_t kMetaVMAOTSectionMagic = 0x5AC71B0E3F2A9D41;
+/*! \brief The magic number at the end of the file whose constants are saved as blobs */
+constexpr uint64_t kMetaVMConstantBlobMagic = 0x3C0B1A5E7D94E6B3;
+/*! \brief The alignment of the blob region and of the large blobs in it */
+constexpr uint64_t kConstantBlobPageSize = 4096;
 
 template <typename T>
 static inline size_t VectorHash(size_t key, const std::vector<T>& values) {
@@ -43,15 +49,22 @@ struct VMFunctionSerializer {
   size_t num_instructions;
   /*! \brief The parameters of the VMFunction. */
   std::vector<std::string> params;
+  /*! \brief The size of the static arena of the VMFunction. */
+  Index arena_size = 0;
+  /*! \brief The alignment of the static arena of the VMFunction. */
+  Index arena_alignment = 0;
 
   VMFunctionSerializer() = default;
 
   VMFunctionSerializer(const std::string& name, Index register_file_size, size_t num_instructions,
-                       const std::vector<std::string>& params)
+                       const std::vector<std::string>& params, Index arena_size = 0,
+                       Index arena_alignment = 0)
       : name(name),
         register_file_size(register_file_size),
         num_instructions(num_instructions),
-        params(params) {
+        params(params),
+        arena_size(arena_size),
+        arena_alignment(arena_alignment) {
   }
 
   /*!
@@ -62,12 +75,17 @@ struct VMFunctionSerializer {
   bool Load(dmlc::Stream* strm) {
     std::vector<std::string> func_info;
     if (!strm->Read(&func_info)) return false;
-    CHECK_EQ(func_info.size(), 3U) << "Failed to decode the vm function."
-                                   << "\n";
+    // The static arena info is optional for the executables saved without it.
+    CHECK(func_info.size() == 3U || func_info.size() == 5U) << "Failed to decode the vm function."
+                                                            << "\n";
     name = func_info[0];
     register_file_size = std::stoll(func_info[1]);
     // Get the number of instructions.
     num_instructions = static_cast<size_t>(std::stoll(func_info[2]));
+    if (func_info.size() == 5U) {
+      arena_size = std::stoll(func_info[3]);
+      arena_alignment = std::stoll(func_info[4]);
+    }
     return strm->Read(&params);
   }
 
@@ -80,6 +98,8 @@ struct VMFunctionSerializer {
     func_info.push_back(name);
     func_info.push_back(std::to_string(register_file_size));
     func_info.push_back(std::to_string(num_instructions));
+    func_info.push_back(std::to_string(arena_size));
+    func_info.push_back(std::to_string(arena_alignment));
     strm->Write(func_info);
     strm->Write(params);
   }
@@ -8,17 +8,23 @@
  * \brief The RAF virtual machine.
  */
 
+#include <dmlc/common.h>
 #include <dmlc/memory_io.h>
 #include <tvm/runtime/memory.h>
 #include <tvm/runtime/object.h>
 #include <tvm/runtime/device_api.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "raf/communicator.h"
@@ -139,6 +145,139 @@ void TensorRepr(std::ostringstream& os, const TensorValueObj* tensor) {
   }
   os << ">";
 }
+
+/*! \brief Markers that delimit the fields of an OpEnv signature. */
+constexpr int64_t kSigSkip = -1;
+constexpr int64_t kSigTensor = -2;
+constexpr int64_t kSigTuple = -3;
+constexpr int64_t kSigOutput = -4;
+
+inline void TensorSignature(std::vector<int64_t>* sig, const TensorValueObj* tensor) {
+  const DLTensor* t = tensor->tensor.operator->();
+  sig->push_back(kSigTensor);
+  sig->push_back((static_cast<int64_t>(t->dtype.code) << 24) |
+                 (static_cast<int64_t>(t->dtype.bits) << 16) | t->dtype.lanes);
+  sig->push_back(t->ndim);
+  sig->insert(sig->end(), t->shape, t->shape + t->ndim);
+}
+
+inline size_t HashSignature(const std::vector<int64_t>& sig) {
+  size_t hash = sig.size();
+  for (int64_t v : sig) {
+    hash = dmlc::HashCombine(hash, v);
+  }
+  return hash;
+}
+
+/*!
+ * \brief Bind an input value to the device. Tensors that already reside on the device, and
+ * tuples of them, are bound without a copy.
+ */
+inline Value BindInput(const Value& value, const Device& dev) {
+  if (const auto* tv = value.as<TensorValueObj>()) {
+    const auto& device = tv->tensor->device;
+    if (device.device_type == dev.device_type() && device.device_id == dev.device_id()) {
+      return value;
+    }
+    return TensorValue::make(tensor::Tensor(tv->tensor.CopyTo(dev)));
+  }
+  if (const auto* tuple = value.as<TupleValueObj>()) {
+    Array<Value> fields;
+    bool changed = false;
+    for (const auto& field : tuple->fields) {
+      fields.push_back(BindInput(field, dev));
+      changed |= !fields.back().same_as(field);
+    }
+    return changed ? TupleValue::make(fields) : value;
+  }
+  return value;
+}
+
+/*! \brief A chunk of memory in a static arena. It keeps the arena alive but never frees. */
+class ArenaMemory final : public Memory {
+ public:
+  ArenaMemory(std::shared_ptr<Memory> arena, int64_t offset) : arena_(std::move(arena)) {
+    this->data = static_cast<char*>(arena_->data) + offset;
+    this->device = arena_->device;
+  }
+
+ private:
+  /*! \brief The arena that this chunk belongs to. */
+  std::shared_ptr<Memory> arena_;
+};
+
+/*!
+ * \brief The dense index of the handler of each opcode in the dispatch loop. The opcodes are
+ * sparse, so they are decoded into this index once at load time.
+ */
+enum DispatchOp : uint8_t {
+  kMove,
+  kRet,
+  kFatal,
+  kLoadConst,
+  kLoadConsti,
+  kGetField,
+  kIf,
+  kGoto,
+  kAllocStorage,
+  kAllocTensor,
+  kAllocTensorReg,
+  kAllocTuple,
+  kAllocClosure,
+  kSetShape,
+  kFree,
+  kInvokeFunc,
+  kInvokeClosure,
+  kInvokePacked,
+  kInvokeJit,
+  kInferType,
+  kCudaSetStream,
+  kCudaAddEvent,
+  kCudaWaitEvent,
+  kCudaStreamBarrier,
+  kNumDispatchOps,
+};
+
+inline DispatchOp DecodeOpcode(Opcode op) {
+  switch (op) {
+#define RAF_VM_DECODE_OPCODE(OP) \
+  case Opcode::OP:               \
+    return k##OP;
+    RAF_VM_DECODE_OPCODE(Move)
+    RAF_VM_DECODE_OPCODE(Ret)
+    RAF_VM_DECODE_OPCODE(Fatal)
+    RAF_VM_DECODE_OPCODE(LoadConst)
+    RAF_VM_DECODE_OPCODE(LoadConsti)
+    RAF_VM_DECODE_OPCODE(GetField)
+    RAF_VM_DECODE_OPCODE(If)
+    RAF_VM_DECODE_OPCODE(Goto)
+    RAF_VM_DECODE_OPCODE(AllocStorage)
+    RAF_VM_DECODE_OPCODE(AllocTensor)
+    RAF_VM_DECODE_OPCODE(AllocTensorReg)
+    RAF_VM_DECODE_OPCODE(AllocTuple)
+    RAF_VM_DECODE_OPCODE(AllocClosure)
+    RAF_VM_DECODE_OPCODE(SetShape)
+    RAF_VM_DECODE_OPCODE(Free)
+    RAF_VM_DECODE_OPCODE(InvokeFunc)
+    RAF_VM_DECODE_OPCODE(InvokeClosure)
+    RAF_VM_DECODE_OPCODE(InvokePacked)
+    RAF_VM_DECODE_OPCODE(InvokeJit)
+    RAF_VM_DECODE_OPCODE(InferType)
+    RAF_VM_DECODE_OPCODE(CudaSetStream)
+    RAF_VM_DECODE_OPCODE(CudaAddEvent)
+    RAF_VM_DECODE_OPCODE(CudaWaitEvent)
+    RAF_VM_DECODE_OPCODE(CudaStreamBarrier)
+#undef RAF_VM_DECODE_OPCODE
+  }
+  LOG(FATAL) << "Unknown opcode " << static_cast<int>(op);
+  return kFatal;
+}
+
+/*!
+ * \brief Thrown when the warmup walk reaches an instruction that depends on the data of a tensor,
+ * which is not computed by the walk. The ops after it are compiled on demand.
+ */
+struct WarmupStop {};
 }  // namespace utils
 
 RAF_REGISTER_OBJECT_REFLECT(VMContextObj);
@@ -202,32 +341,79 @@ inline bool VMContext::IsConst(Index reg) const {
   return self->frames.back().is_const[reg];
 }
 
-inline void VMContext::PushFrame(Index func_index, const std::vector<Value>& args,
-                                 RegName ret_reg) {
+inline VMFrame& VMContext::PushEmptyFrame(Index func_index, Index num_args, RegName ret_reg) {
   auto self = this->operator->();
   const auto& func = self->exec->functions[func_index];
-  CHECK_EQ(func.params.size(), args.size())
-      << "Number of arguments mismatches: " << func.params.size() << " vs " << args.size();
+  CHECK_EQ(func.params.size(), static_cast<size_t>(num_args))
+      << "Number of arguments mismatches: " << func.params.size() << " vs " << num_args;
   auto ret_pc = self->pc + 1;
-  auto frame = VMFrame(self->func_index, ret_pc, ret_reg, args.size(), func.register_file_size);
-  self->frames.push_back(frame);
-  for (size_t i = 0; i < args.size(); ++i) {
-    WriteRegister(i, args[i]);
+  if (self->free_frames.empty()) {
+    self->frames.emplace_back(self->func_index, ret_pc, ret_reg, num_args,
+                              func.register_file_size);
+  } else {
+    self->frames.push_back(std::move(self->free_frames.back()));
+    self->free_frames.pop_back();
+    self->frames.back().Reset(self->func_index, ret_pc, ret_reg, num_args,
+                              func.register_file_size);
   }
   self->func_index = func_index;
   self->code = func.instructions.data();
   self->pc = 0;
+  return self->frames.back();
+}
+
+inline void VMContext::PushFrame(Index func_index, const std::vector<Value>& args,
+                                 RegName ret_reg) {
+  VMFrame& frame = PushEmptyFrame(func_index, args.size(), ret_reg);
+  std::copy(args.begin(), args.end(), frame.register_file.begin());
+}
+
+inline void VMContext::PushFrame(Index func_index, const RegName* arg_regs, Index num_args,
+                                 RegName ret_reg) {
+  auto self = this->operator->();
+  VMFrame& frame = PushEmptyFrame(func_index, num_args, ret_reg);
+  // The caller frame is right below the new one. It is indexed after the push, since the push
+  // may reallocate the frames.
+  const VMFrame& caller = self->frames[self->frames.size() - 2];
+  for (Index i = 0; i < num_args; ++i) {
+    frame.register_file[i] = caller.register_file[arg_regs[i]];
+  }
 }
 
 inline Index VMContext::PopFrame() {
   auto self = this->operator->();
   CHECK_GT(self->frames.size(), 0);
-  const VMFrame& fr = self->frames.back();
+  VMFrame& fr = self->frames.back();
   self->func_index = fr.caller_func_index;
   self->pc = fr.caller_return_pc;
   self->code = self->exec->functions[self->func_index].instructions.data();
+  RegName caller_return_register = fr.caller_return_register;
+  fr.Release();
+  self->free_frames.push_back(std::move(fr));
   self->frames.pop_back();
-  return fr.caller_return_register;
+  return caller_return_register;
+}
+
+const OpEnvCacheEntry* VMFuncOpEnvCache::SetLastEntry(Index pc, size_t hash,
+                                                      const std::vector<int64_t>& signature,
+                                                      OpEnvPtr op_env, std::string key) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto& entry = entries_[pc][key];
+  if (entry == nullptr || entry->hash != hash || entry->signature != signature ||
+      entry->op_env != op_env) {
+    if (entry != nullptr) {
+      retired_entries_.push_back(std::move(entry));
+    }
+    entry = std::make_unique<OpEnvCacheEntry>();
+    entry->hash = hash;
+    entry->signature = signature;
+    entry->op_env = std::move(op_env);
+    entry->key = std::move(key);
+  }
+  if (pc < num_instructions_) {
+    last_entries_[pc].store(entry.get(), std::memory_order_release);
+  }
+  return entry.get();
 }
 
 std::shared_ptr<OpEnvCache> VMFuncOpEnvCache::Get(Index pc) {
@@ -236,14 +422,87 @@ std::shared_ptr<OpEnvCache> VMFuncOpEnvCache::Get(Index pc) {
   if (it != cache_map_.end()) {
     return it->second;
   }
-  auto cache = std::make_shared<OpEnvCache>();
+  // The cache of one instruction is small and rarely contended, so it needs no sharding.
+  auto cache = std::make_shared<OpEnvCache>(0, 1);
   cache_map_.emplace(pc, cache);
   return cache;
 }
 
+std::vector<std::pair<Index, std::shared_ptr<OpEnvCache>>> VMFuncOpEnvCache::GetAll() {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<std::pair<Index, std::shared_ptr<OpEnvCache>>> ret(cache_map_.begin(),
+                                                                 cache_map_.end());
+  std::sort(ret.begin(), ret.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  return ret;
+}
+
 void VMFuncOpEnvCache::Clear() {
   std::lock_guard<std::mutex> lock(mu_);
   cache_map_.clear();
+  for (size_t i = 0; i < num_instructions_; ++i) {
+    last_entries_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  entries_.clear();
+  retired_entries_.clear();
+}
+
+/*! \brief The shared constant pools in use, indexed by the executable and the device. */
+static std::mutex shared_const_pools_mu;
+static std::map<std::pair<const Executable*, std::string>, std::weak_ptr<SharedConstantPool>>
+    shared_const_pools;
+
+std::shared_ptr<SharedConstantPool> SharedConstantPool::Get(const Executable* exec,
+                                                            const Device& device) {
+  std::lock_guard<std::mutex> lock(shared_const_pools_mu);
+  auto& weak_pool = shared_const_pools[std::make_pair(exec, std::string(device.c_str()))];
+  auto pool = weak_pool.lock();
+  if (pool == nullptr) {
+    pool = std::shared_ptr<SharedConstantPool>(new SharedConstantPool(device));
+    weak_pool = pool;
+  }
+  // Drop the pools that are no longer used by any VM.
+  for (auto it = shared_const_pools.begin(); it != shared_const_pools.end();) {
+    it = it->second.expired() ? shared_const_pools.erase(it) : std::next(it);
+  }
+  return pool;
+}
+
+PackedMetricMap SharedConstantPool::GetStats() {
+  int64_t num_pools = 0, num_constants = 0, nbytes = 0;
+  std::lock_guard<std::mutex> lock(shared_const_pools_mu);
+  for (const auto& it : shared_const_pools) {
+    auto pool = it.second.lock();
+    if (pool == nullptr) {
+      continue;
+    }
+    num_pools++;
+    std::lock_guard<std::mutex> pool_lock(pool->mu_);
+    for (const auto& value : pool->values_) {
+      if (const auto* tensor = value.as<TensorValueObj>()) {
+        num_constants++;
+        nbytes += common::shape_utils::BytesCompactTensor(*tensor->tensor.operator->());
+      } else if (value.defined()) {
+        num_constants++;
+      }
+    }
+  }
+  PackedMetricMap stats;
+  stats.Set("num_pools", num_pools);
+  stats.Set("num_constants", num_constants);
+  stats.Set("nbytes", nbytes);
+  return stats;
+}
+
+Value SharedConstantPool::Load(const Executable* exec, Index const_index) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (values_.size() <= static_cast<size_t>(const_index)) {
+    values_.resize(const_index + 1);
+  }
+  if (!values_[const_index].defined()) {
+    values_[const_index] = CopyTo(exec->constants[const_index], device_);
+  }
+  return values_[const_index];
 }
 
 #ifdef RAF_USE_CUDA
@@ -312,6 +571,14 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       int repeat = args[3];
       *rv = Profile(ctx, warmup, number, repeat);
     });
+  } else if (name == "warmup") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      CHECK(exec_) << "The executable is not loaded yet.";
+      VMContext ctx = args[0];
+      int num_threads = args[1];
+      PackedFunc progress = args[2];
+      *rv = Warmup(ctx, num_threads, progress);
+    });
   } else if (name == "set_devices") {
     return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
       std::vector<Device> devices;
@@ -321,6 +588,20 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       }
       this->SetDevices(devices);
     });
+  } else if (name == "share_constants") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      this->SetShareConstants(args[0]);
+    });
+  } else if (name == "bind_inputs") {
+    return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
+      CHECK(exec_) << "The executable is not loaded yet.";
+      VMContext ctx = args[0];
+      std::vector<Value> inputs(args.size() - 1);
+      for (size_t i = 1; i < args.size(); ++i) {
+        inputs[i - 1] = args[i];
+      }
+      BindInputs(ctx, inputs);
+    });
   } else if (name == "prepare_context") {
     return PackedFunc([sptr_to_self, this](registry::TVMArgs args, registry::TVMRetValue* rv) {
       CHECK(exec_) << "The executable is not loaded yet.";
@@ -341,7 +622,25 @@ void VirtualMachine::LoadExecutable(const Executable* exec) {
   CHECK(exec) << "The executable is not created yet.";
   exec_ = exec;
   for (int i = 0; i < exec_->functions.size(); ++i) {
-    op_env_cache_.push_back(std::make_shared<VMFuncOpEnvCache>());
+    op_env_cache_.push_back(
+        std::make_shared<VMFuncOpEnvCache>(exec_->functions[i].instructions.size()));
+  }
+  dispatch_ops_.clear();
+  dispatch_ops_.reserve(exec_->functions.size());
+  for (const auto& func : exec_->functions) {
+    std::vector<uint8_t> ops;
+    ops.reserve(func.instructions.size());
+    for (const auto& instr : func.instructions) {
+      ops.push_back(utils::DecodeOpcode(instr.op));
+    }
+    dispatch_ops_.push_back(std::move(ops));
+  }
+  aot_dispatch_.clear();
+  aot_dispatch_.resize(exec_->functions.size());
+  for (const auto& record : exec_->aot_dispatch) {
+    if (record.func_index >= 0 && record.func_index < aot_dispatch_.size()) {
+      aot_dispatch_[record.func_index][record.pc][record.key] = record.op_name;
+    }
   }
 
   tvm::runtime::Module lib = exec_->lib;
@@ -377,7 +676,7 @@ VMContext VirtualMachine::PrepareVMContext(const std::string& func_name,
     // TODO(@zhiics, @icemelon9): For heterogeneous execution, get input device information
     Device dev = devices_[0];
     for (size_t i = 0; i < inputs.size(); ++i) {
-      ctx->inputs[i] = CopyTo(inputs[i], dev);
+      ctx->inputs[i] = utils::BindInput(inputs[i], dev);
     }
     return ctx;
   };
@@ -392,17 +691,7 @@ VMContext VirtualMachine::PrepareVMContext(const std::string& func_name,
       cuda_graph_impl_ = nullptr;
       cuda_graph_ctx_ = fcreate_ctx();
     } else {
-      for (int i = 0; i < inputs.size(); i++) {
-        Value new_arg = inputs[i];
-        Value graph_arg = cuda_graph_ctx_->inputs[i];
-        if (new_arg.as<TensorValueObj>()) {
-          CHECK(graph_arg.as<TensorValueObj>()) << "Value type mismatch, cannot copy";
-          Downcast<TensorValue>(new_arg)->tensor.CopyTo(Downcast<TensorValue>(graph_arg)->tensor);
-        } else {
-          LOG(FATAL) << "Unsupported Value Type for reusing CUDA Graph";
-        }
-      }
-      DLOG(INFO) << "Updated the inputs to the cached CUDA Graph.";
+      CopyToCudaGraphInputs(inputs);
     }
     cuda_graph_occupied_ = true;
     return cuda_graph_ctx_;
@@ -412,6 +701,60 @@ VMContext VirtualMachine::PrepareVMContext(const std::string& func_name,
   return ctx;
 }
 
+void VirtualMachine::BindInputs(VMContext ctx, const std::vector<Value>& inputs) {
+  const auto& vm_func = exec_->functions[ctx->entry_func_index];
+  CHECK_EQ(inputs.size(), vm_func.params.size())
+      << "The number of inputs doesn't match the number of parameters for function "
+      << vm_func.name;
+#ifdef RAF_USE_CUDA
+  if (enable_cuda_graph_) {
+    std::lock_guard<std::mutex> lock(cuda_graph_mutex_);
+    CHECK(ctx.get() == cuda_graph_ctx_.get()) << "Wrong VMContext provided for CUDA graph.";
+    CHECK(!cuda_graph_occupied_) << "VM in CUDA graph mode doesn't support concurrent execution";
+    // The captured graph reads the inputs from fixed addresses, so they have to be copied.
+    CopyToCudaGraphInputs(inputs);
+    cuda_graph_occupied_ = true;
+    return;
+  }
+#endif
+  Device dev = devices_[0];
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    ctx->inputs[i] = utils::BindInput(inputs[i], dev);
+  }
+}
+
+#ifdef RAF_USE_CUDA
+void VirtualMachine::CopyToCudaGraphInputs(const std::vector<Value>& inputs) {
+  for (int i = 0; i < inputs.size(); i++) {
+    Value new_arg = inputs[i];
+    Value graph_arg = cuda_graph_ctx_->inputs[i];
+    if (new_arg.as<TensorValueObj>()) {
+      CHECK(graph_arg.as<TensorValueObj>()) << "Value type mismatch, cannot copy";
+      Downcast<TensorValue>(new_arg)->tensor.CopyTo(Downcast<TensorValue>(graph_arg)->tensor);
+    } else {
+      LOG(FATAL) << "Unsupported Value Type for reusing CUDA Graph";
+    }
+  }
+  DLOG(INFO) << "Updated the inputs to the cached CUDA Graph.";
+}
+#endif
+
+std::vector<AOTDispatchRecord> VirtualMachine::GetDispatchRecords() const {
+  std::vector<AOTDispatchRecord> records;
+  for (size_t i = 0; i < op_env_cache_.size(); ++i) {
+    for (const auto& it : op_env_cache_[i]->GetAll()) {
+      for (const auto& entry : it.second->Entries()) {
+        const auto& op_env = *entry.second;
+        if (op_env && !op_env->dispatched_op.empty()) {
+          records.push_back({static_cast<Index>(i), it.first, entry.first, op_env->dispatched_op,
+                             op_env->cache_keys});
+        }
+      }
+    }
+  }
+  return records;
+}
+
 Value VirtualMachine::Run(VMContext ctx) {
   auto frun = [&]() {
     // ctx->pc will be reset to 0 in the PushFrame
@@ -430,19 +773,28 @@ Value VirtualMachine::Run(VMContext ctx) {
       DLOG(INFO) << "CUDA graph captured.";
     }
     cuda_graph_impl_->Invoke();
-    std::lock_guard<std::mutex> lock(cuda_graph_mutex_);
-    cuda_graph_occupied_ = false;
+    FinishRun(ctx);
     // TODO(@icemelon9, @zhiics): May need to copy the return register to the host device to
     // avoid data race
     return ctx->return_register;
   }
 #endif
   frun();
-  if (ctx->current_stream_id != 0) {
+  FinishRun(ctx);
+  return ctx->return_register;
+}
+
+void VirtualMachine::FinishRun(const VMContext& ctx) {
+#ifdef RAF_USE_CUDA
+  if (enable_cuda_graph_) {
+    std::lock_guard<std::mutex> lock(cuda_graph_mutex_);
+    cuda_graph_occupied_ = false;
+  }
+#endif
+  if (use_cuda_ && ctx->current_stream_id != 0) {
     // reset the working stream to default stream.
     OpEnv::SetStreamForAllBackends(devices_[0], nullptr);
   }
-  return ctx->return_register;
 }
 
 Array<FloatValue> VirtualMachine::Profile(VMContext ctx, int warmup, int number, int repeat) {
@@ -494,6 +846,17 @@ void VirtualMachine::SetDevices(const std::vector<Device>& devices) {
   if (!use_cuda_) {
     enable_cuda_graph_ = false;
   }
+  SetShareConstants(share_constants_);
+}
+
+void VirtualMachine::SetShareConstants(bool share_constants) {
+  share_constants_ = share_constants;
+  // The constants are loaded again from the pool of the executable and the devices.
+  const_pool_.clear();
+  shared_const_pool_ = nullptr;
+  if (share_constants_ && exec_ != nullptr && !devices_.empty()) {
+    shared_const_pool_ = SharedConstantPool::Get(exec_, devices_[0]);
+  }
 }
 
 inline std::shared_ptr<Memory> VirtualMachine::Alloc(const VMContext& ctx, Device dev,
@@ -516,6 +879,21 @@ inline std::shared_ptr<Memory> VirtualMachine::Alloc(const VMContext& ctx, Devic
   }
 }
 
+std::shared_ptr<Memory> VirtualMachine::AllocFromArena(const VMContext& ctx, Device dev,
+                                                       int64_t offset) const {
+  auto& arenas = ctx->arenas;
+  if (arenas.size() <= static_cast<size_t>(ctx->func_index)) {
+    arenas.resize(ctx->func_index + 1);
+  }
+  auto& arena = arenas[ctx->func_index];
+  if (arena == nullptr) {
+    const auto& func = exec_->functions[ctx->func_index];
+    CHECK_GT(func.arena_size, 0) << "Function " << func.name << " has no static arena";
+    arena = memory_pool::Memory::Alloc(dev, func.arena_size, func.arena_alignment);
+  }
+  return std::make_shared<utils::ArenaMemory>(arena, offset);
+}
+
 void VirtualMachine::RunLoop(VMContext& ctx) {
   CHECK(this->exec_);
   CHECK_GT(ctx->frames.size(), 0) << "The call stack is empty";
@@ -528,133 +906,172 @@ void VirtualMachine::RunLoop(VMContext& ctx) {
   ctx->current_device_id = 0;
   ctx->current_stream_id = 0;
   ctx->current_barrier_event_index = 0;
-  while (true) {
-  main_loop:
-    auto const& instr = ctx->code[ctx->pc];
-    switch (instr.op) {
-      case Opcode::Move: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "Move", "VMInstruction", {},
-                                 { HandleMove(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::Fatal: {
-        throw std::runtime_error("VM encountered fatal error");
-      }
-      case Opcode::LoadConst: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "LoadConst", "VMInstruction", {},
-                                 { HandleLoadConst(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::LoadConsti: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "LoadConsti", "VMInstruction", {},
-                                 { HandleLoadConsti(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::GetField: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "GetField", "VMInstruction", {},
-                                 { HandleGetField(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::Goto: {
-        ctx->pc += instr.pc_offset;
-        goto main_loop;
-      }
-      case Opcode::If: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "If", "VMInstruction", {},
-                                 { HandleIf(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::AllocStorage: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "AllocStorage", "VMInstruction", {},
-                                 { HandleAllocStorage(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::AllocTensor: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "AllocTensor", "VMInstruction", {},
-                                 { HandleAllocTensor(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::AllocTensorReg: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "AllocTensorReg", "VMInstruction", {},
-                                 { HandleAllocTensorReg(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::AllocTuple: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "AllocTuple", "VMInstruction", {},
-                                 { HandleAllocTuple(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::AllocClosure: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "AllocClosure", "VMInstruction", {},
-                                 { HandleAllocClosure(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::Free: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "Free", "VMInstruction", {},
-                                 { HandleFree(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::SetShape: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "SetShape", "VMInstruction", {},
-                                 { HandleSetShape(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::InvokeFunc: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "InvokeFunc", "VMInstruction", {},
-                                 { HandleInvokeFunc(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::InvokePacked: {
-        LOG(FATAL) << "Not supported.";
-      }
-      case Opcode::InvokeClosure: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "InvokeClosure", "VMInstruction", {},
-                                 { HandleInvokeClosure(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::InvokeJit: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "InvokeJit", "VMInstruction", {},
-                                 { HandleInvokeJit(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::InferType: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "InferType", "VMInstruction", {},
-                                 { HandleInferType(ctx, instr); });
-        goto main_loop;
-      }
-      case Opcode::Ret: {
-        bool final_ret;
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "Ret", "VMInstruction", {},
-                                 { final_ret = HandleRet(ctx, instr); });
-        if (final_ret) {
-          return;
-        }
-        goto main_loop;
-      }
-      case Opcode::CudaSetStream: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "CudaSetStream", "VMInstruction", {},
-                                 HandleCudaSetStream(ctx, instr););
-        goto main_loop;
-      }
-      case Opcode::CudaAddEvent: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "CudaAddEvent", "VMInstruction", {},
-                                 HandleCudaAddEvent(ctx, instr););
-        goto main_loop;
-      }
-      case Opcode::CudaWaitEvent: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "CudaWaitEvent", "VMInstruction", {},
-                                 HandleCudaWaitEvent(ctx, instr););
-        goto main_loop;
-      }
-      case Opcode::CudaStreamBarrier: {
-        WITH_BASE_PROFILER_LEVEL(2, host_device_, "CudaStreamBarrier", "VMInstruction", {},
-                                 HandleCudaStreamBarrier(ctx, instr););
-        goto main_loop;
+  ctx->use_host_streams = false;
+  if (profiler::Profiler::Get()->IsProfiling(2)) {
+    RunDispatchLoop<true>(ctx);
+  } else {
+    RunDispatchLoop<false>(ctx);
+  }
+}
+
+// Dispatch with computed goto where the compiler supports labels as values: each handler jumps
+// to the next one through its own indirect branch, which is easier for the branch predictor
+// than the single indirect branch of a switch. Otherwise fall back to the switch.
+#if defined(__GNUC__) && !defined(RAF_VM_DISABLE_COMPUTED_GOTO)
+#define RAF_VM_COMPUTED_GOTO 1
+#endif
+
+#ifdef RAF_VM_COMPUTED_GOTO
+#define VM_TARGET(OP) \
+  case utils::k##OP:  \
+  label_##OP
+#define VM_DISPATCH() goto* dispatch_table[ops[self->pc]]
+#else
+#define VM_TARGET(OP) case utils::k##OP
+#define VM_DISPATCH() goto dispatch
+#endif
+
+#define VM_HANDLE(NAME, CODE_SNIPPET)                                                       \
+  if (kProfiling) {                                                                         \
+    WITH_BASE_PROFILER_LEVEL(2, host_device_, NAME, "VMInstruction", {}, CODE_SNIPPET);     \
+  } else {                                                                                  \
+    CODE_SNIPPET                                                                            \
+  }
+
+template <bool kProfiling>
+void VirtualMachine::RunDispatchLoop(VMContext& ctx) {
+#ifdef RAF_VM_COMPUTED_GOTO
+  // The order must match utils::DispatchOp.
+  static const void* const dispatch_table[] = {
+      &&label_Move, &&label_Ret, &&label_Fatal, &&label_LoadConst, &&label_LoadConsti,
+      &&label_GetField, &&label_If, &&label_Goto, &&label_AllocStorage, &&label_AllocTensor,
+      &&label_AllocTensorReg, &&label_AllocTuple, &&label_AllocClosure, &&label_SetShape,
+      &&label_Free, &&label_InvokeFunc, &&label_InvokeClosure, &&label_InvokePacked,
+      &&label_InvokeJit, &&label_InferType, &&label_CudaSetStream, &&label_CudaAddEvent,
+      &&label_CudaWaitEvent, &&label_CudaStreamBarrier,
+  };
+  static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == utils::kNumDispatchOps,
+                "The dispatch table does not cover all handlers");
+#endif
+  VMContextObj* self = ctx.operator->();
+  // The pre-decoded stream of the current function. It changes only on calls and returns.
+  const uint8_t* ops = dispatch_ops_[self->func_index].data();
+#ifndef RAF_VM_COMPUTED_GOTO
+dispatch:
+#endif
+  switch (static_cast<utils::DispatchOp>(ops[self->pc])) {
+    VM_TARGET(Move) : {
+      VM_HANDLE("Move", { HandleMove(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(Fatal) : {
+      SyncHostStreams(ctx);
+      throw std::runtime_error("VM encountered fatal error");
+    }
+    VM_TARGET(LoadConst) : {
+      VM_HANDLE("LoadConst", { HandleLoadConst(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(LoadConsti) : {
+      VM_HANDLE("LoadConsti", { HandleLoadConsti(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(GetField) : {
+      VM_HANDLE("GetField", { HandleGetField(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(Goto) : {
+      self->pc += self->code[self->pc].pc_offset;
+      VM_DISPATCH();
+    }
+    VM_TARGET(If) : {
+      VM_HANDLE("If", { HandleIf(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(AllocStorage) : {
+      VM_HANDLE("AllocStorage", { HandleAllocStorage(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(AllocTensor) : {
+      VM_HANDLE("AllocTensor", { HandleAllocTensor(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(AllocTensorReg) : {
+      VM_HANDLE("AllocTensorReg", { HandleAllocTensorReg(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(AllocTuple) : {
+      VM_HANDLE("AllocTuple", { HandleAllocTuple(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(AllocClosure) : {
+      VM_HANDLE("AllocClosure", { HandleAllocClosure(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(Free) : {
+      VM_HANDLE("Free", { HandleFree(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(SetShape) : {
+      VM_HANDLE("SetShape", { HandleSetShape(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(InvokeFunc) : {
+      VM_HANDLE("InvokeFunc", { HandleInvokeFunc(ctx, self->code[self->pc]); });
+      ops = dispatch_ops_[self->func_index].data();
+      VM_DISPATCH();
+    }
+    VM_TARGET(InvokePacked) : {
+      LOG(FATAL) << "Not supported.";
+      VM_DISPATCH();
+    }
+    VM_TARGET(InvokeClosure) : {
+      VM_HANDLE("InvokeClosure", { HandleInvokeClosure(ctx, self->code[self->pc]); });
+      ops = dispatch_ops_[self->func_index].data();
+      VM_DISPATCH();
+    }
+    VM_TARGET(InvokeJit) : {
+      VM_HANDLE("InvokeJit", { HandleInvokeJit(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(InferType) : {
+      VM_HANDLE("InferType", { HandleInferType(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(Ret) : {
+      bool final_ret;
+      VM_HANDLE("Ret", { final_ret = HandleRet(ctx, self->code[self->pc]); });
+      if (final_ret) {
+        return;
       }
+      ops = dispatch_ops_[self->func_index].data();
+      VM_DISPATCH();
+    }
+    VM_TARGET(CudaSetStream) : {
+      VM_HANDLE("CudaSetStream", { HandleCudaSetStream(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
     }
+    VM_TARGET(CudaAddEvent) : {
+      VM_HANDLE("CudaAddEvent", { HandleCudaAddEvent(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(CudaWaitEvent) : {
+      VM_HANDLE("CudaWaitEvent", { HandleCudaWaitEvent(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    VM_TARGET(CudaStreamBarrier) : {
+      VM_HANDLE("CudaStreamBarrier", { HandleCudaStreamBarrier(ctx, self->code[self->pc]); });
+      VM_DISPATCH();
+    }
+    default:
+      LOG(FATAL) << "Unknown dispatch op " << static_cast<int>(ops[self->pc]);
   }
 }
 
+#undef VM_HANDLE
+#undef VM_DISPATCH
+#undef VM_TARGET
+
 void VirtualMachine::HandleMove(VMContext& ctx, const Instruction& instr) {
   Value from_obj = ctx.ReadRegister(instr.from);
   ctx.WriteRegister(instr.dst, from_obj);
@@ -671,8 +1088,12 @@ void VirtualMachine::HandleLoadConst(VMContext& ctx, const Instruction& instr) {
   }
 
   if (!const_pool_[instr.const_index].defined()) {
-    // TODO(@zhiics): device could be obtained from the device list.
-    const_pool_[instr.const_index] = CopyTo(constant_obj, devices_[0]);
+    if (shared_const_pool_ != nullptr) {
+      const_pool_[instr.const_index] = shared_const_pool_->Load(exec_, instr.const_index);
+    } else {
+      // TODO(@zhiics): device could be obtained from the device list.
+      const_pool_[instr.const_index] = CopyTo(constant_obj, devices_[0]);
+    }
   }
   ctx.WriteRegister(instr.dst, const_pool_[instr.const_index]);
   ctx->frames.back().is_const[instr.dst] = true;
@@ -693,6 +1114,10 @@ void VirtualMachine::HandleGetField(VMContext& ctx, const Instruction& instr) {
 }
 
 void VirtualMachine::HandleIf(VMContext& ctx, const Instruction& instr) {
+  if (ctx->jit_sites != nullptr) {
+    throw utils::WarmupStop();
+  }
+  SyncHostStreams(ctx);
   int32_t test_val = ctx.LoadTensorInt(instr.if_op.test);
   int32_t target_val = ctx.LoadScalarInt(instr.if_op.target);
 
@@ -715,17 +1140,25 @@ void VirtualMachine::HandleAllocStorage(VMContext& ctx, const Instruction& instr
              << " alloc_async=" << alloc_async;
 
   auto dev = Device(instr.alloc_storage.device_type, instr.alloc_storage.device_id);
-  auto buffer = Alloc(ctx, dev, size, alignment, alloc_async);
+  // The op that owns the storage is known when it is invoked, see PrepareOpEnv.
+  const char* kind = instr.alloc_storage.arena_offset >= 0 ? "arena" : "storage";
+  memory_profiler::AllocSiteScope alloc_site(&exec_->functions[ctx->func_index].name, ctx->pc,
+                                             nullptr, kind);
+  std::shared_ptr<Memory> buffer;
+  if (instr.alloc_storage.arena_offset >= 0) {
+    // The offset is planned by the compiler, so no allocation is needed.
+    buffer = AllocFromArena(ctx, dev, instr.alloc_storage.arena_offset);
+  } else {
+    buffer = Alloc(ctx, dev, size, alignment, alloc_async);
+  }
   auto storage = StorageValue::make(buffer);
   ctx.WriteRegister(instr.dst, storage);
   ctx->pc++;
 }
 
 void VirtualMachine::HandleAllocTensor(VMContext& ctx, const Instruction& instr) {
-  auto shape = std::vector<int64_t>(instr.alloc_tensor.ndim);
-  for (uint32_t i = 0; i < instr.alloc_tensor.ndim; ++i) {
-    shape[i] = instr.alloc_tensor.shape[i];
-  }
+  std::vector<int64_t> shape(instr.alloc_tensor.shape,
+                             instr.alloc_tensor.shape + instr.alloc_tensor.ndim);
 
   auto storage_obj = ctx.ReadRegister(instr.alloc_tensor.storage);
   auto storage = Downcast<StorageValue>(storage_obj);
@@ -733,8 +1166,9 @@ void VirtualMachine::HandleAllocTensor(VMContext& ctx, const Instruction& instr)
   if (instr.alloc_tensor.own) {
     mem = storage->buffer;
   }
+  void* data = static_cast<char*>(storage->buffer->data) + instr.alloc_tensor.offset;
   auto tensor = TensorValue::Assemble(storage->buffer->device, instr.alloc_tensor.dtype, shape, {},
-                                      storage->buffer->data, mem);
+                                      data, mem);
   ctx.WriteRegister(instr.dst, tensor);
   ctx->pc++;
 }
@@ -753,14 +1187,16 @@ void VirtualMachine::HandleAllocTensorReg(VMContext& ctx, const Instruction& ins
   if (instr.alloc_tensor_reg.own) {
     mem = storage->buffer;
   }
+  void* data = static_cast<char*>(storage->buffer->data) + instr.alloc_tensor_reg.offset;
   auto tensor = TensorValue::Assemble(storage->buffer->device, instr.alloc_tensor_reg.dtype, shape,
-                                      {}, storage->buffer->data, mem);
+                                      {}, data, mem);
   ctx.WriteRegister(instr.dst, tensor);
   ctx->pc++;
 }
 
 void VirtualMachine::HandleAllocTuple(VMContext& ctx, const Instruction& instr) {
   Array<Value> fields;
+  fields.reserve(instr.alloc_tuple.num_fields);
   for (Index i = 0; i < instr.alloc_tuple.num_fields; ++i) {
     fields.push_back(ctx.ReadRegister(instr.alloc_tuple.fields[i]));
   }
@@ -770,10 +1206,11 @@ void VirtualMachine::HandleAllocTuple(VMContext& ctx, const Instruction& instr)
 
 void VirtualMachine::HandleAllocClosure(VMContext& ctx, const Instruction& instr) {
   std::vector<Value> free_vars;
+  free_vars.reserve(instr.alloc_closure.num_free_vars);
   for (Index i = 0; i < instr.alloc_closure.num_free_vars; i++) {
     free_vars.push_back(ctx.ReadRegister(instr.alloc_closure.free_vars[i]));
   }
-  auto clo = VMClosureValue::make(instr.alloc_closure.func_index, free_vars);
+  auto clo = VMClosureValue::make(instr.alloc_closure.func_index, std::move(free_vars));
   ctx.WriteRegister(instr.dst, clo);
   ctx->pc++;
 }
@@ -794,17 +1231,15 @@ void VirtualMachine::HandleFree(VMContext& ctx, const Instruction& instr) {
 }
 
 void VirtualMachine::HandleInvokeFunc(VMContext& ctx, const Instruction& instr) {
-  std::vector<Value> args;
-  for (Index i = 0; i < instr.invoke_func.num_args; ++i) {
-    args.push_back(ctx.ReadRegister(instr.invoke_func.args[i]));
-  }
-  ctx.PushFrame(instr.invoke_func.func_index, args, instr.dst);
+  ctx.PushFrame(instr.invoke_func.func_index, instr.invoke_func.args, instr.invoke_func.num_args,
+                instr.dst);
 }
 
 void VirtualMachine::HandleInvokeClosure(VMContext& ctx, const Instruction& instr) {
   auto closure = Downcast<VMClosureValue>(ctx.ReadRegister(instr.invoke_closure.closure));
   std::vector<Value> args;
-  for (auto free_var : closure->free_vars) {
+  args.reserve(closure->free_vars.size() + instr.invoke_closure.num_args);
+  for (const auto& free_var : closure->free_vars) {
     args.push_back(free_var);
   }
   for (Index i = 0; i < instr.invoke_closure.num_args; ++i) {
@@ -814,10 +1249,16 @@ void VirtualMachine::HandleInvokeClosure(VMContext& ctx, const Instruction& inst
 }
 
 void VirtualMachine::HandleInvokeJit(VMContext& ctx, const Instruction& instr) {
+  if (ctx->jit_sites != nullptr) {
+    // Collect the op to be compiled by the warmup without running it.
+    CollectJitSite(ctx, instr);
+    ctx->pc++;
+    return;
+  }
   OpEnvPtr op_env;
   std::vector<Value> inputs;
   Value output;
-  std::string op_env_cache_key;
+  const std::string* op_env_cache_key;
 
   std::tie(op_env, inputs, output, op_env_cache_key) = PrepareOpEnv(ctx, instr);
   if (!dryrun_) {  // Skip the execution in dryrun mode
@@ -826,12 +1267,26 @@ void VirtualMachine::HandleInvokeJit(VMContext& ctx, const Instruction& instr) {
       WITH_CUDA_PROFILER(
           devices_[0],
           utils::GetStreamById(ctx, ctx->current_device_id, ctx->current_stream_id)->data(),
-          op_env->name(), utils::GetStreamName(ctx->current_stream_id), {op_env_cache_key},
+          op_env->name(), utils::GetStreamName(ctx->current_stream_id), {*op_env_cache_key},
           { op_env->Execute(inputs, output); });
     } else
 #endif
-    {  // cpu
-      WITH_BASE_PROFILER(devices_[0], op_env->name(), "ComputationOperator", {op_env_cache_key},
+    if (ctx->use_host_streams && op_env->GetRequests()->workspace.empty()) {
+      // Launch the op to the worker of the current stream. The task holds the OpEnv and the
+      // values, so the memory outlives the registers that are freed in the meantime. The key is
+      // owned by the OpEnv cache, which is not cleared while the VM runs.
+      Device device = devices_[0];
+      ctx->host_streams->Launch(
+          ctx->current_stream_id, [device, op_env, inputs = std::move(inputs),
+                                   output = std::move(output), key = op_env_cache_key]() {
+            WITH_BASE_PROFILER(device, op_env->name(), "ComputationOperator", {*key},
+                               { op_env->Execute(inputs, output); });
+          });
+    } else {  // cpu
+      // The workspace of an OpEnv is shared by its invocations, so the op runs on the VM thread
+      // after the pending ones.
+      SyncHostStreams(ctx);
+      WITH_BASE_PROFILER(devices_[0], op_env->name(), "ComputationOperator", {*op_env_cache_key},
                          { op_env->Execute(inputs, output); });
     }
   }
@@ -861,10 +1316,20 @@ void VirtualMachine::HandleSetShape(VMContext& ctx, const Instruction& instr) {
       shape.push_back(Downcast<IntValue>(tuple->fields[i])->value);
     }
   } else {
+    if (ctx->jit_sites != nullptr) {
+      throw utils::WarmupStop();
+    }
+    SyncHostStreams(ctx);
     raw_shape = CopyTo(raw_shape, Device(DevType::kCPU(), 0));
     shape = common::shape_utils::GetShapeVecFromData(raw_shape);
   }
-  ctx.WriteRegister(instr.dst, data.CreateView(shape));
+  if (instr.set_shape.offset == 0) {
+    ctx.WriteRegister(instr.dst, data.CreateView(shape));
+  } else {
+    const DLTensor* dlt = data;
+    void* view_data = static_cast<char*>(dlt->data) + dlt->byte_offset + instr.set_shape.offset;
+    ctx.WriteRegister(instr.dst, data.CreateView(shape, {}, view_data));
+  }
   ctx->pc++;
 }
 
@@ -874,6 +1339,7 @@ bool VirtualMachine::HandleRet(VMContext& ctx, const Instruction& instr) {
   if (caller_return_register < 0) {
     // We have hit the point from which we started running, we should return to the caller breaking
     // the dispatch loop.
+    SyncHostStreams(ctx);
     ctx->return_register = ret_val;
     return true;
   } else {  // Otherwise we are just returning from a local call.
@@ -883,6 +1349,9 @@ bool VirtualMachine::HandleRet(VMContext& ctx, const Instruction& instr) {
 }
 
 void VirtualMachine::HandleInferType(VMContext& ctx, const Instruction& instr) {
+  // The type functions may read the data of the args, e.g., for the data-dependent ops, which
+  // may still be written by the host streams.
+  SyncHostStreams(ctx);
   Array<Value> args;
   for (Index i = 0; i < instr.infer_type.num_args; i++) {
     args.push_back(ctx.ReadRegister(instr.infer_type.args[i]));
@@ -935,6 +1404,17 @@ void VirtualMachine::HandleInferType(VMContext& ctx, const Instruction& instr) {
 void VirtualMachine::HandleCudaSetStream(VMContext& ctx, const Instruction& instr) {
   Index device_id = instr.cuda_set_stream.device_id;
   Index stream_id = instr.cuda_set_stream.stream_id;
+  if (!use_cuda_) {
+    // On CPU, the ops of each stream run in order on a host worker thread.
+    if (ctx->host_streams == nullptr) {
+      ctx->host_streams = std::make_shared<HostStreamPool>();
+    }
+    ctx->use_host_streams = true;
+    ctx->current_device_id = device_id;
+    ctx->current_stream_id = stream_id;
+    ctx->pc++;
+    return;
+  }
   Device device(DevType::kCUDA(), static_cast<int>(device_id));
   auto stream = utils::GetStreamById(ctx, device_id, stream_id);
   OpEnv::SetStreamForAllBackends(device, stream->data());
@@ -950,6 +1430,12 @@ void VirtualMachine::HandleCudaAddEvent(VMContext& ctx, const Instruction& instr
     stream_id = ctx->current_stream_id;
   }
   Index event_id = instr.cuda_event.event_id;
+  if (!use_cuda_) {
+    CHECK(ctx->use_host_streams) << "Event " << event_id << " is recorded before any stream is set";
+    ctx->host_streams->RecordEvent(stream_id, event_id);
+    ctx->pc++;
+    return;
+  }
   auto event = utils::GetEventById(ctx, device_id, event_id);
   auto stream = utils::GetStreamById(ctx, device_id, stream_id);
   auto api = DeviceAPI::Get(DevType::kCUDA());
@@ -965,6 +1451,12 @@ void VirtualMachine::HandleCudaWaitEvent(VMContext& ctx, const Instruction& inst
     stream_id = ctx->current_stream_id;
   }
   Index event_id = instr.cuda_event.event_id;
+  if (!use_cuda_) {
+    CHECK(ctx->use_host_streams) << "Event " << event_id << " is waited before any stream is set";
+    ctx->host_streams->WaitEvent(stream_id, event_id);
+    ctx->pc++;
+    return;
+  }
   auto event = utils::GetEventById(ctx, device_id, event_id);
   auto stream = utils::GetStreamById(ctx, device_id, stream_id);
   auto api = DeviceAPI::Get(DevType::kCUDA());
@@ -973,6 +1465,11 @@ void VirtualMachine::HandleCudaWaitEvent(VMContext& ctx, const Instruction& inst
 }
 
 void VirtualMachine::HandleCudaStreamBarrier(VMContext& ctx, const Instruction& instr) {
+  if (!use_cuda_) {
+    SyncHostStreams(ctx);
+    ctx->pc++;
+    return;
+  }
   if (ctx->current_barrier_event_index >= ctx->barrier_events.size()) {
     Device device(DevType::kCUDA(), static_cast<int>(ctx->current_device_id));
     ctx->barrier_events.resize(ctx->current_barrier_event_index + 1);
@@ -995,119 +1492,393 @@ void VirtualMachine::HandleCudaStreamBarrier(VMContext& ctx, const Instruction&
   ctx->pc++;
 }
 
-std::tuple<std::shared_ptr<OpEnv>, std::vector<Value>, Value, std::string>
+void VirtualMachine::SyncHostStreams(VMContext& ctx) {
+  if (ctx->host_streams != nullptr) {
+    ctx->host_streams->Synchronize();
+  }
+}
+
+/*! \brief Collect the addresses of the tensors in a value. */
+static void CollectTensorData(const Value& value, std::vector<const void*>* data) {
+  if (const auto* tensor = value.as<TensorValueObj>()) {
+    data->push_back(tensor->tensor->data);
+  } else if (const auto* tuple = value.as<TupleValueObj>()) {
+    for (const auto& field : tuple->fields) {
+      CollectTensorData(field, data);
+    }
+  }
+}
+
+std::tuple<std::shared_ptr<OpEnv>, std::vector<Value>, Value, const std::string*>
 VirtualMachine::PrepareOpEnv(const VMContext& ctx, const Instruction& instr) {
   Index num_inputs = instr.invoke_jit.arity - instr.invoke_jit.output_size;
   Array<Value> args;
   Value output;
 
-  // extract the input args and prepare the hash key to query op env
-  std::ostringstream os;
+  // extract the input args and the output, and prepare the shape/dtype signature
+  thread_local std::vector<int64_t> signature;
+  signature.clear();
   for (Index i = 0; i < num_inputs; i++) {
     Index reg_idx = instr.invoke_jit.args[i];
     auto reg = ctx.ReadRegister(reg_idx);
     args.push_back(reg);
     if (ctx.IsConst(reg_idx)) {
-      // Skip constatnts in the hash key
+      // Skip constatnts in the signature
+      signature.push_back(utils::kSigSkip);
       continue;
     }
     if (auto tensor = reg.as<TensorValueObj>()) {
-      utils::TensorRepr(os, tensor);
+      utils::TensorSignature(&signature, tensor);
     } else if (auto tup = reg.as<TupleValueObj>()) {
-      os << "(";
+      signature.push_back(utils::kSigTuple);
+      signature.push_back(tup->fields.size());
       for (auto field : tup->fields) {
         auto t = field.as<TensorValueObj>();
         if (t != nullptr) {
-          utils::TensorRepr(os, t);
+          utils::TensorSignature(&signature, t);
+        } else {
+          signature.push_back(utils::kSigSkip);
         }
-        os << ",";
       }
-      os << ")";
     } else {
       LOG(FATAL) << "Unsupported non-const register type: " << reg->GetTypeKey();
     }
-    os << ",";
   }
-
-  // extract the output
-  os << "|";
+  signature.push_back(utils::kSigOutput);
   if (instr.invoke_jit.output_size == 1) {
     output = ctx.ReadRegister(instr.invoke_jit.args[num_inputs]);
-    utils::TensorRepr(os, output.as<TensorValueObj>());
+    utils::TensorSignature(&signature, output.as<TensorValueObj>());
   } else {
-    os << "(";
     Array<Value> outs;
     for (Index i = num_inputs; i < instr.invoke_jit.arity; i++) {
       Value val = ctx.ReadRegister(instr.invoke_jit.args[i]);
       outs.push_back(val);
-      utils::TensorRepr(os, val.as<TensorValueObj>());
-      os << ",";
+      utils::TensorSignature(&signature, val.as<TensorValueObj>());
     }
-    os << ")";
     output = TupleValue::make(outs);
   }
-  std::string op_env_cache_key = os.str();
+  size_t signature_hash = utils::HashSignature(signature);
+
+  // check the last OpEnv resolved at this instruction
+  const auto& func_op_env_cache = op_env_cache_[ctx->func_index];
+  const OpEnvCacheEntry* last_entry = nullptr;
+  if (use_op_env_fast_path_) {
+    last_entry = func_op_env_cache->GetLastEntry(ctx->pc);
+  }
+  if (last_entry == nullptr || last_entry->hash != signature_hash ||
+      last_entry->signature != signature) {
+    // The entry also owns the key returned to the caller, so it is recorded even if the fast path
+    // is disabled.
+    std::shared_ptr<OpEnv> op_env;
+    std::string op_env_cache_key;
+    std::tie(op_env, op_env_cache_key) = LookupOpEnv(ctx, instr, args, output);
+    last_entry = func_op_env_cache->SetLastEntry(ctx->pc, signature_hash, signature,
+                                                 std::move(op_env), std::move(op_env_cache_key));
+  }
+  const OpEnvPtr& op_env = last_entry->op_env;
+
+  const std::string& func_name = exec_->functions[ctx->func_index].name;
+  auto* mem_profiler = memory_profiler::MemoryProfiler::Get();
+  std::string op_name;
+  if (mem_profiler->IsTracingAllocs()) {
+    // Charge the storage of the outputs to this op.
+    op_name = op_env->name();
+    std::vector<const void*> data;
+    CollectTensorData(output, &data);
+    mem_profiler->AttributeAllocs(data, func_name, ctx->pc, op_name);
+  }
+  memory_profiler::AllocSiteScope alloc_site(&func_name, ctx->pc, &op_name, "workspace");
+  std::shared_ptr<Requests> requests = op_env->GetRequests();
+  for (size_t i = 0; i < requests->workspace.size(); i++) {
+    Requests::WorkspaceRequest& entry = requests->workspace[i];
+    auto buf = Alloc(ctx, entry.device, entry.nbytes);
+    entry.memory = buf;
+    *entry.dest = buf->data;
+  }
+
+  std::vector<Value> inputs;
+  for (int i : op_env->arg_indices) {
+    CHECK_GE(i, 0) << "Invalid input index: " << i;
+    inputs.push_back(args[i]);
+  }
+  return std::make_tuple(op_env, std::move(inputs), std::move(output), &last_entry->key);
+}
+
+std::pair<std::shared_ptr<OpEnv>, std::string> VirtualMachine::LookupOpEnv(
+    const VMContext& ctx, const Instruction& instr, const Array<Value>& args,
+    const Value& output) {
+  std::string op_env_cache_key = GetOpEnvKey(ctx, instr, args, output);
 
   // check the OpEnv cache
   std::shared_ptr<OpEnv> op_env;
   auto op_env_cache = op_env_cache_[ctx->func_index]->Get(ctx->pc);
-  if (auto p = op_env_cache->Get(op_env_cache_key)) {
+  if (auto p = op_env_cache->GetShared(op_env_cache_key)) {
     // Cache hit. Reuse the OpEnv from the cache.
     op_env = *p;
   } else {
     // Create a new OpEnv.
-    auto call_values = CallValues::make();
     Value callee = ctx.ReadRegister(instr.invoke_jit.op_reg);
-    const auto* op = callee.as<OpValueObj>();
-    const auto* closure = callee.as<ClosureValueObj>();
-    call_values->callee = callee;
-    if (op) {
-      call_values->args = GetOpAttr<FRAFSchema>(op->op, "FRAFSchema")(args);
-    } else {
-      call_values->args = MakeListArgs(args);
+    op_env = CreateOpEnv(ctx->func_index, ctx->pc, callee, args, output, op_env_cache_key);
+    PrepareRequests(ctx, op_env);
+    // add to cache, unless another run or a warmup has cached one in the meantime
+    if (!op_env_cache->TrySet(op_env_cache_key, op_env)) {
+      op_env = *op_env_cache->GetShared(op_env_cache_key);
     }
-    call_values->device = devices_[0];
-    call_values->out = output;
-    op_env = Dispatch(call_values);
-    CHECK(op_env != nullptr) << "ValueError: Cannot dispatch "
-                             << (op ? op->op->name : PrettyPrint(closure->func)) << " @"
-                             << call_values->device.c_str();
-    std::shared_ptr<Requests> requests = op_env->GetRequests();
-    // prepare distributed requests
-    for (size_t i = 0; i < requests->distributed.size(); i++) {
-      Requests::DistributedRequest& entry = requests->distributed[i];
-      *entry.dest = (void*)(Communicator::Get(entry.name, entry.rank_list).as<CommunicatorObj>());
+  }
+  return std::make_pair(op_env, op_env_cache_key);
+}
+
+std::string VirtualMachine::GetOpEnvKey(const VMContext& ctx, const Instruction& instr,
+                                        const Array<Value>& args, const Value& output) const {
+  Index num_inputs = instr.invoke_jit.arity - instr.invoke_jit.output_size;
+
+  // prepare the hash key to query op env
+  std::ostringstream os;
+  for (Index i = 0; i < num_inputs; i++) {
+    if (ctx.IsConst(instr.invoke_jit.args[i])) {
+      // Skip constatnts in the hash key
+      continue;
     }
-#ifdef RAF_USE_CUDA
-    // prepare cuda stream requests
-    for (size_t i = 0; i < requests->stream.size(); i++) {
-      Requests::StreamRequest& entry = requests->stream[i];
-      // currently ignores the stream_idx field in requests, all requests with the same tag_idx will
-      // get the same cuda stream in vm
-      std::shared_ptr<Stream> stream =
-          utils::GetStreamById(ctx, entry.device.device_id(), entry.tag_idx);
-      *entry.dest = stream->data();
-      entry.stream = stream;
+    const auto& reg = args[i];
+    if (auto tensor = reg.as<TensorValueObj>()) {
+      utils::TensorRepr(os, tensor);
+    } else if (auto tup = reg.as<TupleValueObj>()) {
+      os << "(";
+      for (auto field : tup->fields) {
+        auto t = field.as<TensorValueObj>();
+        if (t != nullptr) {
+          utils::TensorRepr(os, t);
+        }
+        os << ",";
+      }
+      os << ")";
     }
-#endif
-    // add to cache
-    op_env_cache->Set(op_env_cache_key, op_env);
+    os << ",";
   }
+  os << "|";
+  if (instr.invoke_jit.output_size == 1) {
+    utils::TensorRepr(os, output.as<TensorValueObj>());
+  } else {
+    os << "(";
+    for (const auto& val : Downcast<TupleValue>(output)->fields) {
+      utils::TensorRepr(os, val.as<TensorValueObj>());
+      os << ",";
+    }
+    os << ")";
+  }
+  return os.str();
+}
+
+OpEnvPtr VirtualMachine::CreateOpEnv(Index func_index, Index pc, const Value& callee,
+                                     const Array<Value>& args, const Value& output,
+                                     const std::string& key) const {
+  auto call_values = CallValues::make();
+  const auto* op = callee.as<OpValueObj>();
+  const auto* closure = callee.as<ClosureValueObj>();
+  call_values->callee = callee;
+  if (op) {
+    call_values->args = GetOpAttr<FRAFSchema>(op->op, "FRAFSchema")(args);
+  } else {
+    call_values->args = MakeListArgs(args);
+  }
+  call_values->device = devices_[0];
+  call_values->out = output;
+  // Replay the dispatch decision bundled with the executable if any, which skips the dialects
+  // that were tried and rejected when the bundle was made.
+  MetaCacheKeyRecorder recorder;
+  OpEnvPtr op_env;
+  const auto& aot_dispatch = aot_dispatch_[func_index];
+  auto aot_it = aot_dispatch.find(pc);
+  if (aot_it != aot_dispatch.end()) {
+    auto record_it = aot_it->second.find(key);
+    if (record_it != aot_it->second.end()) {
+      op_env = DispatchTo(call_values, record_it->second);
+    }
+  }
+  if (op_env == nullptr) {
+    op_env = Dispatch(call_values);
+  }
+  CHECK(op_env != nullptr) << "ValueError: Cannot dispatch "
+                           << (op ? op->op->name : PrettyPrint(closure->func)) << " @"
+                           << call_values->device.c_str();
+  op_env->cache_keys = recorder.TakeKeys();
+  return op_env;
+}
 
+void VirtualMachine::PrepareRequests(const VMContext& ctx, const OpEnvPtr& op_env) {
   std::shared_ptr<Requests> requests = op_env->GetRequests();
-  for (size_t i = 0; i < requests->workspace.size(); i++) {
-    Requests::WorkspaceRequest& entry = requests->workspace[i];
-    auto buf = Alloc(ctx, entry.device, entry.nbytes);
-    entry.memory = buf;
-    *entry.dest = buf->data;
+  // prepare distributed requests
+  for (size_t i = 0; i < requests->distributed.size(); i++) {
+    Requests::DistributedRequest& entry = requests->distributed[i];
+    *entry.dest = (void*)(Communicator::Get(entry.name, entry.rank_list).as<CommunicatorObj>());
+  }
+#ifdef RAF_USE_CUDA
+  // prepare cuda stream requests
+  for (size_t i = 0; i < requests->stream.size(); i++) {
+    Requests::StreamRequest& entry = requests->stream[i];
+    // currently ignores the stream_idx field in requests, all requests with the same tag_idx will
+    // get the same cuda stream in vm
+    std::shared_ptr<Stream> stream =
+        utils::GetStreamById(ctx, entry.device.device_id(), entry.tag_idx);
+    *entry.dest = stream->data();
+    entry.stream = stream;
   }
+#endif
+}
 
-  std::vector<Value> inputs;
-  for (int i : op_env->arg_indices) {
-    CHECK_GE(i, 0) << "Invalid input index: " << i;
-    inputs.push_back(args[i]);
+void VirtualMachine::CollectJitSite(const VMContext& ctx, const Instruction& instr) {
+  Index num_inputs = instr.invoke_jit.arity - instr.invoke_jit.output_size;
+  JitSite site;
+  site.func_index = ctx->func_index;
+  site.pc = ctx->pc;
+  site.callee = ctx.ReadRegister(instr.invoke_jit.op_reg);
+  for (Index i = 0; i < num_inputs; i++) {
+    site.args.push_back(ctx.ReadRegister(instr.invoke_jit.args[i]));
+  }
+  if (instr.invoke_jit.output_size == 1) {
+    site.output = ctx.ReadRegister(instr.invoke_jit.args[num_inputs]);
+  } else {
+    Array<Value> outs;
+    for (Index i = num_inputs; i < instr.invoke_jit.arity; i++) {
+      outs.push_back(ctx.ReadRegister(instr.invoke_jit.args[i]));
+    }
+    site.output = TupleValue::make(outs);
+  }
+  site.key = GetOpEnvKey(ctx, instr, site.args, site.output);
+  ctx->jit_sites->push_back(std::move(site));
+}
+
+PackedMetricMap VirtualMachine::Warmup(VMContext ctx, int num_threads, PackedFunc progress) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Walk the function without executing the ops to collect the jit sites.
+  std::vector<JitSite> sites;
+  ctx->jit_sites = &sites;
+  try {
+    ctx.PushFrame(ctx->entry_func_index, ctx->inputs, -1);
+    RunLoop(ctx);
+  } catch (const utils::WarmupStop&) {
+    while (!ctx->frames.empty()) {
+      ctx.PopFrame();
+    }
+  } catch (...) {
+    ctx->jit_sites = nullptr;
+    FinishRun(ctx);
+    throw;
+  }
+  ctx->jit_sites = nullptr;
+  FinishRun(ctx);
+
+  // Skip the sites that are cached or visited more than once.
+  std::vector<const JitSite*> pending;
+  std::unordered_set<std::string> visited;
+  int64_t num_cached = 0;
+  for (const auto& site : sites) {
+    std::ostringstream os;
+    os << site.func_index << "@" << site.pc << ":" << site.key;
+    if (!visited.insert(os.str()).second) {
+      continue;
+    }
+    if (op_env_cache_[site.func_index]->Get(site.pc)->Has(site.key)) {
+      ++num_cached;
+    } else {
+      pending.push_back(&site);
+    }
+  }
+
+  // Create the OpEnvs on a pool of threads. Each thread works in a copy of the current pass
+  // context, because the pass context is thread local and may be updated by the compilation.
+  const int64_t total = pending.size();
+  if (num_threads <= 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  num_threads = static_cast<int>(std::min<int64_t>(num_threads, total));
+  std::vector<OpEnvPtr> op_envs(total);
+  std::atomic<int64_t> next{0};
+  int64_t num_done = 0;
+  std::mutex mu;
+  std::condition_variable cv;
+  auto pass_ctx = pass::PassContext::Current();
+  auto worker = [&]() {
+    auto local_ctx = pass::PassContext::Create();
+    local_ctx->opt_level = pass_ctx->opt_level;
+    local_ctx->required_pass = pass_ctx->required_pass;
+    local_ctx->disabled_pass = pass_ctx->disabled_pass;
+    local_ctx->config = pass_ctx->config;
+    tvm::With<pass::PassContext> scope(local_ctx);
+    for (int64_t i = next++; i < total; i = next++) {
+      const JitSite* site = pending[i];
+      try {
+        op_envs[i] =
+            CreateOpEnv(site->func_index, site->pc, site->callee, site->args, site->output,
+                        site->key);
+      } catch (const std::exception& e) {
+        LOG(WARNING) << "Failed to warm up instruction " << site->pc << " of function "
+                     << exec_->functions[site->func_index].name << ": " << e.what();
+      } catch (...) {
+        LOG(WARNING) << "Failed to warm up instruction " << site->pc << " of function "
+                     << exec_->functions[site->func_index].name << ": unknown exception";
+      }
+      {
+        std::lock_guard<std::mutex> lock(mu);
+        ++num_done;
+      }
+      cv.notify_one();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  auto join = [&]() {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  int64_t num_reported = 0;
+  try {
+    while (num_reported < total) {
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&]() { return num_done > num_reported; });
+        num_reported = num_done;
+      }
+      if (progress != nullptr) {
+        progress(num_reported, total);
+      }
+    }
+  } catch (...) {
+    // The progress callback may throw, e.g. on a Python exception. Let the workers finish the
+    // sites they are compiling and join them before propagating, as destroying a joinable
+    // thread terminates the process.
+    next = total;
+    join();
+    throw;
   }
-  return std::make_tuple(op_env, std::move(inputs), std::move(output), op_env_cache_key);
+  join();
+
+  // Fill the OpEnv cache on this thread, which also owns the stream requests of the context.
+  int64_t num_compiled = 0;
+  for (int64_t i = 0; i < total; ++i) {
+    if (op_envs[i] == nullptr) {
+      continue;
+    }
+    const JitSite* site = pending[i];
+    PrepareRequests(ctx, op_envs[i]);
+    op_env_cache_[site->func_index]->Get(site->pc)->TrySet(site->key, op_envs[i]);
+    ++num_compiled;
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  PackedMetricMap stats;
+  stats.Set("num_sites", static_cast<int64_t>(visited.size()));
+  stats.Set("num_cached", num_cached);
+  stats.Set("num_compiled", num_compiled);
+  stats.Set("num_failed", total - num_compiled);
+  stats.Set("num_threads", num_threads);
+  stats.Set("elapsed_us", static_cast<int64_t>(elapsed.count()));
+  return stats;
 }
 
 tvm::runtime::Module CreateVirtualMachine(const Executable* exec, bool enable_cuda_graph,
@@ -1117,6 +1888,10 @@ tvm::runtime::Module CreateVirtualMachine(const Executable* exec, bool enable_cu
   return tvm::runtime::Module(vm);
 }
 
+RAF_REGISTER_GLOBAL("raf.vm.SharedConstantPoolStats").set_body_typed([]() {
+  return SharedConstantPool::GetStats();
+});
+
 RAF_REGISTER_GLOBAL("raf.vm.VirtualMachine").set_body([](tvm::TVMArgs args, tvm::TVMRetValue* rv) {
   tvm::runtime::Module mod = args[0];
   bool enable_cuda_graph = args[1];
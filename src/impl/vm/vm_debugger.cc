@@ -85,7 +85,7 @@ void VMDebugger::HandleInvokeJit(VMContext& ctx, const Instruction& instr) {
   OpEnvPtr op_env;
   std::vector<Value> inputs;
   Value output;
-  std::string op_env_cache_key;
+  const std::string* op_env_cache_key;
 
   std::tie(op_env, inputs, output, op_env_cache_key) = PrepareOpEnv(ctx, instr);
   op_env->Execute(inputs, output);
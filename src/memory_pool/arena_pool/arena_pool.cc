@@ -0,0 +1,486 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/memory_pool/arena_pool/arena_pool.cc
+ * \brief A memory pool that splits and coalesces blocks carved out of large segments
+ */
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include "raf/device_api.h"
+#include "raf/memory_pool.h"
+#include "raf/registry.h"
+
+namespace raf {
+namespace memory_pool {
+namespace arena_pool {
+
+using device_api::DeviceAPI;
+
+/*! \brief The granularity of block sizes and offsets. */
+constexpr int64_t kBlockAlign = kDefaultMemoryAlignment;
+/*! \brief The alignment of segments allocated from the device. */
+constexpr int64_t kSegmentAlign = 4096;
+/*! \brief The default size of a segment. */
+constexpr int64_t kDefaultSegmentSize = 2 << 20;
+/*! \brief The number of second-level bins per power of two (exponent). */
+constexpr int kSecondLevelBits = 3;
+constexpr int kSecondLevelCount = 1 << kSecondLevelBits;
+/*! \brief The number of first-level bins. */
+constexpr int kFirstLevelCount = 64 - kSecondLevelBits;
+/*! \brief The maximum number of blocks examined in a bin when searching for the best fit. */
+constexpr int kMaxBestFitScan = 16;
+
+inline int64_t RoundUp(int64_t value, int64_t align) {
+  return (value + align - 1) / align * align;
+}
+
+inline int Log2Floor(uint64_t value) {
+  return 63 - __builtin_clzll(value);
+}
+
+/*!
+ * \brief A contiguous range of a segment. Blocks of the same segment are linked by their
+ * addresses, and free blocks of the same size class are linked in a free list.
+ */
+struct Block {
+  /*! \brief The start address of the block. */
+  char* ptr;
+  /*! \brief The size of the block in bytes. */
+  int64_t size;
+  /*! \brief Whether the block is free. */
+  bool free = true;
+  /*! \brief The physically adjacent blocks in the same segment. */
+  Block* prev_phys = nullptr;
+  Block* next_phys = nullptr;
+  /*! \brief The adjacent blocks in the free list. */
+  Block* prev_free = nullptr;
+  Block* next_free = nullptr;
+};
+
+/*!
+ * \brief The allocator state shared by the pool and the memory it hands out, so that the memory
+ * can be returned correctly even after the pool is removed from the pool manager.
+ */
+class Arena {
+ public:
+  Arena(std::shared_ptr<DeviceAPI> api, int64_t segment_size, int64_t pool_limit)
+      : api_(std::move(api)), segment_size_(segment_size), pool_limit_(pool_limit) {
+    std::fill(second_level_bitmap_, second_level_bitmap_ + kFirstLevelCount, 0);
+    std::fill(free_lists_, free_lists_ + kFirstLevelCount * kSecondLevelCount, nullptr);
+  }
+
+  ~Arena() {
+    for (auto& kv : segments_) {
+      Block* block = kv.second;
+      while (block != nullptr) {
+        Block* next = block->next_phys;
+        delete block;
+        block = next;
+      }
+      api_->FreeMemory(kv.first);
+    }
+  }
+
+  Block* Alloc(int64_t nbytes, int64_t alignment) {
+    std::lock_guard<std::mutex> lock(mu_);
+    int64_t size = RoundUp(nbytes, kBlockAlign);
+    int64_t padding = alignment > kBlockAlign ? alignment - kBlockAlign : 0;
+    int64_t request = size + padding;
+
+    Block* block = FindFreeBlock(request);
+    if (block == nullptr) {
+      block = AddSegment(request);
+    }
+    RemoveFreeBlock(block);
+
+    // Split the head of the block if the block start does not meet the alignment.
+    int64_t offset = RoundUp(reinterpret_cast<int64_t>(block->ptr), alignment) -
+                     reinterpret_cast<int64_t>(block->ptr);
+    if (offset > 0) {
+      Block* head = block;
+      block = SplitBlock(head, offset);
+      InsertFreeBlock(head);
+    }
+    // Split the tail of the block and return it to the free lists.
+    if (block->size - size >= kBlockAlign) {
+      InsertFreeBlock(SplitBlock(block, size));
+    }
+    block->free = false;
+    used_bytes_ += block->size;
+    peak_used_bytes_ = std::max(peak_used_bytes_, used_bytes_);
+    num_allocs_++;
+    return block;
+  }
+
+  void Free(Block* block) {
+    std::lock_guard<std::mutex> lock(mu_);
+    used_bytes_ -= block->size;
+    block->free = true;
+    // Coalesce with the free neighbors.
+    if (block->next_phys != nullptr && block->next_phys->free) {
+      RemoveFreeBlock(block->next_phys);
+      MergeNext(block);
+    }
+    if (block->prev_phys != nullptr && block->prev_phys->free) {
+      block = block->prev_phys;
+      RemoveFreeBlock(block);
+      MergeNext(block);
+    }
+    InsertFreeBlock(block);
+    if (pool_limit_ > 0 && pool_bytes_ > pool_limit_) {
+      ReleaseFreeSegments();
+    }
+  }
+
+  std::pair<int64_t, int64_t> GetPoolSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return {used_bytes_, pool_bytes_};
+  }
+
+  std::unordered_map<std::string, double> GetPoolStats() {
+    std::lock_guard<std::mutex> lock(mu_);
+    int64_t free_bytes = 0;
+    int64_t largest_free_block = 0;
+    int64_t num_free_blocks = 0;
+    for (int i = 0; i < kFirstLevelCount * kSecondLevelCount; ++i) {
+      for (Block* block = free_lists_[i]; block != nullptr; block = block->next_free) {
+        free_bytes += block->size;
+        largest_free_block = std::max(largest_free_block, block->size);
+        num_free_blocks++;
+      }
+    }
+    double fragmentation =
+        free_bytes > 0 ? 1.0 - static_cast<double>(largest_free_block) / free_bytes : 0.0;
+    return {{"used_bytes", used_bytes_},
+            {"pool_bytes", pool_bytes_},
+            {"peak_used_bytes", peak_used_bytes_},
+            {"free_bytes", free_bytes},
+            {"largest_free_block", largest_free_block},
+            {"num_free_blocks", num_free_blocks},
+            {"num_segments", segments_.size()},
+            {"num_allocs", num_allocs_},
+            {"fragmentation", fragmentation}};
+  }
+
+ private:
+  /*! \brief Map a size to the bin that holds free blocks of this size. */
+  static inline void MappingInsert(int64_t size, int* fl, int* sl) {
+    uint64_t units = size / kBlockAlign;
+    if (units < kSecondLevelCount) {
+      *fl = 0;
+      *sl = static_cast<int>(units);
+    } else {
+      int log2 = Log2Floor(units);
+      *fl = log2 - kSecondLevelBits + 1;
+      *sl = static_cast<int>((units >> (log2 - kSecondLevelBits)) - kSecondLevelCount);
+    }
+  }
+
+  /*! \brief Map a size to the first bin whose blocks are all large enough for this size. */
+  static inline void MappingSearch(int64_t size, int* fl, int* sl) {
+    uint64_t units = size / kBlockAlign;
+    if (units >= kSecondLevelCount) {
+      units += (1ULL << (Log2Floor(units) - kSecondLevelBits)) - 1;
+    }
+    MappingInsert(units * kBlockAlign, fl, sl);
+  }
+
+  inline Block*& FreeList(int fl, int sl) {
+    return free_lists_[fl * kSecondLevelCount + sl];
+  }
+
+  Block* FindFreeBlock(int64_t size) {
+    // Best fit among the bin of the requested size, whose blocks may or may not fit.
+    int fl, sl;
+    MappingInsert(size, &fl, &sl);
+    Block* best = nullptr;
+    int scanned = 0;
+    for (Block* block = FreeList(fl, sl); block != nullptr && scanned < kMaxBestFitScan;
+         block = block->next_free, ++scanned) {
+      if (block->size >= size && (best == nullptr || block->size < best->size)) {
+        best = block;
+        if (block->size == size) break;
+      }
+    }
+    if (best != nullptr) {
+      return best;
+    }
+    // Otherwise take the first block of the smallest non-empty bin that always fits.
+    MappingSearch(size, &fl, &sl);
+    if (fl >= kFirstLevelCount) {
+      return nullptr;
+    }
+    uint32_t sl_map = second_level_bitmap_[fl] & (~0U << sl);
+    if (sl_map == 0) {
+      uint64_t fl_map = fl + 1 < 64 ? first_level_bitmap_ & (~0ULL << (fl + 1)) : 0;
+      if (fl_map == 0) {
+        return nullptr;
+      }
+      fl = __builtin_ctzll(fl_map);
+      sl_map = second_level_bitmap_[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return FreeList(fl, sl);
+  }
+
+  void InsertFreeBlock(Block* block) {
+    int fl, sl;
+    MappingInsert(block->size, &fl, &sl);
+    Block*& head = FreeList(fl, sl);
+    block->free = true;
+    block->prev_free = nullptr;
+    block->next_free = head;
+    if (head != nullptr) {
+      head->prev_free = block;
+    }
+    head = block;
+    first_level_bitmap_ |= 1ULL << fl;
+    second_level_bitmap_[fl] |= 1U << sl;
+  }
+
+  void RemoveFreeBlock(Block* block) {
+    int fl, sl;
+    MappingInsert(block->size, &fl, &sl);
+    if (block->prev_free != nullptr) {
+      block->prev_free->next_free = block->next_free;
+    } else {
+      FreeList(fl, sl) = block->next_free;
+    }
+    if (block->next_free != nullptr) {
+      block->next_free->prev_free = block->prev_free;
+    }
+    block->prev_free = block->next_free = nullptr;
+    if (FreeList(fl, sl) == nullptr) {
+      second_level_bitmap_[fl] &= ~(1U << sl);
+      if (second_level_bitmap_[fl] == 0) {
+        first_level_bitmap_ &= ~(1ULL << fl);
+      }
+    }
+  }
+
+  /*! \brief Split the block at the given offset and return the new block after the offset. */
+  Block* SplitBlock(Block* block, int64_t offset) {
+    Block* rest = new Block();
+    rest->ptr = block->ptr + offset;
+    rest->size = block->size - offset;
+    rest->prev_phys = block;
+    rest->next_phys = block->next_phys;
+    if (block->next_phys != nullptr) {
+      block->next_phys->prev_phys = rest;
+    }
+    block->next_phys = rest;
+    block->size = offset;
+    return rest;
+  }
+
+  /*! \brief Merge the next physical block into the given block. */
+  void MergeNext(Block* block) {
+    Block* next = block->next_phys;
+    block->size += next->size;
+    block->next_phys = next->next_phys;
+    if (next->next_phys != nullptr) {
+      next->next_phys->prev_phys = block;
+    }
+    delete next;
+  }
+
+  void* AllocDeviceMemory(int64_t nbytes) {
+    try {
+      return api_->AllocMemory(nbytes, kSegmentAlign);
+    } catch (const dmlc::Error& e) {
+      return nullptr;
+    }
+  }
+
+  /*! \brief Allocate a new segment that fits the given size and add it to the free lists. */
+  Block* AddSegment(int64_t size) {
+    int64_t nbytes = RoundUp(std::max(size, segment_size_), kSegmentAlign);
+    if (pool_limit_ > 0 && pool_bytes_ + nbytes > pool_limit_) {
+      ReleaseFreeSegments();
+    }
+    void* data = AllocDeviceMemory(nbytes);
+    if (data == nullptr) {
+      // Out of memory. Return the free segments to the device and try again.
+      int64_t free_nbytes = ReleaseFreeSegments();
+      DLOG(WARNING) << "Failed to allocate " << nbytes << " bytes. Released " << free_nbytes
+                    << " bytes of free segments";
+      data = AllocDeviceMemory(nbytes);
+    }
+    if (data == nullptr) {
+      LOG(FATAL) << "Out-Of-Memory. Tried to allocate " << nbytes << " bytes; Already allocated "
+                 << pool_bytes_ << " bytes and used " << used_bytes_ << " bytes";
+    }
+    Block* block = new Block();
+    block->ptr = static_cast<char*>(data);
+    block->size = nbytes;
+    segments_.emplace(data, block);
+    pool_bytes_ += nbytes;
+    InsertFreeBlock(block);
+    return block;
+  }
+
+  /*! \brief Return all segments that are entirely free to the device. */
+  int64_t ReleaseFreeSegments() {
+    int64_t total_free = 0;
+    for (auto it = segments_.begin(); it != segments_.end();) {
+      Block* block = it->second;
+      if (block->free && block->next_phys == nullptr) {
+        RemoveFreeBlock(block);
+        total_free += block->size;
+        pool_bytes_ -= block->size;
+        delete block;
+        api_->FreeMemory(it->first);
+        it = segments_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    return total_free;
+  }
+
+  /*! \brief The pointer to the DeviceAPI which determines the context of memory. */
+  std::shared_ptr<DeviceAPI> api_;
+  /*! \brief The minimum size of a segment in bytes. */
+  int64_t segment_size_;
+  /*! \brief The maximum allowed size (bytes) in the pool. 0 means no limit. */
+  int64_t pool_limit_;
+  /*! \brief The segments allocated from the device, mapping to their first block. */
+  std::unordered_map<void*, Block*> segments_;
+  /*! \brief The free lists of each (first level, second level) size class. */
+  Block* free_lists_[kFirstLevelCount * kSecondLevelCount];
+  /*! \brief The bitmap of first-level size classes with non-empty free lists. */
+  uint64_t first_level_bitmap_ = 0;
+  /*! \brief The bitmaps of second-level size classes with non-empty free lists. */
+  uint32_t second_level_bitmap_[kFirstLevelCount];
+  /*! \brief The number of bytes in use, in the pool, and the peak in use. */
+  int64_t used_bytes_ = 0;
+  int64_t pool_bytes_ = 0;
+  int64_t peak_used_bytes_ = 0;
+  /*! \brief The number of allocations served. */
+  int64_t num_allocs_ = 0;
+  /*! \brief The thread-safe lock. */
+  std::mutex mu_;
+};
+
+/*!
+ * \brief A wrapper which holds a block of an arena. The block is returned to the arena when the
+ * wrapper is destructed.
+ */
+class ArenaMemory final : public Memory {
+ public:
+  explicit ArenaMemory(Block* block, const Device& dev, std::shared_ptr<Arena> arena)
+      : block_(block), arena_(std::move(arena)) {
+    this->data = block->ptr;
+    this->device = dev;
+  }
+
+  ~ArenaMemory() {
+    arena_->Free(block_);
+  }
+
+ private:
+  /*! \brief The block in the arena. */
+  Block* block_;
+  /*! \brief The arena that owns the block. */
+  std::shared_ptr<Arena> arena_;
+};
+
+/*!
+ * \brief A Memory Pool that carves memory chunks out of large segments. Free blocks are kept in
+ * size-class bins in the way of TLSF (two-level segregated fit): a first level by the power of
+ * two and a second level that linearly subdivides it, with bitmaps of non-empty bins so that a
+ * fitting free list is found in constant time.
+ *
+ * When a chunk is requested, the pool looks for the best fit in the bin of the requested size,
+ * and otherwise takes a block from the smallest non-empty larger bin. The block is split and
+ * its tail is returned to the bins. When a chunk is freed, it is coalesced with its free
+ * neighbors in the same segment, so that dynamic-shape workloads can reuse memory across sizes.
+ *
+ * Segments are only returned to the device when the pool runs out of memory or exceeds the
+ * limit given by RAF_MEMORY_POOL_SIZE_LIMIT.
+ *
+ * \sa ArenaPool
+ */
+class ArenaPool : public MemoryPool {
+ public:
+  explicit ArenaPool(Device dev, int64_t segment_size = kDefaultSegmentSize,
+                     int64_t pool_limit = 0) {
+    this->device = dev;
+    this->api = DeviceAPI::Get(dev.device_type());
+    if (dev.device_type() == DevType::kCUDA()) {
+      this->api->SetDevice(dev.device_id());
+    }
+    this->arena = std::make_shared<Arena>(api, segment_size, pool_limit);
+  }
+
+  std::string GetName() {
+    return "arena_pool";
+  }
+
+  int64_t GetAllocBytes(int64_t nbytes) override {
+    return RoundUp(nbytes, kBlockAlign);
+  }
+
+  std::shared_ptr<Memory> Alloc(int64_t nbytes, int64_t alignment) override {
+    CHECK_GE(nbytes, 0);
+    if (nbytes == 0) {
+      return std::make_shared<Memory>();
+    }
+    Block* block = arena->Alloc(nbytes, alignment);
+    return std::make_shared<ArenaMemory>(block, device, arena);
+  }
+
+  std::shared_ptr<Memory> AllocAsync(int64_t nbytes, void* stream,
+                                     int64_t alignment = kDefaultMemoryAlignment) override {
+    LOG(FATAL) << "Please use NoPool to use AllocAsync.";
+    throw;
+  }
+
+  std::vector<std::shared_ptr<Memory>> AllocBatch(const std::vector<int64_t>& nbytes,
+                                                  int64_t alignment) override {
+    std::vector<std::shared_ptr<Memory>> ret;
+    ret.reserve(nbytes.size());
+    for (int64_t bytes : nbytes) {
+      ret.emplace_back(Alloc(bytes, alignment));
+    }
+    return ret;
+  }
+
+  std::pair<float, float> GetPoolSize() override {
+    auto ret = arena->GetPoolSize();
+    return {BytesToMegaBytes(ret.first), BytesToMegaBytes(ret.second)};
+  }
+
+  std::unordered_map<std::string, double> GetPoolStats() override {
+    return arena->GetPoolStats();
+  }
+
+ public:
+  static void* make(const Device& dev) {
+    int64_t segment_size = kDefaultSegmentSize;
+    if (const char* val = getenv("RAF_ARENA_POOL_SEGMENT_SIZE")) {
+      segment_size = atol(val);
+    }
+    int64_t max_pool_limit = 0;
+    if (const char* val = getenv("RAF_MEMORY_POOL_SIZE_LIMIT")) {
+      max_pool_limit = atol(val);
+    }
+    return new ArenaPool(dev, segment_size, max_pool_limit);
+  }
+
+  Device device;
+  std::shared_ptr<DeviceAPI> api;
+  std::shared_ptr<Arena> arena;
+};
+
+RAF_REGISTER_GLOBAL("raf.memory_pool._make.arena_pool").set_body_typed([](const Device& dev) {
+  return ArenaPool::make(dev);
+});
+
+}  // namespace arena_pool
+}  // namespace memory_pool
+}  // namespace raf
@@ -0,0 +1,355 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/memory_pool/thread_cache_pool/thread_cache_pool.cc
+ * \brief A per-thread cache in front of another memory pool
+ */
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "raf/device_api.h"
+#include "raf/memory_pool.h"
+#include "raf/registry.h"
+
+namespace raf {
+namespace memory_pool {
+namespace thread_cache_pool {
+
+/*! \brief The default maximum number of bytes cached by each thread. */
+constexpr int64_t kDefaultMaxCachedBytes = 64 << 20;
+/*! \brief The maximum number of chunks cached by each thread for each size. */
+constexpr size_t kMaxChunksPerSize = 32;
+
+/*!
+ * \brief The chunks cached by a thread, grouped by their allocated sizes. The cache is only
+ * accessed by its owner thread, except when the pool is flushed or queried for statistics,
+ * so its lock is almost never contended.
+ */
+struct ThreadCache {
+  /*! \brief The cached chunks of each allocated size. */
+  std::unordered_map<int64_t, std::vector<std::shared_ptr<Memory>>> free_lists;
+  /*! \brief The total number of cached bytes. */
+  int64_t cached_bytes = 0;
+  /*! \brief The lock of this cache. */
+  std::mutex mu;
+};
+
+/*!
+ * \brief The state shared by the pool and the memory it hands out, so that the memory can be
+ * returned correctly even after the pool is removed from the pool manager.
+ */
+class ThreadCacheState : public std::enable_shared_from_this<ThreadCacheState> {
+ public:
+  ThreadCacheState(MemoryPool* inner, int64_t max_cached_bytes)
+      : inner_(inner), max_cached_bytes_(max_cached_bytes) {
+    static std::atomic<uint64_t> next_id{0};
+    id_ = next_id++;
+  }
+
+  /*! \brief Get the cache of the calling thread, creating it on first use. */
+  ThreadCache* GetThreadCache() {
+    thread_local uint64_t last_id = UINT64_MAX;
+    thread_local ThreadCache* last_cache = nullptr;
+    thread_local std::unordered_map<uint64_t, std::shared_ptr<ThreadCache>> caches;
+    if (last_id == id_) {
+      return last_cache;
+    }
+    auto& cache = caches[id_];
+    if (cache == nullptr) {
+      // The cache is destroyed when the thread exits, which returns its chunks to the inner pool
+      // under the lock of the inner pool if the pool is still alive.
+      std::weak_ptr<ThreadCacheState> weak_state = shared_from_this();
+      cache = std::shared_ptr<ThreadCache>(new ThreadCache(), [weak_state](ThreadCache* cache) {
+        if (auto state = weak_state.lock()) {
+          state->FlushCache(cache);
+        }
+        delete cache;
+      });
+      std::lock_guard<std::mutex> lock(registry_mu_);
+      // Drop the caches of the exited threads.
+      registry_.erase(std::remove_if(registry_.begin(), registry_.end(),
+                                     [](const std::weak_ptr<ThreadCache>& weak_cache) {
+                                       return weak_cache.expired();
+                                     }),
+                      registry_.end());
+      registry_.push_back(cache);
+    }
+    last_id = id_;
+    last_cache = cache.get();
+    return last_cache;
+  }
+
+  std::shared_ptr<Memory> Alloc(int64_t nbytes, int64_t size, int64_t alignment) {
+    ThreadCache* cache = GetThreadCache();
+    {
+      std::lock_guard<std::mutex> lock(cache->mu);
+      auto it = cache->free_lists.find(size);
+      if (it != cache->free_lists.end()) {
+        auto& chunks = it->second;
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+          if (reinterpret_cast<int64_t>((*chunk)->data) % alignment == 0) {
+            std::shared_ptr<Memory> mem = std::move(*chunk);
+            chunks.erase(std::next(chunk).base());
+            cache->cached_bytes -= size;
+            hits_++;
+            return mem;
+          }
+        }
+      }
+    }
+    misses_++;
+    std::lock_guard<std::mutex> lock(inner_mu_);
+    return inner_->Alloc(nbytes, alignment);
+  }
+
+  void Release(std::shared_ptr<Memory> mem, int64_t size, std::thread::id alloc_thread) {
+    if (closed_) {
+      std::lock_guard<std::mutex> lock(inner_mu_);
+      mem.reset();
+      return;
+    }
+    if (alloc_thread != std::this_thread::get_id()) {
+      cross_thread_frees_++;
+    }
+    ThreadCache* cache = GetThreadCache();
+    std::vector<std::shared_ptr<Memory>> batch;
+    {
+      std::lock_guard<std::mutex> lock(cache->mu);
+      auto& chunks = cache->free_lists[size];
+      if (chunks.size() >= kMaxChunksPerSize || cache->cached_bytes + size > max_cached_bytes_) {
+        // Return half of the chunks of this size, or all of them if they alone exceed the
+        // byte limit, to the inner pool in a batch.
+        size_t keep = cache->cached_bytes + size > max_cached_bytes_ ? 0 : chunks.size() / 2;
+        batch.assign(std::make_move_iterator(chunks.begin() + keep),
+                     std::make_move_iterator(chunks.end()));
+        chunks.resize(keep);
+        cache->cached_bytes -= size * static_cast<int64_t>(batch.size());
+      }
+      if (cache->cached_bytes + size <= max_cached_bytes_) {
+        chunks.push_back(std::move(mem));
+        cache->cached_bytes += size;
+      } else {
+        batch.push_back(std::move(mem));
+      }
+    }
+    if (!batch.empty()) {
+      batch_returns_++;
+      std::lock_guard<std::mutex> lock(inner_mu_);
+      batch.clear();
+    }
+  }
+
+  /*! \brief Return the chunks cached by a thread to the inner pool. */
+  void FlushCache(ThreadCache* cache) {
+    std::lock_guard<std::mutex> cache_lock(cache->mu);
+    std::lock_guard<std::mutex> inner_lock(inner_mu_);
+    cache->free_lists.clear();
+    cache->cached_bytes = 0;
+  }
+
+  /*! \brief Return the chunks cached by all threads to the inner pool. */
+  void Flush() {
+    std::lock_guard<std::mutex> lock(registry_mu_);
+    for (const auto& weak_cache : registry_) {
+      if (auto cache = weak_cache.lock()) {
+        FlushCache(cache.get());
+      }
+    }
+  }
+
+  /*! \brief Stop caching, and return the cached chunks to the inner pool. */
+  void Close() {
+    closed_ = true;
+    Flush();
+  }
+
+  int64_t GetAllocBytes(int64_t nbytes) {
+    // Rounding the size does not touch the state of the inner pool, so no lock is needed.
+    return inner_->GetAllocBytes(nbytes);
+  }
+
+  std::shared_ptr<Memory> AllocAsync(int64_t nbytes, void* stream, int64_t alignment) {
+    std::lock_guard<std::mutex> lock(inner_mu_);
+    return inner_->AllocAsync(nbytes, stream, alignment);
+  }
+
+  std::pair<float, float> GetPoolSize() {
+    std::lock_guard<std::mutex> lock(inner_mu_);
+    return inner_->GetPoolSize();
+  }
+
+  std::unordered_map<std::string, double> GetPoolStats() {
+    std::unordered_map<std::string, double> stats;
+    {
+      std::lock_guard<std::mutex> lock(inner_mu_);
+      stats = inner_->GetPoolStats();
+    }
+    int64_t cached_bytes = 0;
+    int64_t num_thread_caches = 0;
+    {
+      std::lock_guard<std::mutex> lock(registry_mu_);
+      for (const auto& weak_cache : registry_) {
+        if (auto cache = weak_cache.lock()) {
+          std::lock_guard<std::mutex> cache_lock(cache->mu);
+          cached_bytes += cache->cached_bytes;
+          num_thread_caches++;
+        }
+      }
+    }
+    stats["thread_cache_hits"] = hits_;
+    stats["thread_cache_misses"] = misses_;
+    stats["thread_cache_cross_thread_frees"] = cross_thread_frees_;
+    stats["thread_cache_batch_returns"] = batch_returns_;
+    stats["thread_cache_cached_bytes"] = cached_bytes;
+    stats["thread_cache_num_threads"] = num_thread_caches;
+    return stats;
+  }
+
+  std::string GetInnerName() {
+    return inner_->GetName();
+  }
+
+ private:
+  /*! \brief The unique ID of this state, used to look up the thread caches. */
+  uint64_t id_;
+  /*! \brief The inner pool, which is not assumed to be thread-safe. */
+  std::unique_ptr<MemoryPool> inner_;
+  /*! \brief The lock of the inner pool. */
+  std::mutex inner_mu_;
+  /*! \brief The maximum number of bytes cached by each thread. */
+  int64_t max_cached_bytes_;
+  /*! \brief The caches of all threads that used this pool. */
+  std::vector<std::weak_ptr<ThreadCache>> registry_;
+  /*! \brief The lock of the registry. */
+  std::mutex registry_mu_;
+  /*! \brief Whether the pool has been removed. */
+  std::atomic<bool> closed_{false};
+  /*! \brief The statistics. */
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> cross_thread_frees_{0};
+  std::atomic<int64_t> batch_returns_{0};
+};
+
+/*!
+ * \brief A wrapper of a chunk allocated from the inner pool. The chunk is put into the cache of
+ * the thread that releases it when the wrapper is destructed.
+ */
+class CachedMemory final : public Memory {
+ public:
+  explicit CachedMemory(std::shared_ptr<Memory> mem, int64_t size,
+                        std::shared_ptr<ThreadCacheState> state)
+      : mem_(std::move(mem)),
+        size_(size),
+        state_(std::move(state)),
+        alloc_thread_(std::this_thread::get_id()) {
+    this->data = mem_->data;
+    this->device = mem_->device;
+  }
+
+  ~CachedMemory() {
+    state_->Release(std::move(mem_), size_, alloc_thread_);
+  }
+
+ private:
+  /*! \brief The chunk allocated from the inner pool. */
+  std::shared_ptr<Memory> mem_;
+  /*! \brief The allocated size of the chunk. */
+  int64_t size_;
+  /*! \brief The state of the pool. */
+  std::shared_ptr<ThreadCacheState> state_;
+  /*! \brief The thread that allocated the chunk. */
+  std::thread::id alloc_thread_;
+};
+
+/*!
+ * \brief A Memory Pool that puts a per-thread cache in front of any other memory pool, so that
+ * concurrent VMs on different host threads do not serialize on one pool.
+ *
+ * Released chunks are kept in the cache of the releasing thread, grouped by their allocated
+ * sizes, and a request is first served from the cache of the requesting thread without
+ * touching the inner pool. The caches are bounded in the number of chunks per size and in the
+ * total bytes (RAF_THREAD_CACHE_MAX_BYTES). On overflow, half of the chunks of the size are
+ * returned to the inner pool in one batch.
+ *
+ * The pool is selected by prefixing the name of the inner pool with "thread_cache_pool:", e.g.,
+ * InitPool(dev, "thread_cache_pool:arena_pool").
+ *
+ * \sa ThreadCachePool
+ */
+class ThreadCachePool : public MemoryPool {
+ public:
+  explicit ThreadCachePool(MemoryPool* inner, int64_t max_cached_bytes) {
+    state_ = std::make_shared<ThreadCacheState>(inner, max_cached_bytes);
+  }
+
+  ~ThreadCachePool() {
+    state_->Close();
+  }
+
+  std::string GetName() {
+    return "thread_cache_pool:" + state_->GetInnerName();
+  }
+
+  int64_t GetAllocBytes(int64_t nbytes) override {
+    return state_->GetAllocBytes(nbytes);
+  }
+
+  std::shared_ptr<Memory> Alloc(int64_t nbytes, int64_t alignment) override {
+    CHECK_GE(nbytes, 0);
+    int64_t size = state_->GetAllocBytes(nbytes);
+    auto mem = state_->Alloc(nbytes, size, alignment);
+    if (mem->data == nullptr) {
+      return mem;
+    }
+    return std::make_shared<CachedMemory>(std::move(mem), size, state_);
+  }
+
+  std::shared_ptr<Memory> AllocAsync(int64_t nbytes, void* stream,
+                                     int64_t alignment = kDefaultMemoryAlignment) override {
+    return state_->AllocAsync(nbytes, stream, alignment);
+  }
+
+  std::vector<std::shared_ptr<Memory>> AllocBatch(const std::vector<int64_t>& nbytes,
+                                                  int64_t alignment) override {
+    std::vector<std::shared_ptr<Memory>> ret;
+    ret.reserve(nbytes.size());
+    for (int64_t bytes : nbytes) {
+      ret.emplace_back(Alloc(bytes, alignment));
+    }
+    return ret;
+  }
+
+  std::pair<float, float> GetPoolSize() override {
+    return state_->GetPoolSize();
+  }
+
+  std::unordered_map<std::string, double> GetPoolStats() override {
+    return state_->GetPoolStats();
+  }
+
+ public:
+  static void* wrap(void* inner) {
+    int64_t max_cached_bytes = kDefaultMaxCachedBytes;
+    if (const char* val = getenv("RAF_THREAD_CACHE_MAX_BYTES")) {
+      max_cached_bytes = atol(val);
+    }
+    return new ThreadCachePool(static_cast<MemoryPool*>(inner), max_cached_bytes);
+  }
+
+ private:
+  std::shared_ptr<ThreadCacheState> state_;
+};
+
+RAF_REGISTER_GLOBAL("raf.memory_pool._wrap.thread_cache_pool").set_body_typed([](void* inner) {
+  return ThreadCachePool::wrap(inner);
+});
+
+}  // namespace thread_cache_pool
+}  // namespace memory_pool
+}  // namespace raf
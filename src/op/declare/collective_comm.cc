@@ -8,6 +8,7 @@
  * \brief Declaration of collective communication operators
  */
 #include "raf/op.h"
+#include "raf/dialect.h"
 #include "raf/tensor.h"
 #include "raf/communicator.h"
 #include "../schema/communication.h"
@@ -209,7 +210,19 @@ RAF_OP_DECLARE("raf.op._send", Send)
 void Recv(const CallValues& call) {
   const auto* args = call->args.as<RecvArgs>();
   CHECK(args != nullptr);
-  Device dev(DevType::kCUDA(), GetGlobalCommunicator()->rank);
+  // The received tensor is on the device of the token, or of the current device scope.
+  // Otherwise, it is on the local GPU if a dialect receives on GPUs, e.g., NCCL, and on CPU by the
+  // shared-memory communicator if not.
+  Device dev = Device::Current();
+  if (args->token.defined()) {
+    const DLTensor* token = args->token.value();
+    dev = token->device;
+  } else if (dev.device_type() == DevType::kUnknown()) {
+    bool recv_on_gpu =
+        !OpDialect::GetDispatchList(Op::Get("raf.op._recv"), DevType::kCUDA()).empty();
+    dev = recv_on_gpu ? Device(DevType::kCUDA(), GetGlobalCommunicator()->local_rank)
+                      : Device(DevType::kCPU(), 0);
+  }
   call->device = dev;
   call->out = TensorValue::Assemble(/*ctx=*/dev,
                                     /*dtype=*/ir::String2DLDataType(args->dtype),
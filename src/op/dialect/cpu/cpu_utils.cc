@@ -0,0 +1,143 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/cpu_utils.cc
+ * \brief Native CPU dialect utils
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#endif
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/threading_backend.h>
+#include "raf/op.h"
+#include "raf/registry.h"
+#include "../../../common/shape_utils.h"
+#include "./cpu_utils.h"
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+RAF_REGISTER_DIALECT("cpu").set_enable(DevType::kCPU());
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+/*!
+ * \brief Whether the processor supports F16C, which is read from CPUID directly because older
+ * compilers do not accept "f16c" in __builtin_cpu_supports.
+ */
+bool HasF16C() {
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C);
+}
+#endif
+
+/*!
+ * \brief Whether the processor and the operating system support the instruction set. The
+ * kernels of an instruction set are compiled with -mf16c as well, so F16C is required too.
+ */
+bool IsISASupported(CPUISA isa) {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  switch (isa) {
+    case CPUISA::kAVX512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") &&
+             __builtin_cpu_supports("fma") && HasF16C();
+    case CPUISA::kAVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && HasF16C();
+    default:
+      return true;
+  }
+#else
+  return isa == CPUISA::kScalar;
+#endif
+}
+
+const CPUKernels* GetKernels(CPUISA isa) {
+  switch (isa) {
+    case CPUISA::kAVX512:
+      return GetAVX512Kernels();
+    case CPUISA::kAVX2:
+      return GetAVX2Kernels();
+    default:
+      return GetScalarKernels();
+  }
+}
+
+CPUISA DetectCPUISA() {
+  CPUISA max_isa = CPUISA::kAVX512;
+  if (const char* env = std::getenv("RAF_CPU_ISA")) {
+    std::string name(env);
+    if (name == "scalar") {
+      max_isa = CPUISA::kScalar;
+    } else if (name == "avx2") {
+      max_isa = CPUISA::kAVX2;
+    } else if (name != "avx512") {
+      LOG(WARNING) << "Unknown RAF_CPU_ISA " << name << ", which should be scalar, avx2 or avx512";
+    }
+  }
+  for (int isa = static_cast<int>(max_isa); isa > 0; --isa) {
+    if (GetKernels(static_cast<CPUISA>(isa)) != nullptr &&
+        IsISASupported(static_cast<CPUISA>(isa))) {
+      return static_cast<CPUISA>(isa);
+    }
+  }
+  return CPUISA::kScalar;
+}
+
+CPUISA GetCPUISA() {
+  static const CPUISA isa = DetectCPUISA();
+  return isa;
+}
+
+const CPUKernels& GetCPUKernels() {
+  static const CPUKernels* kernels = GetKernels(GetCPUISA());
+  return *kernels;
+}
+
+bool IsCompactFloat32(const DLTensor* x) {
+  return x->dtype.code == kDLFloat && x->dtype.bits == 32 && x->dtype.lanes == 1 &&
+         common::shape_utils::IsCompact(*x);
+}
+
+/*! \brief The closure of a parallel loop, which is passed to the TVM runtime thread pool. */
+struct ParallelForClosure {
+  int64_t n;
+  const std::function<void(int64_t, int64_t)>* func;
+};
+
+int ParallelForTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+  const auto* closure = static_cast<const ParallelForClosure*>(cdata);
+  int64_t begin = closure->n * task_id / penv->num_task;
+  int64_t end = closure->n * (task_id + 1) / penv->num_task;
+  if (begin < end) {
+    (*closure->func)(begin, end);
+  }
+  return 0;
+}
+
+void ParallelFor(int64_t n, int64_t grain, const std::function<void(int64_t, int64_t)>& func) {
+  static const int64_t max_tasks = tvm::runtime::threading::MaxConcurrency();
+  int64_t num_tasks = std::min(max_tasks, n / std::max<int64_t>(grain, 1));
+  if (num_tasks <= 1) {
+    if (n > 0) {
+      func(0, n);
+    }
+    return;
+  }
+  ParallelForClosure closure{n, &func};
+  TVMBackendParallelLaunch(ParallelForTask, &closure, static_cast<int>(num_tasks));
+}
+
+RAF_REGISTER_GLOBAL("raf.backend.cpu.GetISA").set_body_typed([]() -> std::string {
+  return GetCPUKernels().isa;
+});
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
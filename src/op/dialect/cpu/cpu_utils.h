@@ -0,0 +1,82 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/cpu_utils.h
+ * \brief Helper functions for the native CPU dialect
+ */
+#pragma once
+#include <dlpack/dlpack.h>
+#include <cstdint>
+#include <functional>
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+/*! \brief The instruction sets that the native CPU kernels are compiled for. */
+enum class CPUISA : int {
+  kScalar = 0,
+  kAVX2 = 1,
+  kAVX512 = 2,
+};
+
+/*!
+ * \brief The native CPU kernels compiled for one instruction set. The row kernels process a
+ * row-major float32 matrix of shape (rows, cols) and normalize each row independently.
+ */
+struct CPUKernels {
+  /*! \brief The name of the instruction set. */
+  const char* isa;
+  /*! \brief y = softmax(x) along the rows. */
+  void (*softmax)(const float* x, float* y, int64_t rows, int64_t cols);
+  /*! \brief y = log_softmax(x) along the rows. */
+  void (*log_softmax)(const float* x, float* y, int64_t rows, int64_t cols);
+  /*! \brief y = (x - mean) / sqrt(var + eps) * scale + bias along the rows. */
+  void (*layer_norm)(const float* x, const float* scale, const float* bias, float* y,
+                     int64_t rows, int64_t cols, float eps);
+  /*! \brief Convert float32 to the bits of float16 with round-to-nearest-even. */
+  void (*float_to_half)(const float* x, uint16_t* y, int64_t n);
+  /*! \brief Convert the bits of float16 to float32. */
+  void (*half_to_float)(const uint16_t* x, float* y, int64_t n);
+  /*! \brief Convert float32 to the bits of bfloat16 with round-to-nearest-even. */
+  void (*float_to_bfloat)(const float* x, uint16_t* y, int64_t n);
+  /*! \brief Convert the bits of bfloat16 to float32. */
+  void (*bfloat_to_float)(const uint16_t* x, float* y, int64_t n);
+};
+
+/*! \brief The portable kernels, which rely on the auto-vectorization of the baseline ISA. */
+const CPUKernels* GetScalarKernels();
+/*! \brief The AVX2 kernels, or nullptr if they are not compiled for this target. */
+const CPUKernels* GetAVX2Kernels();
+/*! \brief The AVX-512 kernels, or nullptr if they are not compiled for this target. */
+const CPUKernels* GetAVX512Kernels();
+
+/*!
+ * \brief Get the best instruction set that is both compiled and supported by the processor.
+ * It can be lowered with the environment variable RAF_CPU_ISA, e.g., RAF_CPU_ISA=avx2.
+ */
+CPUISA GetCPUISA();
+
+/*! \brief Get the kernels of the instruction set selected by GetCPUISA. */
+const CPUKernels& GetCPUKernels();
+
+/*! \brief The number of elements below which a task is too small to be worth a thread. */
+constexpr int64_t kParallelGrainSize = 16384;
+
+/*! \brief Whether the tensor is a compact float32 tensor. */
+bool IsCompactFloat32(const DLTensor* x);
+
+/*!
+ * \brief Split [0, n) into contiguous ranges and process them with the TVM runtime thread pool.
+ * \param n The number of items.
+ * \param grain The minimal number of items in a range, below which the loop runs serially.
+ * \param func The function to process the items in [begin, end).
+ */
+void ParallelFor(int64_t n, int64_t grain, const std::function<void(int64_t, int64_t)>& func);
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
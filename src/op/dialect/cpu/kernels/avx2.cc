@@ -0,0 +1,33 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/kernels/avx2.cc
+ * \brief The AVX2 native CPU kernels, which are compiled with -mavx2 -mfma -mf16c on x86
+ */
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#define RAF_CPU_ISA avx2
+#define RAF_CPU_ISA_NAME "avx2"
+#define RAF_CPU_ISA_LEVEL 1
+#include "./kernels_impl.h"
+#else
+#include "../cpu_utils.h"
+#endif
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+const CPUKernels* GetAVX2Kernels() {
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+  return &avx2::kKernels;
+#else
+  return nullptr;
+#endif
+}
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
@@ -0,0 +1,33 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/kernels/avx512.cc
+ * \brief The AVX-512 native CPU kernels, which are compiled with -mavx512f on x86
+ */
+#if defined(__AVX512F__)
+#define RAF_CPU_ISA avx512
+#define RAF_CPU_ISA_NAME "avx512"
+#define RAF_CPU_ISA_LEVEL 2
+#include "./kernels_impl.h"
+#else
+#include "../cpu_utils.h"
+#endif
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+const CPUKernels* GetAVX512Kernels() {
+#if defined(__AVX512F__)
+  return &avx512::kKernels;
+#else
+  return nullptr;
+#endif
+}
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
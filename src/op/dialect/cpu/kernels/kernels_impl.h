@@ -0,0 +1,515 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/kernels/kernels_impl.h
+ * \brief The native CPU kernels, which are compiled once per instruction set. The including file
+ * defines RAF_CPU_ISA (the namespace of this copy), RAF_CPU_ISA_NAME and RAF_CPU_ISA_LEVEL
+ * (0: scalar, 1: AVX2, 2: AVX-512), and is compiled with the matching target flags.
+ * Everything here has internal linkage, so the linker never mixes up the code of different
+ * instruction sets. For the same reason, only C math functions are used instead of the inline
+ * functions and templates of the C++ standard library.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#if RAF_CPU_ISA_LEVEL > 0
+#include <immintrin.h>
+#endif
+#include "../cpu_utils.h"
+
+namespace raf {
+namespace op {
+namespace cpu {
+namespace RAF_CPU_ISA {
+namespace {
+
+/*! \brief A single float, which also handles the remainder of the vector loops. */
+struct ScalarVec {
+  static constexpr int kLanes = 1;
+  float v;
+  static ScalarVec Load(const float* p) {
+    return {*p};
+  }
+  static ScalarVec Set1(float x) {
+    return {x};
+  }
+  void Store(float* p) const {
+    *p = v;
+  }
+};
+
+inline ScalarVec operator+(ScalarVec a, ScalarVec b) {
+  return {a.v + b.v};
+}
+inline ScalarVec operator-(ScalarVec a, ScalarVec b) {
+  return {a.v - b.v};
+}
+inline ScalarVec operator*(ScalarVec a, ScalarVec b) {
+  return {a.v * b.v};
+}
+inline ScalarVec Max(ScalarVec a, ScalarVec b) {
+  return {a.v > b.v ? a.v : b.v};
+}
+inline ScalarVec Min(ScalarVec a, ScalarVec b) {
+  return {a.v < b.v ? a.v : b.v};
+}
+inline ScalarVec FMA(ScalarVec a, ScalarVec b, ScalarVec c) {
+  return {a.v * b.v + c.v};
+}
+inline ScalarVec Round(ScalarVec a) {
+  // Adding and subtracting 1.5 * 2^23 rounds to the nearest integer for |a| < 2^22.
+  const float magic = 12582912.0f;
+  return {(a.v + magic) - magic};
+}
+inline ScalarVec Pow2n(ScalarVec n) {
+  uint32_t bits = static_cast<uint32_t>(static_cast<int32_t>(n.v) + 127) << 23;
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return {ret};
+}
+inline float ReduceAdd(ScalarVec a) {
+  return a.v;
+}
+inline float ReduceMax(ScalarVec a) {
+  return a.v;
+}
+
+#if RAF_CPU_ISA_LEVEL == 1
+/*! \brief Eight floats in an AVX2 register. */
+struct Vec8 {
+  static constexpr int kLanes = 8;
+  __m256 v;
+  static Vec8 Load(const float* p) {
+    return {_mm256_loadu_ps(p)};
+  }
+  static Vec8 Set1(float x) {
+    return {_mm256_set1_ps(x)};
+  }
+  void Store(float* p) const {
+    _mm256_storeu_ps(p, v);
+  }
+};
+
+inline Vec8 operator+(Vec8 a, Vec8 b) {
+  return {_mm256_add_ps(a.v, b.v)};
+}
+inline Vec8 operator-(Vec8 a, Vec8 b) {
+  return {_mm256_sub_ps(a.v, b.v)};
+}
+inline Vec8 operator*(Vec8 a, Vec8 b) {
+  return {_mm256_mul_ps(a.v, b.v)};
+}
+inline Vec8 Max(Vec8 a, Vec8 b) {
+  return {_mm256_max_ps(a.v, b.v)};
+}
+inline Vec8 Min(Vec8 a, Vec8 b) {
+  return {_mm256_min_ps(a.v, b.v)};
+}
+inline Vec8 FMA(Vec8 a, Vec8 b, Vec8 c) {
+  return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+}
+inline Vec8 Round(Vec8 a) {
+  return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline Vec8 Pow2n(Vec8 n) {
+  __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+  return {_mm256_castsi256_ps(_mm256_slli_epi32(e, 23))};
+}
+inline float ReduceAdd(Vec8 a) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+inline float ReduceMax(Vec8 a) {
+  __m128 s = _mm_max_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+using Vec = Vec8;
+#elif RAF_CPU_ISA_LEVEL == 2
+/*! \brief Sixteen floats in an AVX-512 register. */
+struct Vec16 {
+  static constexpr int kLanes = 16;
+  __m512 v;
+  static Vec16 Load(const float* p) {
+    return {_mm512_loadu_ps(p)};
+  }
+  static Vec16 Set1(float x) {
+    return {_mm512_set1_ps(x)};
+  }
+  void Store(float* p) const {
+    _mm512_storeu_ps(p, v);
+  }
+};
+
+inline Vec16 operator+(Vec16 a, Vec16 b) {
+  return {_mm512_add_ps(a.v, b.v)};
+}
+inline Vec16 operator-(Vec16 a, Vec16 b) {
+  return {_mm512_sub_ps(a.v, b.v)};
+}
+inline Vec16 operator*(Vec16 a, Vec16 b) {
+  return {_mm512_mul_ps(a.v, b.v)};
+}
+inline Vec16 Max(Vec16 a, Vec16 b) {
+  return {_mm512_max_ps(a.v, b.v)};
+}
+inline Vec16 Min(Vec16 a, Vec16 b) {
+  return {_mm512_min_ps(a.v, b.v)};
+}
+inline Vec16 FMA(Vec16 a, Vec16 b, Vec16 c) {
+  return {_mm512_fmadd_ps(a.v, b.v, c.v)};
+}
+inline Vec16 Round(Vec16 a) {
+  return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline Vec16 Pow2n(Vec16 n) {
+  __m512i e = _mm512_add_epi32(_mm512_cvtps_epi32(n.v), _mm512_set1_epi32(127));
+  return {_mm512_castsi512_ps(_mm512_slli_epi32(e, 23))};
+}
+inline float ReduceAdd(Vec16 a) {
+  return _mm512_reduce_add_ps(a.v);
+}
+inline float ReduceMax(Vec16 a) {
+  return _mm512_reduce_max_ps(a.v);
+}
+
+using Vec = Vec16;
+#else
+using Vec = ScalarVec;
+#endif
+
+/*!
+ * \brief exp(x) with the Cephes polynomial, accurate to a few ulps. The input is clamped so that
+ * the result is a normal float.
+ */
+template <typename V>
+inline V Exp(V x) {
+  x = Min(Max(x, V::Set1(-87.3f)), V::Set1(88.0f));
+  V n = Round(x * V::Set1(1.44269504088896341f));
+  V r = FMA(n, V::Set1(-0.693359375f), x);
+  r = FMA(n, V::Set1(2.12194440e-4f), r);
+  V p = V::Set1(1.9875691500e-4f);
+  p = FMA(p, r, V::Set1(1.3981999507e-3f));
+  p = FMA(p, r, V::Set1(8.3334519073e-3f));
+  p = FMA(p, r, V::Set1(4.1665795894e-2f));
+  p = FMA(p, r, V::Set1(1.6666665459e-1f));
+  p = FMA(p, r, V::Set1(5.0000001201e-1f));
+  p = FMA(p, r * r, r + V::Set1(1.0f));
+  return p * Pow2n(n);
+}
+
+/*! \brief The maximum of a row, with four accumulators to hide the latency. */
+inline float RowMax(const float* x, int64_t n) {
+  const int64_t lanes = Vec::kLanes;
+  int64_t i = 0;
+  float ret = -INFINITY;
+  if (n >= 4 * lanes) {
+    Vec m0 = Vec::Load(x), m1 = Vec::Load(x + lanes);
+    Vec m2 = Vec::Load(x + 2 * lanes), m3 = Vec::Load(x + 3 * lanes);
+    for (i = 4 * lanes; i + 4 * lanes <= n; i += 4 * lanes) {
+      m0 = Max(m0, Vec::Load(x + i));
+      m1 = Max(m1, Vec::Load(x + i + lanes));
+      m2 = Max(m2, Vec::Load(x + i + 2 * lanes));
+      m3 = Max(m3, Vec::Load(x + i + 3 * lanes));
+    }
+    ret = ReduceMax(Max(Max(m0, m1), Max(m2, m3)));
+  }
+  for (; i < n; ++i) {
+    ret = x[i] > ret ? x[i] : ret;
+  }
+  return ret;
+}
+
+/*! \brief The sum of a row, with four accumulators to hide the latency. */
+inline float RowSum(const float* x, int64_t n) {
+  const int64_t lanes = Vec::kLanes;
+  int64_t i = 0;
+  float ret = 0.0f;
+  if (n >= 4 * lanes) {
+    Vec s0 = Vec::Load(x), s1 = Vec::Load(x + lanes);
+    Vec s2 = Vec::Load(x + 2 * lanes), s3 = Vec::Load(x + 3 * lanes);
+    for (i = 4 * lanes; i + 4 * lanes <= n; i += 4 * lanes) {
+      s0 = s0 + Vec::Load(x + i);
+      s1 = s1 + Vec::Load(x + i + lanes);
+      s2 = s2 + Vec::Load(x + i + 2 * lanes);
+      s3 = s3 + Vec::Load(x + i + 3 * lanes);
+    }
+    ret = ReduceAdd((s0 + s1) + (s2 + s3));
+  }
+  for (; i < n; ++i) {
+    ret += x[i];
+  }
+  return ret;
+}
+
+/*! \brief The sum of exp(x - max) of a row, which is also written to y if it is not nullptr. */
+inline float RowSumExp(const float* x, float* y, int64_t n, float max) {
+  const int64_t lanes = Vec::kLanes;
+  Vec vmax = Vec::Set1(max), acc = Vec::Set1(0.0f);
+  int64_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    Vec e = Exp(Vec::Load(x + i) - vmax);
+    if (y != nullptr) {
+      e.Store(y + i);
+    }
+    acc = acc + e;
+  }
+  float ret = ReduceAdd(acc);
+  for (; i < n; ++i) {
+    float e = Exp(ScalarVec{x[i] - max}).v;
+    if (y != nullptr) {
+      y[i] = e;
+    }
+    ret += e;
+  }
+  return ret;
+}
+
+void Softmax(const float* x, float* y, int64_t rows, int64_t cols) {
+  const int64_t lanes = Vec::kLanes;
+  for (int64_t r = 0; r < rows; ++r) {
+    const float* xr = x + r * cols;
+    float* yr = y + r * cols;
+    float sum = RowSumExp(xr, yr, cols, RowMax(xr, cols));
+    float inv = 1.0f / sum;
+    Vec vinv = Vec::Set1(inv);
+    int64_t i = 0;
+    for (; i + lanes <= cols; i += lanes) {
+      (Vec::Load(yr + i) * vinv).Store(yr + i);
+    }
+    for (; i < cols; ++i) {
+      yr[i] *= inv;
+    }
+  }
+}
+
+void LogSoftmax(const float* x, float* y, int64_t rows, int64_t cols) {
+  const int64_t lanes = Vec::kLanes;
+  for (int64_t r = 0; r < rows; ++r) {
+    const float* xr = x + r * cols;
+    float* yr = y + r * cols;
+    float max = RowMax(xr, cols);
+    float lse = max + logf(RowSumExp(xr, nullptr, cols, max));
+    Vec vlse = Vec::Set1(lse);
+    int64_t i = 0;
+    for (; i + lanes <= cols; i += lanes) {
+      (Vec::Load(xr + i) - vlse).Store(yr + i);
+    }
+    for (; i < cols; ++i) {
+      yr[i] = xr[i] - lse;
+    }
+  }
+}
+
+void LayerNorm(const float* x, const float* scale, const float* bias, float* y, int64_t rows,
+               int64_t cols, float eps) {
+  const int64_t lanes = Vec::kLanes;
+  for (int64_t r = 0; r < rows; ++r) {
+    const float* xr = x + r * cols;
+    float* yr = y + r * cols;
+    float mean = RowSum(xr, cols) / cols;
+    // Two passes over the row, which is in cache, are more accurate than E[x^2] - E[x]^2.
+    Vec vmean = Vec::Set1(mean), acc = Vec::Set1(0.0f);
+    int64_t i = 0;
+    for (; i + lanes <= cols; i += lanes) {
+      Vec d = Vec::Load(xr + i) - vmean;
+      acc = FMA(d, d, acc);
+    }
+    float var = ReduceAdd(acc);
+    for (; i < cols; ++i) {
+      var += (xr[i] - mean) * (xr[i] - mean);
+    }
+    float rstd = 1.0f / sqrtf(var / cols + eps);
+    Vec vrstd = Vec::Set1(rstd);
+    i = 0;
+    if (scale != nullptr) {
+      for (; i + lanes <= cols; i += lanes) {
+        Vec norm = (Vec::Load(xr + i) - vmean) * vrstd;
+        FMA(norm, Vec::Load(scale + i), Vec::Load(bias + i)).Store(yr + i);
+      }
+      for (; i < cols; ++i) {
+        yr[i] = (xr[i] - mean) * rstd * scale[i] + bias[i];
+      }
+    } else {
+      for (; i + lanes <= cols; i += lanes) {
+        ((Vec::Load(xr + i) - vmean) * vrstd).Store(yr + i);
+      }
+      for (; i < cols; ++i) {
+        yr[i] = (xr[i] - mean) * rstd;
+      }
+    }
+  }
+}
+
+inline uint32_t FloatBits(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline float BitsToFloat(uint32_t bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+inline uint16_t FloatToHalf(float f) {
+  uint32_t x = FloatBits(f);
+  uint16_t sign = (x >> 16) & 0x8000;
+  x &= 0x7FFFFFFF;
+  if (x >= 0x7F800000) {
+    // Inf or NaN.
+    return sign | (x > 0x7F800000 ? 0x7E00 : 0x7C00);
+  }
+  if (x >= 0x477FF000) {
+    // Round to inf.
+    return sign | 0x7C00;
+  }
+  if (x < 0x38800000) {
+    // Subnormal or zero: let the float adder round the mantissa.
+    const uint32_t magic = 126u << 23;
+    return sign | static_cast<uint16_t>(FloatBits(BitsToFloat(x) + BitsToFloat(magic)) - magic);
+  }
+  uint32_t mant_odd = (x >> 13) & 1;
+  x += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + mant_odd;
+  return sign | static_cast<uint16_t>(x >> 13);
+}
+
+inline float HalfToFloat(uint16_t h) {
+  const uint32_t shifted_exp = 0x7C00u << 13;
+  uint32_t o = (h & 0x7FFFu) << 13;
+  uint32_t exp = shifted_exp & o;
+  o += static_cast<uint32_t>(127 - 15) << 23;
+  if (exp == shifted_exp) {
+    // Inf or NaN.
+    o += static_cast<uint32_t>(128 - 16) << 23;
+  } else if (exp == 0) {
+    // Subnormal or zero: renormalize with the float subtractor.
+    o += 1u << 23;
+    o = FloatBits(BitsToFloat(o) - BitsToFloat(113u << 23));
+  }
+  return BitsToFloat(o | (static_cast<uint32_t>(h & 0x8000u) << 16));
+}
+
+inline uint16_t FloatToBFloat(float f) {
+  uint32_t x = FloatBits(f);
+  if ((x & 0x7FFFFFFF) > 0x7F800000) {
+    // Keep NaN quiet.
+    return static_cast<uint16_t>((x >> 16) | 0x40);
+  }
+  return static_cast<uint16_t>((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+}
+
+inline float BFloatToFloat(uint16_t h) {
+  return BitsToFloat(static_cast<uint32_t>(h) << 16);
+}
+
+void FloatToHalfArray(const float* x, uint16_t* y, int64_t n) {
+  int64_t i = 0;
+#if RAF_CPU_ISA_LEVEL == 1
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i), h);
+  }
+#elif RAF_CPU_ISA_LEVEL == 2
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), h);
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = FloatToHalf(x[i]);
+  }
+}
+
+void HalfToFloatArray(const uint16_t* x, float* y, int64_t n) {
+  int64_t i = 0;
+#if RAF_CPU_ISA_LEVEL == 1
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+    _mm256_storeu_ps(y + i, _mm256_cvtph_ps(h));
+  }
+#elif RAF_CPU_ISA_LEVEL == 2
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    _mm512_storeu_ps(y + i, _mm512_cvtph_ps(h));
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = HalfToFloat(x[i]);
+  }
+}
+
+void FloatToBFloatArray(const float* x, uint16_t* y, int64_t n) {
+  int64_t i = 0;
+#if RAF_CPU_ISA_LEVEL == 1
+  const __m256i bias = _mm256_set1_epi32(0x7FFF), one = _mm256_set1_epi32(1);
+  const __m256i quiet = _mm256_set1_epi32(0x40);
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(x + i);
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i high = _mm256_srli_epi32(bits, 16);
+    __m256i odd = _mm256_and_si256(high, one);
+    __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(bits, bias), odd), 16);
+    __m256i is_nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(high, quiet), is_nan);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(rounded),
+                                      _mm256_extracti128_si256(rounded, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i), packed);
+  }
+#elif RAF_CPU_ISA_LEVEL == 2
+  const __m512i bias = _mm512_set1_epi32(0x7FFF), one = _mm512_set1_epi32(1);
+  const __m512i quiet = _mm512_set1_epi32(0x40);
+  for (; i + 16 <= n; i += 16) {
+    __m512 v = _mm512_loadu_ps(x + i);
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i high = _mm512_srli_epi32(bits, 16);
+    __m512i odd = _mm512_and_si512(high, one);
+    __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(_mm512_add_epi32(bits, bias), odd), 16);
+    __mmask16 is_nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    rounded = _mm512_mask_blend_epi32(is_nan, rounded, _mm512_or_si512(high, quiet));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), _mm512_cvtepi32_epi16(rounded));
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = FloatToBFloat(x[i]);
+  }
+}
+
+void BFloatToFloatArray(const uint16_t* x, float* y, int64_t n) {
+  int64_t i = 0;
+#if RAF_CPU_ISA_LEVEL == 1
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+    _mm256_storeu_ps(y + i, _mm256_castsi256_ps(bits));
+  }
+#elif RAF_CPU_ISA_LEVEL == 2
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    __m512i bits = _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16);
+    _mm512_storeu_ps(y + i, _mm512_castsi512_ps(bits));
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = BFloatToFloat(x[i]);
+  }
+}
+
+const CPUKernels kKernels = {
+    RAF_CPU_ISA_NAME, Softmax,          LogSoftmax,         LayerNorm,
+    FloatToHalfArray, HalfToFloatArray, FloatToBFloatArray, BFloatToFloatArray,
+};
+
+}  // namespace
+}  // namespace RAF_CPU_ISA
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
@@ -0,0 +1,25 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/kernels/scalar.cc
+ * \brief The portable native CPU kernels
+ */
+#define RAF_CPU_ISA scalar
+#define RAF_CPU_ISA_NAME "scalar"
+#define RAF_CPU_ISA_LEVEL 0
+#include "./kernels_impl.h"
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+const CPUKernels* GetScalarKernels() {
+  return &scalar::kKernels;
+}
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
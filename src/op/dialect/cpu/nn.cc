@@ -0,0 +1,179 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/nn.cc
+ * \brief Native CPU backend of softmax, log_softmax and layer_norm
+ */
+#include "raf/op.h"
+#include "../../schema/nn.h"
+#include "../../../common/shape_utils.h"
+#include "./cpu_utils.h"
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+using namespace raf::value;
+
+/*!
+ * \brief View x as a (rows, cols) matrix that is normalized along the rows.
+ * \return Whether x is a compact float32 tensor and axis is its last axis.
+ */
+bool GetRowMatrix(const DLTensor* x, int64_t axis, int64_t* rows, int64_t* cols) {
+  if (!IsCompactFloat32(x) || x->ndim == 0) {
+    return false;
+  }
+  axis = axis < 0 ? axis + x->ndim : axis;
+  if (axis != x->ndim - 1) {
+    return false;
+  }
+  *cols = x->shape[axis];
+  *rows = 1;
+  for (int i = 0; i < axis; ++i) {
+    *rows *= x->shape[i];
+  }
+  return *cols > 0;
+}
+
+class SoftmaxImpl : public raf::op::OpEnv {
+ public:
+  explicit SoftmaxImpl(const CallValues& cv, bool log) : log_(log) {
+    static auto fschema_index =
+        ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    static auto softmax_op = ir::Op::Get("raf.op.softmax");
+    static auto log_softmax_op = ir::Op::Get("raf.op.log_softmax");
+    auto args = cv->args.as<op::schema::SoftmaxArgs>();
+    this->arg_indices = {fschema_index[log ? log_softmax_op : softmax_op]("x")};
+    DLTensor* x = args->x;
+    if (!GetRowMatrix(x, args->axis, &rows_, &cols_)) {
+      error_msgs.push_back("[CPU] Only supports compact float32 tensors along the last axis");
+    }
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<op::schema::SoftmaxArgs>();
+    Execute(std::vector<Value>{args->x}, cv->out);
+  }
+
+  void Execute(const std::vector<Value>& inputs, Value output) override {
+    DLTensor* x = ir::Downcast<TensorValue>(inputs[0]);
+    DLTensor* out = ir::Downcast<TensorValue>(output);
+    const float* x_p = static_cast<const float*>(x->data);
+    float* out_p = static_cast<float*>(out->data);
+    auto kernel = log_ ? GetCPUKernels().log_softmax : GetCPUKernels().softmax;
+    int64_t cols = cols_;
+    ParallelFor(rows_, kParallelGrainSize / cols_ + 1, [&](int64_t begin, int64_t end) {
+      kernel(x_p + begin * cols, out_p + begin * cols, end - begin, cols);
+    });
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName(log_ ? "raf.op.cpu.log_softmax" : "raf.op.cpu.softmax"));
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SoftmaxImpl(cv, false);
+  }
+
+  static OpEnv* make_log(const CallValues& cv) {
+    return new SoftmaxImpl(cv, true);
+  }
+
+ private:
+  bool log_;
+  int64_t rows_ = 0;
+  int64_t cols_ = 0;
+};
+
+RAF_REGISTER_DIALECT_OP(cpu, softmax, 20);
+RAF_OP_ENV_MAKER("raf.op.cpu.softmax", SoftmaxImpl::make);
+RAF_REGISTER_DIALECT_OP(cpu, log_softmax, 20);
+RAF_OP_ENV_MAKER("raf.op.cpu.log_softmax", SoftmaxImpl::make_log);
+
+class LayerNormImpl : public raf::op::OpEnv {
+ public:
+  explicit LayerNormImpl(const CallValues& cv) {
+    static auto fschema_index =
+        ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    static auto layer_norm_op = ir::Op::Get("raf.op.layer_norm");
+    auto args = cv->args.as<op::schema::LayerNormArgs>();
+    this->arg_indices = {fschema_index[layer_norm_op]("x")};
+    eps_ = args->eps;
+    DLTensor* x = args->x;
+    if (!GetRowMatrix(x, args->axis, &rows_, &cols_)) {
+      error_msgs.push_back("[CPU] Only supports compact float32 tensors along the last axis");
+      return;
+    }
+    if (args->scale.defined() != args->bias.defined()) {
+      error_msgs.push_back("[CPU] Scale and bias must be both given or both omitted");
+      return;
+    }
+    with_scale_bias_ = args->scale.defined();
+    if (with_scale_bias_) {
+      for (auto param : {args->scale.value(), args->bias.value()}) {
+        DLTensor* p = param;
+        if (!IsCompactFloat32(p) || p->ndim != 1 || p->shape[0] != cols_) {
+          error_msgs.push_back("[CPU] Scale and bias must be compact float32 vectors");
+          return;
+        }
+      }
+      this->arg_indices.push_back(fschema_index[layer_norm_op]("scale"));
+      this->arg_indices.push_back(fschema_index[layer_norm_op]("bias"));
+    }
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<op::schema::LayerNormArgs>();
+    std::vector<Value> inputs{args->x};
+    if (with_scale_bias_) {
+      inputs.push_back(args->scale.value());
+      inputs.push_back(args->bias.value());
+    }
+    Execute(inputs, cv->out);
+  }
+
+  void Execute(const std::vector<Value>& inputs, Value output) override {
+    DLTensor* x = ir::Downcast<TensorValue>(inputs[0]);
+    DLTensor* out = ir::Downcast<TensorValue>(output);
+    const float* x_p = static_cast<const float*>(x->data);
+    const float* scale_p = nullptr;
+    const float* bias_p = nullptr;
+    if (with_scale_bias_) {
+      DLTensor* scale = ir::Downcast<TensorValue>(inputs[1]);
+      DLTensor* bias = ir::Downcast<TensorValue>(inputs[2]);
+      scale_p = static_cast<const float*>(scale->data);
+      bias_p = static_cast<const float*>(bias->data);
+    }
+    float* out_p = static_cast<float*>(out->data);
+    auto kernel = GetCPUKernels().layer_norm;
+    int64_t cols = cols_;
+    float eps = eps_;
+    ParallelFor(rows_, kParallelGrainSize / cols_ + 1, [&](int64_t begin, int64_t end) {
+      kernel(x_p + begin * cols, scale_p, bias_p, out_p + begin * cols, end - begin, cols, eps);
+    });
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.cpu.layer_norm"));
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new LayerNormImpl(cv);
+  }
+
+ private:
+  double eps_;
+  bool with_scale_bias_ = false;
+  int64_t rows_ = 0;
+  int64_t cols_ = 0;
+};
+
+RAF_REGISTER_DIALECT_OP(cpu, layer_norm, 20);
+RAF_OP_ENV_MAKER("raf.op.cpu.layer_norm", LayerNormImpl::make);
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
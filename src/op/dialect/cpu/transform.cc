@@ -0,0 +1,232 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/cpu/transform.cc
+ * \brief Native CPU backend of embedding and cast
+ */
+#include <cstring>
+#include "raf/op.h"
+#include "../../schema/nn.h"
+#include "../../schema/transform.h"
+#include "../../../common/shape_utils.h"
+#include "./cpu_utils.h"
+
+namespace raf {
+namespace op {
+namespace cpu {
+
+using namespace raf::value;
+using common::shape_utils::BytesCompactTensor;
+using common::shape_utils::IsCompact;
+
+int64_t NumElements(const DLTensor* x) {
+  int64_t n = 1;
+  for (int i = 0; i < x->ndim; ++i) {
+    n *= x->shape[i];
+  }
+  return n;
+}
+
+/*! \brief Copy the rows of the table in the order of the indices, which are clipped as take. */
+template <typename IndexType>
+void GatherRows(const char* table, int64_t num_rows, int64_t row_bytes, const IndexType* indices,
+                int64_t num_indices, char* out) {
+  ParallelFor(num_indices, kParallelGrainSize * 4 / row_bytes + 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      int64_t index = static_cast<int64_t>(indices[i]);
+      index = index < 0 ? 0 : (index >= num_rows ? num_rows - 1 : index);
+      std::memcpy(out + i * row_bytes, table + index * row_bytes, row_bytes);
+    }
+  });
+}
+
+class EmbeddingImpl : public raf::op::OpEnv {
+ public:
+  explicit EmbeddingImpl(const CallValues& cv) {
+    static auto fschema_index =
+        ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    static auto op = ir::Op::Get("raf.op.embedding");
+    auto args = cv->args.as<op::schema::EmbeddingArgs>();
+    this->arg_indices = {
+        fschema_index[op]("x"),
+        fschema_index[op]("indices"),
+    };
+    DLTensor* x = args->x;
+    DLTensor* indices = args->indices;
+    if (x->ndim == 0 || x->shape[0] == 0 || !IsCompact(*x) || !IsCompact(*indices) ||
+        indices->dtype.code != kDLInt || (indices->dtype.bits != 32 && indices->dtype.bits != 64)) {
+      error_msgs.push_back("[CPU] Only supports compact tables and int32 or int64 indices");
+    }
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<op::schema::EmbeddingArgs>();
+    Execute(std::vector<Value>{args->x, args->indices}, cv->out);
+  }
+
+  void Execute(const std::vector<Value>& inputs, Value output) override {
+    DLTensor* x = ir::Downcast<TensorValue>(inputs[0]);
+    DLTensor* indices = ir::Downcast<TensorValue>(inputs[1]);
+    DLTensor* out = ir::Downcast<TensorValue>(output);
+    int64_t row_bytes = BytesCompactTensor(*x) / x->shape[0];
+    if (row_bytes == 0) {
+      return;
+    }
+    const char* table = static_cast<const char*>(x->data);
+    char* out_p = static_cast<char*>(out->data);
+    if (indices->dtype.bits == 64) {
+      GatherRows(table, x->shape[0], row_bytes, static_cast<const int64_t*>(indices->data),
+                 NumElements(indices), out_p);
+    } else {
+      GatherRows(table, x->shape[0], row_bytes, static_cast<const int32_t*>(indices->data),
+                 NumElements(indices), out_p);
+    }
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.cpu.embedding"));
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new EmbeddingImpl(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(cpu, embedding, 20);
+RAF_OP_ENV_MAKER("raf.op.cpu.embedding", EmbeddingImpl::make);
+
+/*! \brief Convert n elements from the input to the output. */
+using FCastArray = std::function<void(const void* in, void* out, int64_t n)>;
+
+template <typename From, typename To>
+void CastArray(const void* in, void* out, int64_t n) {
+  const From* __restrict__ src = static_cast<const From*>(in);
+  To* __restrict__ dst = static_cast<To*>(out);
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = static_cast<To>(src[i]);
+  }
+}
+
+/*! \brief The index of the numeric types that are converted by static_cast, or -1. */
+int NumericTypeIndex(DLDataType dtype) {
+  if (dtype.lanes != 1) {
+    return -1;
+  }
+  if (dtype.code == kDLFloat) {
+    return dtype.bits == 32 ? 0 : (dtype.bits == 64 ? 1 : -1);
+  } else if (dtype.code == kDLInt) {
+    return dtype.bits == 8 ? 2 : (dtype.bits == 32 ? 3 : (dtype.bits == 64 ? 4 : -1));
+  } else if (dtype.code == kDLUInt) {
+    return dtype.bits == 8 ? 5 : -1;
+  }
+  return -1;
+}
+
+template <typename From>
+FCastArray GetCastArrayFrom(int to) {
+  static const FCastArray casts[] = {CastArray<From, float>,  CastArray<From, double>,
+                                     CastArray<From, int8_t>, CastArray<From, int32_t>,
+                                     CastArray<From, int64_t>, CastArray<From, uint8_t>};
+  return casts[to];
+}
+
+/*! \brief Get the conversion between two data types, or nullptr if it is not supported. */
+FCastArray GetCastArray(DLDataType from, DLDataType to) {
+  const auto& kernels = GetCPUKernels();
+  bool from_f32 = NumericTypeIndex(from) == 0, to_f32 = NumericTypeIndex(to) == 0;
+  if (from_f32 && to.code == kDLFloat && to.bits == 16 && to.lanes == 1) {
+    return [&kernels](const void* in, void* out, int64_t n) {
+      kernels.float_to_half(static_cast<const float*>(in), static_cast<uint16_t*>(out), n);
+    };
+  } else if (to_f32 && from.code == kDLFloat && from.bits == 16 && from.lanes == 1) {
+    return [&kernels](const void* in, void* out, int64_t n) {
+      kernels.half_to_float(static_cast<const uint16_t*>(in), static_cast<float*>(out), n);
+    };
+  } else if (from_f32 && to.code == kDLBfloat && to.bits == 16 && to.lanes == 1) {
+    return [&kernels](const void* in, void* out, int64_t n) {
+      kernels.float_to_bfloat(static_cast<const float*>(in), static_cast<uint16_t*>(out), n);
+    };
+  } else if (to_f32 && from.code == kDLBfloat && from.bits == 16 && from.lanes == 1) {
+    return [&kernels](const void* in, void* out, int64_t n) {
+      kernels.bfloat_to_float(static_cast<const uint16_t*>(in), static_cast<float*>(out), n);
+    };
+  }
+  int from_index = NumericTypeIndex(from), to_index = NumericTypeIndex(to);
+  if (to_index == -1) {
+    return nullptr;
+  }
+  switch (from_index) {
+    case 0:
+      return GetCastArrayFrom<float>(to_index);
+    case 1:
+      return GetCastArrayFrom<double>(to_index);
+    case 2:
+      return GetCastArrayFrom<int8_t>(to_index);
+    case 3:
+      return GetCastArrayFrom<int32_t>(to_index);
+    case 4:
+      return GetCastArrayFrom<int64_t>(to_index);
+    case 5:
+      return GetCastArrayFrom<uint8_t>(to_index);
+    default:
+      return nullptr;
+  }
+}
+
+class CastImpl : public raf::op::OpEnv {
+ public:
+  explicit CastImpl(const CallValues& cv) {
+    static auto fschema_index =
+        ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    static auto op = ir::Op::Get("raf.op.cast");
+    auto args = cv->args.as<op::schema::CastArgs>();
+    this->arg_indices = {fschema_index[op]("data")};
+    DLTensor* data = args->data;
+    DLTensor* out = ir::Downcast<TensorValue>(cv->out);
+    if (!IsCompact(*data) || !IsCompact(*out)) {
+      error_msgs.push_back("[CPU] Only supports compact tensors");
+      return;
+    }
+    cast_ = GetCastArray(data->dtype, out->dtype);
+    if (cast_ == nullptr) {
+      error_msgs.push_back("[CPU] Unsupported cast to " + args->dtype);
+    }
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<op::schema::CastArgs>();
+    Execute(std::vector<Value>{args->data}, cv->out);
+  }
+
+  void Execute(const std::vector<Value>& inputs, Value output) override {
+    DLTensor* data = ir::Downcast<TensorValue>(inputs[0]);
+    DLTensor* out = ir::Downcast<TensorValue>(output);
+    const char* in_p = static_cast<const char*>(data->data);
+    char* out_p = static_cast<char*>(out->data);
+    int64_t in_bytes = (data->dtype.bits + 7) / 8, out_bytes = (out->dtype.bits + 7) / 8;
+    ParallelFor(NumElements(data), kParallelGrainSize * 4, [&](int64_t begin, int64_t end) {
+      cast_(in_p + begin * in_bytes, out_p + begin * out_bytes, end - begin);
+    });
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.cpu.cast"));
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new CastImpl(cv);
+  }
+
+ private:
+  FCastArray cast_;
+};
+
+RAF_REGISTER_DIALECT_OP(cpu, cast, 20);
+RAF_OP_ENV_MAKER("raf.op.cpu.cast", CastImpl::make);
+
+}  // namespace cpu
+}  // namespace op
+}  // namespace raf
@@ -0,0 +1,449 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/op/dialect/shm/shm.cc
+ * \brief Communication operators on CPU implemented by the shared-memory communicator.
+ */
+#include <cstring>
+#include <vector>
+#include "raf/op_utils.h"
+#include "raf/shm_communicator.h"
+#include "../../../common/shape_utils.h"
+#include "../../schema/communication.h"
+
+namespace raf {
+namespace op {
+namespace communication {
+namespace shm {
+using namespace distributed;
+using namespace distributed::communicator;
+using common::shape_utils::BytesCompactTensor;
+
+RAF_REGISTER_DIALECT("shm").set_enable(DevType::kCPU());
+
+class SHMOpEnv : public raf::op::OpEnv {
+ protected:
+  void* communicator;
+
+  SHMCommunicatorObj* comm() const {
+    return reinterpret_cast<SHMCommunicatorObj*>(communicator);
+  }
+};
+
+/*! \brief The number of elements of a compact tensor. */
+inline int64_t NumElements(const DLTensor* x) {
+  return BytesCompactTensor(*x) / ((x->dtype.bits + 7) / 8);
+}
+
+class SHMAllReduce : public SHMOpEnv {
+  SHMReduceOp compute;
+
+  explicit SHMAllReduce(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._allreduce");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    auto args = cv->args.as<raf::op::schema::AllreduceArgs>();
+    this->arg_indices = {fschema_index[op]("x")};
+    RequestDistributed(&communicator, "shm", args->rank_list);
+    compute = ParseSHMReduceOp(args->computation);
+  }
+
+ public:
+  ~SHMAllReduce() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._allreduce"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::AllreduceArgs>();
+    Execute({TupleValue::make(ir::Array<Value>(args->x.begin(), args->x.end()))}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    // Unlike NCCL, the tensors are staged through the shared memory anyway, so they are reduced
+    // one by one instead of being fused into a workspace first.
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    if (tv->fields.size() == 1) {
+      DLTensor* x = tv->fields[0];
+      DLTensor* out = output;
+      comm()->AllReduce(x->data, out->data, NumElements(x), x->dtype, compute);
+      return;
+    }
+    auto out = Downcast<value::TupleValue>(output);
+    for (int i = 0; i < tv->fields.size(); ++i) {
+      DLTensor* x = tv->fields[i];
+      DLTensor* ot = out->fields[i];
+      comm()->AllReduce(x->data, ot->data, NumElements(x), x->dtype, compute);
+    }
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMAllReduce(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _allreduce, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._allreduce", SHMAllReduce::make);
+
+class SHMAllGather : public SHMOpEnv {
+  explicit SHMAllGather(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._allgather");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    auto args = cv->args.as<raf::op::schema::AllgatherArgs>();
+    this->arg_indices = {fschema_index[op]("x")};
+    RequestDistributed(&communicator, "shm", args->rank_list);
+  }
+
+ public:
+  ~SHMAllGather() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._allgather"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::AllgatherArgs>();
+    Execute({args->x}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    DLTensor* x = inputs[0];
+    DLTensor* out = output;
+    comm()->AllGather(x->data, out->data, BytesCompactTensor(*x));
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMAllGather(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _allgather, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._allgather", SHMAllGather::make);
+
+class SHMGroupAllGather : public SHMOpEnv {
+  explicit SHMGroupAllGather(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._group_allgather");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("tensor_list")};
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+  }
+
+ public:
+  ~SHMGroupAllGather() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._group_allgather"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::GroupAllgatherArgs>();
+    Execute(
+        {TupleValue::make(ir::Array<Value>(args->tensor_list.begin(), args->tensor_list.end()))},
+        cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    auto out = Downcast<value::TupleValue>(output);
+    for (int i = 0; i < tv->fields.size(); ++i) {
+      DLTensor* x = tv->fields[i];
+      DLTensor* ot = out->fields[i];
+      comm()->AllGather(x->data, ot->data, BytesCompactTensor(*x));
+    }
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMGroupAllGather(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _group_allgather, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._group_allgather", SHMGroupAllGather::make);
+
+class SHMReduceScatter : public SHMOpEnv {
+  void* in_buffer;
+  size_t size_in_bytes;
+  SHMReduceOp compute;
+
+  explicit SHMReduceScatter(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._reduce_scatter");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("x")};
+    auto args = cv->args.as<raf::op::schema::ReduceScatterArgs>();
+    RequestDistributed(&communicator, "shm", args->rank_list);
+    compute = ParseSHMReduceOp(args->computation);
+    const DLTensor* out = cv->out;
+    size_in_bytes = BytesCompactTensor(*out);
+    if (args->x.size() > 1) {
+      RequestWorkspace(&in_buffer, cv->device, size_in_bytes * args->x.size());
+    }
+  }
+
+ public:
+  ~SHMReduceScatter() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._reduce_scatter"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::ReduceScatterArgs>();
+    Execute({TupleValue::make(ir::Array<Value>(args->x.begin(), args->x.end()))}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    DLTensor* out = output;
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    const void* send_buf = nullptr;
+    if (tv->fields.size() == 1) {
+      DLTensor* x = tv->fields[0];
+      send_buf = x->data;
+    } else {
+      for (int i = 0; i < tv->fields.size(); ++i) {
+        DLTensor* x = tv->fields[i];
+        std::memcpy(static_cast<uint8_t*>(in_buffer) + size_in_bytes * i, x->data, size_in_bytes);
+      }
+      send_buf = in_buffer;
+    }
+    comm()->ReduceScatter(send_buf, out->data, NumElements(out), out->dtype, compute);
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMReduceScatter(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _reduce_scatter, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._reduce_scatter", SHMReduceScatter::make);
+
+class SHMGroupReduceScatter : public SHMOpEnv {
+  SHMReduceOp compute;
+
+  explicit SHMGroupReduceScatter(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._group_reduce_scatter");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("tensor_list")};
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+    auto args = cv->args.as<raf::op::schema::GroupReduceScatterArgs>();
+    compute = ParseSHMReduceOp(args->computation);
+  }
+
+ public:
+  ~SHMGroupReduceScatter() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._group_reduce_scatter"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::GroupReduceScatterArgs>();
+    Execute(
+        {TupleValue::make(ir::Array<Value>(args->tensor_list.begin(), args->tensor_list.end()))},
+        cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    auto out = Downcast<value::TupleValue>(output);
+    for (int i = 0; i < tv->fields.size(); ++i) {
+      DLTensor* x = tv->fields[i];
+      DLTensor* ot = out->fields[i];
+      comm()->ReduceScatter(x->data, ot->data, NumElements(ot), ot->dtype, compute);
+    }
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMGroupReduceScatter(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _group_reduce_scatter, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._group_reduce_scatter", SHMGroupReduceScatter::make);
+
+class SHMBroadcast : public SHMOpEnv {
+  int root;
+
+  explicit SHMBroadcast(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._broadcast");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("x")};
+    auto args = cv->args.as<raf::op::schema::BroadcastArgs>();
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+    root = args->root;
+  }
+
+ public:
+  ~SHMBroadcast() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._broadcast"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::BroadcastArgs>();
+    Execute({TupleValue::make(ir::Array<Value>(args->x.begin(), args->x.end()))}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    if (tv->fields.size() == 1) {
+      DLTensor* x = tv->fields[0];
+      DLTensor* out = output;
+      comm()->Broadcast(x->data, out->data, BytesCompactTensor(*x), root);
+      return;
+    }
+    auto out = Downcast<value::TupleValue>(output);
+    for (int i = 0; i < tv->fields.size(); ++i) {
+      DLTensor* x = tv->fields[i];
+      DLTensor* ot = out->fields[i];
+      comm()->Broadcast(x->data, ot->data, BytesCompactTensor(*x), root);
+    }
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMBroadcast(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _broadcast, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._broadcast", SHMBroadcast::make);
+
+class SHMSend : public SHMOpEnv {
+  int peer;
+
+  explicit SHMSend(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._send");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("x")};
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+    const auto* args = cv->args.as<raf::op::schema::SendArgs>();
+    CHECK(args);
+    peer = args->peer;
+  }
+
+ public:
+  ~SHMSend() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._send"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    const auto* args = cv->args.as<raf::op::schema::SendArgs>();
+    CHECK(args);
+    Execute({args->x}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    const DLTensor* x = inputs[0];
+    comm()->Send(x->data, BytesCompactTensor(*x), peer);
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMSend(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _send, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._send", SHMSend::make);
+
+class SHMRecv : public SHMOpEnv {
+  int peer;
+
+  explicit SHMRecv(const CallValues& cv) {
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+    const auto* args = cv->args.as<raf::op::schema::RecvArgs>();
+    CHECK(args);
+    peer = args->peer;
+  }
+
+ public:
+  ~SHMRecv() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._recv"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    Execute({}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    DLTensor* out = output;
+    comm()->Recv(out->data, BytesCompactTensor(*out), peer);
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMRecv(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _recv, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._recv", SHMRecv::make);
+
+class SHMReduce : public SHMOpEnv {
+  SHMReduceOp compute;
+  int root;
+
+  explicit SHMReduce(const CallValues& cv) {
+    auto op = ir::Op::Get("raf.op._reduce");
+    auto fschema_index = ir::Op::GetAttrMap<op::FRAFSchemaFieldIndex>("FRAFSchemaFieldIndex");
+    this->arg_indices = {fschema_index[op]("x")};
+    RequestDistributed(&communicator, "shm", NullValue<Value>());
+    auto args = cv->args.as<raf::op::schema::CommReduceArgs>();
+    root = args->root;
+    compute = ParseSHMReduceOp(args->computation);
+  }
+
+ public:
+  ~SHMReduce() {
+  }
+
+  std::string name() const override {
+    return TruncateName(GetUniqueName("raf.op.shm._reduce"));
+  }
+
+  void Execute(const CallValues& cv) override {
+    auto args = cv->args.as<raf::op::schema::CommReduceArgs>();
+    Execute({TupleValue::make(ir::Array<Value>(args->x.begin(), args->x.end()))}, cv->out);
+  }
+
+  void Execute(const std::vector<value::Value>& inputs, value::Value output) override {
+    auto tv = Downcast<value::TupleValue>(inputs[0]);
+    if (tv->fields.size() == 1) {
+      DLTensor* x = tv->fields[0];
+      DLTensor* out = output;
+      comm()->Reduce(x->data, out->data, NumElements(x), x->dtype, compute, root);
+      return;
+    }
+    auto out = Downcast<value::TupleValue>(output);
+    for (int i = 0; i < tv->fields.size(); ++i) {
+      DLTensor* x = tv->fields[i];
+      DLTensor* ot = out->fields[i];
+      comm()->Reduce(x->data, ot->data, NumElements(x), x->dtype, compute, root);
+    }
+  }
+
+  static OpEnv* make(const CallValues& cv) {
+    return new SHMReduce(cv);
+  }
+};
+
+RAF_REGISTER_DIALECT_OP(shm, _reduce, 10);
+RAF_OP_ENV_MAKER("raf.op.shm._reduce", SHMReduce::make);
+
+}  // namespace shm
+}  // namespace communication
+}  // namespace op
+}  // namespace raf
@@ -282,7 +282,7 @@ OpEnv* FusedFuncBuild(const op::CallValues& call) {
 
   auto key = HashFusedFunc(Downcast<ClosureValue>(call->callee)->func);
   TVMModuleCacheEntry entry;
-  if (const auto* compiled = cache->Get(key.byte_vector)) {
+  if (auto compiled = cache->GetShared(key.byte_vector)) {
     entry = *compiled;
   } else {
     te_compiler->Clear();
@@ -291,7 +291,7 @@ OpEnv* FusedFuncBuild(const op::CallValues& call) {
       auto cached_func = te_compiler->Lower(cached_key, [](String name) { return name; });
       auto mod = tvm::build(cached_func->funcs, cached_key->target, Target(nullptr));
       entry = TVMModuleCacheEntry(mod, cached_func->prim_fn_var->name_hint);
-      cache->Set(key.byte_vector, entry);
+      cache->TrySet(key.byte_vector, entry);
     } catch (const dmlc::Error& e) {
       if (!AllowJitFailure()) {
         LOG(FATAL) << "Failed to build a fused op " << env->env_name << ": " << e.what();
@@ -107,15 +107,16 @@ void TVMOpEnv::Execute(const op::CallValues& call) {
 }
 
 void TVMOpEnv::Execute(const std::vector<Value>& inputs, Value output) {
-  this->inputs.clear();
-  this->outputs.clear();
+  // The tensors are local, so that the ops sharing this OpEnv can run concurrently.
+  std::vector<DLTensor> in_tensors;
+  std::vector<DLTensor> out_tensors;
   for (auto val : inputs) {
-    GetDLTensor(val, &this->inputs);
+    GetDLTensor(val, &in_tensors);
   }
-  GetDLTensor(output, &this->outputs);
+  GetDLTensor(output, &out_tensors);
   std::vector<TVMValue> values;
   std::vector<int> codes;
-  SetArgs(&this->inputs, &this->outputs, &values, &codes);
+  SetArgs(&in_tensors, &out_tensors, &values, &codes);
   TVMArgs targs(values.data(), codes.data(), values.size());
   TVMRetValue rv;
 
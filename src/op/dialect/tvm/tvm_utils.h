@@ -228,12 +228,13 @@ extern MetaPersistCache<RelayFuncCacheEntry> CacheLoweredFunc;
     RType ret;                                                                                     \
     HashKey key;                                                                                   \
     key << #OP << HASH(param_types, ret_type, schema);                                             \
-    if (const auto* compiled = cache->Get(key.byte_vector)) {                                      \
+    if (auto compiled = cache->GetShared(key.byte_vector)) {                                       \
       ret = *compiled;                                                                             \
     } else {                                                                                       \
       auto lowered = LowerOp(op, attrs, param_types, ret_type);                                    \
       ret = f_post_lower(lowered);                                                                 \
-      cache->Set(key.byte_vector, ret);                                                            \
+      /* Another thread may have built the same kernel concurrently, e.g., during warmup. */       \
+      cache->TrySet(key.byte_vector, ret);                                                         \
     }                                                                                              \
     return ret;                                                                                    \
   }                                                                                                \
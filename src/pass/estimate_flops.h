@@ -64,6 +64,16 @@ class FLOPSEstimater : public ExprVisitor {
   StdMap<float> var_flops_map_;
 };
 
+/*!
+ * \brief Estimate the compute GFLOPS of a call by analyzing the TVM compute of its op.
+ * \param call The type-inferred call to an op, a function or a global function.
+ * \param device The target device.
+ * \param mod The IR module to look up the global functions.
+ * \return The GFLOPS, infinity if the op does not have a TVM dialect, or -1 if the compute
+ * cannot be analyzed.
+ */
+float EstimateCallGFLOPS(const Call& call, const Device& device, const IRModule& mod);
+
 }  // namespace estimate_flops
 }  // namespace pass
 }  // namespace raf
@@ -13,8 +13,10 @@
 #include "raf/ir.h"
 #include "raf/pass.h"
 #include "tvm/ir/type_functor.h"
+#include "tvm/relay/attrs/memory.h"
 #include "./let_list.h"
 #include "./common.h"
+#include "./view_utils.h"
 #include "../common/shape_utils.h"
 
 namespace raf {
@@ -24,11 +26,11 @@ using PackedLiveInMap = Map<Var, Array<Var>>;
 
 namespace liveness_analysis {
 
-MapVSet LivenessAnalyzer::Run() {
+void LivenessAnalyzer::Run() {
   Expr body;
   FormCheck(func_->body);
   if (failure_) {
-    return live_;
+    return;
   }
 
   for (const auto& var : func_->params) {
@@ -56,24 +58,14 @@ MapVSet LivenessAnalyzer::Run() {
 
   // backward analysis
   Var dummy = CreateNull();
-  live_[dummy] = {};
+  SetLive(dummy, {});
   Backward(func_->body, dummy);
 
-  // init find
-  for (const auto& kv : vset_) {
-    const Var& var = kv.first;
-    const auto& tensors = GetTensorVars(var);
-    if (tensors.size() == 1 && *tensors.begin() == var) {
-      union_find_forest_[var] = var;
-    }
-  }
-
-  // init inv
-  for (const auto& kv : live_) {
-    const Var& k = kv.first;
-    const VSet& vs = kv.second;
-    for (const auto& v : vs) {
-      inv_live_[v].insert(k);
+  // init inv. The union find forest is initialized by CreateTensor.
+  inv_live_.resize(tensors_.size());
+  for (uint32_t line = 0; line < live_.size(); ++line) {
+    for (uint32_t tensor : live_[line]) {
+      inv_live_[tensor].push_back(line);
     }
   }
 
@@ -99,8 +91,14 @@ MapVSet LivenessAnalyzer::Run() {
       Unite(fin, fout);
     }
   }
+}
 
-  return live_;
+MapVSet LivenessAnalyzer::GetLiveIn() const {
+  MapVSet ret;
+  for (size_t i = 0; i < lines_.size(); ++i) {
+    ret[lines_[i]] = ToVSet(live_[i]);
+  }
+  return ret;
 }
 
 void LivenessAnalyzer::FormChecker::VisitExpr_(const CallNode* node) {
@@ -162,6 +160,17 @@ void LivenessAnalyzer::ForwardAnalyzer::VisitExpr_(const CallNode* node) {
     CHECK(var != nullptr) << "Expected the first argument of reshape op to be a Var, but got "
                           << node->args[0]->GetTypeKey();
     this->VisitExpr_(var);
+  } else if (view_utils::GetContiguousViews(GetRef<Call>(node))) {
+    // Views of the input are lowered to vm.set_shape as well, so they share the input tensor.
+    auto var = Downcast<Var>(node->args[0]);
+    auto out_types = tvm::relay::FlattenTupleType(node->checked_type());
+    if (node->checked_type()->IsInstance<TupleTypeNode>()) {
+      Array<Var> fields(out_types.size(), var);
+      analyzer_->Init(let_var_, analyzer_->Merge(fields));
+      analyzer_->vtuple_.Set(let_var_, fields);
+    } else {
+      this->VisitExpr_(var.get());
+    }
   } else {
     Var dummy = analyzer_->CreateTensorVar(node->checked_type());
     analyzer_->Init(let_var_, dummy);
@@ -252,13 +261,11 @@ Var LivenessAnalyzer::ForwardAnalyzer::Run() {
 void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const VarNode* node) {
   auto vars = analyzer_->GetTensorVars(GetRef<Var>(node));
   CHECK_EQ(vars.size(), 1U);
-  analyzer_->live_[let_var_] = analyzer_->vset_[MergeLive(vars[0])];
+  analyzer_->SetLive(let_var_, MergeLive(analyzer_->TensorsOf(vars[0])));
 }
 
 void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const FunctionNode* node) {
-  Function f = GetRef<Function>(node);
-  Array<Var> free_vars = FreeVars(f);
-  analyzer_->live_[let_var_] = analyzer_->vset_[MergeLive(let_var_)];
+  analyzer_->SetLive(let_var_, MergeLive(analyzer_->TensorsOf(let_var_)));
 }
 
 void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const CallNode* node) {
@@ -269,6 +276,8 @@ void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const CallNode* node) {
     CHECK(var != nullptr) << "Expected the first argument of reshape op to be a Var, but got "
                           << args[0]->GetTypeKey();
     this->VisitExpr_(var);
+  } else if (view_utils::GetContiguousViews(GetRef<Call>(node))) {
+    this->VisitExpr_(Downcast<Var>(args[0]).get());
   } else {
     Array<Var> vargs;
     for (const auto& arg : node->args) {
@@ -281,9 +290,8 @@ void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const CallNode* node) {
         LOG(FATAL) << "NotImplementedError: unsupported args: " << arg->GetTypeKey();
       }
     }
-    Var d1 = analyzer_->Merge(vargs);
-    Var d2 = MergeLive(d1, let_var_);
-    analyzer_->live_[let_var_] = analyzer_->vset_[d2];
+    analyzer_->SetLive(let_var_,
+                       MergeLive(analyzer_->TensorsOf(vargs), analyzer_->TensorsOf(let_var_)));
   }
 }
 
@@ -296,31 +304,32 @@ void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const TupleNode* node) {
       var_fields.push_back(Downcast<Var>(field));
     }
   }
-  Var d1 = analyzer_->Merge(var_fields);
-  Var d2 = MergeLive(d1, let_var_);
-  analyzer_->live_[let_var_] = analyzer_->vset_[d2];
+  analyzer_->SetLive(let_var_,
+                     MergeLive(analyzer_->TensorsOf(var_fields), analyzer_->TensorsOf(let_var_)));
 }
 
 void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const TupleGetItemNode* node) {
-  analyzer_->live_[let_var_] = analyzer_->vset_[MergeLive(let_var_)];
+  analyzer_->SetLive(let_var_, MergeLive(analyzer_->TensorsOf(let_var_)));
 }
 
 void LivenessAnalyzer::BackwardAnalyzer::VisitExpr_(const IfNode* node) {
-  Var free_true = analyzer_->Merge(FreeVars(node->true_branch));
-  Var free_false = analyzer_->Merge(FreeVars(node->false_branch));
-  analyzer_->live_[let_var_] = analyzer_->vset_[MergeLive(
-      analyzer_->Merge({free_true, free_false, Downcast<Var>(node->cond)}), let_var_)];
+  Array<Var> used_vars = FreeVars(node->true_branch);
+  for (const auto& var : FreeVars(node->false_branch)) {
+    used_vars.push_back(var);
+  }
+  used_vars.push_back(Downcast<Var>(node->cond));
+  analyzer_->SetLive(let_var_,
+                     MergeLive(analyzer_->TensorsOf(used_vars), analyzer_->TensorsOf(let_var_)));
   VisitBranch(node->true_branch, let_var_);
   VisitBranch(node->false_branch, let_var_);
 }
 
 void LivenessAnalyzer::BackwardAnalyzer::VisitBranch(const Expr& branch, const Var& def) {
-  Var total_next = analyzer_->CreateTensorVar("if");
-  // get total live-out variables of true_branch
-  analyzer_->vset_[total_next] = analyzer_->live_[next_var_];
-  // remove the tensors defined at this line
-  Var branch_next = analyzer_->Remove(total_next, def);
-  analyzer_->live_[branch_next] = analyzer_->vset_[branch_next];
+  Var branch_next = analyzer_->CreateTensorVar("if");
+  // the live-out variables of the branch are the ones of this line, except for the tensors
+  // defined at this line
+  analyzer_->SetLive(branch_next,
+                     Difference(analyzer_->LiveOf(next_var_), analyzer_->TensorsOf(def)));
   analyzer_->Backward(branch, branch_next);
 }
 
@@ -333,7 +342,7 @@ void LivenessAnalyzer::BackwardAnalyzer::Run(Var next_var) {
   // Backward analysis
   next_var_ = next_var;
   analyzer_->dummy_output_ = analyzer_->CreateNull();
-  analyzer_->live_[analyzer_->dummy_output_] = analyzer_->vset_[MergeLive(ell_->ret)];
+  analyzer_->SetLive(analyzer_->dummy_output_, MergeLive(analyzer_->TensorsOf(ell_->ret)));
   for (int i = n - 1; i >= 0; --i) {
     let_var_ = vars[i];
     next_var_ = i == n - 1 ? analyzer_->dummy_output_ : vars[i + 1];
@@ -342,11 +351,10 @@ void LivenessAnalyzer::BackwardAnalyzer::Run(Var next_var) {
     // the same value may point to the same reference, so only the first one will be visited.
     if (exprs[i].as<OpNode>() || exprs[i].as<ConstantNode>() || exprs[i].as<FunctionNode>()) {
       auto dummy_vars = analyzer_->GetTensorVars(next_var_);
-      Var d1 = analyzer_->Merge(dummy_vars);
-      Var d2 = MergeLive(d1, next_var_);
-      analyzer_->live_[let_var_] = analyzer_->vset_[d2];
+      analyzer_->SetLive(let_var_, MergeLive(analyzer_->TensorsOf(dummy_vars),
+                                             analyzer_->TensorsOf(next_var_)));
     } else {
-      CHECK_GT(analyzer_->live_.count(next_var_), 0);
+      CHECK_GT(analyzer_->line_ids_.count(next_var_), 0);
     }
     ExprVisitor::VisitExpr(exprs[i]);
   }
@@ -467,7 +475,8 @@ liveness_analysis::MapVSet LivenessAnalysis(const IRModule& mod) {
   auto entry = mod->GetGlobalVar("main");
   auto func = Downcast<Function>(mod->Lookup(entry));
   auto la = liveness_analysis::LivenessAnalyzer(func);
-  return la.Run();
+  la.Run();
+  return la.GetLiveIn();
 }
 
 // Put the live in set to an Array as std::unordered_set is not in the object system.
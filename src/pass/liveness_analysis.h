@@ -8,6 +8,9 @@
  * \brief A pass for analyzing tensor liveness.
  */
 #pragma once
+#include <algorithm>
+#include <iterator>
+#include <string>
 #include <vector>
 #include "raf/op.h"
 #include "raf/op_utils.h"
@@ -67,27 +70,42 @@ using MapVar = StdMap<Var>;
 using MapVSet = StdMap<VSet>;
 using MapFunction = StdMap<Function>;
 
+/*!
+ * \brief A set of dummy tensor vars, represented by their dense indices in the ascending order.
+ * A member takes 4 bytes, and the set operations are linear merges without hashing, so the live
+ * sets of all lines in large functions fit in memory.
+ */
+using TensorSet = std::vector<uint32_t>;
+
 class LivenessAnalyzer {
  public:
   LivenessAnalyzer(const Function& func) : func_(func) {
   }
 
-  MapVSet Run();
+  /*! \brief Run the analysis, whose results are queried by GetLiveVars and GetTensorVars. */
+  void Run();
 
   bool IsSuccess() {
     return !failure_;
   }
 
+  /*!
+   * \brief Get the live in tensors of all lines. It materializes every live set, so it is only
+   * for debugging and testing.
+   */
+  MapVSet GetLiveIn() const;
+
   /*! \brief Get live in tensors of the given line (var). */
-  VSet GetLiveVars(const Var& x) {
-    if (live_.count(x) == 0) {
+  VSet GetLiveVars(const Var& x) const {
+    auto it = line_ids_.find(x);
+    if (it == line_ids_.end()) {
       return VSet();
     }
-    return live_.at(x);
+    return ToVSet(live_[it->second]);
   }
 
   /*! \brief Get the dummy tensor variables of the final outputs. */
-  VSet GetOutputTensorVars() {
+  VSet GetOutputTensorVars() const {
     return GetLiveVars(dummy_output_);
   }
 
@@ -99,12 +117,12 @@ class LivenessAnalyzer {
     }
 
     Array<Var> ret;
-    if (vset_.count(x) == 0) {
+    auto it = vset_.find(x);
+    if (it == vset_.end()) {
       return ret;
     }
-    CHECK(vset_.find(x) != vset_.end());
-    for (auto var : vset_.at(x)) {
-      ret.push_back(var);
+    for (uint32_t id : it->second) {
+      ret.push_back(tensors_[id]);
     }
     return ret;
   }
@@ -128,36 +146,35 @@ class LivenessAnalyzer {
 
   /*! \brief Union-find Forest: Get root in Union-find Forest */
   Var Find(const Var& x) {
-    CHECK(union_find_forest_.find(x) != union_find_forest_.end());
-    if (x == union_find_forest_.at(x)) {
-      return x;
-    }
-    Var root = Find(union_find_forest_.at(x));
-    union_find_forest_[x] = root;
-    return root;
+    return tensors_[FindRoot(TensorId(x))];
   }
 
   /*! \brief Union-find Forest: Unite two trees in Union-find Forest */
   Var Unite(const Var& x, const Var& y) {
-    Var fx = Find(x);
-    Var fy = Find(y);
+    uint32_t fx = FindRoot(TensorId(x));
+    uint32_t fy = FindRoot(TensorId(y));
     union_find_forest_[fx] = fy;
-    CHECK_GT(inv_live_.count(fx), 0);
-    CHECK_GT(inv_live_.count(fy), 0);
-    inv_live_[fy].insert(inv_live_.at(fx).begin(), inv_live_.at(fx).end());
-    return fy;
+    if (fx != fy) {
+      inv_live_[fy] = Union(inv_live_[fx], inv_live_[fy]);
+    }
+    return tensors_[fy];
   }
 
   /*! \brief check if inv_live_[x] and inv_live_[y] intersects or not */
   bool Intersect(const Var& x, const Var& y) {
-    CHECK_GT(inv_live_.count(x), 0);
-    CHECK_GT(inv_live_.count(y), 0);
-    const VSet& sx = inv_live_.at(x);
-    const VSet& sy = inv_live_.at(y);
-    for (const auto& v : sx) {
-      if (sy.find(v) != sy.end()) {
+    const auto& sx = inv_live_[TensorId(x)];
+    const auto& sy = inv_live_[TensorId(y)];
+    auto ix = sx.begin();
+    auto iy = sy.begin();
+    while (ix != sx.end() && iy != sy.end()) {
+      if (*ix == *iy) {
         return true;
       }
+      if (*ix < *iy) {
+        ++ix;
+      } else {
+        ++iy;
+      }
     }
     return false;
   }
@@ -194,12 +211,16 @@ class LivenessAnalyzer {
 
   /*! \brief Debug output: live_ */
   std::string DebugDumpLiveIn() {
-    return DebugDump(live_);
+    return DebugDump(GetLiveIn());
   }
 
   /*! \brief Debug output: vset_ */
   std::string DebugDumpDummyVars() {
-    return DebugDump(vset_);
+    MapVSet vset;
+    for (const auto& kv : vset_) {
+      vset[kv.first] = ToVSet(kv.second);
+    }
+    return DebugDump(vset);
   }
 
  private:
@@ -223,58 +244,101 @@ class LivenessAnalyzer {
   /*! \brief Create a dummy tensor variable, which contains itself. */
   Var CreateTensor(const std::string& name = "t") {
     Var var = CreateTensorVar(name);
-    vset_[var] = {var};
+    uint32_t id = tensors_.size();
+    tensors_.push_back(var);
+    tensor_ids_[var] = id;
+    union_find_forest_.push_back(id);
+    vset_[var] = {id};
     return var;
   }
 
-  /*! \brief vset1 - vset2 */
-  static VSet Remove(const VSet& vset1, const VSet& vset2) {
-    VSet ret(vset1);
-    for (const auto& var : vset2) {
-      ret.erase(var);
+  /*! \brief Get the dense index of a dummy tensor variable. */
+  uint32_t TensorId(const Var& x) const {
+    auto it = tensor_ids_.find(x);
+    CHECK(it != tensor_ids_.end()) << "Not a dummy tensor variable: " << x;
+    return it->second;
+  }
+
+  /*! \brief Union-find Forest: Get the root of a dummy tensor by its index */
+  uint32_t FindRoot(uint32_t x) {
+    uint32_t root = x;
+    while (union_find_forest_[root] != root) {
+      root = union_find_forest_[root];
     }
+    while (union_find_forest_[x] != root) {
+      uint32_t parent = union_find_forest_[x];
+      union_find_forest_[x] = root;
+      x = parent;
+    }
+    return root;
+  }
+
+  /*! \brief Convert a set of dense indices to the set of dummy tensor variables. */
+  VSet ToVSet(const TensorSet& set) const {
+    VSet ret;
+    ret.reserve(set.size());
+    for (uint32_t id : set) {
+      ret.insert(tensors_[id]);
+    }
+    return ret;
+  }
+
+  /*! \brief set1 - set2 */
+  static TensorSet Difference(const TensorSet& set1, const TensorSet& set2) {
+    TensorSet ret;
+    ret.reserve(set1.size());
+    std::set_difference(set1.begin(), set1.end(), set2.begin(), set2.end(),
+                        std::back_inserter(ret));
     return ret;
   }
 
-  /*! \brief the union of vset1 and vset2 */
-  static VSet Merge(const VSet& vset1, const VSet& vset2) {
-    VSet ret(vset1);
-    ret.insert(vset2.begin(), vset2.end());
+  /*! \brief the union of set1 and set2 */
+  static TensorSet Union(const TensorSet& set1, const TensorSet& set2) {
+    if (set2.empty()) {
+      return set1;
+    }
+    TensorSet ret;
+    ret.reserve(set1.size() + set2.size());
+    std::set_union(set1.begin(), set1.end(), set2.begin(), set2.end(), std::back_inserter(ret));
     return ret;
   }
 
-  /*! \brief Remove vset_[v2] from vset_[v1] */
-  Var Remove(Var v1, Var v2) {
-    bool v1_legel = (v1.defined() && vset_.find(v1) != vset_.end());
-    bool v2_legel = (v2.defined() && vset_.find(v2) != vset_.end());
-    if (v1_legel && !v2_legel) {
-      // v1 - v2 = v1 - null = v1
-      return v1;
-    } else if (!v1_legel) {
-      // null - v2 = null
-      return Var();
+  /*! \brief Get vset_[var], or an empty set if var contains nothing. */
+  const TensorSet& TensorsOf(const Var& var) const {
+    static const TensorSet empty;
+    auto it = vset_.find(var);
+    return it == vset_.end() ? empty : it->second;
+  }
+
+  /*! \brief Get the union of vset_[vars[i]] */
+  TensorSet TensorsOf(const Array<Var>& vars) const {
+    TensorSet ret;
+    for (const auto& var : vars) {
+      const auto& set = TensorsOf(var);
+      ret.insert(ret.end(), set.begin(), set.end());
     }
-    const VSet& vset1 = vset_.at(v1);
-    const VSet& vset2 = vset_.at(v2);
-    Var rs = CreateTensorVar("rs");
-    vset_[rs] = Remove(vset1, vset2);
-    return rs;
-  }
-
-  /*! \brief Merge vset_[v1] and vset_[v2] */
-  Var Merge(Var v1, Var v2) {
-    bool v1_legel = (v1.defined() && vset_.find(v1) != vset_.end());
-    bool v2_legel = (v2.defined() && vset_.find(v2) != vset_.end());
-    if (!v1_legel && !v2_legel) {
-      return Var();
-    } else if (!v1_legel || !v2_legel) {
-      return (v1_legel) ? v1 : v2;
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+  }
+
+  /*! \brief Get the live in tensors of a line, which must have been analyzed. */
+  const TensorSet& LiveOf(const Var& line) const {
+    auto it = line_ids_.find(line);
+    CHECK(it != line_ids_.end()) << "The live in tensors of " << line << " are not analyzed";
+    return live_[it->second];
+  }
+
+  /*! \brief Set the live in tensors of a line. */
+  void SetLive(const Var& line, TensorSet live) {
+    auto it = line_ids_.find(line);
+    if (it != line_ids_.end()) {
+      live_[it->second] = std::move(live);
+      return;
     }
-    const VSet& vset1 = vset_.at(v1);
-    const VSet& vset2 = vset_.at(v2);
-    Var ms = CreateTensorVar("ms");
-    vset_[ms] = Merge(vset1, vset2);
-    return ms;
+    line_ids_[line] = live_.size();
+    lines_.push_back(line);
+    live_.push_back(std::move(live));
   }
 
   /*! \brief Merge vset_[vars[i]] */
@@ -285,13 +349,20 @@ class LivenessAnalyzer {
     } else if (n == 1) {
       CHECK(vset_.find(vars[0]) != vset_.end());
       return vars[0];
-    } else {
-      Var ret = Merge(vars[0], vars[1]);
-      for (size_t i = 2; i < n; ++i) {
-        ret = Merge(ret, vars[i]);
+    }
+    // The vars that are undefined or contain nothing are skipped.
+    Array<Var> valid_vars;
+    for (const auto& var : vars) {
+      if (var.defined() && vset_.find(var) != vset_.end()) {
+        valid_vars.push_back(var);
       }
-      return ret;
     }
+    if (valid_vars.size() <= 1) {
+      return valid_vars.empty() ? Var() : valid_vars[0];
+    }
+    Var ms = CreateTensorVar("ms");
+    vset_[ms] = TensorsOf(valid_vars);
+    return ms;
   }
 
   /*! \brief Init vtuple_[to] and vset_[to] with from */
@@ -356,22 +427,31 @@ class LivenessAnalyzer {
   /*! \brief whether func_ contains closure invoke */
   bool failure_{false};
   /*! \brief maps a var to the set of real or fake variables which share memory with the key */
-  MapVSet vset_;
+  StdMap<TensorSet> vset_;
   /*! \brief maps a variable with TupleType to its constituent (fake) variables */
   Map<Var, Array<Var>> vtuple_;
-  /*! \brief the live-in variables at a specific line */
-  MapVSet live_;
+  /*! \brief the dummy tensor variables, indexed by their dense indices in TensorSet */
+  std::vector<Var> tensors_;
+  /*! \brief maps a dummy tensor variable to its dense index */
+  StdMap<uint32_t> tensor_ids_;
+  /*! \brief the lines (vars) whose live-in tensors are analyzed, in the order of analysis */
+  std::vector<Var> lines_;
+  /*! \brief maps a line to its index in lines_ */
+  StdMap<uint32_t> line_ids_;
+  /*! \brief the live-in tensors of each line, indexed by the line index */
+  std::vector<TensorSet> live_;
   /*! \brief The dummy value of the final output */
   Var dummy_output_;
   /*! \brief count the occurences of a var name, to avoid name collision */
   std::unordered_map<std::string, int> label_;
   /*! \brief mandatory memory sharing between a pair of vars */
   Array<Var> var_out_, var_in_;
-  /*! \brief vars that share memory with one another are merged in the union find forest */
-  std::unordered_map<Var, Var, ObjectPtrHash, ObjectPtrEqual> union_find_forest_;
-  /*! \brief the lines where a variable is live.
+  /*! \brief vars that share memory with one another are merged in the union find forest,
+             which is indexed by the dense indices of the dummy tensors */
+  std::vector<uint32_t> union_find_forest_;
+  /*! \brief the indices of the lines where a dummy tensor is live, in the ascending order.
              Initially it's the inversion of live_: inv_live_[x] = {y | x \in live_[y]} */
-  MapVSet inv_live_;
+  std::vector<std::vector<uint32_t>> inv_live_;
 };
 
 class LivenessAnalyzer::FormChecker : public ExprVisitor {
@@ -464,19 +544,15 @@ class LivenessAnalyzer::BackwardAnalyzer : public ExprVisitor {
   void Run(Var next_var);
 
  private:
-  /*! \brief returns live_[next_var_] - vset_[def] + vset_[cur]
+  /*! \brief returns live_[next_var_] - def + use
              it's an instantiation of the following rule:
              live(l + 1, x) && !define(l, x) => live(l, x) */
-  Var MergeLive(const Var& cur, const Var& def = Var()) {
-    Var next_line_var = analyzer_->CreateTensorVar("ml");
-    CHECK(analyzer_->live_.find(next_var_) != analyzer_->live_.end());
-    analyzer_->vset_[next_line_var] = analyzer_->live_.at(next_var_);
-    Var remain = next_line_var;
-    if (def.defined()) {
-      remain = analyzer_->Remove(remain, def);
+  TensorSet MergeLive(const TensorSet& use, const TensorSet& def = {}) {
+    const TensorSet& next = analyzer_->LiveOf(next_var_);
+    if (def.empty()) {
+      return Union(next, use);
     }
-    Var ret = analyzer_->Merge(remain, cur);
-    return ret;
+    return Union(Difference(next, def), use);
   }
 
  private:
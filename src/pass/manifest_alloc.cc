@@ -19,6 +19,7 @@
 #include "raf/pass.h"
 #include "./common.h"
 #include "./let_list.h"
+#include "./view_utils.h"
 #include "../common/shape_utils.h"
 #include "tvm/relay/attrs/memory.h"
 
@@ -147,6 +148,7 @@ class ManifestAllocMutator : public ExprMutator {
       }
       auto scope = scopes_.back().get();
       Var bind_var = let_binding_[GetRef<Call>(node)];
+      std::vector<view_utils::ContiguousView> views;
 
       auto ret_type = call->checked_type();
       auto out_types = tvm::relay::FlattenTupleType(ret_type);
@@ -174,6 +176,18 @@ class ManifestAllocMutator : public ExprMutator {
         auto tensor_ty_node = out_types[0].as<TensorTypeNode>();
         new_args.push_back(MakeConstant(op::ArrayToIntTuple(tensor_ty_node->shape)));
         return Call(vm_set_shape_op, new_args);
+      } else if (!use_upper_bound && view_utils::GetContiguousViews(call, &views)) {
+        // generate vm.set_shape with offsets for the layout ops whose outputs are contiguous
+        // ranges of the input, e.g., split along the first axis, to avoid copying kernels
+        auto data = VisitExpr(call->args[0]);
+        std::vector<Expr> outs;
+        for (size_t i = 0; i < views.size(); ++i) {
+          auto shape = MakeConstant(op::ArrayToIntTuple(views[i].shape));
+          auto offset = MakeConstant(ScalarValue::make(views[i].offset));
+          Call view = Call(vm_set_shape_op, {data, shape, offset});
+          outs.push_back(out_types.size() == 1U ? Expr(view) : scope->Push(view));
+        }
+        return tvm::relay::ToTupleType(ret_type, outs);
       } else {
         // allocate necessary memory buffers and invoke ops
         for (auto& arg : call->args) {
@@ -54,6 +54,11 @@ struct TensorGroup {
 
   /*! \brief The alignment of this group. */
   int64_t alignment;
+
+  /*! \brief The offsets of the dummy tensors in the storage when the tensors are packed by
+   * offsets. Tensors without an offset are at the beginning of the storage.
+   */
+  StdMap<int64_t> offsets;
 };
 
 /*! \brief A list of tensor groups with manipulation utilities. */
@@ -213,9 +218,16 @@ class TensorGroups {
  */
 class MemoryPlanner : public ExprMutator {
  public:
-  MemoryPlanner(const Function& func, liveness_analysis::LivenessAnalyzer* analyzer)
+  MemoryPlanner(const Function& func, liveness_analysis::LivenessAnalyzer* analyzer,
+                const std::string& policy = "group", bool dump_stat = false)
       : func_(func), analyzer_(analyzer), tensor_groups_(Group()) {
     scopes_.emplace_back(new LetList);
+    if (policy == "offset") {
+      PackOffsets(dump_stat);
+    } else {
+      CHECK_EQ(policy, "group") << "Unknown memory plan policy " << policy
+                                << ", candidates are group and offset";
+    }
   }
 
   Expr Run() {
@@ -350,6 +362,18 @@ class MemoryPlanner : public ExprMutator {
         new_args.Set(4, own);
       }
 
+      // Set the offset in the storage if the tensors in the group are packed by offsets.
+      const auto& offsets = tensor_groups_.groups[group_id].offsets;
+      auto offset_it = offsets.find(tensor_groups_.GetTensorVar(curr_let_));
+      if (offset_it != offsets.end()) {
+        auto offset = MakeConstant(ScalarValue::make(offset_it->second));
+        if (new_args.size() == 5) {
+          new_args.push_back(offset);
+        } else {
+          new_args.Set(5, offset);
+        }
+      }
+
       return Call(alloc_tensor_op, new_args);
     } else if (op_node && GetRef<Op>(op_node) == reshape_tensor_op) {
       // Other ops that will also create a new tensor/view. We do not need to mutate them,
@@ -364,6 +388,8 @@ class MemoryPlanner : public ExprMutator {
 
   TensorGroups Group();
 
+  void PackOffsets(bool dump_stat);
+
   inline Expr MakeFreeMemory(const Var& memory_var) {
     static const Op& op = Op::Get("raf.op.vm.free");
     return Call(op, {memory_var});
@@ -493,13 +519,184 @@ TensorGroups MemoryPlanner::Group() {
   return TensorGrouper(func_, analyzer_).Run();
 }
 
+/*!
+ * \brief Pack the statically sized tensor groups without a final output into one storage by
+ * assigning an offset to each group. Two groups may overlap in the storage only if their live
+ * intervals, which span the let bindings where any of their tensors is live, are disjoint.
+ * The groups are placed greedily from the largest one, each at the best-fit offset, i.e., the
+ * smallest gap between the placed groups with overlapping intervals that can hold it, or on top
+ * of them if no gap fits. The achieved peak is compared to the lower bound, which is the maximum
+ * total size of the groups live at the same let binding.
+ */
+void MemoryPlanner::PackOffsets(bool dump_stat) {
+  static const Op& alloc_storage_op = Op::Get("raf.op.vm.alloc_storage");
+  auto ell = ExplicitLetList::make(func_->body);
+  const auto& vars = ell->vars;
+  const auto& exprs = ell->exprs;
+  StdMap<int64_t> lines;
+  for (size_t i = 0; i < vars.size(); ++i) {
+    if (exprs[i].as<IfNode>()) {
+      LOG(WARNING) << "Offset packing is disabled because of the control flow";
+      return;
+    }
+    lines[vars[i]] = i;
+  }
+
+  // The live interval of each dummy tensor.
+  StdMap<std::pair<int64_t, int64_t>> live_intervals;
+  for (size_t i = 0; i < vars.size(); ++i) {
+    for (const auto& tensor_var : analyzer_->GetLiveVars(vars[i])) {
+      auto it = live_intervals.find(tensor_var);
+      if (it == live_intervals.end()) {
+        live_intervals[tensor_var] = std::make_pair(i, i);
+      } else {
+        it->second.second = i;
+      }
+    }
+  }
+
+  struct PackedGroup {
+    size_t group_id;
+    int64_t size;
+    int64_t alignment;
+    int64_t start;
+    int64_t end;
+    int64_t offset;
+  };
+  std::vector<PackedGroup> packed;
+  auto& groups = tensor_groups_.groups;
+  Expr device_type, device_id;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    const auto& group = groups[i];
+    if (group.size <= 0 || group.members.empty() || tensor_groups_.HasOutputTensor(i) ||
+        lines.count(group.storage) == 0) {
+      continue;
+    }
+    // All packed tensors must be on the same device.
+    auto storage_call = Downcast<Call>(exprs[lines[group.storage]]);
+    CHECK(storage_call->op == alloc_storage_op);
+    if (!device_type.defined()) {
+      device_type = storage_call->args[2];
+      device_id = storage_call->args[3];
+    } else if (!tvm::StructuralEqual()(device_type, storage_call->args[2]) ||
+               !tvm::StructuralEqual()(device_id, storage_call->args[3])) {
+      LOG(WARNING) << "Offset packing is disabled because the tensors are on different devices";
+      return;
+    }
+    PackedGroup pg{i, group.size, group.alignment, lines[group.storage], lines[group.storage], -1};
+    for (const auto& member : group.members) {
+      int64_t line = lines.at(member.second.first);
+      pg.start = std::min(pg.start, line);
+      pg.end = std::max(pg.end, line);
+      auto it = live_intervals.find(member.first);
+      if (it != live_intervals.end()) {
+        pg.start = std::min(pg.start, it->second.first);
+        pg.end = std::max(pg.end, it->second.second);
+      }
+    }
+    packed.push_back(pg);
+  }
+  if (packed.size() < 2) {
+    return;
+  }
+
+  // Assign offsets from the largest group.
+  std::vector<size_t> order(packed.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return packed[a].size > packed[b].size; });
+  int64_t peak = 0;
+  int64_t alignment = 1;
+  std::vector<size_t> placed;
+  for (auto idx : order) {
+    auto& pg = packed[idx];
+    std::vector<size_t> conflicts;
+    for (auto other : placed) {
+      if (packed[other].start <= pg.end && pg.start <= packed[other].end) {
+        conflicts.push_back(other);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end(),
+              [&](size_t a, size_t b) { return packed[a].offset < packed[b].offset; });
+    auto align_up = [&](int64_t x) { return (x + pg.alignment - 1) / pg.alignment * pg.alignment; };
+    int64_t cursor = 0;
+    int64_t best_offset = -1;
+    int64_t best_gap = 0;
+    for (auto other : conflicts) {
+      int64_t gap_start = align_up(cursor);
+      int64_t gap = packed[other].offset - gap_start;
+      if (gap >= pg.size && (best_offset == -1 || gap < best_gap)) {
+        best_offset = gap_start;
+        best_gap = gap;
+      }
+      cursor = std::max(cursor, packed[other].offset + packed[other].size);
+    }
+    pg.offset = (best_offset == -1) ? align_up(cursor) : best_offset;
+    placed.push_back(idx);
+    peak = std::max(peak, pg.offset + pg.size);
+    alignment = std::max(alignment, pg.alignment);
+  }
+
+  // The lower bound is the peak total size of the live groups.
+  std::vector<int64_t> deltas(vars.size() + 1, 0);
+  int64_t total = 0;
+  for (const auto& pg : packed) {
+    deltas[pg.start] += pg.size;
+    deltas[pg.end + 1] -= pg.size;
+    total += pg.size;
+  }
+  int64_t lower_bound = 0;
+  int64_t live_bytes = 0;
+  for (auto delta : deltas) {
+    live_bytes += delta;
+    lower_bound = std::max(lower_bound, live_bytes);
+  }
+
+  // Merge the packed groups into the one whose storage is allocated first.
+  auto first = std::min_element(packed.begin(), packed.end(),
+                                [&](const PackedGroup& a, const PackedGroup& b) {
+                                  return lines[groups[a.group_id].storage] <
+                                         lines[groups[b.group_id].storage];
+                                });
+  auto& arena = groups[first->group_id];
+  for (const auto& pg : packed) {
+    auto& group = groups[pg.group_id];
+    for (const auto& member : group.members) {
+      arena.offsets[member.first] = pg.offset;
+      if (&group != &arena) {
+        arena.members[member.first] = member.second;
+      }
+    }
+    if (&group != &arena) {
+      group.members.clear();
+      group.size = 0;
+    }
+  }
+  arena.size = peak;
+  arena.alignment = alignment;
+
+  std::stringstream ss;
+  ss << "Offset packing of " << packed.size() << " tensors: peak " << peak / 1048576.0
+     << " MBs, lower bound " << lower_bound / 1048576.0 << " MBs, without sharing "
+     << total / 1048576.0 << " MBs";
+  if (dump_stat) {
+    LOG(INFO) << ss.str();
+  } else {
+    DLOG(INFO) << ss.str();
+  }
+}
+
 }  // namespace memory_plan
 
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.memory_plan.dump_liveness_stat", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.memory_plan.policy", String);
 
 Pass MemoryPlan() {
   PassContext pass_ctx = PassContext::Current();
   Bool dump_stat = pass_ctx->GetConfig("raf.memory_plan.dump_liveness_stat", Bool(false)).value();
+  std::string policy = pass_ctx->GetConfig<String>("raf.memory_plan.policy", "group").value();
   TypedPackedFunc<Function(Function, IRModule, PassContext)> pass_func = [=](Function f, IRModule m,
                                                                              PassContext pc) {
     auto func = f;
@@ -512,18 +709,19 @@ Pass MemoryPlan() {
 
     auto analyzer = liveness_analysis::LivenessAnalyzer(func);
     try {
-      auto live_in = analyzer.Run();
+      analyzer.Run();
       if (!analyzer.IsSuccess()) {
         throw;
       }
       if (dump_stat) {
-        liveness_analysis::DumpLivenessStat(live_in);
+        liveness_analysis::DumpLivenessStat(analyzer.GetLiveIn());
       }
     } catch (const dmlc::Error& e) {
       LOG(WARNING) << "Memory planning is disabled because liveness analysis was failed";
       return func;
     }
-    return Downcast<ir::Function>(memory_plan::MemoryPlanner(func, &analyzer).Run());
+    return Downcast<ir::Function>(
+        memory_plan::MemoryPlanner(func, &analyzer, policy, dump_stat).Run());
   };
   return CreateRAFFunctionPass(pass_func, 2, "MemoryPlan", {});
 }
@@ -7,8 +7,13 @@
  * \file src/pass/pass_manager.cc
  * \brief Infrastructure for transformation passes.
  */
+#include <sys/resource.h>
+#include <unistd.h>
 #include <tvm/node/repr_printer.h>
 
+#include <chrono>
+#include <fstream>
+
 #include "raf/file.h"
 #include "raf/pass.h"
 #include "raf/pass_manager.h"
@@ -108,6 +113,135 @@ std::string DumpAfterPassIRToFile(std::string dump_ir_path, const IRModule& mod,
   return dump_ir_path;
 }
 
+PassProfiler* PassProfiler::Get() {
+  static PassProfiler inst;
+  return &inst;
+}
+
+size_t PassProfiler::Begin(const std::string& seq_name, const std::string& pass_name,
+                           int depth) {
+  std::lock_guard<std::mutex> lock(mu_);
+  PassProfileRecord record;
+  record.seq_name = seq_name;
+  record.pass_name = pass_name;
+  record.depth = depth;
+  records_.push_back(std::move(record));
+  return records_.size() - 1;
+}
+
+void PassProfiler::End(size_t index, const PassProfileRecord& record) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (index < records_.size() && records_[index].elapsed_us < 0 &&
+      records_[index].pass_name == record.pass_name) {
+    records_[index] = record;
+  }
+}
+
+std::vector<PassProfileRecord> PassProfiler::GetRecords() {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<PassProfileRecord> ret;
+  for (const auto& record : records_) {
+    if (record.elapsed_us >= 0) {
+      ret.push_back(record);
+    }
+  }
+  return ret;
+}
+
+void PassProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(mu_);
+  records_.clear();
+}
+
+/*! \brief Count the distinct expression nodes without recursing into the let chains. */
+class NodeCounter : public MixedModeVisitor {
+ public:
+  using MixedModeVisitor::VisitExpr_;
+
+  void VisitExpr_(const LetNode* op) final {
+    auto pre_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->var);
+      this->VisitExpr(op->value);
+    };
+    auto post_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->body);
+      this->visit_counter_[op] += 1;
+    };
+    ExpandANormalForm(op, pre_visit, post_visit);
+  }
+
+  int64_t Count(const IRModule& mod) {
+    for (const auto& it : mod->functions) {
+      if (it.second->IsInstance<FunctionNode>()) {
+        VisitExpr(Downcast<Function>(it.second));
+      }
+    }
+    return visit_counter_.size();
+  }
+};
+
+/*! \brief Get the peak resident set size of the process in KBs. */
+inline int64_t GetPeakRSSKB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/*! \brief Get the resident set size of the process in KBs, or 0 if it is unknown. */
+inline int64_t GetRSSKB() {
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0, resident = 0;
+  if (!(statm >> size >> resident)) {
+    return 0;
+  }
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/*! \brief The number of the RAFSequential being run by the current thread. */
+thread_local int seq_depth = 0;
+
+/*! \brief Count a running RAFSequential in its scope. */
+struct SeqDepthGuard {
+  SeqDepthGuard() {
+    ++seq_depth;
+  }
+  ~SeqDepthGuard() {
+    --seq_depth;
+  }
+};
+
+/*!
+ * \brief Run a pass of a RAFSequential, and record its compile cost if the pass profiler is
+ * enabled.
+ * \param nodes The number of nodes of the module, or -1 if it is unknown. It is updated to the
+ * number of nodes of the module after the pass, so consecutive passes count a module once.
+ */
+IRModule RunPass(const Pass& pass, IRModule mod, const PassContext& pass_ctx,
+                 const std::string& seq_name, int64_t* nodes) {
+  auto* profiler = PassProfiler::Get();
+  if (!profiler->IsEnabled()) {
+    *nodes = -1;
+    return pass(std::move(mod), pass_ctx);
+  }
+  PassProfileRecord record;
+  record.seq_name = seq_name;
+  record.pass_name = pass->Info()->name;
+  record.depth = seq_depth - 1;
+  record.nodes_before = *nodes >= 0 ? *nodes : NodeCounter().Count(mod);
+  size_t index = profiler->Begin(seq_name, record.pass_name, record.depth);
+  int64_t peak_rss = GetPeakRSSKB(), rss = GetRSSKB();
+  auto start = std::chrono::steady_clock::now();
+  mod = pass(std::move(mod), pass_ctx);
+  auto end = std::chrono::steady_clock::now();
+  record.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  record.peak_rss_delta_kb = GetPeakRSSKB() - peak_rss;
+  record.rss_delta_kb = GetRSSKB() - rss;
+  record.nodes_after = NodeCounter().Count(mod);
+  *nodes = record.nodes_after;
+  profiler->End(index, record);
+  return mod;
+}
+
 // TODO(zhiics): we currenlty only sequentially execute each pass in
 // a RAFSequential without the consideration of their orders. The phase
 // ordering problem needs to be handled in the future.
@@ -129,15 +263,18 @@ IRModule RAFSequentialNode::operator()(IRModule mod, const PassContext& pass_ctx
   }
 
   size_t pass_cnt = 1;
+  int64_t nodes = -1;
+  std::string seq_name = pass_info->name;
+  SeqDepthGuard depth_guard;
   for (const Pass& pass : passes) {
     ICHECK(pass.defined()) << "Found undefined pass for optimization.";
     const PassInfo& pass_info = pass->Info();
     if (!pass_ctx.PassEnabled(pass_info)) continue;
     // resolve dependencies
     for (const auto& it : pass_info->required) {
-      mod = GetPass(it)(std::move(mod), pass_ctx);
+      mod = RunPass(GetPass(it), std::move(mod), pass_ctx, seq_name, &nodes);
     }
-    mod = pass(std::move(mod), pass_ctx);
+    mod = RunPass(pass, std::move(mod), pass_ctx, seq_name, &nodes);
     DumpAfterPassIRToFile(dump_ir_path, mod, pass_cnt++, pass_info->name);
   }
   return mod;
@@ -291,6 +428,31 @@ RAF_REGISTER_GLOBAL("raf.pass_.RAFSequential").set_body([](TVMArgs args, TVMRetV
   *ret = RAFSequential(passes, pass_info);
 });
 
+RAF_REGISTER_GLOBAL("raf.pass_.SetPassProfiling").set_body_typed([](bool enabled) {
+  PassProfiler::Get()->SetEnabled(enabled);
+});
+
+RAF_REGISTER_GLOBAL("raf.pass_.ResetPassProfile").set_body_typed([]() {
+  PassProfiler::Get()->Reset();
+});
+
+/*!
+ * \brief Get the records of the pass profiler. Each record is an array of
+ * [seq_name, pass_name, depth, elapsed_us, peak_rss_delta_kb, rss_delta_kb, nodes_before,
+ * nodes_after].
+ */
+RAF_REGISTER_GLOBAL("raf.pass_.GetPassProfile").set_body_typed([]() {
+  auto to_int = [](int64_t value) { return IntImm(DataType::Int(64), value); };
+  Array<Array<ObjectRef>> ret;
+  for (const auto& record : PassProfiler::Get()->GetRecords()) {
+    ret.push_back({String(record.seq_name), String(record.pass_name), to_int(record.depth),
+                   to_int(record.elapsed_us), to_int(record.peak_rss_delta_kb),
+                   to_int(record.rss_delta_kb), to_int(record.nodes_before),
+                   to_int(record.nodes_after)});
+  }
+  return ret;
+});
+
 TVM_STATIC_IR_FUNCTOR(ReprPrinter, vtable)
     .set_dispatch<RAFSequentialNode>([](const ObjectRef& ref, ReprPrinter* p) {
       auto* node = static_cast<const RAFSequentialNode*>(ref.get());
@@ -11,7 +11,7 @@
 #include "raf/op.h"
 #include "raf/ir.h"
 #include "raf/pass.h"
-#include "raf/op_profiler.h"
+#include "raf/cost_model.h"
 #include "./common.h"
 #include "./estimate_flops.h"
 #include "./let_list.h"
@@ -296,12 +296,12 @@ class Rematerializer : public ExprMutator {
  public:
   explicit Rematerializer(liveness_analysis::LivenessAnalyzer* analyzer, const Device& device,
                           const Function& func, const IRModule& mod, const int64_t budget,
-                          op_profiler::OpProfiler* profiler)
+                          cost_model::CostModel* cost_model)
       : analyzer_(analyzer),
         func_(func),
         budget_(budget),
-        profiler_(profiler),
-        tensor_infos_(AnalyzeTensors(device, func, mod, analyzer, profiler)) {
+        cost_model_(cost_model),
+        tensor_infos_(AnalyzeTensors(device, func, mod, analyzer, cost_model)) {
     scopes_.emplace_back(new LetList);
     VERBOSE_LOG << "Tensor infos:\n" << tensor_infos_.DebugDump();
   }
@@ -340,7 +340,7 @@ class Rematerializer : public ExprMutator {
     ss << "Estimated peak memory after rematerialization is " << peak_memory_ / kMegaBytes
        << " MBs; while the budget is " << budget_ / kMegaBytes << " MBs. " << n_recompute_ops_
        << " more ops were inserted";
-    if (profiler_) {
+    if (cost_model_) {
       ss << " with " << std::setw(2) << (total_recompute_cost_ / 1000.0) << " ms latency overhead";
     }
     LOG(INFO) << ss.str();
@@ -580,7 +580,7 @@ class Rematerializer : public ExprMutator {
 
   TensorInfos AnalyzeTensors(const Device& device, const Function& func, const IRModule& mod,
                              liveness_analysis::LivenessAnalyzer* analyzer,
-                             op_profiler::OpProfiler* profiler);
+                             cost_model::CostModel* cost_model);
 
   /*!
    * \brief Generate TupleGetItem or reshape to match the given type.
@@ -716,11 +716,8 @@ class Rematerializer : public ExprMutator {
 
     // Record for final report.
     n_recompute_ops_++;
-    if (profiler_) {
-      auto exec_time_and_ws_size = profiler_->ProfileOp(remat_call);
-      // Default is to repeat once, so we take the first element
-      auto compute_cost = exec_time_and_ws_size.first[0];
-      total_recompute_cost_ += compute_cost;
+    if (cost_model_) {
+      total_recompute_cost_ += cost_model_->EstimateOp(remat_call).latency;
     }
 
     // Update the let_var to be the rematerialized one and mark the tensor as live again.
@@ -838,8 +835,8 @@ class Rematerializer : public ExprMutator {
   StdMap<Expr> let_vars_;
   /*! \brief The liveness analyzer, including liveness analysis results. */
   liveness_analysis::LivenessAnalyzer* analyzer_;
-  /*! \brief The profiler used in rematerialization. */
-  op_profiler::OpProfiler* profiler_;
+  /*! \brief The cost model used in rematerialization, or nullptr to use GFLOPS as the cost. */
+  cost_model::CostModel* cost_model_;
   /*! \brief The memory budget in bytes. */
   int64_t budget_;
   /*! \brief The current memory consumption in bytes. */
@@ -861,10 +858,13 @@ class Rematerializer : public ExprMutator {
 class Rematerializer::TensorAnalyzer : public ExprVisitor {
  public:
   TensorAnalyzer(const Device& device, const Function& func, const IRModule& mod,
-                 liveness_analysis::LivenessAnalyzer* analyzer, op_profiler::OpProfiler* profiler)
-      : func_(func), analyzer_(analyzer), ell_(ExplicitLetList::make(func)), profiler_(profiler) {
+                 liveness_analysis::LivenessAnalyzer* analyzer, cost_model::CostModel* cost_model)
+      : func_(func),
+        analyzer_(analyzer),
+        ell_(ExplicitLetList::make(func)),
+        cost_model_(cost_model) {
     CHECK(analyzer_->IsSuccess());
-    if (!profiler_) {
+    if (!cost_model_) {
       op_flops_estimater_.Run(device, func, mod);
     }
   }
@@ -940,12 +940,11 @@ class Rematerializer::TensorAnalyzer : public ExprVisitor {
       if (op.defined() && IsNonDeterministicOp(op) && IsCollectiveOp(op)) {
         // Non-deterministic and collective ops cannot be recomputed
         compute_cost = std::numeric_limits<float>::max();
-      } else if (profiler_) {
-        // Try to profile the op
-        auto exec_time_and_ws_size = profiler_->ProfileOp(exprs[i]);
-        // Default is to repeat once, so we take the first element
-        compute_cost = exec_time_and_ws_size.first[0];
-        ws_size = exec_time_and_ws_size.second;
+      } else if (cost_model_) {
+        // Estimate the latency of the op
+        auto cost = cost_model_->EstimateOp(exprs[i]);
+        compute_cost = cost.latency;
+        ws_size = cost.workspace_size;
       } else {
         // Use FLOPS estimator instead, the workspace size won't be tracked in this case
         compute_cost = op_flops_estimater_.GetFLOPS(curr_let_);
@@ -981,8 +980,8 @@ class Rematerializer::TensorAnalyzer : public ExprVisitor {
   liveness_analysis::LivenessAnalyzer* analyzer_;
   /*! \brief The analyzed tensor infos. */
   TensorInfos tensor_infos_;
-  /*! \brief The profiler used in rematerialization. */
-  op_profiler::OpProfiler* profiler_;
+  /*! \brief The cost model used in rematerialization, or nullptr to use GFLOPS as the cost. */
+  cost_model::CostModel* cost_model_;
   /*! \brief A set of all let vars in the function. */
   VSet let_var_set_;
 };
@@ -990,21 +989,27 @@ class Rematerializer::TensorAnalyzer : public ExprVisitor {
 TensorInfos Rematerializer::AnalyzeTensors(const Device& device, const Function& func,
                                            const IRModule& mod,
                                            liveness_analysis::LivenessAnalyzer* analyzer,
-                                           op_profiler::OpProfiler* profiler) {
-  return TensorAnalyzer(device, func, mod, analyzer, profiler).Run();
+                                           cost_model::CostModel* cost_model) {
+  return TensorAnalyzer(device, func, mod, analyzer, cost_model).Run();
 }
 
 }  // namespace rematerialization
 
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.memory_budget", IntImm);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.remat.use_gflops_cost", IntImm);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.remat.cost_model", String);
 
 Pass Rematerialization() {
   PassContext pass_ctx = PassContext::Current();
   Integer memory_budget =
       pass_ctx->GetConfig("raf.memory_budget", Integer(static_cast<int>(0))).value();
-  // Turn profiler on by default. With caching it is pretty fast now.
-  bool use_profiler = !(pass_ctx->GetConfig("raf.remat.use_gflops_cost", Bool(false)).value());
+  // Turn profiler on by default. With caching it is pretty fast now. The cost model can be
+  // "profiler", "roofline", or "gflops" to use the GFLOPS of each op as its cost.
+  std::string cost_model_name =
+      pass_ctx->GetConfig("raf.remat.cost_model", String("profiler")).value();
+  if (pass_ctx->GetConfig("raf.remat.use_gflops_cost", Bool(false)).value()) {
+    cost_model_name = "gflops";
+  }
   TypedPackedFunc<Function(Function, IRModule, PassContext)> pass_func = [=](Function f, IRModule m,
                                                                              PassContext pc) {
     // We use budget 0 to diable this pass because it is guaranteed to fail.
@@ -1027,16 +1032,18 @@ Pass Rematerialization() {
       return f;
     }
 
-    op_profiler::OpProfiler* profiler = nullptr;
-    if (use_profiler) {
-      LOG(INFO)
-          << "Using profiler-based cost estimation for rematerialization. This may take a while. ";
-      profiler = op_profiler::OpProfiler::Get(device);
+    cost_model::CostModelPtr cost_model;
+    if (cost_model_name != "gflops") {
+      // Only the profiler runs every op, which is slow on large models.
+      LOG(INFO) << "Using " << cost_model_name << "-based cost estimation for rematerialization."
+                << (cost_model_name == "profiler" ? " This may take a while." : "");
+      cost_model = cost_model::CostModel::Make(cost_model_name, device);
     } else {
       LOG(INFO) << "Using GFLOPS-based cost estimation. ";
     }
-    return Downcast<Function>(
-        rematerialization::Rematerializer(&analyzer, device, f, m, memory_budget, profiler).Run());
+    return Downcast<Function>(rematerialization::Rematerializer(&analyzer, device, f, m,
+                                                                memory_budget, cost_model.get())
+                                  .Run());
   };
 
   Pass func_pass = CreateRAFFunctionPass(pass_func, 2, "RematerializationHelper", {});
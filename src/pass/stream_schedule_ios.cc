@@ -16,7 +16,7 @@
 #include "raf/pass.h"
 #include "raf/analysis.h"
 #include "raf/op.h"
-#include "raf/op_profiler.h"
+#include "raf/cost_model.h"
 #include "raf/op_utils.h"
 #include "raf/profiler.h"
 #include "./stream_schedule.h"
@@ -73,7 +73,6 @@ inline int CountOneBits(uint64_t v) {
   return c;
 }
 
-#ifdef RAF_USE_CUDA
 /*!
  * \brief The cost model of IOS scheduler. It profile the latency of IOS proposed stage on device.
  *
@@ -88,72 +87,48 @@ inline int CountOneBits(uint64_t v) {
  * This gives us the flexibility to profile (we can control the times of warmup and repeat). It is
  * also the most efficient way to profile. This decision is a trade-off between the profiling
  * accuracy and the compilation time.
+ *
+ * Alternatively, the "roofline" cost model estimates the stage latency analytically, which does
+ * not run any kernel and works without the device.
  */
 class IOSCostModel {
-  using OpEnvCache = MetaCache<std::shared_ptr<OpEnv>>;
-
  public:
   /*!
    * \brief The IOS cost model.
-   * \param device The target device. Must be a cuda device.
-   * \param num_stream The maximum number of streams to support.
+   * \param device The target device, which must be a CUDA device for the profiler cost model.
+   * \param cost_model The name of the underlying cost model.
    * \param warmup The number of warmups before real execution.
    * \param number The number of executions as a repeat.
    * \param repeat The number of repeat times.
    */
-  IOSCostModel(Device device, int warmup, int number, int repeat) {
-    CHECK_EQ(device.device_type(), DevType::kCUDA()) << "IOS cost model only supports CUDA.";
-    this->device_ = device;
-    this->warmup_ = warmup;
-    this->number_ = number;
-    this->repeat_ = repeat;
-    this->profiler_ = op_profiler::OpProfiler::Get(device);
+  IOSCostModel(Device device, const std::string& cost_model, int warmup, int number, int repeat) {
+    if (cost_model == "profiler") {
+#ifndef RAF_USE_CUDA
+      LOG(FATAL) << "Please build with CUDA enabled to use IOS schedule with the profiler cost "
+                 << "model, or set raf.stream_schedule.ios.cost_model to roofline.";
+#endif
+      CHECK_EQ(device.device_type(), DevType::kCUDA())
+          << "The profiler cost model of IOS only supports CUDA, but the target device is "
+          << device.c_str() << ". Set raf.stream_schedule.ios.cost_model to roofline instead.";
+    }
+    Map<String, ObjectRef> options = {
+        {"warmup", Integer(warmup)}, {"number", Integer(number)}, {"repeat", Integer(repeat)}};
+    this->cost_model_ = cost_model::CostModel::Make(cost_model, device, options);
   }
 
   /*!
    * \brief Measure the latency of a stage (consists of multiple independent groups).
-   * \param groups The independent groups.
+   * \param groups The independent groups. The i-th group is assigned to the i-th stream.
    * \return The latency of the stage.
    */
   std::vector<float> StageLatency(const std::vector<std::vector<Expr>>& groups) {
-    std::vector<Expr> flat_group;
-    std::vector<int> stream_ids;
-    for (size_t i = 0; i < groups.size(); i++) {
-      auto group = groups[i];
-      for (auto& expr : group) {
-        flat_group.push_back(expr);
-        stream_ids.push_back(i);  // The i-th group is assigned to the i-th stream.
-      }
-    }
-    auto prof_res = profiler_->ProfileOpGroup(flat_group, stream_ids, warmup_, number_, repeat_);
-    return prof_res.first;
+    return cost_model_->EstimateStage(groups);
   }
 
  private:
-  /*The following data are configs. */
-
-  /*! \brief Target device to profile on. */
-  Device device_;
-  /*! \brief Number of warmups. */
-  int warmup_;
-  /*! \brief The number of executions as a repeat.*/
-  int number_;
-  /*! \brief The number of repeat times. */
-  int repeat_;
-  /*! \brief The op profiler. */
-  op_profiler::OpProfiler* profiler_;
+  /*! \brief The underlying cost model. */
+  cost_model::CostModelPtr cost_model_;
 };
-#else
-class IOSCostModel {
- public:
-  IOSCostModel(Device device, int warmup, int number, int repeat) {
-    LOG(FATAL) << "Please build with CUDA enabled to use IOS schedule.";
-  }
-  std::vector<float> StageLatency(const std::vector<std::vector<Expr>>& groups) {
-    return {};
-  }
-};
-#endif
 
 class IOSScheduler : public StreamSchedulerBase {
   /*! \brief A group of nodes. */
@@ -191,6 +166,7 @@ class IOSScheduler : public StreamSchedulerBase {
    * even if they have already satisfied the stream constraint. This may slower the scheduling.
    * \param schedule_units The schedule units. A schedule unit is a sequence of operators. We will
    * schedule the model based on these units. This helps to reduce the search complexity.
+   * \param cost_model The name of the cost model to measure the stage latency.
    * \param warmup The number of warmups before real execution.
    * \param number The number of executions as a repeat.
    * \param repeat The number of repeat times.
@@ -198,9 +174,10 @@ class IOSScheduler : public StreamSchedulerBase {
    */
   explicit IOSScheduler(Device device, int max_block_size = 20, int max_stream_num = 5,
                         int max_stage_ops = 10, bool search_group_combination = true,
-                        Array<Array<Op>> schedule_units = {}, int warmup = 2, int number = 5,
+                        Array<Array<Op>> schedule_units = {},
+                        const std::string& cost_model = "profiler", int warmup = 2, int number = 5,
                         int repeat = 5, bool verbose = false)
-      : cost_model_(device, warmup, number, repeat), verbose_(this, verbose) {
+      : cost_model_(device, cost_model, warmup, number, repeat), verbose_(this, verbose) {
     CHECK_GE(max_stream_num, 1) << "Stream number must be greater or equal to 1, but got "
                                 << max_stream_num;
     CHECK_LE(max_block_size, 64) << "Only support maximum block size less or equal to 64, but got "
@@ -946,10 +923,11 @@ class IOSScheduler : public StreamSchedulerBase {
 Expr IOSStreamSchedule(const Expr& e, Device device, int block_max_size = 20,
                        int max_stream_num = 5, int max_stage_ops = 10,
                        bool search_group_combination = true, Array<Array<Op>> schedule_units = {},
-                       int warmup = 1, int number = 5, int repeat = 5, bool verbose = false) {
+                       const std::string& cost_model = "profiler", int warmup = 1, int number = 5,
+                       int repeat = 5, bool verbose = false) {
   IOSScheduler scheduler(device, block_max_size, max_stream_num, max_stage_ops,
-                         search_group_combination, std::move(schedule_units), warmup, number,
-                         repeat, verbose);
+                         search_group_combination, std::move(schedule_units), cost_model, warmup,
+                         number, repeat, verbose);
   return scheduler.Schedule(e);
 }
 
@@ -976,6 +954,8 @@ Pass IOSStreamSchedule() {
   int number = get_int_config("number", 1);
   int repeat = get_int_config("repeat", 8);
   bool verbose = get_bool_config("verbose", true);
+  std::string cost_model =
+      ctx->GetConfig<String>("raf.stream_schedule.ios.cost_model", String("profiler")).value();
   Array<Array<Op>> schedule_units =
       ctx->GetConfig<Array<Array<Op>>>("raf.stream_schedule.ios.schedule_units", Array<Array<Op>>())
           .value();
@@ -988,10 +968,15 @@ Pass IOSStreamSchedule() {
 
   tvm::TypedPackedFunc<Function(Function, IRModule, PassContext)> pass_func =
       [=](Function f, IRModule m, PassContext pc) {
+        // Schedule for the device in scope, which is the first GPU by default.
+        Device device = Device::Current();
+        if (device.device_type() == DevType::kUnknown()) {
+          device = Device(DevType::kCUDA(), 0);
+        }
         auto transform = [=](Expr e) {
           return ios_stream_schedule::IOSStreamSchedule(
-              e, Device(DevType::kCUDA(), 0), block_max_size, max_stream_num, max_stage_ops,
-              search_group_combination, schedule_units, warmup, number, repeat, verbose);
+              e, device, block_max_size, max_stream_num, max_stage_ops, search_group_combination,
+              schedule_units, cost_model, warmup, number, repeat, verbose);
         };
         return Downcast<Function>(tvm::relay::TransformF(transform, f));
       };
@@ -1007,6 +992,7 @@ TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.warmup", tvm::Integer);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.number", tvm::Integer);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.repeat", tvm::Integer);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.verbose", tvm::Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.cost_model", String);
 TVM_REGISTER_PASS_CONFIG_OPTION("raf.stream_schedule.ios.schedule_units", Array<Array<Op>>);
 }  // namespace pass
 }  // namespace raf
@@ -43,7 +43,8 @@ class TypeInferencer : public ExprMutator {
   RAF_NODE_NOT_IMPL(RefCreateNode)
 
  public:
-  TypeInferencer(IRModule& mod) : mod_(mod) {
+  TypeInferencer(IRModule& mod, bool incremental = false)
+      : mod_(mod), incremental_(incremental) {
   }
 
   Type GetValueType(const Value& v) {
@@ -62,6 +63,9 @@ class TypeInferencer : public ExprMutator {
       } else {
         var->checked_type_ = IncompleteType(kType);
       }
+      if (incremental_) {
+        dirty_vars_.insert(var.get());
+      }
     }
     return var;
   }
@@ -246,7 +250,9 @@ class TypeInferencer : public ExprMutator {
       curr_fn = WithFields(curr_fn, new_params);
       UpdateFuncParamVarMap(curr_fn.as<FunctionNode>(), call->args);
     }
+    ++closure_depth_;
     curr_fn = Downcast<Function>(VisitExpr(curr_fn));
+    --closure_depth_;
 
     // Mark both the original and updated closure as visited because they are not allowed
     // to be updated anymore.
@@ -268,6 +274,10 @@ class TypeInferencer : public ExprMutator {
       } else {
         var_value_map_[fn->params[i].get()] = arg;
       }
+      if (incremental_) {
+        // The value of the param may change without changing its type, e.g., a shape constant.
+        dirty_vars_.insert(fn->params[i].get());
+      }
     }
   }
 
@@ -281,7 +291,9 @@ class TypeInferencer : public ExprMutator {
       return;
     }
     UpdateFuncParamVarMap(fn, args);
+    ++closure_depth_;
     auto new_fn = VisitExpr(GetRef<Function>(fn));
+    --closure_depth_;
     fn_var->checked_type_ = new_fn->checked_type();
     var_value_map_[fn_var] = new_fn;
   }
@@ -317,10 +329,23 @@ class TypeInferencer : public ExprMutator {
   }
 
   Expr VisitExpr_(const LetNode* op) override {
-    auto pre_visit = [this](const LetNode* op) {
+    // The bindings reused by the incremental inference.
+    std::unordered_set<const LetNode*> reused;
+    bool incremental = incremental_ && IsIncrementalChain(op);
+    auto pre_visit = [this, incremental, &reused](const LetNode* op) {
+      if (incremental && IsUnchangedBinding(op)) {
+        reused.insert(op);
+        BindValue(op->var, op->value);
+        ++num_reused_;
+        return;
+      }
+      if (incremental) {
+        ++num_inferred_;
+      }
       Expr ovalue = op->value;
       Var var = op->var;
       Expr value = ovalue;
+      Type old_type = var->checked_type_;
 
       // Do not infer binded primitive functions here. Since we may need the caller arguments
       // to infer types of function body, we defer type inference of primitive function to its
@@ -330,26 +355,36 @@ class TypeInferencer : public ExprMutator {
       if (infer_body) {
         value = VisitExpr(ovalue);
       }
+      if (incremental) {
+        MarkUsersIfChanged(var, old_type, value);
+      }
 
       if (value.as<ConstantNode>()) {
         this->memo_[var] = value;
         return;
       }
 
-      const VarNode* v = value.as<VarNode>();
-      if (v && var_value_map_.count(v)) {
-        var_value_map_[op->var.get()] = var_value_map_[v];
-      } else {
-        var_value_map_[op->var.get()] = value;
-      }
+      BindValue(var, value);
 
       // If the binded primitive function has not been inferred, then it does not have the type yet.
       if (infer_body) {
         var->checked_type_ = value->checked_type();
       }
     };
-    auto post_visit = [this](const LetNode* op) {
+    auto post_visit = [this, &reused](const LetNode* op) {
       auto expr = GetRef<Expr>(op);
+      if (reused.count(op)) {
+        Expr body = this->VisitExpr(op->body);
+        if (body.same_as(op->body)) {
+          op->checked_type_ = body->checked_type();
+          this->memo_[expr] = expr;
+        } else {
+          Let let(op->var, op->value, body);
+          let->checked_type_ = body->checked_type();
+          this->memo_[expr] = let;
+        }
+        return;
+      }
       Expr ovalue = op->value;
       Var var = op->var;
       Expr value = ovalue;
@@ -376,6 +411,102 @@ class TypeInferencer : public ExprMutator {
     return memo_[GetRef<Expr>(op)];
   }
 
+  /*! \brief Track the value of a let var, following the var aliases. */
+  void BindValue(const Var& var, const Expr& value) {
+    const VarNode* v = value.as<VarNode>();
+    if (v && var_value_map_.count(v)) {
+      var_value_map_[var.get()] = var_value_map_[v];
+    } else {
+      var_value_map_[var.get()] = value;
+    }
+  }
+
+  /*!
+   * \brief Check whether the bindings of a let chain can be reused. The chains in closures, or with
+   * closures or branches, are fully inferred, as the closures are inferred with the arguments of
+   * the callers.
+   */
+  bool IsIncrementalChain(const LetNode* op) {
+    static const Op& invoke_op = Op::Get("raf.op.vm.invoke_op");
+    if (closure_depth_ > 0) {
+      // The params of a closure are updated by its callers, so its body is fully inferred.
+      return false;
+    }
+    Expr expr = GetRef<Expr>(op);
+    while (const auto* let = expr.as<LetNode>()) {
+      const Expr& value = let->value;
+      if (value->IsInstance<FunctionNode>() || value->IsInstance<GlobalVarNode>() ||
+          value->IsInstance<IfNode>()) {
+        return false;
+      }
+      if (const auto* call = value.as<CallNode>()) {
+        if (call->op->IsInstance<VarNode>() || call->op.same_as(invoke_op)) {
+          return false;
+        }
+      }
+      expr = let->body;
+    }
+    return true;
+  }
+
+  /*! \brief Check whether an argument of a binding keeps its type from the last inference. */
+  bool IsUnchangedArg(const Expr& arg) {
+    if (const auto* var = arg.as<VarNode>()) {
+      return var->checked_type_.defined() && dirty_vars_.count(var) == 0;
+    }
+    return arg->IsInstance<RelayConstantNode>() && arg->checked_type_.defined();
+  }
+
+  /*!
+   * \brief Check whether a binding keeps its type from the last inference, i.e., its value is
+   * typed and is not changed since then, and its arguments keep their types.
+   */
+  bool IsUnchangedBinding(const LetNode* op) {
+    const Expr& value = op->value;
+    if (!value->checked_type_.defined() || !op->var->checked_type_.same_as(value->checked_type_)) {
+      return false;
+    }
+    auto unchanged_args = [this](const Array<Expr>& args) {
+      for (const auto& arg : args) {
+        if (!IsUnchangedArg(arg)) {
+          return false;
+        }
+      }
+      return true;
+    };
+    if (const auto* call = value.as<CallNode>()) {
+      // Primitive functions are closed, so they only depend on the arguments.
+      const auto* fn = call->op.as<FunctionNode>();
+      bool closed = call->op->IsInstance<OpNode>() || (fn && fn->HasNonzeroAttr(attr::kPrimitive));
+      return closed && unchanged_args(call->args);
+    } else if (const auto* tuple = value.as<TupleNode>()) {
+      return unchanged_args(tuple->fields);
+    } else if (const auto* tgi = value.as<TupleGetItemNode>()) {
+      return IsUnchangedArg(tgi->tuple);
+    } else if (value->IsInstance<VarNode>()) {
+      return IsUnchangedArg(value);
+    }
+    return false;
+  }
+
+  /*!
+   * \brief Mark the users of a re-inferred binding to be re-inferred, if its type changes, or if
+   * its users may depend on its value, e.g., a constant or a tuple of constants.
+   */
+  void MarkUsersIfChanged(const Var& var, const Type& old_type, const Expr& value) {
+    bool by_type = value->IsInstance<CallNode>() || value->IsInstance<TupleGetItemNode>();
+    const Type& new_type = value->checked_type_;
+    if (!by_type || !old_type.defined() || !new_type.defined() ||
+        old_type->IsInstance<IncompleteTypeNode>() || !tvm::StructuralEqual()(old_type, new_type)) {
+      dirty_vars_.insert(var.get());
+    }
+  }
+
+  /*! \brief The number of the bindings that are re-inferred and reused. */
+  std::pair<int64_t, int64_t> GetStats() const {
+    return {num_inferred_, num_reused_};
+  }
+
   Expr VisitExpr_(const TupleNode* op) override {
     Array<Expr> fields;
     Array<Type> types;
@@ -441,6 +572,15 @@ class TypeInferencer : public ExprMutator {
   std::unordered_map<Var, Var, ObjectPtrHash, ObjectPtrEqual> closure_param_map_;
   /*! \brief Track visited Expr to avoid indefinite recursion in IR with recursive functions */
   std::unordered_set<Expr, ObjectPtrHash, ObjectPtrEqual> visited_;
+  /*! \brief Whether to reuse the bindings that keep their types from the last inference. */
+  bool incremental_;
+  /*! \brief The vars whose bindings are re-inferred with changes that affect their users. */
+  std::unordered_set<const VarNode*> dirty_vars_;
+  /*! \brief The number of the closures being inferred with the arguments of their callers. */
+  int closure_depth_ = 0;
+  /*! \brief The number of the bindings that are re-inferred and reused incrementally. */
+  int64_t num_inferred_ = 0;
+  int64_t num_reused_ = 0;
 };
 
 class Unifier : public TypeFunctor<Type(const Type&, const Type&)> {
@@ -611,24 +751,94 @@ void AddGlobalTypes(ir::IRModule mod) {
   }
 }
 
+/*! \brief Infer the types of the functions in a module. */
+ir::IRModule InferModuleTypes(const ir::IRModule& mod, bool incremental) {
+  ir::IRModule updated_mod = ir::IRModule(mod->functions);
+  AddGlobalTypes(updated_mod);
+  auto ti = type_infer::TypeInferencer(updated_mod, incremental);
+  for (auto kv : updated_mod->functions) {
+    if (kv.second.as<ir::FunctionNode>()) {
+      auto func = tvm::runtime::Downcast<ir::Function>(ti.VisitExpr(kv.second));
+      updated_mod->Add(kv.first, func, true);
+    }
+  }
+  if (incremental) {
+    auto stats = ti.GetStats();
+    DLOG(INFO) << "pass::InferType re-inferred " << stats.first << " bindings and reused "
+               << stats.second << " bindings";
+  }
+  return updated_mod;
+}
+
+/*! \brief The type of a function and the types of its top-level let bindings in order. */
+using FunctionTypes = std::pair<ir::Type, std::vector<std::pair<ir::Var, ir::Type>>>;
+
+FunctionTypes GetFunctionTypes(const ir::Function& func) {
+  FunctionTypes ret{func->checked_type(), {}};
+  ir::Expr expr = func->body;
+  while (const auto* let = expr.as<ir::LetNode>()) {
+    ret.second.emplace_back(let->var, let->value->checked_type());
+    expr = let->body;
+  }
+  return ret;
+}
+
+/*!
+ * \brief Check the types inferred incrementally against a full inference of the module.
+ * \param incremental_mod The module with the types inferred incrementally.
+ * \param mod The module before the inference.
+ */
+void ValidateIncrementalTypes(const ir::IRModule& incremental_mod, const ir::IRModule& mod) {
+  // The types are collected before the full inference, as it updates the types of the vars.
+  std::unordered_map<std::string, FunctionTypes> expected;
+  for (const auto& kv : incremental_mod->functions) {
+    if (const auto* func = kv.second.as<ir::FunctionNode>()) {
+      expected[kv.first->name_hint] = GetFunctionTypes(GetRef<ir::Function>(func));
+    }
+  }
+  ir::IRModule full_mod = InferModuleTypes(mod, false);
+  tvm::StructuralEqual equal;
+  for (const auto& kv : full_mod->functions) {
+    const auto* func = kv.second.as<ir::FunctionNode>();
+    if (func == nullptr) {
+      continue;
+    }
+    const std::string& name = kv.first->name_hint;
+    const FunctionTypes& inc = expected.at(name);
+    FunctionTypes full = GetFunctionTypes(GetRef<ir::Function>(func));
+    CHECK_EQ(inc.second.size(), full.second.size())
+        << "The incremental type inference of " << name << " has " << inc.second.size()
+        << " bindings, while the full inference has " << full.second.size();
+    for (size_t i = 0; i < full.second.size(); ++i) {
+      CHECK(equal(inc.second[i].second, full.second[i].second))
+          << "The incremental type inference of " << name << " mismatches the full inference at "
+          << full.second[i].first->name_hint() << ": `" << PrettyPrint(inc.second[i].second)
+          << "` vs. `" << PrettyPrint(full.second[i].second) << "`";
+    }
+    CHECK(equal(inc.first, full.first))
+        << "The incremental type inference of " << name << " mismatches the full inference: `"
+        << PrettyPrint(inc.first) << "` vs. `" << PrettyPrint(full.first) << "`";
+  }
+}
+
 Pass InferType() {
   return CreateModulePass(
       [=](IRModule mod, const PassContext& pass_ctx) {
         DLOG(INFO) << "pass::InferType";
-        ir::IRModule updated_mod = ir::IRModule(mod->functions);
-        AddGlobalTypes(updated_mod);
-        auto ti = type_infer::TypeInferencer(updated_mod);
-        for (auto kv : updated_mod->functions) {
-          if (kv.second.as<ir::FunctionNode>()) {
-            auto func = tvm::runtime::Downcast<ir::Function>(ti.VisitExpr(kv.second));
-            updated_mod->Add(kv.first, func, true);
-          }
+        bool incremental = pass_ctx->GetConfig("raf.type_infer.incremental", Bool(false)).value();
+        ir::IRModule updated_mod = InferModuleTypes(mod, incremental);
+        if (incremental && pass_ctx->GetConfig("raf.type_infer.validate", Bool(false)).value()) {
+          ValidateIncrementalTypes(updated_mod, mod);
         }
         return updated_mod;
       },
       0, "InferType", {});
 }
 
+void MarkBindingChanged(const ir::Var& var) {
+  var->checked_type_ = ir::Type();
+}
+
 Expr InferType(Expr func) {
   auto mod = GlobalModule();
   return type_infer::TypeInferencer(mod).VisitExpr(func);
@@ -675,6 +885,9 @@ Expr InferTypeWithModule(const Expr& expr, const IRModule& m) {
   return ret;
 }
 
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.type_infer.incremental", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.type_infer.validate", Bool);
+
 RAF_REGISTER_GLOBAL("raf.pass_.InferType").set_body_typed([]() { return InferType(); });
 
 }  // namespace pass
@@ -0,0 +1,283 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file view_utils.cc
+ * \brief Utilities for replacing layout ops with views of their inputs.
+ */
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include "raf/device.h"
+#include "raf/op.h"
+#include "raf/value.h"
+#include "tvm/relay/attrs/memory.h"
+#include "../op/schema/transform.h"
+#include "./common.h"
+#include "./view_utils.h"
+
+namespace raf {
+namespace pass {
+namespace view_utils {
+
+using namespace raf::op;
+using namespace raf::op::schema;
+using namespace raf::value;
+
+/*! \brief The layout of a view in its base tensor, in elements. */
+struct StridedLayout {
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  int64_t offset = 0;
+};
+
+bool GetStaticShape(const Type& type, std::vector<int64_t>* shape) {
+  const auto* ttype = type.as<TensorTypeNode>();
+  if (ttype == nullptr) {
+    return false;
+  }
+  for (const auto& dim : ttype->shape) {
+    const auto* imm = dim.as<IntImmNode>();
+    if (imm == nullptr) {
+      return false;
+    }
+    shape->push_back(imm->value);
+  }
+  return true;
+}
+
+bool GetIntTuple(const Value& value, std::vector<int64_t>* ints) {
+  const auto* tuple = value.as<TupleValueObj>();
+  if (tuple == nullptr) {
+    return false;
+  }
+  for (const auto& field : tuple->fields) {
+    const auto* int_value = field.as<IntValueObj>();
+    if (int_value == nullptr) {
+      return false;
+    }
+    ints->push_back(int_value->value);
+  }
+  return true;
+}
+
+StridedLayout CompactLayout(const std::vector<int64_t>& shape) {
+  StridedLayout layout;
+  layout.shape = shape;
+  layout.strides.resize(shape.size());
+  int64_t stride = 1;
+  for (int i = static_cast<int>(shape.size()) - 1; i >= 0; --i) {
+    layout.strides[i] = stride;
+    stride *= shape[i];
+  }
+  return layout;
+}
+
+/*! \brief Whether the elements of the layout are adjacent and in order. Unit axes are ignored. */
+bool IsContiguous(const StridedLayout& layout) {
+  for (auto dim : layout.shape) {
+    if (dim == 0) {
+      return true;
+    }
+  }
+  int64_t expected = 1;
+  for (int i = static_cast<int>(layout.shape.size()) - 1; i >= 0; --i) {
+    if (layout.shape[i] == 1) {
+      continue;
+    }
+    if (layout.strides[i] != expected) {
+      return false;
+    }
+    expected *= layout.shape[i];
+  }
+  return true;
+}
+
+bool Permute(const StridedLayout& input, const std::vector<int64_t>& axes, StridedLayout* output) {
+  const int64_t ndim = input.shape.size();
+  if (static_cast<int64_t>(axes.size()) != ndim) {
+    return false;
+  }
+  output->offset = input.offset;
+  for (auto axis : axes) {
+    axis = axis >= 0 ? axis : axis + ndim;
+    if (axis < 0 || axis >= ndim) {
+      return false;
+    }
+    output->shape.push_back(input.shape[axis]);
+    output->strides.push_back(input.strides[axis]);
+  }
+  return true;
+}
+
+/*! \brief Slice the layout in the same way as the declaration of strided_slice. */
+bool StridedSlice(const StridedLayout& input, const StridedSliceArgs* args,
+                  StridedLayout* output) {
+  const int64_t ndim = input.shape.size();
+  const int64_t max_range = std::numeric_limits<int64_t>::max();
+  std::vector<int64_t> begin, end;
+  if (!GetIntTuple(args->begin, &begin) || !GetIntTuple(args->end, &end) ||
+      begin.size() != end.size() || static_cast<int64_t>(begin.size()) > ndim) {
+    return false;
+  }
+  std::vector<int64_t> steps(ndim, 1);
+  if (args->slice_mode == "end") {
+    if (args->strides.size() != begin.size()) {
+      return false;
+    }
+    std::copy(args->strides.begin(), args->strides.end(), steps.begin());
+  } else if (args->slice_mode != "size") {
+    return false;
+  }
+  *output = input;
+  for (int64_t i = 0; i < ndim; ++i) {
+    int64_t step = steps[i];
+    if (step <= 0) {
+      // Reversed slices are not replaced by views.
+      return false;
+    }
+    int64_t begin_v = i < static_cast<int64_t>(begin.size()) ? begin[i] : 0;
+    int64_t end_v = max_range;
+    if (i < static_cast<int64_t>(end.size())) {
+      if (args->slice_mode == "size") {
+        end_v = end[i] < 0 ? max_range : begin_v + end[i];
+      } else {
+        end_v = end[i];
+      }
+    }
+    const int64_t dim = input.shape[i];
+    begin_v = begin_v < 0 ? std::max<int64_t>(0, dim + begin_v) : begin_v;
+    end_v = end_v < 0 ? dim + end_v : std::min(dim, end_v);
+    if (begin_v > end_v) {
+      return false;
+    }
+    output->offset += begin_v * input.strides[i];
+    output->shape[i] = (end_v - begin_v + step - 1) / step;
+    output->strides[i] = input.strides[i] * step;
+  }
+  return true;
+}
+
+bool Split(const StridedLayout& input, const SplitArgs* args, std::vector<StridedLayout>* outputs) {
+  const int64_t ndim = input.shape.size();
+  const int64_t axis = args->axis >= 0 ? args->axis : args->axis + ndim;
+  if (axis < 0 || axis >= ndim) {
+    return false;
+  }
+  const int64_t dim = input.shape[axis];
+  std::vector<int64_t> indices;
+  if (const auto* sections = args->indices_or_sections.as<IntValueObj>()) {
+    if (sections->value <= 0 || dim % sections->value != 0) {
+      return false;
+    }
+    for (int64_t i = 1; i < sections->value; ++i) {
+      indices.push_back(dim / sections->value * i);
+    }
+  } else if (!GetIntTuple(args->indices_or_sections, &indices)) {
+    return false;
+  }
+  indices.push_back(dim);
+  int64_t begin = 0;
+  for (auto end : indices) {
+    if (end < begin || end > dim) {
+      return false;
+    }
+    StridedLayout output = input;
+    output.shape[axis] = end - begin;
+    output.offset += begin * input.strides[axis];
+    outputs->push_back(output);
+    begin = end;
+  }
+  return true;
+}
+
+bool GetContiguousViews(const Call& call, std::vector<ContiguousView>* views) {
+  static const Op& transpose_op = Op::Get("raf.op.transpose");
+  static const Op& swap_axis_op = Op::Get("raf.op.swap_axis");
+  static const Op& strided_slice_op = Op::Get("raf.op.strided_slice");
+  static const Op& split_op = Op::Get("raf.op.split");
+  static auto fschema = Op::GetAttrMap<FRAFSchema>("FRAFSchema");
+
+  const auto* op_node = call->op.as<OpNode>();
+  if (op_node == nullptr || call->args.empty() || !call->checked_type_.defined()) {
+    return false;
+  }
+  Op op = GetRef<Op>(op_node);
+  if (IsDialectOp(op)) {
+    op = GetBaseOp(op);
+  }
+  if (op != transpose_op && op != swap_axis_op && op != strided_slice_op && op != split_op) {
+    return false;
+  }
+  std::vector<int64_t> ishape;
+  if (!call->args[0]->IsInstance<VarNode>() || !call->args[0]->checked_type_.defined() ||
+      !GetStaticShape(call->args[0]->checked_type(), &ishape)) {
+    return false;
+  }
+
+  Array<Value> arg_values;
+  for (const auto& arg : call->args) {
+    arg_values.push_back(GetValue(arg));
+  }
+  auto args = fschema[op](arg_values);
+  StridedLayout input = CompactLayout(ishape);
+  std::vector<StridedLayout> outputs(1);
+  bool valid = false;
+  if (op == transpose_op) {
+    std::vector<int64_t> axes = args.as<TransposeArgs>()->axes;
+    if (axes.empty()) {
+      for (int64_t i = static_cast<int64_t>(ishape.size()) - 1; i >= 0; --i) {
+        axes.push_back(i);
+      }
+    }
+    valid = Permute(input, axes, &outputs[0]);
+  } else if (op == swap_axis_op) {
+    const auto* swap_args = args.as<SwapAxisArgs>();
+    std::vector<int64_t> axes(ishape.size());
+    std::iota(axes.begin(), axes.end(), 0);
+    if (swap_args->axis1 >= 0 && swap_args->axis1 < static_cast<int>(axes.size()) &&
+        swap_args->axis2 >= 0 && swap_args->axis2 < static_cast<int>(axes.size())) {
+      std::swap(axes[swap_args->axis1], axes[swap_args->axis2]);
+      valid = Permute(input, axes, &outputs[0]);
+    }
+  } else if (op == strided_slice_op) {
+    valid = StridedSlice(input, args.as<StridedSliceArgs>(), &outputs[0]);
+  } else {
+    outputs.clear();
+    valid = Split(input, args.as<SplitArgs>(), &outputs);
+  }
+  if (!valid) {
+    return false;
+  }
+
+  // The views must match the inferred output types, and be contiguous.
+  auto out_types = tvm::relay::FlattenTupleType(call->checked_type());
+  if (out_types.size() != outputs.size()) {
+    return false;
+  }
+  std::vector<ContiguousView> results;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    std::vector<int64_t> oshape;
+    if (!GetStaticShape(out_types[i], &oshape) || oshape != outputs[i].shape ||
+        !IsContiguous(outputs[i])) {
+      return false;
+    }
+    // Kernels assume their buffers are aligned, so the views must start at aligned addresses.
+    auto dtype = out_types[i].as<TensorTypeNode>()->dtype;
+    int64_t offset = outputs[i].offset * ((dtype.bits() * dtype.lanes() + 7) / 8);
+    if (offset % kDefaultMemoryAlignment != 0) {
+      return false;
+    }
+    results.push_back(ContiguousView{oshape, offset});
+  }
+  if (views != nullptr) {
+    *views = std::move(results);
+  }
+  return true;
+}
+
+}  // namespace view_utils
+}  // namespace pass
+}  // namespace raf
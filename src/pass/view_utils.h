@@ -0,0 +1,42 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file view_utils.h
+ * \brief Utilities for replacing layout ops with views of their inputs.
+ */
+#pragma once
+#include <vector>
+#include "raf/ir.h"
+
+namespace raf {
+namespace pass {
+namespace view_utils {
+
+using namespace raf::ir;
+
+/*! \brief A compact view of a compact tensor, which starts at a byte offset. */
+struct ContiguousView {
+  /*! \brief The shape of the view. */
+  std::vector<int64_t> shape;
+  /*! \brief The offset of the view in its base tensor in bytes. */
+  int64_t offset;
+};
+
+/*!
+ * \brief Check whether the call of transpose, swap_axis, strided_slice or split produces
+ * views of its input, i.e., whether each output occupies a contiguous range of the input
+ * in the same order and starts at an aligned address. For example, split along the first
+ * non-unit axis, or transpose that only moves unit axes. Such calls can be replaced by views
+ * instead of kernels that copy.
+ * \param call The call, whose input must be a variable with a static shape.
+ * \param views The views, one per output tensor. Ignored if nullptr.
+ * \return Whether all outputs are contiguous views of the input.
+ */
+bool GetContiguousViews(const Call& call, std::vector<ContiguousView>* views = nullptr);
+
+}  // namespace view_utils
+}  // namespace pass
+}  // namespace raf
@@ -7,13 +7,79 @@
  * \file src/profiler/base/profiler.cc
  * \brief RAF profiler, a simple implementation
  */
+#include <algorithm>
 #include "raf/registry.h"
 #include "raf/profiler.h"
 
 namespace raf {
 namespace profiler {
 
-Profiler::Profiler() {
+/*! \brief The default capacity in events of the ring buffer of each thread. */
+constexpr int64_t kDefaultBufferSize = 1 << 16;
+
+/*!
+ * \brief The fixed-capacity ring buffer of the events recorded by one thread. The buffer is only
+ * written by its owner thread, and read when the events are collected, so its lock is almost
+ * never contended.
+ */
+class ProfileRingBuffer {
+ public:
+  explicit ProfileRingBuffer(int64_t capacity) : events_(capacity) {
+  }
+
+  /*!
+   * \brief Append an event, overwriting the oldest one if the buffer is full.
+   * \return Whether an event was overwritten.
+   */
+  bool Push(const ProfileEvent& event) {
+    std::lock_guard<std::mutex> lock(mu_);
+    events_[head_ % events_.size()] = event;
+    ++head_;
+    if (head_ - tail_ > events_.size()) {
+      ++tail_;
+      return true;
+    }
+    return false;
+  }
+
+  /*! \brief Move the buffered events to the output. */
+  void Drain(std::vector<ProfileEvent>* out) {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (; tail_ < head_; ++tail_) {
+      out->push_back(events_[tail_ % events_.size()]);
+    }
+  }
+
+  /*! \brief Whether the owner thread has exited. */
+  std::atomic<bool> retired{false};
+
+ private:
+  /*! \brief The events. */
+  std::vector<ProfileEvent> events_;
+  /*! \brief The number of events ever pushed and drained. */
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+  /*! \brief The lock of this buffer. */
+  std::mutex mu_;
+};
+
+/*! \brief Holds the ring buffer of a thread, and retires it when the thread exits. */
+struct ThreadBufferHolder {
+  std::shared_ptr<ProfileRingBuffer> buffer;
+
+  ~ThreadBufferHolder() {
+    if (buffer) {
+      buffer->retired = true;
+    }
+  }
+};
+
+Profiler::Profiler() : buffer_size_(kDefaultBufferSize) {
+  strings_.emplace_back();
+  string_ids_.emplace("", 0);
+  if (const char* val = getenv("RAF_PROFILER_BUFFER_SIZE")) {
+    buffer_size_ = std::max<int64_t>(atol(val), 1);
+  }
 }
 
 Profiler::~Profiler() {
@@ -31,6 +97,93 @@ void Profiler::AddNewProfileStat(std::string categories, std::string name, uint6
   profile_stats_.opr_exec_stats_->enqueue(stat.release());
 }
 
+void Profiler::Configure(bool sync_device, int sample_rate, int64_t buffer_size) {
+  CHECK_GE(sample_rate, 1) << "The sample rate must be positive";
+  sync_device_ = sync_device;
+  sample_rate_ = sample_rate;
+  if (buffer_size > 0) {
+    buffer_size_ = buffer_size;
+  }
+}
+
+uint32_t Profiler::Intern(const std::string& str) {
+  if (str.empty()) {
+    return 0;
+  }
+  // Look up the strings interned by this thread first, so that the lock is only taken when the
+  // thread sees a string for the first time.
+  thread_local std::unordered_map<std::string, uint32_t> local_ids;
+  auto it = local_ids.find(str);
+  if (it != local_ids.end()) {
+    return it->second;
+  }
+  uint32_t id;
+  {
+    std::lock_guard<std::mutex> lock(strings_mu_);
+    auto res = string_ids_.emplace(str, static_cast<uint32_t>(strings_.size()));
+    if (res.second) {
+      strings_.push_back(str);
+    }
+    id = res.first->second;
+  }
+  local_ids.emplace(str, id);
+  return id;
+}
+
+std::string Profiler::LookupString(uint32_t id) {
+  std::lock_guard<std::mutex> lock(strings_mu_);
+  CHECK_LT(id, strings_.size()) << "Unknown string ID " << id;
+  return strings_[id];
+}
+
+ProfileRingBuffer* Profiler::GetThreadBuffer() {
+  thread_local ThreadBufferHolder holder;
+  if (holder.buffer == nullptr) {
+    holder.buffer = std::make_shared<ProfileRingBuffer>(buffer_size_);
+    std::lock_guard<std::mutex> lock(buffers_mu_);
+    buffers_.push_back(holder.buffer);
+  }
+  return holder.buffer.get();
+}
+
+void Profiler::Record(const ProfileEvent& event) {
+  if (GetThreadBuffer()->Push(event)) {
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Profiler::CollectStat() {
+  std::vector<ProfileEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mu_);
+    for (auto it = buffers_.begin(); it != buffers_.end();) {
+      // A retired buffer gets no more events, so it can be removed once drained.
+      bool retired = (*it)->retired;
+      (*it)->Drain(&events);
+      it = retired ? buffers_.erase(it) : it + 1;
+    }
+  }
+  // Emit the events of all threads in the order of their start times.
+  std::stable_sort(events.begin(), events.end(),
+                   [](const ProfileEvent& a, const ProfileEvent& b) {
+                     return a.start_time < b.start_time;
+                   });
+  for (const auto& event : events) {
+    std::vector<std::string> args;
+    for (uint32_t i = 0; i < event.num_args; ++i) {
+      args.push_back(LookupString(event.arg_ids[i]));
+    }
+    AddNewProfileStat(LookupString(event.category_id), LookupString(event.name_id),
+                      event.start_time, event.end_time, args);
+  }
+  int64_t num_dropped = num_dropped_.exchange(0);
+  if (num_dropped > 0) {
+    LOG(WARNING) << num_dropped << " profiling events were overwritten before they were "
+                 << "collected. Collect more often, sample the events, or increase "
+                 << "RAF_PROFILER_BUFFER_SIZE.";
+  }
+}
+
 std::string Profiler::GetProfile() {
   std::lock_guard<std::recursive_mutex> lock{this->m_};
   std::stringstream ss;
@@ -79,6 +232,24 @@ DeviceStats::~DeviceStats() {
   }
 }
 
+ProfileRecorder::ProfileRecorder(const Device& device, const std::string& name,
+                                 const std::string& categories,
+                                 const std::vector<std::string>& args)
+    : device_(device) {
+  Profiler* profiler = Profiler::Get();
+  if (profiler->sync_device() && device.device_type() != DevType::kUnknown()) {
+    dev_api_ = device_api::DeviceAPI::Get(device.device_type());
+  }
+  event_.name_id = profiler->Intern(name);
+  event_.category_id = profiler->Intern(categories);
+  CHECK_LE(args.size(), kMaxProfileEventArgs)
+      << "A profiled region takes at most " << kMaxProfileEventArgs << " arguments";
+  event_.num_args = static_cast<uint32_t>(args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    event_.arg_ids[i] = profiler->Intern(args[i]);
+  }
+}
+
 ProfileStat::ProfileStat(std::string categories, std::string name, uint64_t start_time,
                          uint64_t end_time, const std::vector<std::string>& args) {
   categories_ = categories;
@@ -131,6 +302,10 @@ void DisableProfiler() {
   Profiler::Get()->set_profile_level(0);
 }
 
+void ConfigureProfiler(bool sync_device, int sample_rate, int64_t buffer_size) {
+  Profiler::Get()->Configure(sync_device, sample_rate, buffer_size);
+}
+
 void CollectBaseProfile() {
   Profiler::Get()->CollectStat();
 }
@@ -141,6 +316,7 @@ std::string GetProfile() {
 
 RAF_REGISTER_GLOBAL("raf.profiler.EnableProfiler").set_body_typed(EnableProfiler);
 RAF_REGISTER_GLOBAL("raf.profiler.DisableProfiler").set_body_typed(DisableProfiler);
+RAF_REGISTER_GLOBAL("raf.profiler.ConfigureProfiler").set_body_typed(ConfigureProfiler);
 RAF_REGISTER_GLOBAL("raf.profiler.CollectBaseProfile").set_body_typed(CollectBaseProfile);
 RAF_REGISTER_GLOBAL("raf.profiler.GetProfile").set_body_typed(GetProfile);
 
@@ -0,0 +1,284 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!
+ * \file src/profiler/cost_model.cc
+ * \brief The cost models to estimate the latency of ops for the compilation passes.
+ */
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include "raf/cost_model.h"
+#include "raf/op_profiler.h"
+#include "raf/pass.h"
+#include "raf/registry.h"
+#include "../common/shape_utils.h"
+#include "../pass/estimate_flops.h"
+
+namespace raf {
+namespace cost_model {
+
+using namespace raf::op;
+
+CostModelPtr CostModel::Make(const std::string& name, const Device& device,
+                             Map<String, ObjectRef> options) {
+  void* ret = registry::GetPackedFunc("raf.cost_model._make." + name)(device, options);
+  return CostModelPtr(static_cast<CostModel*>(ret));
+}
+
+/*! \brief Get an integer option of a cost model, or the default value if it is not given. */
+inline int GetIntOption(const Map<String, ObjectRef>& options, const std::string& name,
+                        int default_value) {
+  auto it = options.find(name);
+  return it == options.end() ? default_value : Downcast<Integer>((*it).second)->value;
+}
+
+/*! \brief The cost model that measures the latency of ops on the device with OpProfiler. */
+class ProfilerCostModel : public CostModel {
+ public:
+  ProfilerCostModel(const Device& device, int warmup, int number, int repeat)
+      : profiler_(op_profiler::OpProfiler::Get(device)),
+        warmup_(warmup),
+        number_(number),
+        repeat_(repeat) {
+  }
+
+  OpCost EstimateOp(const Expr& op) override {
+    auto res = profiler_->ProfileOp(op, warmup_, number_, repeat_);
+    OpCost cost;
+    for (float latency : res.first) {
+      cost.latency += latency;
+    }
+    cost.latency /= std::max<size_t>(res.first.size(), 1);
+    cost.workspace_size = res.second;
+    return cost;
+  }
+
+  std::vector<float> EstimateStage(const std::vector<std::vector<Expr>>& groups) override {
+    std::vector<Expr> flat_group;
+    std::vector<int> stream_ids;
+    for (size_t i = 0; i < groups.size(); i++) {
+      for (auto& expr : groups[i]) {
+        flat_group.push_back(expr);
+        stream_ids.push_back(i);
+      }
+    }
+    return profiler_->ProfileOpGroup(flat_group, stream_ids, warmup_, number_, repeat_).first;
+  }
+
+ private:
+  /*! \brief The op profiler of the device. */
+  op_profiler::OpProfiler* profiler_;
+  /*! \brief The number of warmups. */
+  int warmup_;
+  /*! \brief The number of executions as a repeat. */
+  int number_;
+  /*! \brief The number of repeat times. */
+  int repeat_;
+};
+
+/*! \brief Make a type-inferred call to an op with float32 tensor arguments of the given shapes. */
+Expr MakeCalibrationCall(const std::string& op_name, const std::vector<std::vector<int>>& shapes,
+                         size_t num_null_args = 0) {
+  Array<Expr> args;
+  for (const auto& shape : shapes) {
+    Array<PrimExpr> dims;
+    for (int dim : shape) {
+      dims.push_back(Integer(dim));
+    }
+    args.push_back(MakeVar("x", TensorType(dims, DataType::Float(32))));
+  }
+  for (size_t i = 0; i < num_null_args; ++i) {
+    args.push_back(MakeNull());
+  }
+  return pass::InferType(Call(Op::Get(op_name), args));
+}
+
+/*!
+ * \brief Calibrate the roofline of a device by profiling a matmul for the compute throughput,
+ * an add for the memory bandwidth, and a tiny op for the launch overhead. The measurements are
+ * kept in the op latency database, so they are persisted along with it.
+ */
+Roofline CalibrateRoofline(const Device& device) {
+  const bool is_cuda = device.device_type() == DevType::kCUDA();
+  const int n = is_cuda ? 2048 : 512;
+  const int m = 1 << 24;
+  auto* profiler = op_profiler::OpProfiler::Get(device);
+  auto profile = [&](const Expr& op) {
+    auto latency = profiler->ProfileOp(op, 2, 5, 3).first;
+    return *std::min_element(latency.begin(), latency.end());
+  };
+
+  Roofline roofline;
+  roofline.launch_overhead_us = profile(MakeCalibrationCall("raf.op.relu", {{1}}));
+  double matmul_us = profile(MakeCalibrationCall("raf.op.matmul", {{n, n}, {n, n}}));
+  double add_us = profile(MakeCalibrationCall("raf.op.add", {{m}, {m}}, 2));
+  // The latency excluding the launch overhead, which is at least 1us to avoid dividing by 0.
+  auto busy_us = [&](double latency) {
+    return std::max(latency - roofline.launch_overhead_us, 1.0);
+  };
+  roofline.peak_gflops = 2.0 * n * n * n / 1e3 / busy_us(matmul_us);
+  roofline.bandwidth_gbps = 3.0 * m * sizeof(float) / 1e3 / busy_us(add_us);
+  LOG(INFO) << "Calibrated the roofline of " << device.c_str() << ": "
+            << roofline.peak_gflops << " GFLOPS, " << roofline.bandwidth_gbps << " GB/s, "
+            << roofline.launch_overhead_us << " us launch overhead";
+  return roofline;
+}
+
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.cost_model.roofline.peak_gflops", FloatImm);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.cost_model.roofline.bandwidth_gbps", FloatImm);
+TVM_REGISTER_PASS_CONFIG_OPTION("raf.cost_model.roofline.launch_overhead_us", FloatImm);
+
+Roofline Roofline::Get(const Device& device) {
+  pass::PassContext ctx = pass::PassContext::Current();
+  auto peak_gflops = ctx->GetConfig<FloatImm>("raf.cost_model.roofline.peak_gflops");
+  auto bandwidth_gbps = ctx->GetConfig<FloatImm>("raf.cost_model.roofline.bandwidth_gbps");
+  auto launch_overhead_us =
+      ctx->GetConfig<FloatImm>("raf.cost_model.roofline.launch_overhead_us");
+
+  Roofline roofline;
+  if (!peak_gflops.defined() || !bandwidth_gbps.defined() || !launch_overhead_us.defined()) {
+    static std::mutex mu;
+    static std::unordered_map<std::string, Roofline> calibrated;
+    std::lock_guard<std::mutex> lock(mu);
+    std::string key = device.c_str();
+    if (calibrated.count(key) == 0) {
+      calibrated[key] = CalibrateRoofline(device);
+    }
+    roofline = calibrated[key];
+  }
+  if (peak_gflops.defined()) {
+    roofline.peak_gflops = peak_gflops.value()->value;
+  }
+  if (bandwidth_gbps.defined()) {
+    roofline.bandwidth_gbps = bandwidth_gbps.value()->value;
+  }
+  if (launch_overhead_us.defined()) {
+    roofline.launch_overhead_us = launch_overhead_us.value()->value;
+  }
+  CHECK_GT(roofline.peak_gflops, 0) << "Invalid peak GFLOPS of the roofline";
+  CHECK_GT(roofline.bandwidth_gbps, 0) << "Invalid bandwidth of the roofline";
+  return roofline;
+}
+
+/*!
+ * \brief The analytical cost model, which bounds the latency of an op by the roofline of the
+ * device with its FLOPs and the bytes it reads and writes. It runs no kernel, so the passes that
+ * use it compile in milliseconds, even on the machines without the target device when the
+ * roofline is given by the pass configs.
+ */
+class RooflineCostModel : public CostModel {
+ public:
+  explicit RooflineCostModel(const Device& device)
+      : device_(device), roofline_(Roofline::Get(device)) {
+  }
+
+  OpCost EstimateOp(const Expr& op) override {
+    double gflops, bytes;
+    OpCost cost;
+    if (Analyze(op, &gflops, &bytes)) {
+      cost.latency = roofline_.Latency(gflops, bytes);
+    }
+    return cost;
+  }
+
+  std::vector<float> EstimateStage(const std::vector<std::vector<Expr>>& groups) override {
+    // The groups run concurrently, so the stage takes as long as its longest group, unless the
+    // groups together saturate the compute or the memory bandwidth of the device.
+    double longest_group_us = 0, total_gflops = 0, total_bytes = 0;
+    for (const auto& group : groups) {
+      double group_us = 0;
+      for (const auto& op : group) {
+        double gflops, bytes;
+        if (Analyze(op, &gflops, &bytes)) {
+          group_us += roofline_.Latency(gflops, bytes);
+          total_gflops += gflops;
+          total_bytes += bytes;
+        }
+      }
+      longest_group_us = std::max(longest_group_us, group_us);
+    }
+    return {static_cast<float>(
+        std::max(longest_group_us, roofline_.Latency(total_gflops, total_bytes)))};
+  }
+
+ private:
+  /*! \brief Get the bytes of the tensors in a type, or 0 if it has no static shape. */
+  static double Bytes(const Type& type) {
+    if (const auto* tensor_type = type.as<TensorTypeNode>()) {
+      return common::shape_utils::BytesCompactTensor(tensor_type);
+    }
+    double bytes = 0;
+    if (const auto* tuple_type = type.as<TupleTypeNode>()) {
+      for (const auto& field : tuple_type->fields) {
+        bytes += Bytes(field);
+      }
+    }
+    return bytes;
+  }
+
+  /*!
+   * \brief Get the GFLOPs of an op and the bytes it reads and writes.
+   * \return Whether the op launches a kernel.
+   */
+  bool Analyze(const Expr& op, double* gflops, double* bytes) {
+    const auto* call = op.as<CallNode>();
+    if (call == nullptr) {
+      return false;
+    }
+    // The ops that cannot be analyzed, e.g., the ones without a TVM dialect, are assumed to be
+    // memory bound.
+    *gflops = pass::estimate_flops::EstimateCallGFLOPS(GetRef<Call>(call), device_, IRModule());
+    if (!std::isfinite(*gflops) || *gflops < 0) {
+      *gflops = 0;
+    }
+    // Constant arguments are the attributes of the op.
+    *bytes = Bytes(call->checked_type());
+    for (const auto& arg : call->args) {
+      if (!arg->IsInstance<RelayConstantNode>()) {
+        *bytes += Bytes(arg->checked_type());
+      }
+    }
+    return true;
+  }
+
+  /*! \brief The target device. */
+  Device device_;
+  /*! \brief The roofline of the device. */
+  Roofline roofline_;
+};
+
+RAF_REGISTER_GLOBAL("raf.cost_model._make.profiler")
+    .set_body_typed([](const Device& device, Map<String, ObjectRef> options) -> void* {
+      return new ProfilerCostModel(device, GetIntOption(options, "warmup", 10),
+                                   GetIntOption(options, "number", 10),
+                                   GetIntOption(options, "repeat", 1));
+    });
+
+RAF_REGISTER_GLOBAL("raf.cost_model._make.roofline")
+    .set_body_typed([](const Device& device, Map<String, ObjectRef> options) -> void* {
+      return new RooflineCostModel(device);
+    });
+
+RAF_REGISTER_GLOBAL("raf.cost_model.GetRoofline").set_body_typed([](const Device& device) {
+  auto roofline = Roofline::Get(device);
+  Map<String, FloatImm> ret;
+  ret.Set("peak_gflops", FloatImm(DataType::Float(64), roofline.peak_gflops));
+  ret.Set("bandwidth_gbps", FloatImm(DataType::Float(64), roofline.bandwidth_gbps));
+  ret.Set("launch_overhead_us", FloatImm(DataType::Float(64), roofline.launch_overhead_us));
+  return ret;
+});
+
+RAF_REGISTER_GLOBAL("raf.cost_model.EstimateOp")
+    .set_body_typed([](const Expr& op, const Device& device, const std::string& name) {
+      auto cost = CostModel::Make(name, device)->EstimateOp(op);
+      Map<String, FloatImm> ret;
+      ret.Set("latency", FloatImm(DataType::Float(32), cost.latency));
+      ret.Set("workspace_size", FloatImm(DataType::Float(32), cost.workspace_size));
+      return ret;
+    });
+
+}  // namespace cost_model
+}  // namespace raf
@@ -7,6 +7,7 @@
  * \file src/profiler/memory_profiler.cc
  * \brief Memory profiler implementation
  */
+#include <iterator>
 #include "raf/registry.h"
 #include "raf/memory_profiler.h"
 #include "raf/memory_pool.h"
@@ -14,12 +15,26 @@
 namespace raf {
 namespace memory_profiler {
 
+thread_local AllocSite AllocSiteScope::current_;
+
+/*! \brief The memory returned by the pool with the free of it traced. */
+struct TracedMemory {
+  std::shared_ptr<memory_pool::Memory> memory;
+  int64_t generation;
+  int64_t event_id;
+
+  ~TracedMemory() {
+    MemoryProfiler::Get()->TraceFree(generation, event_id);
+  }
+};
+
 MemoryProfiler::~MemoryProfiler() {
 }
 
 MemoryProfiler* MemoryProfiler::Get() {
-  static MemoryProfiler prof;
-  return &prof;
+  // Never destroyed, because the traced memory may be freed during the static destruction.
+  static MemoryProfiler* prof = new MemoryProfiler();
+  return prof;
 }
 
 void MemoryProfiler::Record(const Device& device, const std::string& tag) {
@@ -37,6 +52,106 @@ void MemoryProfiler::Record(const Device& device, const std::string& tag) {
 
 void MemoryProfiler::Reset() {
   memory_stats_.clear();
+  std::lock_guard<std::mutex> lock(alloc_mu_);
+  alloc_events_.clear();
+  live_allocs_.clear();
+  next_seq_ = 0;
+  ++alloc_generation_;
+  start_time_ = std::chrono::steady_clock::now();
+}
+
+int64_t MemoryProfiler::NowUs() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               start_time_)
+      .count();
+}
+
+std::shared_ptr<memory_pool::Memory> MemoryProfiler::TraceAlloc(
+    const Device& device, int64_t nbytes, int64_t reserved_bytes,
+    std::shared_ptr<memory_pool::Memory> memory) {
+  if (memory == nullptr) {
+    return memory;
+  }
+  const AllocSite& site = AllocSiteScope::Current();
+  AllocEvent event;
+  event.device = device.c_str();
+  event.data = memory->data;
+  event.nbytes = nbytes;
+  event.reserved_bytes = reserved_bytes;
+  if (site.func_name != nullptr) {
+    event.func_name = *site.func_name;
+  }
+  event.pc = site.pc;
+  if (site.op_name != nullptr) {
+    event.op_name = *site.op_name;
+  }
+  event.kind = site.kind;
+
+  auto traced = std::make_shared<TracedMemory>();
+  {
+    std::lock_guard<std::mutex> lock(alloc_mu_);
+    event.alloc_seq = next_seq_++;
+    event.alloc_us = NowUs();
+    traced->generation = alloc_generation_;
+    traced->event_id = alloc_events_.size();
+    if (event.data != nullptr) {
+      live_allocs_[event.data] = traced->event_id;
+    }
+    alloc_events_.push_back(std::move(event));
+  }
+  auto* ptr = memory.get();
+  traced->memory = std::move(memory);
+  // Share the ownership of the holder, while pointing to the memory itself.
+  return std::shared_ptr<memory_pool::Memory>(traced, ptr);
+}
+
+void MemoryProfiler::TraceFree(int64_t generation, int64_t event_id) {
+  std::lock_guard<std::mutex> lock(alloc_mu_);
+  if (generation != alloc_generation_) {
+    return;
+  }
+  auto& event = alloc_events_[event_id];
+  event.free_seq = next_seq_++;
+  event.free_us = NowUs();
+  auto it = live_allocs_.find(event.data);
+  if (it != live_allocs_.end() && it->second == event_id) {
+    live_allocs_.erase(it);
+  }
+}
+
+void MemoryProfiler::AttributeAllocs(const std::vector<const void*>& data,
+                                     const std::string& func_name, int64_t pc,
+                                     const std::string& op_name) {
+  std::lock_guard<std::mutex> lock(alloc_mu_);
+  for (const void* addr : data) {
+    // Find the last chunk that starts at or before the address, which contains the address if
+    // the address is in any live chunk.
+    auto it = live_allocs_.upper_bound(addr);
+    if (it == live_allocs_.begin()) {
+      continue;
+    }
+    auto& event = alloc_events_[std::prev(it)->second];
+    // The arena of a function holds the outputs of many ops, so it is not charged to any of them.
+    if (!event.op_name.empty() || event.kind == "arena" ||
+        static_cast<const char*>(addr) >= static_cast<const char*>(event.data) + event.nbytes) {
+      continue;
+    }
+    event.func_name = func_name;
+    event.pc = pc;
+    event.op_name = op_name;
+  }
+}
+
+std::vector<AllocEvent> MemoryProfiler::GetAllocEvents(const Device& device) {
+  std::string device_str = device.c_str();
+  std::vector<AllocEvent> ret;
+  std::lock_guard<std::mutex> lock(alloc_mu_);
+  for (const auto& event : alloc_events_) {
+    if (event.device == device_str) {
+      ret.push_back(event);
+    }
+  }
+  return ret;
 }
 
 Map<String, FloatImm> MemoryProfiler::GetMaxMemoryInfo(const Device& device) {
@@ -96,6 +211,10 @@ void DisableMemoryProfiler() {
   MemoryProfiler::Get()->SetProfile(false);
 }
 
+void SetTraceAllocs(bool trace) {
+  MemoryProfiler::Get()->SetTraceAllocs(trace);
+}
+
 void ResetMemoryProfiler() {
   MemoryProfiler::Get()->Reset();
 }
@@ -108,6 +227,22 @@ std::string GetMemoryTrace(const Device& device) {
   return MemoryProfiler::Get()->GetMemoryTrace(device);
 }
 
+/*!
+ * \brief Get the allocation events of the given device. Each event is an array of
+ * [nbytes, reserved_bytes, alloc_seq, free_seq, alloc_us, free_us, func_name, pc, op_name, kind].
+ */
+Array<Array<ObjectRef>> GetAllocTrace(const Device& device) {
+  auto to_int = [](int64_t value) { return IntImm(DataType::Int(64), value); };
+  Array<Array<ObjectRef>> ret;
+  for (const auto& event : MemoryProfiler::Get()->GetAllocEvents(device)) {
+    ret.push_back({to_int(event.nbytes), to_int(event.reserved_bytes), to_int(event.alloc_seq),
+                   to_int(event.free_seq), to_int(event.alloc_us), to_int(event.free_us),
+                   String(event.func_name), to_int(event.pc), String(event.op_name),
+                   String(event.kind)});
+  }
+  return ret;
+}
+
 RAF_REGISTER_GLOBAL("raf.memory_profiler.EnableMemoryProfiler")
     .set_body_typed(EnableMemoryProfiler);
 RAF_REGISTER_GLOBAL("raf.memory_profiler.DisableMemoryeProfiler")
@@ -115,6 +250,8 @@ RAF_REGISTER_GLOBAL("raf.memory_profiler.DisableMemoryeProfiler")
 RAF_REGISTER_GLOBAL("raf.memory_profiler.ResetMemoryProfiler").set_body_typed(ResetMemoryProfiler);
 RAF_REGISTER_GLOBAL("raf.memory_profiler.GetMaxMemoryInfo").set_body_typed(GetMaxMemoryInfo);
 RAF_REGISTER_GLOBAL("raf.memory_profiler.GetMemoryTrace").set_body_typed(GetMemoryTrace);
+RAF_REGISTER_GLOBAL("raf.memory_profiler.SetTraceAllocs").set_body_typed(SetTraceAllocs);
+RAF_REGISTER_GLOBAL("raf.memory_profiler.GetAllocTrace").set_body_typed(GetAllocTrace);
 
 }  // namespace memory_profiler
 }  // namespace raf
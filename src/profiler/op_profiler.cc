@@ -8,11 +8,16 @@
  * \brief A simple profiler with caching to profile ops during compilation
  */
 
+#include <dmlc/io.h>
 #include "raf/op_profiler.h"
 #include "raf/ir.h"
+#include "raf/persist_cache_store.h"
 #include "../op/dialect/tvm/tvm_utils.h"
 #include "../requests.h"
 #include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <thread>
 
 namespace raf {
 namespace op_profiler {
@@ -20,6 +25,74 @@ namespace op_profiler {
 using namespace raf::op;
 using namespace raf::value;
 
+/*! \brief The version of the latency database. Bump it when the keys or the records change. */
+constexpr const char* kOpLatencyDBVersion = "v1";
+/*! \brief Magic number of the exported latency database. */
+constexpr uint64_t kOpLatencyDBMagic = 0x4C4154454E435944;
+
+/*! \brief The persist cache entry of the measured latency and workspace size of ops. */
+class OpLatencyRecord {
+ public:
+  explicit OpLatencyRecord() {
+  }
+
+  OpLatencyRecord(const std::vector<float>& latency, int64_t workspace_size)
+      : latency(latency), workspace_size(workspace_size) {
+  }
+
+  static OpLatencyRecord Load(const std::string path) {
+    std::ifstream ifs(path + "/" + RECORD_FILE);
+    std::string version;
+    size_t num_latency = 0;
+    OpLatencyRecord record;
+    ifs >> version >> record.workspace_size >> num_latency;
+    CHECK(ifs.good() && version == kOpLatencyDBVersion)
+        << "Invalid latency record of version " << version;
+    record.latency.resize(num_latency);
+    for (auto& latency : record.latency) {
+      ifs >> latency;
+    }
+    CHECK(!ifs.fail()) << "Truncated latency record";
+    return record;
+  }
+
+  bool Save(const std::string& path) {
+    std::ofstream ofs(path + "/" + RECORD_FILE);
+    if (!ofs.is_open()) {
+      return false;
+    }
+    // 9 significant digits round-trip a float.
+    ofs << kOpLatencyDBVersion << " " << workspace_size << " " << latency.size()
+        << std::setprecision(9);
+    for (float lat : latency) {
+      ofs << " " << lat;
+    }
+    ofs << std::endl;
+    return ofs.good();
+  }
+
+  /*! \brief The latency of each repeat in microseconds. */
+  std::vector<float> latency;
+  /*! \brief The workspace size in bytes. */
+  int64_t workspace_size = 0;
+
+ private:
+  /*! \brief The persist record file name. */
+  static constexpr const char* RECORD_FILE = "latency.txt";
+};
+
+/*!
+ * \brief The latency database shared by the op profilers of all devices. It is persisted
+ * under the RAF persistent cache directory when RAF_PERSIST_CACHE=1, where the entries written
+ * by concurrent processes are merged. The latencies depend on the machine, so they are not
+ * bundled with the executables.
+ */
+MetaPersistCache<OpLatencyRecord>* GetOpLatencyDB() {
+  static MetaPersistCache<OpLatencyRecord> db("op_latency", GetMetaCacheCapacityFromEnv(),
+                                              /*bundled=*/false);
+  return &db;
+}
+
 OpProfiler* OpProfiler::Get(const Device& device) {
   CHECK_EQ(device.device_id(), 0) << "Multi-device profiling is not supported yet";
   if (device.device_type() == DevType::kCPU()) {
@@ -98,6 +171,65 @@ OpWithData::~OpWithData() {
   }
 }
 
+const std::string& OpProfiler::GetDeviceSignature() {
+  if (!device_signature_.empty()) {
+    return device_signature_;
+  }
+  std::ostringstream os;
+  os << device_.c_str();
+  if (device_.device_type() == DevType::kCUDA()) {
+#ifdef RAF_USE_CUDA
+    cudaDeviceProp prop;
+    CUDA_CALL(cudaGetDeviceProperties(&prop, device_.device_id()));
+    os << ":" << prop.name << ":sm_" << prop.major << prop.minor;
+#endif
+  } else if (device_.device_type() == DevType::kCPU()) {
+    std::ifstream ifs("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.compare(0, 10, "model name") == 0) {
+        os << ":" << line.substr(line.find(':') + 2);
+        break;
+      }
+    }
+    os << ":" << std::thread::hardware_concurrency();
+  }
+  device_signature_ = os.str();
+  return device_signature_;
+}
+
+std::string OpProfiler::GetDBKey(const std::vector<Expr>& ops, const std::vector<int>& stream_ids,
+                                 int32_t warmup, int32_t exec_number, int32_t repeat) {
+  std::ostringstream os;
+  os << kOpLatencyDBVersion << "|" << GetDeviceSignature() << "|" << warmup << "," << exec_number
+     << "," << repeat;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    os << "|" << (stream_ids.empty() ? -1 : stream_ids[i]) << ":";
+    const auto* call = ops[i].as<CallNode>();
+    if (call == nullptr) {
+      os << raf::ir::AsText(ops[i]->checked_type(), false);
+      continue;
+    }
+    // Fused functions are printed as a whole, since they have no name to identify them.
+    if (const auto* op_node = call->op.as<OpNode>()) {
+      os << op_node->name;
+    } else {
+      os << raf::ir::AsText(call->op, false);
+    }
+    // The values of constant arguments, e.g., axis, are the attributes of the op.
+    for (const auto& arg : call->args) {
+      os << ";";
+      if (const auto* const_node = arg.as<RelayConstantNode>()) {
+        os << static_cast<const ConstantNode*>(const_node)->value;
+      } else {
+        os << raf::ir::AsText(arg->checked_type(), false);
+      }
+    }
+    os << "->" << raf::ir::AsText(call->checked_type(), false);
+  }
+  return os.str();
+}
+
 OpEnvPtr OpProfiler::GetOpEnv(const Expr& op) {
   if (auto call_node = op.as<CallNode>()) {
     auto call = GetRef<Call>(call_node);
@@ -121,6 +253,14 @@ std::pair<std::vector<float>, float> OpProfiler::ProfileOpGroup(const std::vecto
     return latency_and_workspace_size_cache_[key];
   }
 
+  // Reuse the latency measured before, possibly by another process.
+  auto db_key = GetDBKey(ops, stream_ids, warmup, exec_number, repeat);
+  if (auto record = GetOpLatencyDB()->GetShared(db_key)) {
+    latency_and_workspace_size_cache_[key] =
+        std::make_pair(record->latency, record->workspace_size);
+    return latency_and_workspace_size_cache_[key];
+  }
+
   // Prepare ops for profiling.
   std::vector<OpWithDataPtr> ops_with_data;
   int64_t total_workspace_size = 0;
@@ -136,6 +276,7 @@ std::pair<std::vector<float>, float> OpProfiler::ProfileOpGroup(const std::vecto
 
   // Profiling.
   std::vector<float> cost = RunOpGroup(ops_with_data, warmup, exec_number, repeat);
+  GetOpLatencyDB()->TrySet(db_key, OpLatencyRecord(cost, total_workspace_size));
 
   // Add the result to the cache.
   latency_and_workspace_size_cache_[key] =
@@ -157,6 +298,18 @@ std::pair<std::vector<float>, float> OpProfiler::ProfileOp(const Expr& op, int32
       return latency_and_workspace_size_cache_[key];
     }
 
+    // Reuse the latency measured before, possibly by another process. The callers that do not
+    // measure the latency (repeat is 0) need the OpEnv, so they always build the op.
+    std::string db_key;
+    if (repeat > 0) {
+      db_key = GetDBKey({op}, {}, warmup, exec_number, repeat);
+      if (auto record = GetOpLatencyDB()->GetShared(db_key)) {
+        latency_and_workspace_size_cache_[key] =
+            std::make_pair(record->latency, record->workspace_size);
+        return latency_and_workspace_size_cache_[key];
+      }
+    }
+
     // Build the op and generate dummy input data for profiling.
     OpWithDataPtr op_with_data = std::make_shared<OpWithData>(device_, op);
 
@@ -167,6 +320,9 @@ std::pair<std::vector<float>, float> OpProfiler::ProfileOp(const Expr& op, int32
     // Profile the op.
     std::vector<float> cost = RunOp(op_with_data, warmup, exec_number, repeat);
     int64_t workspace_size = op_with_data->workspace_size;
+    if (repeat > 0 && op_with_data->profilable()) {
+      GetOpLatencyDB()->TrySet(db_key, OpLatencyRecord(cost, workspace_size));
+    }
 
     // Add the profiled cost to the cache.
     latency_and_workspace_size_cache_[key] =
@@ -385,9 +541,67 @@ RAF_REGISTER_GLOBAL("raf.op_profiler.ProfileGroup")
       *ret = results;
     });
 
+/*!
+ * \brief Export the entries of the latency database to a file.
+ * \param path The path of the file.
+ * \return The number of exported entries.
+ */
+int64_t ExportLatencyDB(const std::string& path) {
+  auto entries = GetOpLatencyDB()->Export();
+  std::unique_ptr<dmlc::Stream> strm(dmlc::Stream::Create(path.c_str(), "w"));
+  strm->Write(kOpLatencyDBMagic);
+  strm->Write(std::string(kOpLatencyDBVersion));
+  strm->Write(static_cast<uint64_t>(entries.size()));
+  for (const auto& entry : entries) {
+    strm->Write(entry.first);
+    strm->Write(entry.second);
+  }
+  return entries.size();
+}
+
+/*!
+ * \brief Import the entries of a latency database exported by ExportLatencyDB. The entries are
+ * also persisted if the persistent cache is enabled.
+ * \param path The path of the file.
+ * \return The number of imported entries, excluding the ones that already exist.
+ */
+int64_t ImportLatencyDB(const std::string& path) {
+  std::unique_ptr<dmlc::Stream> strm(dmlc::Stream::Create(path.c_str(), "r"));
+  uint64_t magic;
+  std::string version;
+  uint64_t num_entries;
+  CHECK(strm->Read(&magic) && magic == kOpLatencyDBMagic)
+      << "Not a latency database: " << path;
+  CHECK(strm->Read(&version) && version == kOpLatencyDBVersion)
+      << "Unsupported latency database version " << version << " in " << path;
+  CHECK(strm->Read(&num_entries)) << "Truncated latency database: " << path;
+  auto* db = GetOpLatencyDB();
+  int64_t num_imported = 0;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    std::string key, packed;
+    CHECK(strm->Read(&key) && strm->Read(&packed)) << "Truncated latency database: " << path;
+    if (db->Has(key)) {
+      continue;
+    }
+    ScratchDir dir;
+    CHECK(UnpackDirectory(packed.data(), packed.size(), dir.path()))
+        << "Malformed latency record in " << path;
+    if (db->TrySet(key, OpLatencyRecord::Load(dir.path()))) {
+      ++num_imported;
+    }
+  }
+  return num_imported;
+}
+
+RAF_REGISTER_GLOBAL("raf.op_profiler.ExportLatencyDB").set_body_typed(ExportLatencyDB);
+
+RAF_REGISTER_GLOBAL("raf.op_profiler.ImportLatencyDB").set_body_typed(ImportLatencyDB);
+
 RAF_REGISTER_GLOBAL("raf.op_profiler.ResetCache").set_body_typed([](const Device& device) {
   auto profiler = OpProfiler::Get(device);
-  return profiler->Reset();
+  profiler->Reset();
+  // Also drop the latencies in memory, so the ops are measured again unless they are persisted.
+  GetOpLatencyDB()->Clear();
 });
 
 RAF_REGISTER_GLOBAL("raf.op_profiler.GetCacheSize").set_body_typed([](const Device& device) {
@@ -0,0 +1,170 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <raf/cache.h>
+#include <raf/persist_cache_store.h>
+
+using raf::PersistCacheStore;
+using raf::op::MetaCache;
+
+TEST(MetaCache, GetSet) {
+  MetaCache<int> cache;
+  ASSERT_EQ(cache.GetShared(std::string("a")), nullptr);
+  cache.Set(std::string("a"), 1);
+  cache.Set(std::vector<uint8_t>{'b'}, 2);
+  ASSERT_TRUE(cache.Has(std::string("a")));
+  ASSERT_EQ(*cache.GetShared(std::string("b")), 2);
+  ASSERT_EQ(*cache.GetShared(std::string("a")), 1);
+  ASSERT_EQ(cache.Size(), 2);
+  ASSERT_EQ(cache.NumEvicted(), 0);
+}
+
+TEST(MetaCache, LRU) {
+  MetaCache<int> cache(4, 1);
+  for (int i = 0; i < 4; ++i) {
+    cache.Set(std::to_string(i), i);
+  }
+  // Hold "1" and then touch the other entries, so that "1" becomes the least recently used one.
+  auto held = cache.GetShared(std::string("1"));
+  for (const char* key : {"0", "2", "3"}) {
+    ASSERT_NE(cache.GetShared(std::string(key)), nullptr);
+  }
+  cache.Set(std::string("4"), 4);
+  ASSERT_EQ(cache.Size(), 4);
+  ASSERT_EQ(cache.NumEvicted(), 1);
+  ASSERT_TRUE(cache.Has(std::string("0")));
+  ASSERT_FALSE(cache.Has(std::string("1")));
+  // The evicted value stays alive while it is held.
+  ASSERT_EQ(*held, 1);
+}
+
+TEST(MetaCache, Clear) {
+  MetaCache<int> cache;
+  for (int i = 0; i < 100; ++i) {
+    cache.Set(std::to_string(i), i);
+  }
+  auto held = cache.GetShared(std::string("7"));
+  cache.Clear();
+  ASSERT_EQ(cache.Size(), 0);
+  ASSERT_FALSE(cache.Has(std::string("7")));
+  ASSERT_EQ(*held, 7);
+  cache.Set(std::string("7"), 8);
+  ASSERT_EQ(*cache.GetShared(std::string("7")), 8);
+}
+
+TEST(MetaCache, Concurrent) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumKeys = 1000;
+  MetaCache<int> cache;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < kNumKeys; ++i) {
+        cache.Set(std::to_string(t * kNumKeys + i), i);
+        for (int j = 0; j <= i; j += 7) {
+          auto val = cache.GetShared(std::to_string(t * kNumKeys + j));
+          ASSERT_NE(val, nullptr);
+          ASSERT_EQ(*val, j);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(cache.Size(), kNumThreads * kNumKeys);
+}
+
+TEST(MetaCache, BoundedConcurrent) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumKeys = 500;
+  constexpr size_t kCapacity = 64;
+  MetaCache<int> cache(kCapacity, 4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 10000; ++i) {
+        const int key = (t * 7 + i) % kNumKeys;
+        if (auto val = cache.GetShared(std::to_string(key))) {
+          ASSERT_EQ(*val, key);
+        } else {
+          cache.TrySet(std::to_string(key), key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_LE(cache.Size(), kCapacity);
+  ASSERT_GT(cache.NumEvicted(), 0);
+}
+
+TEST(PersistCacheStore, SaveLoad) {
+  char tmpl[] = "/tmp/raf_persist_cache_XXXXXX";
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  std::string path = std::string(tmpl) + "/store";
+  auto f_save = [](const std::string& value) {
+    return [value](const std::string& dir) {
+      std::ofstream(dir + "/value.txt") << value;
+      return true;
+    };
+  };
+  auto f_load = [](std::string* value) {
+    return [value](const std::string& dir) { std::ifstream(dir + "/value.txt") >> *value; };
+  };
+  {
+    PersistCacheStore store(path);
+    ASSERT_FALSE(store.Contains("a"));
+    ASSERT_TRUE(store.Save("a", f_save("1")));
+    ASSERT_TRUE(store.Save("b", f_save("2")));
+  }
+  {
+    // Reopen the store, and the entries are found in the index.
+    PersistCacheStore store(path);
+    ASSERT_EQ(store.Size(), 2);
+    std::string value;
+    ASSERT_EQ(store.Load("b", f_load(&value)), PersistCacheStore::LoadResult::kHit);
+    ASSERT_EQ(value, "2");
+    ASSERT_EQ(store.Load("c", f_load(&value)), PersistCacheStore::LoadResult::kMiss);
+  }
+  {
+    // The oldest entries are evicted to fit the size limit.
+    PersistCacheStore store(path, 256);
+    for (int i = 0; i < 16; ++i) {
+      ASSERT_TRUE(store.Save("key" + std::to_string(i), f_save(std::string(32, 'x'))));
+    }
+    ASSERT_LT(store.Size(), 16);
+    ASSERT_TRUE(store.Contains("key15"));
+    // The entries are evicted in the order of the writes, even if they are written in the same
+    // second, so the remaining ones are the newest.
+    bool kept = false;
+    for (int i = 0; i < 16; ++i) {
+      bool contains = store.Contains("key" + std::to_string(i));
+      ASSERT_TRUE(contains || !kept);
+      kept = kept || contains;
+    }
+    ASSERT_FALSE(store.Contains("a"));
+  }
+  unlink((path + "/index").c_str());
+  unlink((path + "/data").c_str());
+  unlink((path + "/lock").c_str());
+  rmdir(path.c_str());
+  rmdir(tmpl);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -5,6 +5,10 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <thread>
+#include <vector>
+
 #include <raf/device.h>
 #include <raf/memory_pool.h>
 
@@ -63,6 +67,89 @@ TEST(PageUnitPool, CPU) {
   Memory::RemovePool(dev);
 }
 
+TEST(ArenaPool, CPU) {
+  Device dev{DevType::kCPU(), 0};
+  Memory::InitPool(dev, "arena_pool");
+  {
+    std::shared_ptr<Memory> result = Memory::Alloc(dev, 0);
+    ASSERT_EQ(result.use_count(), 1);
+    ASSERT_EQ(result->data, nullptr);
+  }
+  for (int memory : {11, 19, 2019, 1024124}) {
+    for (int align : {(int)kDefaultMemoryAlignment, 512, 1024, 4096}) {
+      std::shared_ptr<Memory> result = Memory::Alloc(dev, memory, align);
+      ASSERT_EQ(result.use_count(), 1);
+      int64_t address = (int64_t)result->data;
+      ASSERT_EQ(address % align, 0);
+    }
+  }
+  auto pool_size = Memory::GetPoolSize(dev);
+  ASSERT_EQ(pool_size.first, 0);  // No chunk is used.
+
+  // Adjacent chunks are split from and coalesced back into the same segment.
+  std::shared_ptr<Memory> a = Memory::Alloc(dev, 4096);
+  std::shared_ptr<Memory> b = Memory::Alloc(dev, 4096);
+  ASSERT_EQ((int64_t)b->data - (int64_t)a->data, 4096);
+  pool_size = Memory::GetPoolSize(dev);
+  auto used_size = pool_size.first * 1048576.0;
+  ASSERT_LE(std::abs(used_size - 8192), 1);
+  void* a_data = a->data;
+  a.reset();
+  b.reset();
+  std::shared_ptr<Memory> c = Memory::Alloc(dev, 8192);
+  ASSERT_EQ(c->data, a_data);
+  c.reset();
+
+  auto stats = Memory::GetPoolStats(dev);
+  ASSERT_EQ(stats["used_bytes"], 0);
+  ASSERT_EQ(stats["num_free_blocks"], stats["num_segments"]);
+  ASSERT_EQ(stats["fragmentation"], 0);
+  Memory::RemovePool(dev);
+}
+
+TEST(ThreadCachePool, CPU) {
+  Device dev{DevType::kCPU(), 0};
+  Memory::InitPool(dev, "thread_cache_pool:arena_pool");
+  ASSERT_EQ(Memory::GetPool(dev)->GetName(), "thread_cache_pool:arena_pool");
+  {
+    std::shared_ptr<Memory> result = Memory::Alloc(dev, 0);
+    ASSERT_EQ(result->data, nullptr);
+  }
+  // A released chunk is reused by the same thread from its cache.
+  void* data = Memory::Alloc(dev, 4096)->data;
+  ASSERT_EQ(Memory::Alloc(dev, 4096)->data, data);
+
+  // Chunks allocated by one thread can be released by another.
+  std::vector<std::shared_ptr<Memory>> chunks;
+  std::thread producer([&]() {
+    for (int i = 0; i < 16; ++i) {
+      chunks.push_back(Memory::Alloc(dev, 1024 * (i + 1)));
+    }
+  });
+  producer.join();
+  std::vector<std::thread> consumers;
+  for (int t = 0; t < 4; ++t) {
+    consumers.emplace_back([&, t]() {
+      for (int i = t; i < 16; i += 4) {
+        chunks[i].reset();
+      }
+      for (int i = 0; i < 100; ++i) {
+        std::shared_ptr<Memory> result = Memory::Alloc(dev, 1024 * (i % 16 + 1), 512);
+        ASSERT_EQ((int64_t)result->data % 512, 0);
+      }
+    });
+  }
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  auto stats = Memory::GetPoolStats(dev);
+  ASSERT_EQ(stats["thread_cache_cross_thread_frees"], 16);
+  ASSERT_GT(stats["thread_cache_hits"], 0);
+  // The caches of the exited threads are returned to the inner pool.
+  ASSERT_EQ(stats["thread_cache_num_threads"], 1);
+  Memory::RemovePool(dev);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,75 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <raf/profiler.h>
+
+using raf::Device;
+using raf::profiler::Profiler;
+
+/*! \brief Record events with the given name on each of the threads. */
+void RecordEvents(int num_threads, int num_events, const std::string& name) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([num_events, name, t]() {
+      Device device;
+      for (int i = 0; i < num_events; ++i) {
+        WITH_BASE_PROFILER(device, name, "Test", {std::to_string(t)}, {});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/*! \brief Collect the events and count the ones with the given name. */
+int CountEvents(const std::string& name) {
+  Profiler::Get()->CollectStat();
+  int count = 0;
+  for (const auto& stat : Profiler::Get()->GetProfileStats()) {
+    if (stat.name_ == name && stat.categories_ == "Test") {
+      count++;
+    }
+  }
+  return count;
+}
+
+TEST(Profiler, ConcurrentRecord) {
+  Profiler::Get()->Configure(false, 1, 1024);
+  Profiler::Get()->set_profile_level(1);
+  RecordEvents(4, 500, "concurrent");
+  Profiler::Get()->set_profile_level(0);
+  ASSERT_EQ(CountEvents("concurrent"), 2000);
+}
+
+TEST(Profiler, Sample) {
+  Profiler::Get()->Configure(false, 4, 1024);
+  Profiler::Get()->set_profile_level(1);
+  RecordEvents(1, 100, "sampled");
+  Profiler::Get()->set_profile_level(0);
+  ASSERT_EQ(CountEvents("sampled"), 25);
+}
+
+TEST(Profiler, Overwrite) {
+  Profiler::Get()->Configure(false, 1, 16);
+  Profiler::Get()->set_profile_level(1);
+  RecordEvents(1, 100, "overwritten");
+  Profiler::Get()->set_profile_level(0);
+  ASSERT_EQ(Profiler::Get()->NumDroppedEvents(), 84);
+  // Only the latest events are kept.
+  ASSERT_EQ(CountEvents("overwritten"), 16);
+  ASSERT_EQ(Profiler::Get()->NumDroppedEvents(), 0);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
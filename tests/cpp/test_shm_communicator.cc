@@ -0,0 +1,165 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <raf/registry.h>
+#include <raf/shm_communicator.h>
+
+using raf::distributed::communicator::Communicator;
+using raf::distributed::communicator::SHMCommunicatorObj;
+using raf::distributed::communicator::SHMReduceOp;
+using raf::registry::GetPackedFunc;
+
+/*! \brief Fork a process for the rank, which exits with 0 if the function succeeds. */
+pid_t RunRank(int size, int rank, const std::function<bool(SHMCommunicatorObj*)>& func) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    GetPackedFunc("raf.distributed.SetGlobalSize")(size);
+    GetPackedFunc("raf.distributed.SetGlobalRank")(rank);
+    auto comm = Communicator::Get("shm");
+    _exit(func(const_cast<SHMCommunicatorObj*>(comm.as<SHMCommunicatorObj>())) ? 0 : 1);
+  }
+  return pid;
+}
+
+/*! \brief Count the processes that failed. */
+int WaitRanks(const std::vector<pid_t>& pids) {
+  int num_failed = 0;
+  for (auto pid : pids) {
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
+
+/*! \brief Fork one process per rank, and count the ranks where the function failed. */
+int RunRanks(int size, const std::function<bool(SHMCommunicatorObj*)>& func) {
+  std::vector<pid_t> pids;
+  for (int rank = 0; rank < size; ++rank) {
+    pids.push_back(RunRank(size, rank, func));
+  }
+  return WaitRanks(pids);
+}
+
+class SHMCommunicator : public testing::Test {
+ protected:
+  void SetUp() override {
+    // Use small chunks so that the tensors span many steps.
+    setenv("RAF_SHM_CHUNK_BYTES", "4096", 1);
+  }
+};
+
+TEST_F(SHMCommunicator, AllReduce) {
+  ASSERT_EQ(RunRanks(4,
+                     [](SHMCommunicatorObj* comm) {
+                       const int64_t n = 10000;
+                       std::vector<float> x(n), y(n);
+                       for (int64_t i = 0; i < n; ++i) {
+                         x[i] = comm->rank + i % 3;
+                       }
+                       comm->AllReduce(x.data(), y.data(), n, DLDataType{kDLFloat, 32, 1},
+                                       SHMReduceOp::kSum);
+                       comm->AllReduce(x.data(), x.data(), n, DLDataType{kDLFloat, 32, 1},
+                                       SHMReduceOp::kMax);
+                       for (int64_t i = 0; i < n; ++i) {
+                         if (y[i] != 6 + 4 * (i % 3) || x[i] != 3 + i % 3) return false;
+                       }
+                       return true;
+                     }),
+            0);
+}
+
+TEST_F(SHMCommunicator, ReduceScatterAllGather) {
+  ASSERT_EQ(RunRanks(3,
+                     [](SHMCommunicatorObj* comm) {
+                       const int64_t n = 5000;
+                       std::vector<int32_t> x(3 * n), y(n), z(3 * n);
+                       for (int64_t i = 0; i < 3 * n; ++i) {
+                         x[i] = comm->rank * i;
+                       }
+                       comm->ReduceScatter(x.data(), y.data(), n, DLDataType{kDLInt, 32, 1},
+                                           SHMReduceOp::kSum);
+                       comm->AllGather(y.data(), z.data(), n * sizeof(int32_t));
+                       for (int64_t i = 0; i < 3 * n; ++i) {
+                         if (z[i] != 3 * i) return false;
+                       }
+                       return true;
+                     }),
+            0);
+}
+
+TEST_F(SHMCommunicator, BroadcastSendRecv) {
+  ASSERT_EQ(RunRanks(2,
+                     [](SHMCommunicatorObj* comm) {
+                       const int64_t n = 20000;
+                       std::vector<int64_t> x(n, comm->rank == 1 ? 7 : 0);
+                       comm->Broadcast(x.data(), x.data(), n * sizeof(int64_t), 1);
+                       std::vector<int64_t> y(n, comm->rank);
+                       if (comm->rank == 0) {
+                         comm->Send(y.data(), n * sizeof(int64_t), 1);
+                       } else {
+                         comm->Recv(y.data(), n * sizeof(int64_t), 0);
+                       }
+                       for (int64_t i = 0; i < n; ++i) {
+                         if (x[i] != 7 || y[i] != 0) return false;
+                       }
+                       return true;
+                     }),
+            0);
+}
+
+TEST_F(SHMCommunicator, StaleSegment) {
+  // Leave the segment of a job whose rank 0 is killed while waiting for rank 1.
+  setenv("RAF_SHM_JOB_ID", "test_stale_segment", 1);
+  std::ostringstream name;
+  name << "/raf_shm_test_stale_segment_" << std::hex << std::hash<std::string>{}("0,1,");
+  pid_t crashed = RunRank(2, 0, [](SHMCommunicatorObj*) { return true; });
+  int fd = -1;
+  while ((fd = shm_open(name.str().c_str(), O_RDONLY, 0)) < 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  close(fd);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  kill(crashed, SIGKILL);
+  waitpid(crashed, nullptr, 0);
+
+  // Start rank 1 of the next job first, so it finds the stale segment before rank 0 replaces it.
+  std::vector<pid_t> pids;
+  pids.push_back(RunRank(2, 1, [](SHMCommunicatorObj* comm) {
+    int64_t x = comm->rank + 1;
+    comm->AllReduce(&x, &x, 1, DLDataType{kDLInt, 64, 1}, SHMReduceOp::kSum);
+    return x == 3;
+  }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  pids.push_back(RunRank(2, 0, [](SHMCommunicatorObj* comm) {
+    int64_t x = comm->rank + 1;
+    comm->AllReduce(&x, &x, 1, DLDataType{kDLInt, 64, 1}, SHMReduceOp::kSum);
+    return x == 3;
+  }));
+  unsetenv("RAF_SHM_JOB_ID");
+  ASSERT_EQ(WaitRanks(pids), 0);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
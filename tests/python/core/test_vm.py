@@ -4,9 +4,14 @@
 import pytest
 import numpy as np
 import raf
+from raf._core.device import Device
 from raf._core.executor import VMExecutor
+from raf._core.vm import BatchingServer, VirtualMachine
+from raf._lib import _TVMError
 from raf.testing import check, compile_vm_model, run_vm_model, get_arr_addr, randn
 from raf.testing import get_testable_devices
+from raf.utils import profiler
+from tvm import relay
 
 
 @pytest.mark.parametrize("device", get_testable_devices())
@@ -187,6 +192,245 @@ def test_split_fusion(device):
     check_e2e(model, device, [m_x])
 
 
+@pytest.mark.parametrize("device", get_testable_devices())
+@pytest.mark.parametrize("shape", [[3, 3], [4, 4]])
+def test_static_arena(device, shape):
+    # pylint: disable=protected-access
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):  # pylint: disable=no-self-use
+            a = raf.add(x, x)
+            b = raf.relu(a)
+            c = raf.multiply(b, x)
+            d = raf.add(c, b)
+            return raf.relu(d)
+
+    model = Model()
+    model.infer_mode()
+    m_x, _ = randn(shape, device=device)
+    mod = model._internal(m_x).mod
+    config = {"raf.vm.static_arena": True}
+    with raf.ir.PassContext(config=config, disabled_pass=["FuseDialect", "FuseTVM"]):
+        executor = VMExecutor(mod, device)
+    assert "static arena size" in executor.executable.bytecode
+    ref_y = model(m_x).numpy()
+    m_y = executor.make_executor()(m_x)
+    np.testing.assert_allclose(m_y.numpy(), ref_y, rtol=1e-5, atol=1e-5)
+
+    # The output of a run must stay valid after the next run.
+    m_x2, _ = randn(shape, device=device)
+    m_y2 = executor.vm.run(m_x2)
+    np.testing.assert_allclose(m_y.numpy(), ref_y, rtol=1e-5, atol=1e-5)
+    np.testing.assert_allclose(m_y2.numpy(), model(m_x2).numpy(), rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_context_reuse(device):
+    # pylint: disable=protected-access
+    shape = [4, 4]
+
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, y):  # pylint: disable=no-self-use
+            a = raf.matmul(x, y)
+            return raf.relu(raf.add(a, x))
+
+    model = Model()
+    model.infer_mode()
+    m_x, _ = randn(shape, device=device)
+    m_y, _ = randn(shape, device=device)
+    mod = model._internal(m_x, m_y).mod
+    executor = VMExecutor(mod, device)
+    vm = executor.vm
+    ctx = vm.prepare_context("main", m_x, m_y)
+    m_z = vm.run(m_x, m_y, ctx=ctx)
+    ref_z = model(m_x, m_y).numpy()
+    check(m_z, ref_z, rtol=1e-5, atol=1e-5)
+
+    # Rebind the inputs of the same context, including by name.
+    for _ in range(3):
+        n_x, _ = randn(shape, device=device)
+        n_y, _ = randn(shape, device=device)
+        n_z = vm.run(n_x, ctx=ctx, y=n_y)
+        check(n_z, model(n_x, n_y), rtol=1e-5, atol=1e-5)
+    # The output of an earlier run must stay valid.
+    check(m_z, ref_z, rtol=1e-5, atol=1e-5)
+
+    with pytest.raises(Exception):
+        vm.bind_inputs(ctx, m_x)
+
+
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_warmup(device):
+    # pylint: disable=protected-access
+    shape = [8, 8]
+
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, y):  # pylint: disable=no-self-use
+            a = raf.matmul(x, y)
+            b = raf.softmax(a)
+            return raf.relu(raf.add(b, x))
+
+    model = Model()
+    model.infer_mode()
+    m_x, _ = randn(shape, device=device)
+    m_y, _ = randn(shape, device=device)
+    mod = model._internal(m_x, m_y).mod
+    vm = VMExecutor(mod, device).vm
+
+    finished = []
+    stats = vm.warmup(m_x, m_y, num_threads=2, progress=lambda done, total: finished.append(done))
+    assert stats["num_sites"] > 0
+    assert stats["num_compiled"] == stats["num_sites"]
+    assert stats["num_failed"] == 0
+    assert finished[-1] == stats["num_compiled"]
+
+    # All kernels are cached by the first warmup.
+    stats = vm.warmup(m_x, m_y)
+    assert stats["num_cached"] == stats["num_sites"]
+    assert stats["num_compiled"] == 0
+
+    m_z = vm.run(m_x, m_y)
+    check(m_z, model(m_x, m_y), rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_shared_constants(device):
+    # pylint: disable=protected-access
+    shape = (4, 16)
+    konst = np.random.randn(*shape).astype("float32")
+    x = raf.ir.var("x", shape=shape)
+    y = raf.ir.op.add(x, raf.ir.const(konst))
+    mod = raf.ir.IRModule()
+    mod["main"] = relay.Function([x], y)
+    mod = raf._ffi.pass_.ToANormalForm()(mod)
+    with raf.ir.PassContext(opt_level=1):
+        exe = VMExecutor(mod, device).executable
+    m_x, n_x = randn(shape, device=device)
+
+    def get_stats():
+        return {str(k): v.value for k, v in raf._ffi.vm.SharedConstantPoolStats().items()}
+
+    base = get_stats()
+    vms = [VirtualMachine(exe, Device(device), share_constants=True) for _ in range(3)]
+    for vm in vms:
+        check(vm.run(m_x), n_x + konst)
+    # The replicas hold a single copy of the constant.
+    stats = get_stats()
+    assert stats["num_pools"] == base["num_pools"] + 1
+    assert stats["nbytes"] == base["nbytes"] + konst.nbytes
+
+    # A VM that does not share the constants loads its own copy.
+    check(VirtualMachine(exe, Device(device)).run(m_x), n_x + konst)
+    assert get_stats() == stats
+
+    # The pool is freed with the last VM that uses it.
+    del vm, vms
+    assert get_stats() == base
+
+
+@pytest.mark.parametrize("device", get_testable_devices())
+@pytest.mark.parametrize("num_workers", [1, 2])
+def test_batching_server(device, num_workers):
+    # pylint: disable=protected-access
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, w):  # pylint: disable=no-self-use
+            y = raf.relu(raf.matmul(x, w))
+            return y, raf.add(y, y)
+
+    model = Model()
+    model.infer_mode()
+    m_w, n_w = randn((8, 8), device=device)
+    m_x, _ = randn((1, 8), device=device)
+    server = BatchingServer.from_model(
+        model,
+        device,
+        [1, 2, 4],
+        [m_x],
+        [m_w],
+        max_delay_us=100000,
+        num_workers=num_workers,
+    )
+
+    requests = [randn((rows, 8), device=device) for rows in [1, 2, 1, 1, 3]]
+    ids = [server.submit(m_x) for m_x, _ in requests]
+    for request_id, (_, n_x) in zip(ids, requests):
+        m_y, m_z = server.get(request_id)
+        n_y = np.maximum(np.matmul(n_x, n_w), 0)
+        check(m_y, n_y, rtol=1e-5, atol=1e-5)
+        check(m_z, n_y + n_y, rtol=1e-5, atol=1e-5)
+    m_y, _ = server.infer(requests[0][0])
+    check(m_y, np.maximum(np.matmul(requests[0][1], n_w), 0), rtol=1e-5, atol=1e-5)
+
+    stats = server.stats()
+    assert stats["num_requests"] == 6
+    assert stats["num_rows"] == 9
+    assert stats["num_batches"] < 6
+
+    # The row shape and dtype of a request must match the parameter.
+    with pytest.raises(_TVMError):
+        server.submit(randn((1, 4), device=device)[0])
+    with pytest.raises(_TVMError):
+        server.submit(randn((1, 8), dtype="float64", device=device)[0])
+    server.stop()
+
+
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_instruction_profiling(device):
+    # pylint: disable=protected-access
+    shape = [3, 3]
+
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):  # pylint: disable=no-self-use
+            y = raf.add(x, x)
+            z = raf.add(x, y)
+            return y, z
+
+    model = Model()
+    model.infer_mode()
+    m_x, _ = randn(shape, device=device)
+    mod = model._internal(m_x).mod
+    executor = VMExecutor(mod, device)
+    ref_y, ref_z = model(m_x)
+
+    # The dispatch loop is specialized on whether each instruction is profiled.
+    profiler.start(prof_level=2)
+    m_y, m_z = executor.vm.run(m_x)
+    profiler.stop()
+    check(m_y, ref_y, rtol=1e-5, atol=1e-5)
+    check(m_z, ref_z, rtol=1e-5, atol=1e-5)
+    data = profiler.get()
+    names = {e["name"] for e in data["traceEvents"] if e["cat"] == "VMInstruction"}
+    assert {"InvokeJit", "AllocTuple", "Ret"} <= names
+
+    m_y, m_z = executor.vm.run(m_x)
+    check(m_y, ref_y, rtol=1e-5, atol=1e-5)
+    check(m_z, ref_z, rtol=1e-5, atol=1e-5)
+
+
 def test_reshape():
     # pylint: disable=protected-access, attribute-defined-outside-init, no-self-use
     shape = [3, 4, 5]
@@ -113,5 +113,51 @@ def test_vm_memory_profiler(device, pool_name):
             assert peak_memory == 0
 
 
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_vm_alloc_trace(device):
+    # pylint: disable=protected-access
+    class Model(raf.Model):
+        # pylint: disable=attribute-defined-outside-init,no-self-use
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, w):
+            y = raf.conv2d(x, w, stride=1, padding=1, dilation=1, groups=1)
+            y = raf.conv2d(y, w, stride=1, padding=1, dilation=1, groups=1)
+            y = raf.conv2d(y, w, stride=1, padding=1, dilation=1, groups=1)
+            return y
+
+    xshape = (32, 3, 224, 224)
+    wshape = (3, 3, 3, 3)
+    model = Model()
+    model.infer_mode()
+    m_x, _ = randn(xshape, device=device)
+    m_w, _ = randn(wshape, device=device)
+    mod = model._internal(m_x, m_w).mod
+    with tvm.transform.PassContext(opt_level=3):
+        executor = VMExecutor(mod, device).make_executor()
+        raf.utils.memory_profiler.reset()
+        raf.utils.memory_profiler.start(trace_pool=False, trace_allocations=True)
+        executor(m_x, m_w)
+        raf.utils.memory_profiler.stop()
+
+    events = raf.utils.memory_profiler.get_allocation_trace(raf.Device(device))
+    assert events
+    assert all(event["func_name"] == "main" for event in events if event["kind"] == "storage")
+    estimated = raf.model.model.trace_memory(model, device, [m_x, m_w], include_param=False)
+    ret = raf.utils.memory_profiler.analyze_allocations(
+        raf.Device(device), top_n=2, estimated_trace=estimated
+    )
+    # The peak has the input and the output of a conv2d, besides the possible workspace.
+    buffer_size = (32 * 3 * 224 * 224) * 4 / 1048576
+    assert ret["high_water_mark"] >= 2 * buffer_size - 1e-3
+    assert 0 <= ret["fragmentation"] < 1
+    assert "conv2d" in ret["top_contributors"][0][0]
+    assert len(ret["top_tensors"]) <= 2
+    assert "estimate_error" in ret
+    raf.utils.memory_profiler.reset()
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
@@ -2,6 +2,10 @@
 # SPDX-License-Identifier: Apache-2.0
 
 # pylint: disable=invalid-name,protected-access,attribute-defined-outside-init
+import os
+import subprocess
+import sys
+
 import pytest
 import numpy as np
 import raf
@@ -19,8 +23,8 @@ def run_exec(exe, inputs):
     return out
 
 
-def serialize_and_load(exe):
-    code, lib = exe.save()
+def serialize_and_load(exe, vm=None, mmap=False):
+    code, lib = exe.save(vm)
     tmp = tvm.contrib.utils.tempdir()
     if lib is not None:
         lib_path = tmp.relpath("lib.so")
@@ -30,8 +34,10 @@ def serialize_and_load(exe):
         fo.write(code)
 
     # load from file
-    loaded_code = bytearray(open(code_path, "rb").read())
     loaded_lib = None if lib is None else tvm.runtime.load_module(lib_path)
+    if mmap:
+        return Executable.load_exec_from_file(code_path, loaded_lib)
+    loaded_code = bytearray(open(code_path, "rb").read())
     return Executable.load_exec(loaded_code, loaded_lib)
 
 
@@ -66,7 +72,8 @@ def test_simple(fuse):
 
 
 @pytest.mark.parametrize("fuse", [True, False])
-def test_constant(fuse):
+@pytest.mark.parametrize("mmap", [True, False])
+def test_constant(fuse, mmap):
     shape = (3, 5)
     konst1 = raf.ir.const(np.random.randn(1, 5).astype("float32"))
     x = raf.ir.var("x", shape=shape)
@@ -82,7 +89,7 @@ def test_constant(fuse):
     m_x, _ = randn(shape)
     ref_y = executor.make_executor()(m_x)
 
-    loaded_exe = serialize_and_load(executor.executable)
+    loaded_exe = serialize_and_load(executor.executable, mmap=mmap)
     m_y = run_exec(loaded_exe, [m_x])
     check(m_y, ref_y)
 
@@ -115,5 +122,98 @@ def test_tuple(fuse):
         check(t, ref_t)
 
 
+def test_constant_blobs():
+    # A large constant is saved as a page aligned blob, while the small one is packed after it.
+    large = np.random.randn(64, 256).astype("float32")
+    small = np.random.randn(1, 256).astype("float32")
+    x = raf.ir.var("x", shape=(64, 256))
+    y = raf.ir.op.add(x, raf.ir.const(large))
+    y = raf.ir.op.multiply(y, raf.ir.const(small))
+    mod = raf.ir.IRModule()
+    mod["main"] = relay.Function([x], y)
+    mod = raf._ffi.pass_.ToANormalForm()(mod)
+    executor = VMExecutor(mod, "cpu")
+    m_x, n_x = randn((64, 256))
+
+    code, _ = executor.executable.save()
+    assert len(code) >= 4096 + large.nbytes + small.nbytes
+
+    # The executable saved from the mapped one is the same.
+    loaded_exe = serialize_and_load(executor.executable, mmap=True)
+    assert loaded_exe.save()[0] == code
+    check(run_exec(loaded_exe, [m_x]), (n_x + large) * small)
+
+
+def test_aot_bundle():
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, w):
+            y = raf.matmul(x, w)
+            return raf.relu(raf.add(y, x))
+
+    model = Model()
+    m_x, _ = randn((4, 4), device="cpu")
+    m_w, _ = randn((4, 4), device="cpu")
+    mod = model._internal(m_x, m_w).mod
+    executor = VMExecutor(mod, "cpu")
+    vm = executor.vm
+    ref_out = vm.run(m_x, m_w)
+
+    # The bundle records the dispatch decisions made by the VM.
+    loaded_exe = serialize_and_load(executor.executable, vm)
+    assert "AOT dispatch records" in loaded_exe.stats
+    out = run_exec(loaded_exe, [m_x, m_w])
+    check(out, ref_out)
+
+    # A new process runs the bundle with the bundled kernels only, without JIT compilation.
+    tmp = tvm.contrib.utils.tempdir()
+    code, lib = executor.executable.save(vm)
+    lib_path = ""
+    if lib is not None:
+        lib_path = tmp.relpath("lib.so")
+        lib.export_library(lib_path)
+    with open(tmp.relpath("code.ro"), "wb") as fo:
+        fo.write(code)
+    np.savez(tmp.relpath("inputs.npz"), x=m_x.numpy(), w=m_w.numpy())
+    script = """
+import sys
+import numpy as np
+import tvm
+import raf
+from raf._core.device import Device
+from raf._core.vm import Executable, VirtualMachine
+
+lib = tvm.runtime.load_module(sys.argv[4]) if sys.argv[4] else None
+exe = Executable.load_exec(bytearray(open(sys.argv[1], "rb").read()), lib)
+inputs = np.load(sys.argv[2])
+x = raf.array(inputs["x"], device="cpu")
+w = raf.array(inputs["w"], device="cpu")
+out = VirtualMachine(exe, Device("cpu")).run(x, w)
+np.save(sys.argv[3], out.numpy())
+metric = raf._ffi.cache.DumpTVMCacheMetric("tvm_cpu")
+print(int(metric["CacheMiss"]), int(metric["CacheSet"]))
+"""
+    env = dict(os.environ)
+    env.pop("RAF_PERSIST_CACHE", None)
+    result = subprocess.run(
+        [sys.executable, "-c", script]
+        + [tmp.relpath(name) for name in ["code.ro", "inputs.npz", "out.npy"]]
+        + [lib_path],
+        env=env,
+        stdout=subprocess.PIPE,
+        check=True,
+    )
+    num_miss, num_set = result.stdout.decode().split()[-2:]
+    assert (num_miss, num_set) == ("0", "0")
+    check(np.load(tmp.relpath("out.npy")), ref_out)
+
+    # A plain executable has no AOT section.
+    loaded_exe = serialize_and_load(executor.executable)
+    assert "AOT dispatch records" not in loaded_exe.stats
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
@@ -0,0 +1,197 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# pylint: disable=no-self-use,invalid-name, protected-access, too-many-locals, broad-except
+"""Test the collective communication operators of the shm dialect on CPU.
+Unlike test_collective_communication.py, this test does not need mpirun. Each test forks one
+process per rank, which sets its rank in the void communicator and runs the operators with both
+the interpreter and the VM.
+"""
+import multiprocessing
+import os
+import sys
+
+import pytest
+import numpy as np
+
+import raf
+from raf import distributed as dist
+from raf._core.ndarray import Symbol
+from raf.testing import check, run_model, run_vm_model
+
+DEVICE = "cpu"
+TIMEOUT = 300
+
+
+def run_ranks(size, func):
+    """Fork one process per rank to run func(rank, size), and return the results by rank."""
+    ctx = multiprocessing.get_context("fork")
+    queue = ctx.Queue()
+
+    def worker(rank):
+        try:
+            dist.set_default_communicator("void")
+            comm = dist.get_communicator()
+            comm.size = size
+            comm.rank = rank
+            comm.local_size = size
+            comm.local_rank = rank
+            queue.put((rank, func(rank, size), None))
+        except Exception as err:
+            queue.put((rank, None, repr(err)))
+        finally:
+            os._exit(0)
+
+    procs = [ctx.Process(target=worker, args=(rank,)) for rank in range(size)]
+    for proc in procs:
+        proc.start()
+    results = [None] * size
+    for _ in range(size):
+        rank, result, err = queue.get(timeout=TIMEOUT)
+        assert err is None, f"Rank {rank} failed: {err}"
+        results[rank] = result
+    for proc in procs:
+        proc.join()
+    return results
+
+
+@pytest.mark.parametrize("computation", ["sum", "prod", "min", "max", "avg"])
+def test_allreduce(computation):
+    class TestModel(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x1, x2):
+            x = raf.allreduce([x1, x2], computation=computation)
+            return raf.concatenate((x[0], x[1]))
+
+    def run(rank, _):
+        model = TestModel()
+        model.to(device=DEVICE)
+        x1 = raf.array(np.ones((4, 4), dtype="float32") * (rank + 1), device=DEVICE)
+        x2 = raf.array(np.ones((4, 4), dtype="float32") * (-rank - 1), device=DEVICE)
+        return run_model(model, [x1, x2], DEVICE).numpy()
+
+    size = 3
+    ones = np.ones((4, 4), dtype="float32")
+    values = np.arange(1, size + 1, dtype="float32")
+    reduce = {"sum": np.sum, "prod": np.prod, "min": np.min, "max": np.max, "avg": np.mean}
+    reduce = reduce[computation]
+    target = np.concatenate([ones * reduce(values), ones * reduce(-values)])
+    for out in run_ranks(size, run):
+        check(out, target)
+
+
+@pytest.mark.parametrize("axis", [0, 1])
+def test_allgather(axis):
+    class TestModel(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            return raf.allgather(x, axis=axis)
+
+    def run(rank, _):
+        model = TestModel()
+        model.to(device=DEVICE)
+        x = raf.array(np.ones((4, 4), dtype="float32") * (rank + 1), device=DEVICE)
+        return run_model(model, [x], DEVICE).numpy()
+
+    size = 2
+    ones = np.ones((4, 4), dtype="float32")
+    target = np.concatenate([ones * (r + 1) for r in range(size)], axis=axis)
+    for out in run_ranks(size, run):
+        check(out, target)
+
+
+def test_reduce_scatter():
+    class TestModel(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, y):
+            return raf.reduce_scatter(Symbol.make_tuple([x, y]), computation="sum")
+
+    def run(rank, _):
+        model = TestModel()
+        model.to(device=DEVICE)
+        x = raf.array(np.ones((4, 4), dtype="float32") * (rank + 1), device=DEVICE)
+        y = raf.array(np.ones((4, 4), dtype="float32") * (-rank - 1), device=DEVICE)
+        return run_model(model, [x, y], DEVICE).numpy()
+
+    ones = np.ones((4, 4), dtype="float32")
+    out0, out1 = run_ranks(2, run)
+    check(out0, ones * 3)
+    check(out1, -ones * 3)
+
+
+@pytest.mark.parametrize("root", [0, 1])
+def test_broadcast_reduce(root):
+    # pylint: disable=attribute-defined-outside-init
+    class TestModel(raf.Model):
+        def build(self, root):
+            self.root = root
+
+        @raf.model.trace
+        def forward(self, x):
+            y = raf.broadcast(x, self.root)
+            z = raf.reduce(x, self.root, computation="sum")
+            return Symbol.make_tuple([y, z])
+
+    def run(rank, _):
+        model = TestModel(root=root)
+        model.to(device=DEVICE)
+        x = raf.array(np.ones((4, 4), dtype="float32") * (rank + 1), device=DEVICE)
+        # The result of reduce is only valid on the root.
+        out = run_model(model, [x], DEVICE, check_result=False)
+        return [out[0].numpy(), out[1].numpy()]
+
+    ones = np.ones((4, 4), dtype="float32")
+    for rank, out in enumerate(run_ranks(2, run)):
+        check(out[0], ones * (root + 1))
+        if rank == root:
+            check(out[1], ones * 3)
+
+
+def test_send_recv():
+    shape = [2, 2]
+    dtype = "float32"
+
+    class TestModel_0(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            t = raf.send(x, peer=1)
+            y = raf.recv(peer=1, shape=shape, dtype=dtype, token=t)
+            return Symbol.make_tuple([raf.add(x, y), t])
+
+    class TestModel_1(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            y = raf.recv(peer=0, shape=shape, dtype=dtype)
+            t = raf.send(x, peer=0, token=y)
+            return Symbol.make_tuple([raf.add(x, y), t])
+
+    def run(rank, _):
+        model = TestModel_0() if rank == 0 else TestModel_1()
+        model.to(device=DEVICE)
+        x = raf.array(np.ones(shape, dtype=dtype) * (rank + 1), device=DEVICE)
+        out1 = model(x)
+        out2 = run_vm_model(model, DEVICE, [x])
+        return [out1[0].numpy(), out2[0].numpy()]
+
+    for out1, out2 in run_ranks(2, run):
+        check(out1, np.ones(shape, dtype=dtype) * 3)
+        check(out2, out1)
+
+
+if __name__ == "__main__":
+    sys.exit(pytest.main([__file__]))
@@ -46,6 +46,32 @@ def test_simple(device, fuse):
     check(v_res, expected)
 
 
+@pytest.mark.parametrize("device", get_testable_devices())
+@pytest.mark.parametrize("fast_path", [True, False])
+def test_changing_shapes(device, fast_path, monkeypatch):
+    # pylint: disable=no-self-use, protected-access
+    monkeypatch.setenv("RAF_VM_DISABLE_OPENV_FAST_PATH", "0" if fast_path else "1")
+
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            y = raf.argwhere(x)
+            y = raf.abs(y)
+            return y
+
+    model = Model()
+    m_x = raf.array(np.ones((2, 2)).astype("float32"), device=device)
+    mod = model._internal(m_x).mod
+    vm = get_vm_executor(mod, device)
+    # The same instructions see different shapes across runs.
+    for n_x in [np.ones((2, 2)), np.eye(2), np.ones((2, 2))]:
+        m_x = raf.array(n_x.astype("float32"), device=device)
+        check(vm(m_x), model(m_x))
+
+
 @pytest.mark.parametrize("device", get_testable_devices())
 def test_dynamic_reshape(device):
     # pylint: disable=no-self-use
@@ -0,0 +1,145 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# pylint: disable=too-many-locals,too-many-arguments,protected-access,no-member
+import pytest
+import numpy as np
+
+import raf
+from raf.testing import randn, randint, run_vm_model, check, with_dialect
+
+
+def np_softmax(x, axis):
+    x = x - np.max(x, axis=axis, keepdims=True)
+    e_x = np.exp(x)
+    return e_x / np.sum(e_x, axis=axis, keepdims=True)
+
+
+def np_log_softmax(x, axis):
+    x = x - np.max(x, axis=axis, keepdims=True)
+    return x - np.log(np.sum(np.exp(x), axis=axis, keepdims=True))
+
+
+def test_cpu_isa():
+    isa = raf._core.backends.cpu.isa
+    assert isa in ["scalar", "avx2", "avx512"]
+
+
+@with_dialect(["cpu", "tvm"])
+@pytest.mark.parametrize("shape", [[3], [3, 2], [4, 7, 33], [2, 1000]])
+@pytest.mark.parametrize("axis", [-1, 0])
+@pytest.mark.parametrize(
+    "funcs",
+    [
+        [raf._op.sym.softmax, np_softmax],
+        [raf._op.sym.log_softmax, np_log_softmax],
+    ],
+)
+def test_cpu_softmax(shape, axis, funcs):
+    raf_fwd, np_fwd = funcs
+
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            return raf_fwd(x, axis=axis)
+
+    model = Model()
+    m_x, n_x = randn(shape)
+    m_y = model(m_x)
+    v_y = run_vm_model(model, "cpu", [m_x], disable_fusion=True)
+    n_y = np_fwd(n_x, axis)
+    check(m_y, n_y, rtol=1e-5, atol=1e-5)
+    check(v_y, n_y, rtol=1e-5, atol=1e-5)
+
+
+@with_dialect(["cpu", "tvm"])
+@pytest.mark.parametrize("shape", [[5, 4], [2, 3, 65], [8, 1024]])
+@pytest.mark.parametrize("eps", [1e-5, 1e-12])
+@pytest.mark.parametrize("affine", [True, False])
+def test_cpu_layer_norm(shape, eps, affine):
+    class LayerNorm(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, *inputs):
+            return raf.layer_norm(*inputs, axis=-1, eps=eps)
+
+    model = LayerNorm()
+    m_x, n_x = randn(shape)
+    n_mean = np.mean(n_x, axis=-1, keepdims=True)
+    n_var = np.var(n_x, axis=-1, keepdims=True)
+    n_y = (n_x - n_mean) / np.sqrt(n_var + eps)
+    inputs = [m_x]
+    if affine:
+        m_scale, n_scale = randn([shape[-1]])
+        m_bias, n_bias = randn([shape[-1]])
+        n_y = n_y * n_scale + n_bias
+        inputs += [m_scale, m_bias]
+    m_y = model(*inputs)
+    v_y = run_vm_model(model, "cpu", inputs, disable_fusion=True)
+    check(m_y, n_y, rtol=1e-4, atol=1e-4)
+    check(v_y, n_y, rtol=1e-4, atol=1e-4)
+
+
+@with_dialect(["cpu", "tvm"])
+@pytest.mark.parametrize("shape", [[10, 3], [50, 128]])
+@pytest.mark.parametrize("ishape", [[4], [2, 7]])
+@pytest.mark.parametrize("idtype", ["int32", "int64"])
+def test_cpu_embedding(shape, ishape, idtype):
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x, indices):
+            return raf.embedding(x, indices)
+
+    model = Model()
+    m_x, n_x = randn(shape)
+    m_i, n_i = randint(ishape, low=0, high=shape[0], dtype=idtype)
+    m_y = model(m_x, m_i)
+    v_y = run_vm_model(model, "cpu", [m_x, m_i], disable_fusion=True)
+    n_y = np.take(n_x, n_i, axis=0)
+    check(m_y, n_y)
+    check(v_y, n_y)
+
+
+@with_dialect(["cpu", "tvm"])
+@pytest.mark.parametrize("shape", [[7], [3, 100001]])
+@pytest.mark.parametrize(
+    "dtypes",
+    [
+        ["float32", "float16"],
+        ["float16", "float32"],
+        ["float32", "int32"],
+        ["int64", "float64"],
+        ["uint8", "float32"],
+    ],
+)
+def test_cpu_cast(shape, dtypes):
+    itype, otype = dtypes
+
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            return raf.cast(x, otype)
+
+    model = Model()
+    n_x = (np.random.randn(*shape) * 100).astype(itype)
+    m_x = raf.array(n_x, device="cpu")
+    m_y = model(m_x)
+    v_y = run_vm_model(model, "cpu", [m_x], disable_fusion=True)
+    n_y = n_x.astype(otype)
+    check(m_y, n_y)
+    check(v_y, n_y)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -505,5 +505,97 @@ def test_multi_functions():
     assert mod["main"].checked_type == expected_ty
 
 
+def test_incremental():
+    # pylint: disable=too-many-statements
+    x = extended_var("x", shape=(4, 1), dtype="float32")
+    y = extended_var("y", shape=(1, 8), dtype="float32")
+    a1, a2, a3 = extended_var("a1"), extended_var("a2"), extended_var("a3")
+    b, out = extended_var("b"), extended_var("out")
+    body = relay.Let(out, raf.ir.op.add(a3, b), out)
+    body = relay.Let(a3, raf.ir.op.abs(a2), body)
+    body = relay.Let(a2, raf.ir.op.add(a1, a1), body)
+    body = relay.Let(b, raf.ir.op.abs(y), body)
+    body = relay.Let(a1, raf.ir.op.relu(x), body)
+    mod = IRModule.from_expr(relay.Function([x, y], body))
+    mod = InferType()(mod)
+
+    def get_bindings(func):
+        bindings, expr = [], func.body
+        while isinstance(expr, relay.Let):
+            bindings.append((expr.var, expr.value))
+            expr = expr.body
+        return bindings, expr
+
+    config = {"raf.type_infer.incremental": True, "raf.type_infer.validate": True}
+    # Nothing is changed, so all bindings are reused.
+    with raf.ir.PassContext(config=config):
+        new_mod = InferType()(mod)
+    assert new_mod["main"].body.same_as(mod["main"].body)
+    assert new_mod["main"].checked_type == mod["main"].checked_type
+
+    # Change the binding of a1, which changes the types of a2 and a3 but not out.
+    func = mod["main"]
+    bindings, ret = get_bindings(func)
+    params = list(func.params)
+    bindings[0] = (bindings[0][0], raf.ir.op.add(params[0], params[1]))
+    body = ret
+    for var, value in reversed(bindings):
+        body = relay.Let(var, value, body)
+    mod = IRModule.from_expr(relay.Function(params, body))
+    with raf.ir.PassContext(config=config):
+        new_mod = InferType()(mod)
+    new_bindings, _ = get_bindings(new_mod["main"])
+    ty = relay.TensorType((4, 8))
+    for idx in [0, 2, 3, 4]:
+        assert_has_type(new_bindings[idx][1], ty)
+    assert_has_type(new_bindings[1][1], relay.TensorType((1, 8)))
+    # The binding of b does not depend on a1, so it is reused.
+    assert new_bindings[1][1].same_as(bindings[1][1])
+    assert not new_bindings[2][1].same_as(bindings[2][1])
+    assert new_mod["main"].checked_type == relay.FuncType(
+        [relay.TensorType((4, 1)), relay.TensorType((1, 8))], ty
+    )
+
+
+def test_incremental_primitive_function():
+    p0 = extended_var("p0", shape=(4, 1), dtype="float32")
+    p1, p2 = extended_var("p1"), extended_var("p2")
+    fn_body = relay.Let(p1, raf.ir.op.add(p0, p0), relay.Let(p2, raf.ir.op.abs(p1), p2))
+    fn = relay.Function([p0], fn_body).with_attr("Primitive", tvm.tir.IntImm("int32", 1))
+    x = extended_var("x", shape=(4, 1), dtype="float32")
+    y = extended_var("y", shape=(1, 8), dtype="float32")
+    a1, a2 = extended_var("a1"), extended_var("a2")
+    body = relay.Let(a1, raf.ir.op.relu(x), relay.Let(a2, relay.Call(fn, [a1]), a2))
+    mod = IRModule.from_expr(relay.Function([x, y], body))
+    mod = InferType()(mod)
+
+    # Change the shape of the argument of the fused function, whose body must be re-inferred
+    # with its updated params.
+    func = mod["main"]
+    params = list(func.params)
+    call = func.body.body.value
+    body = relay.Let(
+        func.body.var,
+        raf.ir.op.add(params[0], params[1]),
+        relay.Let(func.body.body.var, call, func.body.body.body),
+    )
+    mod = IRModule.from_expr(relay.Function(params, body))
+    config = {"raf.type_infer.incremental": True, "raf.type_infer.validate": True}
+    with raf.ir.PassContext(config=config):
+        new_mod = InferType()(mod)
+    ty = relay.TensorType((4, 8))
+    new_call = new_mod["main"].body.body.value
+    assert_has_type(new_call, ty)
+    new_fn = new_call.op
+    assert_has_type(new_fn.params[0], ty)
+    assert_has_type(new_fn.body.value, ty)
+    assert_has_type(new_fn.body.body.value, ty)
+    # The body refers to the updated params instead of the stale ones.
+    assert new_fn.body.value.args[0].same_as(new_fn.params[0])
+    assert new_mod["main"].checked_type == relay.FuncType(
+        [relay.TensorType((4, 1)), relay.TensorType((1, 8))], ty
+    )
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
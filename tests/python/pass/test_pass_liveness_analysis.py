@@ -239,6 +239,28 @@ def test_folded_const_in_tuple():
     verify_live_in_set(mod, expected)
 
 
+def test_residual_chain():
+    # Each add reads the output of the previous line and the one of skip lines before.
+    num_ops, skip = 200, 4
+    sb = ScopeBuilder()
+    p0 = raf.ir.var("p0", shape=(4, 4))
+    outs = [p0]
+    for i in range(num_ops):
+        outs.append(sb.let("a%d" % i, raf.ir.op.add(outs[i], outs[max(i + 1 - skip, 0)])))
+    sb.ret(outs[-1])
+    mod = tvm.IRModule.from_expr(relay.Function([p0], sb.get()))
+    mod = InferType()(mod)
+    ret = LivenessAnalysis(mod)
+    ret = {key.name_hint: {v.name_hint for v in var_list} for key, var_list in ret.items()}
+
+    # outs[j] is live from line j to its last use.
+    names = ["param_0"] + ["t_%d" % j for j in range(num_ops)]
+    last_use = [skip - 1] + [j + skip - 1 for j in range(1, num_ops + 1)]
+    for i in range(num_ops):
+        expected = {names[j] for j in range(i + 1) if last_use[j] >= i}
+        assert ret["a%d" % i] == expected, "Live in set of a%d: %s" % (i, ret["a%d" % i])
+
+
 def test_reshape():
     shape = (10, 10)
 
@@ -15,6 +15,7 @@ from tvm.relay.transform import function_pass, FunctionPass
 from raf._ffi import pass_
 from raf._ffi.pass_ import FromRelay
 from raf.ir import RAFSequential
+from raf.utils import pass_profiler
 
 
 def get_var_func():
@@ -156,5 +157,48 @@ def test_sequential_pass():
     assert isinstance(ret_mod["mySub"].body.checked_type, tvm.ir.TensorType)
 
 
+def test_pass_profiler():
+    shape = (10,)
+    tp = relay.TensorType(shape, "float32")
+    x = relay.var("x", tp)
+    y = relay.var("y", tp)
+    v_sub = relay.GlobalVar("mySub")
+    sub = relay.Function([x, y], relay.log(relay.subtract(x, y)))
+    tvm_mod = FromRelay()(tvm.IRModule({v_sub: sub}))
+
+    inner = RAFSequential(passes=[pass_.InferType()], opt_level=1, name="inner")
+    sequential = RAFSequential(
+        passes=[pass_.InferType(), inner, pass_.DeadCodeElimination()], opt_level=1, name="outer"
+    )
+    pass_profiler.reset()
+    pass_profiler.start()
+    try:
+        with PassContext():
+            sequential(tvm_mod)
+    finally:
+        pass_profiler.stop()
+    records = pass_profiler.get_records()
+    pass_profiler.reset()
+
+    names = [(r["seq_name"], r["pass_name"], r["depth"]) for r in records]
+    assert names == [
+        ("outer", "InferType", 0),
+        ("outer", "inner", 0),
+        ("inner", "InferType", 1),
+        ("outer", "DeadCodeElimination", 0),
+    ]
+    for record in records:
+        assert record["elapsed_us"] >= 0
+        assert record["peak_rss_delta_kb"] >= 0
+        assert record["nodes_before"] > 0 and record["nodes_after"] > 0
+    # Type inference does not change the expressions.
+    assert records[0]["nodes_before"] == records[0]["nodes_after"]
+    # The nested sequence is not counted twice.
+    summary = {r["pass_name"]: r for r in pass_profiler.summarize(records)}
+    assert "inner" not in summary
+    assert summary["InferType"]["count"] == 2
+    assert not pass_profiler.get_records()
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
@@ -7,7 +7,7 @@ import raf
 from raf._lib import tvm
 from raf._core.module import IRModule
 from raf._core.device import Device
-from raf.testing import get_testable_devices, randn
+from raf.testing import check, get_testable_devices, randn, run_vm_model
 
 
 @pytest.mark.parametrize("device", get_testable_devices())
@@ -149,6 +149,43 @@ def test_reshape():
     assert "squeeze" not in text
 
 
+def test_view():
+    shape = [4, 32]
+
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            y = raf.split(x, 2, axis=0)
+            z = raf.strided_slice(y[1], (1,), (2,), (1,))
+            z = raf.transpose(z, (1, 0))
+            w = raf.strided_slice(x, (0, 0), (4, 8), (1, 1))
+            return raf.add(y[0], y[1]), raf.relu(z), w
+
+    model = Model()
+    m_x, n_x = randn(shape, device="cpu")
+    func = model._internal(m_x).mod["main"]
+    mod = IRModule.from_expr(func)
+    mod = raf._ffi.pass_.InferType()(mod)
+    with Device("cpu"):
+        mod = raf._ffi.pass_.ManifestAlloc()(mod)
+    text = mod["main"].astext()
+    # The split, the slice of a row, and the transpose of a row are views;
+    # the slice of columns is not contiguous so it is still a kernel.
+    assert text.count("vm.set_shape") == 4
+    assert "[2, 32], int64(256))" in text
+    assert "split" not in text
+    assert "transpose" not in text
+    assert text.count("strided_slice") == 1
+
+    m_y, m_z, m_w = run_vm_model(model, "cpu", [m_x])
+    check(m_y, n_x[:2] + n_x[2:])
+    check(m_z, n_x[3:4].T.clip(min=0))
+    check(m_w, n_x[:, :8])
+
+
 def test_device():
     shape = [5, 5]
 
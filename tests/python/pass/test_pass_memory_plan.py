@@ -3,18 +3,22 @@
 
 # pylint: disable=protected-access, no-self-use, attribute-defined-outside-init, invalid-name
 # pylint: disable=unused-variable, too-many-arguments
+import re
+
 import pytest
 import raf
 from raf._lib import tvm
+from raf._core.executor import VMExecutor
 from raf.testing import get_testable_devices, randn, check, run_vm_model
 
 
-def optimize(mod, device, fusion=False):
+def optimize(mod, device, fusion=False, policy="group"):
     device_name = device if device != "cpu" else "llvm"
     disabled_pass = []
     if not fusion:
         disabled_pass = ["FuseDialect", "FuseTVM"]
-    with tvm.transform.PassContext(opt_level=3, disabled_pass=disabled_pass):
+    config = {"raf.memory_plan.policy": policy}
+    with tvm.transform.PassContext(opt_level=3, config=config, disabled_pass=disabled_pass):
         opt_mod, _ = raf._core.vm.VMCompiler().optimize(mod, device=device_name, params={})
     return opt_mod
 
@@ -167,5 +171,49 @@ def test_set_shape():
     verify_correctness(model, "cpu", args, fusion=False)
 
 
+@pytest.mark.parametrize("device", get_testable_devices())
+def test_memory_plan_offset(device):
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, a, b, c, d):
+            t0 = raf.add(a, a)
+            t1 = raf.add(t0, b)
+            t2 = raf.add(t1, c)
+            t3 = raf.add(t2, t0)
+            t4 = raf.add(t3, d)
+            return t4
+
+    shape = (5, 5)
+    model = Model()
+    model.infer_mode()
+    args = [randn(shape, device=device)[0] for _ in range(4)]
+    mod = model._internal(*args).mod
+
+    # t0-t3 are packed into one storage, where t1 and t3 share the same offset because their
+    # live intervals are disjoint. The output t4 has its own storage.
+    opt_mod = optimize(mod, device, fusion=False, policy="offset")
+    alloc_storage = 0
+    total_size = 0
+    offsets = set()
+    for line in raf.ir.AsText(opt_mod["main"]).split("\n"):
+        if line.find("raf.op.vm.alloc_storage") != -1:
+            alloc_storage += 1
+            total_size += int(line[line.find("int64(") + 6 : line.find(")")])
+        elif line.find("raf.op.vm.alloc_tensor") != -1 and line.find("bool(0)") != -1:
+            offsets.add(re.findall(r"int64\((\d+)\)", line)[-1])
+    assert alloc_storage == 2
+    assert len(offsets) == 3
+    assert total_size < 500
+
+    config = {"raf.memory_plan.policy": "offset"}
+    with raf.ir.PassContext(config=config, disabled_pass=["FuseDialect", "FuseTVM"]):
+        executor = VMExecutor(mod, device)
+    out = executor.make_executor()(*args)
+    check(out, model(*args))
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
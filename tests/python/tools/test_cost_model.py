@@ -0,0 +1,92 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# pylint: disable=no-self-use,protected-access
+import pytest
+
+import raf
+from raf._ffi.cost_model import EstimateOp, GetRoofline
+from raf.testing import get_testable_devices, run_infer_type
+
+from tvm import relay
+
+ROOFLINE_CONFIG = {
+    "raf.cost_model.roofline.peak_gflops": 1000.0,
+    "raf.cost_model.roofline.bandwidth_gbps": 100.0,
+    "raf.cost_model.roofline.launch_overhead_us": 5.0,
+}
+
+
+def test_roofline_from_config():
+    with raf.ir.PassContext(config=ROOFLINE_CONFIG):
+        roofline = GetRoofline(raf.Device("cpu"))
+    assert roofline["peak_gflops"].value == 1000.0
+    assert roofline["bandwidth_gbps"].value == 100.0
+    assert roofline["launch_overhead_us"].value == 5.0
+
+
+def test_roofline_calibrate():
+    roofline = GetRoofline(raf.Device("cpu"))
+    assert roofline["peak_gflops"].value > 0
+    assert roofline["bandwidth_gbps"].value > 0
+    assert roofline["launch_overhead_us"].value >= 0
+
+
+@pytest.mark.parametrize("device_str", get_testable_devices())
+def test_roofline_estimate(device_str):
+    # The roofline is given by the configs, so no device is needed.
+    x = raf.ir.var("x", shape=(256, 256))
+    y = raf.ir.var("y", shape=(256, 256))
+    matmul = run_infer_type(raf.ir.op.matmul(x, y)).body
+    relu = run_infer_type(raf.ir.op.relu(x)).body
+    device = raf.Device(device_str)
+    with raf.ir.PassContext(config=ROOFLINE_CONFIG):
+        matmul_us = EstimateOp(matmul, device, "roofline")["latency"].value
+        relu_us = EstimateOp(relu, device, "roofline")["latency"].value
+
+    # The matmul is compute bound: 2 * 256^3 FLOPs at 1000 GFLOPS.
+    assert matmul_us == pytest.approx(5.0 + 2 * 256**3 / 1e9 * 1e6 / 1000, rel=1e-3)
+    # The relu is memory bound: reads and writes 256 * 256 floats at 100 GB/s.
+    assert relu_us == pytest.approx(5.0 + 2 * 256 * 256 * 4 / 1e9 * 1e6 / 100, rel=1e-3)
+
+
+def test_remat_with_roofline():
+    class Model(raf.Model):
+        def build(self):
+            pass
+
+        @raf.model.trace
+        def forward(self, x):
+            a_1 = raf.relu(x)
+            a_2 = raf.tanh(a_1)
+            a_3 = raf.tanh(a_2)
+            a_4 = raf.tanh(a_3)
+            a_5 = raf.add(a_3, a_4)
+            a_6 = raf.add(a_2, a_5)
+            return raf.add(a_1, a_6)
+
+    def count_calls(func):
+        calls = []
+        relay.analysis.post_order_visit(
+            func, lambda expr: calls.append(expr) if isinstance(expr, relay.Call) else None
+        )
+        return len(calls)
+
+    model = Model()
+    m_x = raf.array(raf.testing.randn((256, 256))[1], device="cpu")
+    mod = model._internal(m_x).mod
+    # The peak is x and a_1 to a_5, which are 0.25 MBs each, so one of them has to be
+    # rematerialized to fit into the budget.
+    config = dict(ROOFLINE_CONFIG)
+    config["raf.memory_budget"] = int(1.25 * 1048576)
+    config["raf.remat.cost_model"] = "roofline"
+    with raf.Device("cpu"):
+        with raf.ir.PassContext(config=config):
+            mod = raf._ffi.pass_.InferType()(mod)
+            num_calls = count_calls(mod["main"])
+            mod = raf._ffi.pass_.Rematerialization()(mod)
+    assert count_calls(mod["main"]) > num_calls, raf.ir.AsText(mod["main"])
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
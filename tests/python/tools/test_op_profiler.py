@@ -2,10 +2,14 @@
 # SPDX-License-Identifier: Apache-2.0
 
 # pylint: disable=no-self-use,protected-access
+import os
+import tempfile
+
 import pytest
 
 import raf
 from raf._ffi.op_profiler import Profile, ProfileGroup, ResetCache, GetCacheSize
+from raf._ffi.op_profiler import ExportLatencyDB, ImportLatencyDB
 from raf.testing import get_testable_devices, run_infer_type, randn
 
 
@@ -87,6 +91,28 @@ def test_closure(device_str):
     assert GetCacheSize(device) == 1
 
 
+@pytest.mark.parametrize("device_str", get_testable_devices())
+def test_latency_db(device_str):
+    data = raf.ir.var("x", shape=(8, 24))
+    expr = raf.ir.op.log_softmax(data, 0)
+    expr = run_infer_type(expr).body
+    device = raf.Device(device_str)
+
+    ResetCache(device)
+    lat = [v.value for v in Profile(expr, device, 1, 1, 3)["latency"]]
+
+    # The measurement is reused from the database after the in-memory cache is reset.
+    ResetCache(device)
+    assert [v.value for v in Profile(expr, device, 1, 1, 3)["latency"]] == lat
+    assert GetCacheSize(device) == 1
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        path = os.path.join(temp_dir, "op_latency.db")
+        assert ExportLatencyDB(path) >= 1
+        # All entries are already in the database.
+        assert ImportLatencyDB(path) == 0
+
+
 @pytest.mark.skipif(not raf.build.with_cuda(), reason="CUDA is not enabled")
 def test_workspace():
     data = raf.ir.var("x", shape=(2, 3, 14, 14))